@@ -33,21 +33,61 @@
 #define BCAST_ID        (0x7F7)
 
 #define CAN_FLAG_GOTDUMMY   (1)
-// incoming message buffer size
-#define CAN_INMESSAGE_SIZE  (6)
+#define CAN_INMESSAGE_MASK  (CAN_INMESSAGE_SIZE - 1)
+// max filter match index: 4 16-bit IDs in each bank
+#define CAN_FMI_MAX         (4 * CAN_FILTERS_AMOUNT)
 
 extern volatile uint32_t Tms;
 
-// circular buffer for  received messages
+// circular buffer for received messages: head is moved only by interrupt, tail - by pop
 static CAN_message messages[CAN_INMESSAGE_SIZE];
-static uint8_t first_free_idx = 0;    // index of first empty cell
-static int8_t first_nonfree_idx = -1; // index of first data cell
+static volatile uint16_t rxhead = 0, rxtail = 0;
+
+// filters configuration (restored after CAN reinit)
+typedef struct{
+    uint8_t mode;           // CAN_FILT_* flags
+    uint8_t N;              // amount of values (0 - bank is inactive)
+    uint32_t data[4];       // IDs or pairs ID/mask
+} filter_conf;
+static filter_conf filters[CAN_FILTERS_AMOUNT];
+static uint8_t userfilters = 0; // ==1 if filters were set by user (don't restore default)
+// bank 0 receives all frames while SLCAN gateway is opened; its previous configuration
+static uint8_t gwfilter = 0;
+static filter_conf gwsaved;
+// filter match index -> filter bank for each FIFO
+static uint8_t fmi2bank[2][CAN_FMI_MAX];
+
+// transmit queue: messages storage, their indexes sorted by priority and free cells
+static CAN_message txqueue[CAN_OUTMESSAGE_SIZE];
+static uint8_t txorder[CAN_OUTMESSAGE_SIZE], txfree[CAN_OUTMESSAGE_SIZE];
+static uint8_t txN = 0, txNfree = 0;
+// copy of messages in mailboxes, mailboxes busy & aborted for more important message
+static CAN_message txbox[3];
+static uint8_t txboxbusy = 0, txpreempt = 0;
+
+CAN_txcounters CAN_txstat;
+CAN_filtstat CAN_filterstat[CAN_FILTERS_AMOUNT];
+volatile uint32_t CAN_fifoovr[2] = {0, 0}; // hardware FIFOs overruns
+volatile uint8_t CAN_timestamp_ms = 0; // ==1 to timestamp received messages by Tms instead of CAN timer
+
+// current bit timing (BTR with SILM flag), bitrate & sample point
+static uint32_t btr = 0, bitrate = CAN_DEFSPEED;
+static uint16_t samplepoint = CAN_DEFSAMPLEPOINT;
+// standard bitrates for autodetection
+static const uint32_t stdrates[] = {1000000, 800000, 500000, 250000, 125000, 100000, 50000, 20000, 10000};
+#define STDRATES_AMOUNT     (sizeof(stdrates) / sizeof(stdrates[0]))
+// autodetection: index of bitrate checked (-1 if inactive), round, time of start
+static int8_t abidx = -1;
+static uint8_t abround = 0;
+static uint32_t abstart = 0;
 
 static uint16_t CANID = 0xFFFF;
 static uint32_t last_err_code = 0;
 static CAN_status can_status = CAN_STOP;
 
 static void can_process_fifo(uint8_t fifo_num);
+static void tx_refill();
+static void tx_abortall();
 
 CAN_status CAN_get_status(){
     CAN_status st = can_status;
@@ -56,34 +96,25 @@ CAN_status CAN_get_status(){
     return st;
 }
 
-// push next message into buffer; return 1 if buffer overfull
-static int CAN_messagebuf_push(CAN_message *msg){
-    MSG("Try to push\n");
-    if(first_free_idx == first_nonfree_idx) return 1; // no free space
-    if(first_nonfree_idx < 0) first_nonfree_idx = 0;  // first message in empty buffer
-    memcpy(&messages[first_free_idx++], msg, sizeof(CAN_message));
-    // need to roll?
-    if(first_free_idx == CAN_INMESSAGE_SIZE) first_free_idx = 0;
-    #ifdef EBUG
-    MSG("1st free: "); usart_putchar('0' + first_free_idx); newline();
-    #endif
-    return 0;
+/**
+ * @brief CAN_get_errors - get error status register
+ * @return CAN->ESR (LEC, error counters and flags)
+ */
+uint32_t CAN_get_errors(){
+    return CAN->ESR;
 }
 
-// pop message from buffer
-CAN_message *CAN_messagebuf_pop(){
-    if(first_nonfree_idx < 0) return NULL;
-    #ifdef EBUG
-    MSG("read from idx "); usart_putchar('0' + first_nonfree_idx); newline();
-    #endif
-    CAN_message *msg = &messages[first_nonfree_idx++];
-    if(first_nonfree_idx == CAN_INMESSAGE_SIZE) first_nonfree_idx = 0;
-    if(first_nonfree_idx == first_free_idx){ // buffer is empty - refresh it
-        first_nonfree_idx = -1;
-        first_free_idx = 0;
-        MSG("refresh buffer\n");
-    }
-    return msg;
+/**
+ * @brief CAN_messagebuf_pop - get next received message
+ * @param msg - message (copied out of buffer as interrupt can rewrite it)
+ * @return 1 if got message, 0 if buffer is empty
+ */
+int CAN_messagebuf_pop(CAN_message *msg){
+    uint16_t t = rxtail;
+    if(t == rxhead) return 0;
+    memcpy(msg, &messages[t], sizeof(CAN_message));
+    rxtail = (t + 1) & CAN_INMESSAGE_MASK;
+    return 1;
 }
 
 // get CAN address data from GPIO pins
@@ -97,14 +128,405 @@ uint16_t getCANID(){
     return CANID;
 }
 
-void CAN_reinit(){
-    readCANID();
-    CAN->TSR |= CAN_TSR_ABRQ0 | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2;
+// reset CAN peripheral and set it up again (with current timing & filters)
+static void can_restart(){
+    // request abort for all mailboxes
+    tx_abortall();
     RCC->APB1RSTR |= RCC_APB1RSTR_CANRST;
     RCC->APB1RSTR &= ~RCC_APB1RSTR_CANRST;
     CAN_setup();
 }
 
+void CAN_reinit(){
+    readCANID();
+    can_restart();
+}
+
+// filter element for 16-bit scale: STDID[10:0], RTR, IDE, EXID[17:15]
+// (extended IDs are compared only by 14 most significant bits)
+static uint32_t filt16(uint32_t val, uint8_t ismask){
+    uint32_t e, id = val & CAN_MSG_IDMASK;
+    if(val & CAN_MSG_EXT) e = (id >> 18) << 5 | 1 << 3 | ((id >> 15) & 7);
+    else e = (id & 0x7ff) << 5;
+    if(val & CAN_MSG_RTR) e |= 1 << 4;
+    if(ismask) e |= 1 << 3; // IDE should match
+    return e;
+}
+
+// filter element for 32-bit scale: STDID[10:0]/EXID[28:0], IDE, RTR
+static uint32_t filt32(uint32_t val, uint8_t ismask){
+    uint32_t e;
+    if(val & CAN_MSG_EXT) e = ((val & CAN_MSG_IDMASK) << 3) | CAN_RI0R_IDE;
+    else e = (val & 0x7ff) << 21;
+    if(val & CAN_MSG_RTR) e |= CAN_RI0R_RTR;
+    if(ismask) e |= CAN_RI0R_IDE; // IDE should match
+    return e;
+}
+
+/**
+ * @brief filter_program - write bank configuration into filter registers
+ * should be called when FINIT is set
+ * @param bank - filter bank number
+ */
+static void filter_program(uint8_t bank){
+    filter_conf *f = &filters[bank];
+    uint32_t bit = 1 << bank, e[4];
+    CAN->FA1R &= ~bit;
+    if(f->mode & CAN_FILT_LIST) CAN->FM1R |= bit;
+    else CAN->FM1R &= ~bit;
+    if(f->mode & CAN_FILT_32BIT) CAN->FS1R |= bit;
+    else CAN->FS1R &= ~bit;
+    if(f->mode & CAN_FILT_FIFO1) CAN->FFA1R |= bit;
+    else CAN->FFA1R &= ~bit;
+    if(!f->N) return;
+    // fill unused cells by repeating values given: the same IDs or pairs ID/mask
+    for(int i = 0; i < 4; ++i){
+        uint8_t ismask = !(f->mode & CAN_FILT_LIST) && (i & 1);
+        uint32_t val = f->data[i % f->N];
+        e[i] = (f->mode & CAN_FILT_32BIT) ? filt32(val, ismask) : filt16(val, ismask);
+    }
+    if(f->mode & CAN_FILT_32BIT){
+        CAN->sFilterRegister[bank].FR1 = e[0];
+        CAN->sFilterRegister[bank].FR2 = e[1];
+    }else{
+        CAN->sFilterRegister[bank].FR1 = e[0] | e[1] << 16;
+        CAN->sFilterRegister[bank].FR2 = e[2] | e[3] << 16;
+    }
+    CAN->FA1R |= bit;
+}
+
+/**
+ * @brief fmi_remap - refresh filter match index to bank conversion table
+ * filters are numbered for each FIFO in order of banks (both active and inactive),
+ * each bank takes 1 (32-bit mask), 2 (32-bit list or 16-bit mask) or 4 (16-bit list) numbers
+ */
+static void fmi_remap(){
+    uint8_t idx[2] = {0, 0};
+    for(uint8_t b = 0; b < CAN_FILTERS_AMOUNT; ++b){
+        uint32_t bit = 1 << b;
+        uint8_t fifo = (CAN->FFA1R & bit) ? 1 : 0, n = (CAN->FS1R & bit) ? 1 : 2;
+        if(CAN->FM1R & bit) n *= 2;
+        while(n-- && idx[fifo] < CAN_FMI_MAX) fmi2bank[fifo][idx[fifo]++] = b;
+    }
+}
+
+// default bank 0: our ID and broadcast
+static void filter_default(filter_conf *f){
+    f->mode = CAN_FILT_LIST;
+    f->N = 2;
+    f->data[0] = CANID;
+    f->data[1] = BCAST_ID;
+}
+
+// all standard & extended frames: pairs ID/mask
+static void filter_acceptall(filter_conf *f){
+    f->mode = 0;
+    f->N = 4;
+    f->data[0] = f->data[1] = 0;
+    f->data[2] = f->data[3] = CAN_MSG_EXT;
+}
+
+// write new configuration of bank into hardware
+static void bank_reprogram(uint8_t bank){
+    NVIC_DisableIRQ(CEC_CAN_IRQn);
+    CAN->FMR |= CAN_FMR_FINIT;
+    filter_program(bank);
+    CAN->FMR &= ~CAN_FMR_FINIT;
+    fmi_remap();
+    NVIC_EnableIRQ(CEC_CAN_IRQn);
+}
+
+/**
+ * @brief CAN_setfilter - set filter bank configuration in runtime
+ * @param bank - bank number (0..CAN_FILTERS_AMOUNT-1)
+ * @param mode - CAN_FILT_* flags
+ * @param N - amount of values (0 to deactivate bank): 1..4 IDs for 16-bit list,
+ *      1..2 IDs for 32-bit list, 2 or 4 (ID, mask) for 16-bit mask and 2 for 32-bit mask
+ * @param data - IDs or pairs ID/mask (with CAN_MSG_EXT and CAN_MSG_RTR flags)
+ * @return 0 if all OK
+ */
+int CAN_setfilter(uint8_t bank, uint8_t mode, uint8_t N, const uint32_t *data){
+    uint8_t Nmax = (mode & CAN_FILT_32BIT) ? 2 : 4;
+    if(bank >= CAN_FILTERS_AMOUNT || N > Nmax) return 1;
+    if(!(mode & CAN_FILT_LIST) && (N & 1)) return 1; // need pairs
+    filter_conf *f = &filters[bank];
+    f->mode = mode;
+    f->N = N;
+    for(uint8_t i = 0; i < N; ++i) f->data[i] = data[i];
+    userfilters = 1;
+    if(bank == 0) gwfilter = 0; // user's bank 0 won't be replaced on gateway closing
+    bank_reprogram(bank);
+    return 0;
+}
+
+/**
+ * @brief CAN_gwfilter - receive all frames by bank 0 while SLCAN gateway is opened
+ * (user filters flag isn't changed, so default bank 0 still follows CAN ID)
+ * @param on - 1 to save bank 0 and accept all, 0 to restore bank 0 (or default)
+ */
+void CAN_gwfilter(uint8_t on){
+    filter_conf *f = &filters[0];
+    if(on){
+        if(!gwfilter) gwsaved = *f;
+        gwfilter = 1;
+        filter_acceptall(f);
+    }else{
+        if(!gwfilter) return;
+        gwfilter = 0;
+        if(userfilters) *f = gwsaved;
+        else filter_default(f);
+    }
+    bank_reprogram(0);
+}
+
+// get number from string `str`, omit leading spaces; @return pointer to next symbol or NULL if no number
+static const char *getnum(const char *str, uint32_t *N, uint8_t base){
+    uint32_t val = 0;
+    const char *start;
+    while(*str == ' ') ++str;
+    if(base == 16 && str[0] == '0' && (str[1] == 'x' || str[1] == 'X')) str += 2;
+    start = str;
+    for(;; ++str){
+        char c = *str;
+        if(c >= '0' && c <= '9') c -= '0';
+        else if(base == 16 && c >= 'a' && c <= 'f') c -= 'a' - 10;
+        else if(base == 16 && c >= 'A' && c <= 'F') c -= 'A' - 10;
+        else break;
+        val = val * base + (uint32_t)c;
+    }
+    if(str == start) return NULL;
+    *N = val;
+    return str;
+}
+
+/**
+ * @brief CAN_filtercmd - set filter by text command
+ * @param str - "F bank" to deactivate bank or "F bank fifo mode ID0 [ID1 ...]", where
+ *  mode: L - list, M - pairs ID/mask; X after it - 32-bit scale (extended IDs > 0x7ff);
+ *  IDs are hex, R after ID - remote frame
+ */
+void CAN_filtercmd(const char *str){
+    uint32_t bank, fifo, data[4];
+    uint8_t mode = 0, N = 0;
+    const char *p = getnum(str + 1, &bank, 10);
+    if(!p || bank >= CAN_FILTERS_AMOUNT) goto bad;
+    while(*p == ' ') ++p;
+    if(*p == '\n' || *p == 0){
+        CAN_setfilter(bank, 0, 0, NULL);
+        SEND("Filter deactivated\n");
+        return;
+    }
+    if(!(p = getnum(p, &fifo, 10)) || fifo > 1) goto bad;
+    if(fifo) mode |= CAN_FILT_FIFO1;
+    while(*p == ' ') ++p;
+    if(*p == 'L') mode |= CAN_FILT_LIST;
+    else if(*p != 'M') goto bad;
+    if(*(++p) == 'X'){
+        mode |= CAN_FILT_32BIT;
+        ++p;
+    }
+    while(N < 4 && (p = getnum(p, &data[N], 16))){
+        if(*p == 'R'){
+            data[N] |= CAN_MSG_RTR;
+            ++p;
+        }
+        if((data[N] & CAN_MSG_IDMASK) > 0x7ff) data[N] |= CAN_MSG_EXT;
+        ++N;
+    }
+    if(!N || CAN_setfilter(bank, mode, N, data)) goto bad;
+    SEND("Filter set\n");
+    return;
+bad:
+    SEND("Wrong filter; format: F bank [fifo L|M[X] ID0 [ID1 ...]]\n");
+}
+
+/**
+ * @brief CAN_showfilters - print filters configuration and statistics
+ */
+void CAN_showfilters(){
+    for(uint8_t b = 0; b < CAN_FILTERS_AMOUNT; ++b){
+        filter_conf *f = &filters[b];
+        if(!f->N && !CAN_filterstat[b].hits) continue;
+        SEND("Filter "); printu(b);
+        if(f->N){
+            SEND(": FIFO"); usart_putchar((f->mode & CAN_FILT_FIFO1) ? '1' : '0');
+            SEND((f->mode & CAN_FILT_LIST) ? " list" : " mask");
+            SEND((f->mode & CAN_FILT_32BIT) ? "32" : "16");
+            for(uint8_t i = 0; i < f->N; ++i){
+                usart_putchar(' ');
+                printuhex(f->data[i] & CAN_MSG_IDMASK);
+                if(f->data[i] & CAN_MSG_RTR) usart_putchar('R');
+            }
+        }else SEND(": inactive");
+        SEND(", hits="); printu(CAN_filterstat[b].hits);
+        SEND(", overruns="); printu(CAN_filterstat[b].overruns);
+        newline();
+    }
+    SEND("FIFO overruns: "); printu(CAN_fifoovr[0]);
+    SEND(", "); printu(CAN_fifoovr[1]);
+    newline();
+}
+
+/**
+ * @brief CAN_calctiming - calculate bit timing
+ * Bit consists of N = 1 + BS1 + BS2 time quanta (8..25), sample point is after BS1.
+ * Solution with the least bitrate error is chosen, then with the nearest sample point, then
+ * with the greatest N (finer resynchronization).
+ * @param pclk - APB clock (Hz)
+ * @param br - bitrate (bit/s)
+ * @param sp - sample point (1/1000 of bit)
+ * @param t (o) - timing
+ * @return 0 if found timing with bitrate error not more than CAN_MAXBRERR
+ */
+int CAN_calctiming(uint32_t pclk, uint32_t br, uint16_t sp, CAN_timing *t){
+    uint32_t bestbr = UINT32_MAX, bestsp = UINT32_MAX;
+    if(!br || br > 1000000 || sp < 500 || sp > 950) return 1;
+    for(uint32_t N = 25; N >= 8; --N){
+        uint32_t div = br * N, p = (pclk + div / 2) / div;
+        if(p < 1 || p > 1024) continue;
+        uint32_t real = pclk / (p * N), diff = (real > br) ? real - br : br - real;
+        if(diff > br / 100) continue;
+        uint32_t brerr = diff * 10000 / br;
+        if(brerr > CAN_MAXBRERR) continue;
+        // BS2 less than 2tq leaves no time for information processing
+        int32_t bs1 = (int32_t)((sp * N + 500) / 1000) - 1, bs2 = (int32_t)N - 1 - bs1;
+        if(bs2 < 2) bs2 = 2;
+        else if(bs2 > 8) bs2 = 8;
+        bs1 = (int32_t)N - 1 - bs2;
+        if(bs1 < 1 || bs1 > 16) continue;
+        int32_t d = 1000 * (1 + bs1) - (int32_t)(sp * N);
+        uint32_t sperr = (d < 0 ? -d : d) * 100 / N;
+        if(brerr < bestbr || (brerr == bestbr && sperr < bestsp)){
+            bestbr = brerr;
+            bestsp = sperr;
+            t->prescaler = p;
+            t->bs1 = bs1;
+            t->bs2 = bs2;
+            t->sjw = (bs2 < 4) ? bs2 : 4;
+        }
+    }
+    return bestbr == UINT32_MAX;
+}
+
+static uint32_t timing2btr(const CAN_timing *t){
+    return (uint32_t)(t->sjw - 1) << 24 | (uint32_t)(t->bs2 - 1) << 20 | (uint32_t)(t->bs1 - 1) << 16 | (t->prescaler - 1);
+}
+
+/**
+ * @brief CAN_setspeed - change bitrate (CAN is reinitialized, messages in mailboxes are lost)
+ * @param br - bitrate (bit/s)
+ * @param sp - sample point (1/1000 of bit)
+ * @return 0 if OK
+ */
+int CAN_setspeed(uint32_t br, uint16_t sp){
+    CAN_timing t;
+    if(CAN_calctiming(CAN_PCLK, br, sp, &t)) return 1;
+    // autodetection ends in normal mode
+    uint32_t silent = (abidx > -1) ? 0 : (btr & CAN_BTR_SILM);
+    abidx = -1;
+    btr = timing2btr(&t) | silent;
+    bitrate = br;
+    samplepoint = sp;
+    can_restart();
+    return 0;
+}
+
+uint32_t CAN_getspeed(){
+    return bitrate;
+}
+
+/**
+ * @brief CAN_setsilent - turn silent (listen only) mode on or off
+ * @param silent - ==1 to turn on
+ */
+void CAN_setsilent(uint8_t silent){
+    uint32_t b = silent ? (btr | CAN_BTR_SILM) : (btr & ~CAN_BTR_SILM);
+    if(b == btr) return;
+    btr = b;
+    can_restart();
+}
+
+// try next bitrate in autodetection mode
+static void ab_try(){
+    CAN_timing t;
+    CAN_calctiming(CAN_PCLK, stdrates[abidx], samplepoint, &t);
+    btr = timing2btr(&t) | CAN_BTR_SILM;
+    can_restart();
+    CAN->ESR = CAN_ESR_LEC; // LEC = 7: hardware will clear it after first frame received without errors
+    abstart = Tms;
+}
+
+/**
+ * @brief CAN_autobaud - start bitrate autodetection: each standard bitrate is listened in
+ * silent mode until some message received without errors (at least one more node should
+ * acknowledge it). Normal mode is restored after detection.
+ */
+void CAN_autobaud(){
+    abidx = 0;
+    abround = 0;
+    ab_try();
+}
+
+// check autodetection result; @return 1 if it is still active
+static int ab_proc(){
+    if(abidx < 0) return 0;
+    uint32_t lec = CAN->ESR & CAN_ESR_LEC;
+    if(lec == 0){ // got message
+        uint32_t br = stdrates[abidx];
+        CAN_setspeed(br, samplepoint);
+        SEND("Bitrate detected: "); printu(br);
+        newline();
+        return 0;
+    }
+    if(Tms - abstart < CAN_AUTOBAUD_MS) return 1;
+    if(++abidx == STDRATES_AMOUNT){
+        abidx = 0;
+        if(++abround == CAN_AUTOBAUD_ROUNDS){
+            CAN_setspeed(bitrate, samplepoint); // restore previous
+            SEND("Bitrate not detected\n");
+            return 0;
+        }
+    }
+    ab_try();
+    return 1;
+}
+
+/**
+ * @brief CAN_speedcmd - process command "b kbps [samplepoint]" (samplepoint is in 1/1000)
+ */
+void CAN_speedcmd(const char *str){
+    uint32_t br, sp = samplepoint;
+    const char *p = getnum(str + 1, &br, 10);
+    if(!p || br == 0 || br > 1000) goto bad;
+    while(*p == ' ') ++p;
+    if(*p != '\n' && *p != 0 && !getnum(p, &sp, 10)) goto bad;
+    if(sp > 1000 || CAN_setspeed(br * 1000, sp)) goto bad;
+    CAN_showtiming();
+    return;
+bad:
+    SEND("Wrong bitrate; format: b kbps [samplepoint/1000]\n");
+}
+
+/**
+ * @brief CAN_showtiming - print current bitrate and bit timing
+ */
+void CAN_showtiming(){
+    uint32_t b = CAN->BTR;
+    if(abidx > -1){
+        SEND("Autodetection, trying "); printu(stdrates[abidx]);
+        newline();
+        return;
+    }
+    SEND("Bitrate="); printu(bitrate);
+    SEND(", sample point="); printu(samplepoint);
+    SEND(", prescaler="); printu((b & CAN_BTR_BRP) + 1);
+    SEND(", BS1="); printu(((b & CAN_BTR_TS1) >> 16) + 1);
+    SEND(", BS2="); printu(((b & CAN_BTR_TS2) >> 20) + 1);
+    SEND(", SJW="); printu(((b & CAN_BTR_SJW) >> 24) + 1);
+    if(b & CAN_BTR_SILM) SEND(", silent");
+    newline();
+}
+
 void CAN_setup(){
     uint32_t tmout = 16000000;
     if(CANID == 0xFFFF) readCANID();
@@ -121,38 +543,45 @@ void CAN_setup(){
     /* (1) Enter CAN init mode to write the configuration */
     /* (2) Wait the init mode entering */
     /* (3) Exit sleep mode */
-    /* (4) Loopback mode, set timing to 100kb/s: BS1 = 4, BS2 = 3, prescaler = 60 */
+    /* (4) Set bit timing (default is CAN_DEFSPEED) & silent mode if needed */
     /* (5) Leave init mode */
     /* (6) Wait the init mode leaving */
-    /* (7) Enter filter init mode, (16-bit + mask, filter 0 for FIFO 0) */
-    /* (8) Acivate filter 0 for two IDs */
-    /* (9) Identifier list mode */
-    /* (10) Set the Id list */
-    /* (12) Leave filter init */
-    /* (13) Set error interrupts enable */
+    /* (7) Enter filter init mode */
+    /* (8) Program all filter banks (by default bank 0 receives our ID and broadcast) */
+    /* (9) Leave filter init */
+    /* (10) Set receive, transmit & error interrupts enable */
     CAN->MCR |= CAN_MCR_INRQ; /* (1) */
     while((CAN->MSR & CAN_MSR_INAK)!=CAN_MSR_INAK) /* (2) */
     {
         if(--tmout == 0) break;
     }
     CAN->MCR &=~ CAN_MCR_SLEEP; /* (3) */
-    CAN->MCR |= CAN_MCR_ABOM;
+    CAN->MCR |= CAN_MCR_ABOM | CAN_MCR_TTCM; // TTCM - timestamps in RDTR
 
-    CAN->BTR |=  2 << 20 | 3 << 16 | 59 << 0; /* (4) */
+    if(!btr){
+        CAN_timing t;
+        CAN_calctiming(CAN_PCLK, bitrate, samplepoint, &t);
+        btr = timing2btr(&t);
+    }
+    CAN->BTR = btr; /* (4) */
     CAN->MCR &=~ CAN_MCR_INRQ; /* (5) */
     tmout = 16000000;
     while((CAN->MSR & CAN_MSR_INAK)==CAN_MSR_INAK) /* (6) */
     {
         if(--tmout == 0) break;
     }
+    if(!userfilters){
+        memset(filters, 0, sizeof(filters));
+        filter_default(&filters[0]);
+    }
+    if(gwfilter) filter_acceptall(&filters[0]);
     CAN->FMR = CAN_FMR_FINIT; /* (7) */
-    CAN->FA1R = CAN_FA1R_FACT0; /* (8) */
-    CAN->FM1R = CAN_FM1R_FBM0; /* (9) */
-    CAN->sFilterRegister[0].FR1 = CANID << 5 | ((BCAST_ID << 5) << 16); /* (10) */
-
-    CAN->FMR &=~ CAN_FMR_FINIT; /* (12) */
-    CAN->IER |= CAN_IER_ERRIE | CAN_IER_FOVIE0 | CAN_IER_FOVIE1; /* (13) */
+    for(uint8_t i = 0; i < CAN_FILTERS_AMOUNT; ++i) filter_program(i); /* (8) */
+    CAN->FMR &=~ CAN_FMR_FINIT; /* (9) */
+    fmi_remap();
+    CAN->IER |= CAN_IER_ERRIE | CAN_IER_FOVIE0 | CAN_IER_FOVIE1 | CAN_IER_FMPIE0 | CAN_IER_FMPIE1 | CAN_IER_TMEIE; /* (10) */
 
+    tx_refill(); // continue transmission of queued messages
     /* Configure IT */
     /* (14) Set priority for CAN_IRQn */
     /* (15) Enable CAN_IRQn */
@@ -162,6 +591,7 @@ void CAN_setup(){
 }
 
 void can_proc(){
+    if(ab_proc()) return; // errors are normal while bitrate isn't found
     if(last_err_code){
 #ifdef EBUG
         MSG("Error, ESR=");
@@ -170,21 +600,9 @@ void can_proc(){
 #endif
         last_err_code = 0;
     }
-    // check for messages in FIFO0 & FIFO1
-    if(CAN->RF0R & CAN_RF0R_FMP0){
-        can_process_fifo(0);
-    }
-    if(CAN->RF1R & CAN_RF1R_FMP1){
-        can_process_fifo(1);
-    }
     if(CAN->ESR & (CAN_ESR_BOFF | CAN_ESR_EPVF | CAN_ESR_EWGF)){ // much errors - restart CAN BUS
         MSG("bus-off, restarting\n");
-        // request abort for all mailboxes
-        CAN->TSR |= CAN_TSR_ABRQ0 | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2;
-        // reset CAN bus
-        RCC->APB1RSTR |= RCC_APB1RSTR_CANRST;
-        RCC->APB1RSTR &= ~RCC_APB1RSTR_CANRST;
-        CAN_setup();
+        can_restart();
     }
     LED_off(LED1);
 #if 0
@@ -214,54 +632,173 @@ void can_proc(){
 #endif
 }
 
-CAN_status can_send(uint8_t *msg, uint8_t len, uint16_t target_id){
-    uint8_t mailbox = 0;
-    // check first free mailbox
-    if(CAN->TSR & (CAN_TSR_TME)){
-        mailbox = (CAN->TSR & CAN_TSR_CODE) >> 24;
-        #ifdef EBUG
-        MSG("select "); usart_putchar('0'+mailbox); SEND(" mailbox\n");
-        #endif
-    }else{ // no free mailboxes
-        return CAN_BUSY;
-    }
-    CAN_TxMailBox_TypeDef *box = &CAN->sTxMailBox[mailbox];
-    uint32_t lb = 0, hb = 0;
-    switch(len){
-        case 8:
-            hb |= (uint32_t)msg[7] << 24;
-            __attribute__((fallthrough));
-        case 7:
-            hb |= (uint32_t)msg[6] << 16;
-            __attribute__((fallthrough));
-        case 6:
-            hb |= (uint32_t)msg[5] << 8;
-            __attribute__((fallthrough));
-        case 5:
-            hb |= (uint32_t)msg[4];
-            __attribute__((fallthrough));
-        case 4:
-            lb |= (uint32_t)msg[3] << 24;
-            __attribute__((fallthrough));
-        case 3:
-            lb |= (uint32_t)msg[2] << 16;
-            __attribute__((fallthrough));
-        case 2:
-            lb |= (uint32_t)msg[1] << 8;
-            __attribute__((fallthrough));
-        default:
-            lb |= (uint32_t)msg[0];
-    }
-    box->TDLR = lb;
-    box->TDHR = hb;
-    box->TDTR = len;
-    box->TIR  = (target_id & 0x7FF) << 21 | CAN_TI0R_TXRQ;
-    return CAN_OK;
+/**
+ * @brief txkey - arbitration priority of message (less is more important)
+ * bits: 31..21 - base ID, 20 - RTR (SRR for extended), 19 - IDE, 18..1 - extended ID, 0 - RTR of extended
+ * @param ID - identifier with flags
+ */
+static uint32_t txkey(uint32_t ID){
+    uint32_t k, id = ID & CAN_MSG_IDMASK;
+    if(ID & CAN_MSG_EXT){
+        k = (id >> 18) << 21 | 3 << 19 | (id & 0x3ffff) << 1;
+        if(ID & CAN_MSG_RTR) k |= 1;
+    }else{
+        k = (id & 0x7ff) << 21;
+        if(ID & CAN_MSG_RTR) k |= 1 << 20;
+    }
+    return k;
+}
+
+/**
+ * @brief tx_insert - put message into transmit queue
+ * @param m - message
+ * @param first - ==1 to put before messages with the same priority (returned from mailbox)
+ * @return 0 if all OK or 1 if queue is full
+ */
+static int tx_insert(const CAN_message *m, uint8_t first){
+    if(txNfree == 0){
+        if(txN == 0){ // first run: all cells are free
+            for(uint8_t i = 0; i < CAN_OUTMESSAGE_SIZE; ++i) txfree[i] = i;
+            txNfree = CAN_OUTMESSAGE_SIZE;
+        }else return 1;
+    }
+    uint32_t k = txkey(m->ID);
+    uint8_t pos = 0, idx = txfree[--txNfree];
+    while(pos < txN){
+        uint32_t kq = txkey(txqueue[txorder[pos]].ID);
+        if(kq > k || (first && kq == k)) break;
+        ++pos;
+    }
+    memmove(&txorder[pos + 1], &txorder[pos], txN - pos);
+    txorder[pos] = idx;
+    memcpy(&txqueue[idx], m, sizeof(CAN_message));
+    ++txN;
+    return 0;
+}
+
+// write message into mailbox and request transmission
+static void tx_load(uint8_t mb, const CAN_message *m){
+    CAN_TxMailBox_TypeDef *box = &CAN->sTxMailBox[mb];
+    uint32_t dat[2], tir;
+    memcpy(dat, m->data, 8);
+    if(m->ID & CAN_MSG_EXT) tir = ((m->ID & CAN_MSG_IDMASK) << 3) | CAN_TI0R_IDE;
+    else tir = (m->ID & 0x7FF) << 21;
+    if(m->ID & CAN_MSG_RTR) tir |= CAN_TI0R_RTR;
+    box->TDLR = dat[0];
+    box->TDHR = dat[1];
+    box->TDTR = m->length;
+    box->TIR  = tir | CAN_TI0R_TXRQ;
+}
+
+/**
+ * @brief tx_complete - check mailboxes with completed requests: count sent/aborted messages,
+ *      return messages aborted to send more important into queue
+ */
+static void tx_complete(){
+    uint32_t tsr = CAN->TSR;
+    for(uint8_t b = 0; b < 3; ++b){
+        uint32_t rqcp = CAN_TSR_RQCP0 << (8*b), bit = 1 << b;
+        if(!(tsr & rqcp)) continue;
+        CAN->TSR = rqcp; // clear RQCP, TXOK, ALST & TERR
+        if(!(txboxbusy & bit)) continue;
+        txboxbusy &= ~bit;
+        if(tsr & (CAN_TSR_TXOK0 << (8*b))) ++CAN_txstat.sent;
+        else if(txpreempt & bit){
+            ++CAN_txstat.preempted;
+            if(tx_insert(&txbox[b], 1)) ++CAN_txstat.dropped;
+        }else ++CAN_txstat.aborted;
+        txpreempt &= ~bit;
+    }
+}
+
+/**
+ * @brief tx_refill - move the most important messages from queue into empty mailboxes;
+ *      if all mailboxes are busy by less important messages, abort the least important
+ */
+static void tx_refill(){
+    while(txN){
+        uint32_t tsr = CAN->TSR, k = txkey(txqueue[txorder[0]].ID);
+        uint8_t worst = 3;
+        uint32_t kworst = 0;
+        for(uint8_t b = 0; b < 3; ++b){
+            if(!(txboxbusy & (1 << b))) continue;
+            uint32_t kb = txkey(txbox[b].ID);
+            if(kb == k) return; // don't break order of messages with the same ID
+            if(kb > kworst && !(txpreempt & (1 << b))){
+                kworst = kb;
+                worst = b;
+            }
+        }
+        if(!(tsr & CAN_TSR_TME)){ // no empty mailboxes
+            if(worst < 3 && kworst > k && !txpreempt){
+                txpreempt |= 1 << worst;
+                CAN->TSR = CAN_TSR_ABRQ0 << (8*worst);
+            }
+            return;
+        }
+        uint8_t mb = (tsr & CAN_TSR_CODE) >> 24, idx = txorder[0];
+        if(txboxbusy & (1 << mb)) return; // completion isn't processed yet
+        memcpy(&txbox[mb], &txqueue[idx], sizeof(CAN_message));
+        txboxbusy |= 1 << mb;
+        --txN;
+        memmove(&txorder[0], &txorder[1], txN);
+        txfree[txNfree++] = idx;
+        tx_load(mb, &txbox[mb]);
+    }
+}
+
+// abort all transmissions before CAN reset: messages in mailboxes are lost
+static void tx_abortall(){
+    NVIC_DisableIRQ(CEC_CAN_IRQn);
+    tx_complete();
+    CAN->TSR = CAN_TSR_ABRQ0 | CAN_TSR_ABRQ1 | CAN_TSR_ABRQ2;
+    for(uint8_t b = 0; b < 3; ++b) if(txboxbusy & (1 << b)) ++CAN_txstat.aborted;
+    txboxbusy = 0;
+    txpreempt = 0;
+}
+
+/**
+ * @brief can_send - put message into transmit queue
+ * @param msg - data (could be NULL for RTR or empty message)
+ * @param len - data length
+ * @param target_id - identifier with CAN_MSG_EXT and CAN_MSG_RTR flags
+ * @return CAN_OK or CAN_BUSY if queue is full
+ */
+CAN_status can_send(const uint8_t *msg, uint8_t len, uint32_t target_id){
+    CAN_message m;
+    CAN_status ret = CAN_OK;
+    if(len > 8) len = 8;
+    memset(m.data, 0, 8);
+    if(msg && !(target_id & CAN_MSG_RTR)) memcpy(m.data, msg, len);
+    m.ID = target_id;
+    m.length = len;
+    NVIC_DisableIRQ(CEC_CAN_IRQn);
+    if(tx_insert(&m, 0)){
+        ++CAN_txstat.dropped;
+        ret = CAN_BUSY;
+    }else ++CAN_txstat.queued;
+    tx_complete();
+    tx_refill();
+    NVIC_EnableIRQ(CEC_CAN_IRQn);
+    return ret;
+}
+
+/**
+ * @brief CAN_showtx - print transmit statistics
+ */
+void CAN_showtx(){
+    SEND("TX queued="); printu(CAN_txstat.queued);
+    SEND(", sent="); printu(CAN_txstat.sent);
+    SEND(", aborted="); printu(CAN_txstat.aborted);
+    SEND(", preempted="); printu(CAN_txstat.preempted);
+    SEND(", dropped="); printu(CAN_txstat.dropped);
+    SEND(", in queue="); printu(txN);
+    newline();
 }
 
 void can_send_dummy(){
     uint8_t msg = CMD_TOGGLE;
-    if(CAN_OK != can_send(&msg, 1, TARG_ID)) SEND("Bus busy!\n");
+    if(CAN_OK != can_send(&msg, 1, TARG_ID)) SEND("Transmit queue is full!\n");
     MSG("CAN->MSR: ");
     printuhex(CAN->MSR); newline();
     MSG("CAN->TSR: ");
@@ -272,80 +809,71 @@ void can_send_dummy(){
 
 void can_send_broadcast(){
     uint8_t msg = CMD_BCAST;
-    if(CAN_OK != can_send(&msg, 1, BCAST_ID)) SEND("Bus busy!\n");
+    if(CAN_OK != can_send(&msg, 1, BCAST_ID)) SEND("Transmit queue is full!\n");
     MSG("Broadcast message sent\n");
 }
 
+/**
+ * @brief can_process_fifo - move all messages from FIFO into receive ring
+ * called from interrupt
+ * @param fifo_num - FIFO number
+ */
 static void can_process_fifo(uint8_t fifo_num){
     if(fifo_num > 1) return;
-    LED_on(LED1); // Toggle LED1
+    LED_on(LED1);
     CAN_FIFOMailBox_TypeDef *box = &CAN->sFIFOMailBox[fifo_num];
     volatile uint32_t *RFxR = (fifo_num) ? &CAN->RF1R : &CAN->RF0R;
-    MSG("Receive, RDTR=");
-    #ifdef EBUG
-    printuhex(box->RDTR);
-    newline();
-    #endif
-    // read all
     while(*RFxR & CAN_RF0R_FMP0){ // amount of messages pending
         // CAN_RDTxR: (16-31) - timestamp, (8-15) - filter match index, (0-3) - data length
-        /* TODO: check filter match index if more than one ID can receive */
-        CAN_message msg;
-        uint8_t *dat = msg.data;
-        uint8_t len = box->RDTR & 0x7;
-        msg.length = len;
-        if(len){ // message can be without data
-            uint32_t hb = box->RDHR, lb = box->RDLR;
-            switch(len){
-                case 8:
-                    dat[7] = hb>>24;
-                    __attribute__((fallthrough));
-                case 7:
-                    dat[6] = (hb>>16) & 0xff;
-                    __attribute__((fallthrough));
-                case 6:
-                    dat[5] = (hb>>8) & 0xff;
-                    __attribute__((fallthrough));
-                case 5:
-                    dat[4] = hb & 0xff;
-                    __attribute__((fallthrough));
-                case 4:
-                    dat[3] = lb>>24;
-                    __attribute__((fallthrough));
-                case 3:
-                    dat[2] = (lb>>16) & 0xff;
-                    __attribute__((fallthrough));
-                case 2:
-                    dat[1] = (lb>>8) & 0xff;
-                    __attribute__((fallthrough));
-                case 1:
-                    dat[0] = lb & 0xff;
-            }
+        uint32_t rdtr = box->RDTR, rir = box->RIR;
+        uint8_t fmi = (rdtr >> 8) & 0xff;
+        uint8_t bank = (fmi < CAN_FMI_MAX) ? fmi2bank[fifo_num][fmi] : 0;
+        uint16_t h = rxhead, next = (h + 1) & CAN_INMESSAGE_MASK;
+        if(next == rxtail){ // buffer is full: message lost
+            ++CAN_filterstat[bank].overruns;
+            can_status = CAN_FIFO_OVERRUN;
+        }else{
+            CAN_message *msg = &messages[h];
+            uint32_t dat[2] = {box->RDLR, box->RDHR};
+            uint8_t len = rdtr & 0xf;
+            if(len > 8) len = 8;
+            if(rir & CAN_RI0R_IDE) msg->ID = (rir >> 3) | CAN_MSG_EXT;
+            else msg->ID = rir >> 21;
+            if(rir & CAN_RI0R_RTR) msg->ID |= CAN_MSG_RTR;
+            msg->timestamp = CAN_timestamp_ms ? Tms % 60000 : rdtr >> 16;
+            msg->filter = bank;
+            msg->length = len;
+            memcpy(msg->data, dat, 8);
+            rxhead = next;
+            ++CAN_filterstat[bank].hits;
         }
-        if(CAN_messagebuf_push(&msg)) return; // error: buffer is full, try later
-        *RFxR |= CAN_RF0R_RFOM0; // release fifo for access to next message
+        *RFxR = CAN_RF0R_RFOM0; // release fifo for access to next message (other bits are rc_w1)
     }
-    if(*RFxR & CAN_RF0R_FULL0) *RFxR &= ~CAN_RF0R_FULL0;
 }
 
 void cec_can_isr(){
+    if(CAN->TSR & (CAN_TSR_RQCP0 | CAN_TSR_RQCP1 | CAN_TSR_RQCP2)){ // transmission done or aborted
+        tx_complete();
+        tx_refill();
+    }
+    if(CAN->RF0R & CAN_RF0R_FMP0) can_process_fifo(0);
+    if(CAN->RF1R & CAN_RF1R_FMP1) can_process_fifo(1);
     if(CAN->RF0R & CAN_RF0R_FOVR0){ // FIFO overrun
-        CAN->RF0R &= ~CAN_RF0R_FOVR0;
+        CAN->RF0R = CAN_RF0R_FOVR0;
+        ++CAN_fifoovr[0];
         can_status = CAN_FIFO_OVERRUN;
     }
     if(CAN->RF1R & CAN_RF1R_FOVR1){
-        CAN->RF1R &= ~CAN_RF1R_FOVR1;
+        CAN->RF1R = CAN_RF1R_FOVR1;
+        ++CAN_fifoovr[1];
         can_status = CAN_FIFO_OVERRUN;
     }
-    #ifdef EBUG
-    if(can_status == CAN_FIFO_OVERRUN) MSG("fifo 0 overrun\n");
-    #endif
     if(CAN->MSR & CAN_MSR_ERRI){ // Error
-        CAN->MSR &= ~CAN_MSR_ERRI;
+        CAN->MSR = CAN_MSR_ERRI;
         // request abort for problem mailbox
-        if(CAN->TSR & CAN_TSR_TERR0) CAN->TSR |= CAN_TSR_ABRQ0;
-        if(CAN->TSR & CAN_TSR_TERR1) CAN->TSR |= CAN_TSR_ABRQ1;
-        if(CAN->TSR & CAN_TSR_TERR2) CAN->TSR |= CAN_TSR_ABRQ2;
+        if(CAN->TSR & CAN_TSR_TERR0) CAN->TSR = CAN_TSR_ABRQ0;
+        if(CAN->TSR & CAN_TSR_TERR1) CAN->TSR = CAN_TSR_ABRQ1;
+        if(CAN->TSR & CAN_TSR_TERR2) CAN->TSR = CAN_TSR_ABRQ2;
         last_err_code = CAN->ESR;
     }
 }
@@ -26,11 +26,65 @@
 
 #include "hardware.h"
 
+// APB clock (HSI48)
+#define CAN_PCLK            (48000000)
+// default bitrate (bit/s) & sample point (1/1000 of bit)
+#define CAN_DEFSPEED        (100000)
+#define CAN_DEFSAMPLEPOINT  (875)
+// max bitrate error allowed by timing calculator (1/10000)
+#define CAN_MAXBRERR        (50)
+// time to listen each bitrate in autodetection mode (ms) and amount of rounds over all rates
+#define CAN_AUTOBAUD_MS     (250)
+#define CAN_AUTOBAUD_ROUNDS (4)
+
+// incoming messages ring size (should be a power of 2)
+#define CAN_INMESSAGE_SIZE  (128)
+// transmit queue size
+#define CAN_OUTMESSAGE_SIZE (32)
+// amount of filter banks
+#define CAN_FILTERS_AMOUNT  (14)
+
+// flags in CAN_message.ID
+#define CAN_MSG_EXT         (1UL << 31)
+#define CAN_MSG_RTR         (1UL << 30)
+#define CAN_MSG_IDMASK      (0x1FFFFFFF)
+
 typedef struct{
-    uint8_t data[8];
+    uint32_t ID;            // identifier with CAN_MSG_EXT (29 bits) and CAN_MSG_RTR flags
+    uint16_t timestamp;     // CAN timer value (bit times) @ SOF or ms (0..59999) if CAN_timestamp_ms
+    uint8_t filter;         // number of filter bank matched
     uint8_t length;
+    uint8_t data[8];
 } CAN_message;
 
+// filter bank mode (CAN_setfilter)
+#define CAN_FILT_LIST       (1 << 0)    // list of IDs (else pairs ID/mask)
+#define CAN_FILT_32BIT      (1 << 1)    // 32-bit: 2 IDs or 1 pair (extended IDs allowed), else 16-bit: 4 IDs or 2 pairs
+#define CAN_FILT_FIFO1      (1 << 2)    // FIFO1 (else FIFO0)
+
+// filter statistics
+typedef struct{
+    uint32_t hits;          // messages received through this filter
+    uint32_t overruns;      // messages lost because receive ring was full
+} CAN_filtstat;
+
+// transmit statistics
+typedef struct{
+    uint32_t queued;        // messages put into queue
+    uint32_t sent;          // transmitted successfully
+    uint32_t aborted;       // aborted due to errors or CAN reinit
+    uint32_t preempted;     // returned from mailbox into queue to send more important message
+    uint32_t dropped;       // lost because queue was full
+} CAN_txcounters;
+
+// bit timing
+typedef struct{
+    uint16_t prescaler;     // 1..1024
+    uint8_t bs1;            // time segment 1 (tq): 1..16
+    uint8_t bs2;            // time segment 2 (tq): 1..8
+    uint8_t sjw;            // resynchronization jump width (tq): 1..4
+} CAN_timing;
+
 typedef enum{
     CAN_STOP,
     CAN_READY,
@@ -39,7 +93,13 @@ typedef enum{
     CAN_FIFO_OVERRUN
 } CAN_status;
 
+extern CAN_filtstat CAN_filterstat[CAN_FILTERS_AMOUNT];
+extern volatile uint32_t CAN_fifoovr[2];
+extern CAN_txcounters CAN_txstat;
+extern volatile uint8_t CAN_timestamp_ms;
+
 CAN_status CAN_get_status();
+uint32_t CAN_get_errors();
 
 void readCANID();
 uint16_t getCANID();
@@ -47,10 +107,25 @@ uint16_t getCANID();
 void CAN_reinit();
 void CAN_setup();
 
+int CAN_calctiming(uint32_t pclk, uint32_t bitrate, uint16_t samplepoint, CAN_timing *t);
+int CAN_setspeed(uint32_t bitrate, uint16_t samplepoint);
+uint32_t CAN_getspeed();
+void CAN_setsilent(uint8_t silent);
+void CAN_autobaud();
+void CAN_speedcmd(const char *str);
+void CAN_showtiming();
+
+int CAN_setfilter(uint8_t bank, uint8_t mode, uint8_t N, const uint32_t *data);
+void CAN_gwfilter(uint8_t on);
+void CAN_filtercmd(const char *str);
+void CAN_showfilters();
+
+CAN_status can_send(const uint8_t *msg, uint8_t len, uint32_t target_id);
+void CAN_showtx();
 void can_send_dummy();
 void can_send_broadcast();
 void can_proc();
 
-CAN_message *CAN_messagebuf_pop();
+int CAN_messagebuf_pop(CAN_message *msg);
 
 #endif // __CAN_H__
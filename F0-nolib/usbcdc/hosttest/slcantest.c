@@ -0,0 +1,390 @@
+/*
+ *                                                                                                  geany_encoding=koi8-r
+ * slcantest.c
+ *
+ * Copyright 2020 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+// Host test of SLCAN gateway: session file lines are
+// > cmd     - host sends command (with '\r' added) split into random parts
+// < answer  - expected device output since previous check
+// ('\r', '\n' and '\a' are escaped in commands and answers)
+// ! frame   - frame comes from CAN bus (in SLCAN notation)
+// = frame   - frame expected to be sent into CAN bus
+// @ ms      - current time (timestamp of frames from bus)
+// E esr     - value of CAN error status register (hex)
+// X         - receive ring overrun
+// B 0|1     - transmit queue is full
+// % N       - burst of N frames from bus: check flow control and USB packets batching
+// I id      - CAN ID jumpers changed (hex), CAN is reinitialized
+// U L|M id0 [id1 ..] - user sets filter bank 0 (list or pairs ID/mask, hex)
+// G L|M id0 [id1 ..] - expected configuration of filter bank 0
+// lines beginning with '#' are comments
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "slcan.h"
+#include "usb.h"
+
+#define LINESZ  (256)
+
+// stubs of CAN layer
+volatile uint8_t CAN_timestamp_ms = 0;
+static CAN_message rxring[CAN_INMESSAGE_SIZE];
+static int rxhead = 0, rxtail = 0;
+static CAN_status status = CAN_READY;
+static uint32_t esr = 0;
+static int txfull = 0;
+static CAN_message txsent[16];
+static int Ntxsent = 0;
+
+CAN_status CAN_get_status(){
+    CAN_status st = status;
+    if(st == CAN_FIFO_OVERRUN) status = CAN_READY;
+    return st;
+}
+
+uint32_t CAN_get_errors(){
+    return esr;
+}
+
+// filter bank 0 as in can.c: default one follows CAN ID until user sets filters
+typedef struct{
+    uint8_t mode;
+    uint8_t N;
+    uint32_t data[4];
+} filter_conf;
+static filter_conf bank0, gwsaved;
+static uint8_t userfilters = 0, gwfilter = 0;
+static uint16_t canid = 0x2A9;
+
+uint16_t getCANID(){
+    return canid;
+}
+
+static void filter_default(){
+    bank0 = (filter_conf){CAN_FILT_LIST, 2, {canid, 0x7F7, 0, 0}};
+}
+
+static void filter_acceptall(){
+    bank0 = (filter_conf){0, 4, {0, 0, CAN_MSG_EXT, CAN_MSG_EXT}};
+}
+
+// filters part of CAN_setup
+static void can_setup(){
+    if(!userfilters) filter_default();
+    if(gwfilter) filter_acceptall();
+}
+
+int CAN_setfilter(uint8_t bank, uint8_t mode, uint8_t N, const uint32_t *data){
+    if(bank || N > 4) return 1;
+    bank0.mode = mode;
+    bank0.N = N;
+    memcpy(bank0.data, data, N * sizeof(uint32_t));
+    userfilters = 1;
+    gwfilter = 0;
+    return 0;
+}
+
+void CAN_gwfilter(uint8_t on){
+    if(on){
+        if(!gwfilter) gwsaved = bank0;
+        gwfilter = 1;
+        filter_acceptall();
+    }else if(gwfilter){
+        gwfilter = 0;
+        if(userfilters) bank0 = gwsaved;
+        else filter_default();
+    }
+}
+
+// bank 0 configuration as "L|M id0 id1 .."
+static const char *bank0str(){
+    static char buf[LINESZ];
+    int l = sprintf(buf, "%c", (bank0.mode & CAN_FILT_LIST) ? 'L' : 'M');
+    for(int i = 0; i < bank0.N; ++i) l += sprintf(buf + l, " %X", bank0.data[i]);
+    return buf;
+}
+
+int CAN_setspeed(uint32_t br, uint16_t sp){
+    (void) sp;
+    return br > 1000000;
+}
+
+void CAN_setsilent(uint8_t silent){
+    (void) silent;
+}
+
+CAN_status can_send(const uint8_t *msg, uint8_t len, uint32_t target_id){
+    if(txfull || Ntxsent == 16) return CAN_BUSY;
+    CAN_message *m = &txsent[Ntxsent++];
+    memset(m, 0, sizeof(CAN_message));
+    m->ID = target_id;
+    m->length = len;
+    if(msg && !(target_id & CAN_MSG_RTR)) memcpy(m->data, msg, len);
+    return CAN_OK;
+}
+
+int CAN_messagebuf_pop(CAN_message *msg){
+    if(rxtail == rxhead) return 0;
+    *msg = rxring[rxtail];
+    rxtail = (rxtail + 1) % CAN_INMESSAGE_SIZE;
+    return 1;
+}
+
+static int rxpush(const CAN_message *m){
+    int next = (rxhead + 1) % CAN_INMESSAGE_SIZE;
+    if(next == rxtail) return 1;
+    rxring[rxhead] = *m;
+    rxhead = next;
+    return 0;
+}
+
+// stubs of USB layer: device output is collected in ring-sized buffer
+static uint8_t outbuf[USB_TXRINGSZ];
+static int outlen = 0;
+
+int USB_txspace(){
+    return USB_TXRINGSZ - 1 - outlen;
+}
+
+int USB_sendn(const uint8_t *buf, int len){
+    int n = USB_txspace();
+    if(len > n) len = n;
+    memcpy(&outbuf[outlen], buf, len);
+    outlen += len;
+    return len;
+}
+
+// escape '\r' & '\a' for printing
+static const char *escape(const uint8_t *s, int len){
+    static char buf[LINESZ * 2];
+    char *p = buf;
+    for(int i = 0; i < len && p < buf + sizeof(buf) - 3; ++i){
+        if(s[i] == '\r'){ *p++ = '\\'; *p++ = 'r'; }
+        else if(s[i] == '\a'){ *p++ = '\\'; *p++ = 'a'; }
+        else *p++ = s[i];
+    }
+    *p = 0;
+    return buf;
+}
+
+static void unescape(char *s){
+    char *o = s;
+    for(; *s; ++s){
+        if(*s == '\\' && s[1] == 'r'){ *o++ = '\r'; ++s; }
+        else if(*s == '\\' && s[1] == 'n'){ *o++ = '\n'; ++s; }
+        else if(*s == '\\' && s[1] == 'a'){ *o++ = '\a'; ++s; }
+        else *o++ = *s;
+    }
+    *o = 0;
+}
+
+// feed command by random parts
+static void hostsend(const char *cmd){
+    char buf[LINESZ];
+    int l = snprintf(buf, LINESZ, "%s\r", cmd), i = 0;
+    while(i < l){
+        int n = 1 + rand() % 8;
+        if(n > l - i) n = l - i;
+        slcan_rx((uint8_t*)&buf[i], n);
+        i += n;
+    }
+    slcan_proc();
+}
+
+// frame to string without timestamp
+static const char *frame(const CAN_message *m){
+    static char buf[SLCAN_FRAMESZ + 1];
+    int l = (m->ID & CAN_MSG_EXT) ? 10 : 5;
+    if(!(m->ID & CAN_MSG_RTR)) l += 2 * m->length;
+    slcan_frame2str(m, buf);
+    buf[l] = 0;
+    return buf;
+}
+
+/**
+ * @brief burst - N frames from bus: the ring is refilled and USB sends one 64-byte packet
+ *  each main loop iteration
+ * @return 0 if all frames received by host in right order
+ */
+static int burst(int N){
+    static uint8_t host[65536];
+    int hostlen = 0, pushed = 0, packets = 0, bad = 0, got = 0;
+    CAN_message m;
+    while(pushed < N || rxhead != rxtail || outlen){
+        for(; pushed < N; ++pushed){
+            memset(&m, 0, sizeof(m));
+            m.ID = (pushed & 1) ? (0x1234567 + pushed) | CAN_MSG_EXT : (pushed & 0x7ff);
+            m.length = pushed % 9;
+            for(int i = 0; i < m.length; ++i) m.data[i] = pushed + i;
+            if(rxpush(&m)) break;
+        }
+        slcan_proc();
+        int n = outlen > USB_PKTSZ ? USB_PKTSZ : outlen;
+        if(hostlen + n > (int)sizeof(host)) return 1;
+        memcpy(&host[hostlen], outbuf, n);
+        memmove(outbuf, &outbuf[n], outlen - n);
+        outlen -= n;
+        hostlen += n;
+        if(n) ++packets;
+    }
+    // check frames
+    char line[LINESZ];
+    int l = 0;
+    for(int i = 0; i < hostlen; ++i){
+        if(host[i] != '\r'){
+            if(l < LINESZ - 1) line[l++] = host[i];
+            continue;
+        }
+        line[l] = 0;
+        l = 0;
+        if(!slcan_str2frame(line, &m) || m.length != got % 9 ||
+           m.ID != ((got & 1) ? (0x1234567 + got) | CAN_MSG_EXT : (got & 0x7ffU))) ++bad;
+        else for(int j = 0; j < m.length; ++j) if(m.data[j] != (uint8_t)(got + j)) ++bad;
+        ++got;
+    }
+    printf("Burst of %d frames: %d received, %d bad, %d bytes in %d USB packets (%.2f frames per packet)\n",
+           N, got, bad, hostlen, packets, packets ? (double)got / packets : 0.);
+    return bad || got != N;
+}
+
+int main(int argc, char **argv){
+    if(argc != 2){
+        fprintf(stderr, "Usage: %s session\n", argv[0]);
+        return 1;
+    }
+    FILE *f = fopen(argv[1], "r");
+    if(!f){
+        perror(argv[1]);
+        return 1;
+    }
+    char line[LINESZ];
+    int lineno = 0, bad = 0, checks = 0;
+    uint32_t ms = 0;
+    CAN_message m;
+    srand(1);
+    can_setup();
+    while(fgets(line, LINESZ, f)){
+        ++lineno;
+        char *nl = strchr(line, '\n');
+        if(nl) *nl = 0;
+        if(!line[0] || line[0] == '#') continue;
+        char *arg = line + 1;
+        while(*arg == ' ') ++arg;
+        int err = 0;
+        switch(line[0]){
+            case '>':
+                unescape(arg);
+                hostsend(arg);
+            break;
+            case '<':
+                unescape(arg);
+                if((int)strlen(arg) != outlen || memcmp(arg, outbuf, outlen)){
+                    printf("line %d: expected '%s'", lineno, escape((uint8_t*)arg, strlen(arg)));
+                    printf(", got '%s'\n", escape(outbuf, outlen));
+                    err = 1;
+                }
+                outlen = 0;
+                ++checks;
+            break;
+            case '!':
+                if(!slcan_str2frame(arg, &m)){
+                    printf("line %d: bad frame\n", lineno);
+                    err = 1;
+                    break;
+                }
+                m.timestamp = CAN_timestamp_ms ? ms % 60000 : 0xBEEF;
+                rxpush(&m);
+                slcan_proc();
+            break;
+            case '=':
+                ++checks;
+                if(!Ntxsent){
+                    printf("line %d: frame %s wasn't sent\n", lineno, arg);
+                    err = 1;
+                    break;
+                }
+                if(strcmp(frame(&txsent[0]), arg)){
+                    printf("line %d: expected frame %s, sent %s\n", lineno, arg, frame(&txsent[0]));
+                    err = 1;
+                }
+                memmove(txsent, &txsent[1], --Ntxsent * sizeof(CAN_message));
+            break;
+            case '@':
+                ms = strtoul(arg, NULL, 0);
+            break;
+            case 'E':
+                esr = strtoul(arg, NULL, 16);
+            break;
+            case 'X':
+                status = CAN_FIFO_OVERRUN;
+            break;
+            case 'B':
+                txfull = atoi(arg);
+            break;
+            case '%':
+                ++checks;
+                err = burst(atoi(arg));
+            break;
+            case 'I':
+                canid = strtoul(arg, NULL, 16);
+                can_setup();
+            break;
+            case 'U':{
+                uint32_t data[4];
+                uint8_t N = 0;
+                char *p = arg + 1;
+                while(N < 4 && *p){
+                    char *e;
+                    data[N] = strtoul(p, &e, 16);
+                    if(e == p) break;
+                    ++N;
+                    p = e;
+                }
+                CAN_setfilter(0, (*arg == 'L') ? CAN_FILT_LIST : 0, N, data);
+            }
+            break;
+            case 'G':
+                ++checks;
+                if(strcmp(bank0str(), arg)){
+                    printf("line %d: expected filter bank 0 '%s', got '%s'\n", lineno, arg, bank0str());
+                    err = 1;
+                }
+            break;
+            default:
+                printf("line %d: unknown directive\n", lineno);
+                err = 1;
+        }
+        bad += err;
+    }
+    fclose(f);
+    if(Ntxsent){
+        printf("%d frames sent but not expected, the first is %s\n", Ntxsent, frame(&txsent[0]));
+        ++bad;
+    }
+    if(slcan_txdropped){
+        printf("%u bytes of output were dropped\n", slcan_txdropped);
+        ++bad;
+    }
+    printf("SLCAN test: %d checks, %d failed: %s\n", checks, bad, bad ? "FAILED" : "OK");
+    return !!bad;
+}
@@ -22,6 +22,7 @@
 #include "hardware.h"
 #include "usart.h"
 #include "can.h"
+#include "slcan.h"
 #include "usb.h"
 #include "usb_lib.h"
 
@@ -58,8 +59,9 @@ void iwdg_setup(){
 int main(void){
     uint32_t lastT = 0;
     uint8_t ctr, len;
-    CAN_message *can_mesg;
-    int L;
+    CAN_message can_mesg;
+    uint8_t usbbuf[USB_RXBUFSZ];
+    int L = 0, Lusb;
     char *txt;
     sysreset();
     SysTick_Config(6000, 1);
@@ -92,16 +94,22 @@ int main(void){
         }
         can_proc();
         usb_proc();
-        if(CAN_get_status() == CAN_FIFO_OVERRUN){
+        Lusb = USB_receive(usbbuf, USB_RXBUFSZ);
+        if(Lusb) slcan_rx(usbbuf, Lusb);
+        if(slcan_getstate() != SLCAN_CLOSED) slcan_proc(); // gateway opened: all messages go to USB
+        else if(CAN_get_status() == CAN_FIFO_OVERRUN){
             SEND("CAN bus fifo overrun occured!\n");
         }
-        can_mesg = CAN_messagebuf_pop();
-        if(can_mesg){ // new data in buff
-            len = can_mesg->length;
-            SEND("got message, len: "); usart_putchar('0' + len);
+        while(slcan_getstate() == SLCAN_CLOSED && CAN_messagebuf_pop(&can_mesg)){ // new data in buff
+            len = can_mesg.length;
+            SEND("got message, ID="); printuhex(can_mesg.ID & CAN_MSG_IDMASK);
+            if(can_mesg.ID & CAN_MSG_RTR) SEND(" (RTR)");
+            SEND(", filter="); printu(can_mesg.filter);
+            SEND(", ts="); printu(can_mesg.timestamp);
+            SEND(", len: "); usart_putchar('0' + len);
             SEND(", data: ");
             for(ctr = 0; ctr < len; ++ctr){
-                printuhex(can_mesg->data[ctr]);
+                printuhex(can_mesg.data[ctr]);
                 usart_putchar(' ');
             }
             newline();
@@ -109,9 +117,22 @@ int main(void){
         if(usartrx()){ // usart1 received data, store in in buffer
             L = usart_getline(&txt);
             char _1st = txt[0];
-            if(L == 2 && txt[1] == '\n'){
+            if(_1st == 'F' && L > 2){ // set filter
+                CAN_filtercmd(txt);
+                L = 0;
+            }else if(_1st == 'b' && L > 2){ // set bitrate
+                CAN_speedcmd(txt);
+                L = 0;
+            }else if(L == 2 && txt[1] == '\n'){
                 L = 0;
                 switch(_1st){
+                    case 'A':
+                        SEND("Bitrate autodetection\n");
+                        CAN_autobaud();
+                    break;
+                    case 'b':
+                        CAN_showtiming();
+                    break;
                     case 'f':
                         transmit_tbuf();
                     break;
@@ -121,11 +142,20 @@ int main(void){
                     case 'C':
                         can_send_dummy();
                     break;
+                    case 'F':
+                        CAN_showfilters();
+                    break;
                     case 'G':
                         SEND("Can address: ");
                         printuhex(getCANID());
                         newline();
                     break;
+                    case 'Q':
+                        CAN_showtx();
+                        SEND("SLCAN bytes dropped: ");
+                        printu(slcan_txdropped);
+                        newline();
+                    break;
                     case 'R':
                         SEND("Soft reset\n");
                         NVIC_SystemReset();
@@ -142,7 +172,7 @@ int main(void){
                         newline();
                     break;
                     case 'U':
-                        USB_send("Test string for USB; a very long string that don't fit into one 64-byte buffer, what will be with it?\n");
+                        if(slcan_getstate() == SLCAN_CLOSED) USB_send("Test string for USB; a very long string that don't fit into one 64-byte buffer, what will be with it?\n");
                     break;
                     case 'W':
                         SEND("Wait for reboot\n");
@@ -150,10 +180,17 @@ int main(void){
                     break;
                     default: // help
                         SEND(
+                        "'A' - autodetect CAN bitrate\n"
+                        "'b' - show CAN bitrate and timing\n"
+                        "'b kbps [sp]' - set bitrate (sample point sp in 1/1000 of bit)\n"
                         "'f' - flush UART buffer\n"
                         "'B' - send broadcast dummy byte\n"
                         "'C' - send dummy byte over CAN\n"
+                        "'F' - show CAN filters and their statistics\n"
+                        "'F bank' - deactivate filter bank\n"
+                        "'F bank fifo L|M[X] ID0 [ID1..]' - set filter (list/mask[32-bit]), IDs are hex\n"
                         "'G' - get CAN address\n"
+                        "'Q' - show CAN transmit & SLCAN output statistics\n"
                         "'R' - software reset\n"
                         "'S' - reinit CAN (with new address)\n"
                         "'T' - gen time from start (ms)"
@@ -168,7 +205,7 @@ int main(void){
         if(L){ // text waits for sending
             txt[L] = 0;
             usart_send(txt);
-            USB_send(txt);
+            if(slcan_getstate() == SLCAN_CLOSED) USB_send(txt);
             L = 0;
         }
     }
@@ -0,0 +1,268 @@
+/*
+ *                                                                                                  geany_encoding=koi8-r
+ * slcan.c
+ *
+ * Copyright 2020 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+
+#include "slcan.h"
+#include "usb.h"
+
+// SLCAN bitrate codes S0..S8 (kbit/s)
+static const uint16_t slcan_speeds[] = {10, 20, 50, 100, 125, 250, 500, 800, 1000};
+#define SLCAN_SPEEDS_AMOUNT (sizeof(slcan_speeds) / sizeof(slcan_speeds[0]))
+
+static const char hexdigits[] = "0123456789ABCDEF";
+
+static slcan_state state = SLCAN_CLOSED;
+static uint8_t flags = 0;       // SLCAN_FLAG_*, cleared by 'F'
+static uint8_t timestamps = 0;  // ==1 to add ms timestamp to received frames
+// incoming command; cmdlen > SLCAN_CMDSZ when command is too long (skip it till '\r')
+static char cmd[SLCAN_CMDSZ + 1];
+static uint8_t cmdlen = 0;
+
+volatile uint32_t slcan_txdropped = 0; // bytes of answers & frames lost because USB ring was full
+
+slcan_state slcan_getstate(){
+    return state;
+}
+
+static void reply(const char *str){
+    int l = 0;
+    while(str[l]) ++l;
+    slcan_txdropped += l - USB_sendn((const uint8_t*)str, l);
+}
+
+// put N hex digits of val into buf
+static char *puthex(char *buf, uint32_t val, uint8_t N){
+    for(int8_t i = N - 1; i > -1; --i){
+        buf[i] = hexdigits[val & 0xf];
+        val >>= 4;
+    }
+    return buf + N;
+}
+
+/**
+ * @brief gethex - read exactly N hex digits
+ * @param str - string
+ * @param N - amount of digits
+ * @param val (o) - value
+ * @return 0 if bad digit found
+ */
+static int gethex(const char *str, uint8_t N, uint32_t *val){
+    uint32_t v = 0;
+    for(uint8_t i = 0; i < N; ++i){
+        char c = str[i];
+        if(c >= '0' && c <= '9') c -= '0';
+        else if(c >= 'A' && c <= 'F') c -= 'A' - 10;
+        else if(c >= 'a' && c <= 'f') c -= 'a' - 10;
+        else return 0;
+        v = v << 4 | (uint8_t)c;
+    }
+    *val = v;
+    return 1;
+}
+
+/**
+ * @brief slcan_frame2str - make SLCAN string for received frame
+ * @param m - message
+ * @param buf - buffer for string (at least SLCAN_FRAMESZ bytes)
+ * @return string length (without trailing zero)
+ */
+int slcan_frame2str(const CAN_message *m, char *buf){
+    char *p = buf;
+    uint8_t len = (m->length > 8) ? 8 : m->length, rtr = (m->ID & CAN_MSG_RTR) ? 1 : 0;
+    if(m->ID & CAN_MSG_EXT){
+        *p++ = rtr ? 'R' : 'T';
+        p = puthex(p, m->ID & CAN_MSG_IDMASK, 8);
+    }else{
+        *p++ = rtr ? 'r' : 't';
+        p = puthex(p, m->ID & 0x7ff, 3);
+    }
+    *p++ = '0' + len;
+    if(!rtr) for(uint8_t i = 0; i < len; ++i) p = puthex(p, m->data[i], 2);
+    if(timestamps) p = puthex(p, m->timestamp, 4);
+    *p++ = '\r';
+    *p = 0;
+    return p - buf;
+}
+
+/**
+ * @brief slcan_str2frame - parse transmit command (t, T, r or R)
+ * @param str - command without '\r'
+ * @param m (o) - message
+ * @return 0 if command is wrong
+ */
+int slcan_str2frame(const char *str, CAN_message *m){
+    uint32_t v;
+    uint8_t idlen = 3, len;
+    const char *p = str + 1;
+    switch(*str){
+        case 'T':
+            m->ID = CAN_MSG_EXT;
+            idlen = 8;
+        break;
+        case 't':
+            m->ID = 0;
+        break;
+        case 'R':
+            m->ID = CAN_MSG_EXT | CAN_MSG_RTR;
+            idlen = 8;
+        break;
+        case 'r':
+            m->ID = CAN_MSG_RTR;
+        break;
+        default:
+            return 0;
+    }
+    if(!gethex(p, idlen, &v)) return 0;
+    if(v > ((idlen == 3) ? 0x7ffUL : CAN_MSG_IDMASK)) return 0;
+    m->ID |= v;
+    p += idlen;
+    if(*p < '0' || *p > '8') return 0;
+    len = *p++ - '0';
+    m->length = len;
+    for(uint8_t i = 0; i < 8; ++i) m->data[i] = 0;
+    if(!(m->ID & CAN_MSG_RTR)) for(uint8_t i = 0; i < len; ++i, p += 2){
+        if(!gethex(p, 2, &v)) return 0;
+        m->data[i] = v;
+    }
+    return *p == 0;
+}
+
+static void gw_open(slcan_state st){
+    CAN_message m;
+    CAN_setsilent(st == SLCAN_LISTEN);
+    CAN_gwfilter(1); // receive all frames
+    CAN_timestamp_ms = timestamps;
+    while(CAN_messagebuf_pop(&m)); // forget all received before
+    CAN_get_status(); // and old overrun
+    flags = 0;
+    state = st;
+}
+
+// run command; return answer
+static const char *runcmd(){
+    static char ans[8];
+    CAN_message m;
+    uint32_t v;
+    char *p;
+    if(cmdlen == 0) return "\r"; // empty command
+    switch(cmd[0]){
+        case 'S': // bitrate
+            if(state != SLCAN_CLOSED || cmdlen != 2 || cmd[1] < '0' ||
+                (uint8_t)(cmd[1] - '0') >= SLCAN_SPEEDS_AMOUNT) break;
+            if(CAN_setspeed(slcan_speeds[cmd[1] - '0'] * 1000UL, CAN_DEFSAMPLEPOINT)) break;
+            return "\r";
+        case 'O':
+        case 'L':
+            if(state != SLCAN_CLOSED || cmdlen != 1) break;
+            gw_open(cmd[0] == 'O' ? SLCAN_OPENED : SLCAN_LISTEN);
+            return "\r";
+        case 'C':
+            if(state == SLCAN_CLOSED || cmdlen != 1) break;
+            if(state == SLCAN_LISTEN) CAN_setsilent(0);
+            CAN_gwfilter(0);
+            state = SLCAN_CLOSED;
+            CAN_timestamp_ms = 0;
+            return "\r";
+        case 't':
+        case 'T':
+        case 'r':
+        case 'R':
+            if(state != SLCAN_OPENED || !slcan_str2frame(cmd, &m)) break;
+            if(CAN_OK != can_send(m.data, m.length, m.ID)){
+                flags |= SLCAN_FLAG_TXFULL;
+                break;
+            }
+            return (m.ID & CAN_MSG_EXT) ? "Z\r" : "z\r";
+        case 'F': // status flags
+            if(cmdlen != 1) break;
+            v = CAN_get_errors();
+            if(v & CAN_ESR_EWGF) flags |= SLCAN_FLAG_ERRWARN;
+            if(v & CAN_ESR_EPVF) flags |= SLCAN_FLAG_ERRPASV;
+            if(v & CAN_ESR_LEC) flags |= SLCAN_FLAG_BUSERR;
+            p = ans;
+            *p++ = 'F';
+            p = puthex(p, flags, 2);
+            *p++ = '\r'; *p = 0;
+            flags = 0;
+            return ans;
+        case 'V':
+            if(cmdlen != 1) break;
+            return SLCAN_VERSION "\r";
+        case 'N': // serial number: our CAN ID
+            if(cmdlen != 1) break;
+            p = ans;
+            *p++ = 'N';
+            p = puthex(p, getCANID(), 4);
+            *p++ = '\r'; *p = 0;
+            return ans;
+        case 'Z':
+            if(cmdlen != 2 || (cmd[1] != '0' && cmd[1] != '1')) break;
+            timestamps = cmd[1] - '0';
+            if(state != SLCAN_CLOSED) CAN_timestamp_ms = timestamps;
+            return "\r";
+        case 'M': // acceptance code & mask: filters are set by USART commands
+        case 'm':
+            if(cmdlen != 9 || !gethex(&cmd[1], 8, &v)) break;
+            return "\r";
+        default:
+        break;
+    }
+    return "\a";
+}
+
+/**
+ * @brief slcan_rx - process data received from host
+ * @param data - data (commands ends with '\r', could be split into several parts)
+ * @param len - data length
+ */
+void slcan_rx(const uint8_t *data, int len){
+    for(int i = 0; i < len; ++i){
+        char c = data[i];
+        if(c == '\n') continue;
+        if(c != '\r'){
+            if(cmdlen < SLCAN_CMDSZ) cmd[cmdlen] = c;
+            if(cmdlen <= SLCAN_CMDSZ) ++cmdlen;
+            continue;
+        }
+        if(cmdlen > SLCAN_CMDSZ) reply("\a");
+        else{
+            cmd[cmdlen] = 0;
+            reply(runcmd());
+        }
+        cmdlen = 0;
+    }
+}
+
+/**
+ * @brief slcan_proc - send received frames to host while there's space in USB buffer
+ * (frames are accumulated in USB ring and transmitted by 64-byte packets)
+ */
+void slcan_proc(){
+    CAN_message m;
+    char buf[SLCAN_FRAMESZ + 1];
+    if(state == SLCAN_CLOSED) return;
+    if(CAN_get_status() == CAN_FIFO_OVERRUN) flags |= SLCAN_FLAG_OVERRUN | SLCAN_FLAG_RXFULL;
+    while(USB_txspace() >= SLCAN_FRAMESZ && CAN_messagebuf_pop(&m)){
+        int l = slcan_frame2str(&m, buf);
+        slcan_txdropped += l - USB_sendn((uint8_t*)buf, l);
+    }
+}
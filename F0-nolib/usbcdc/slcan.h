@@ -0,0 +1,59 @@
+/*
+ *                                                                                                  geany_encoding=koi8-r
+ * slcan.h
+ *
+ * Copyright 2020 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ *
+ */
+#pragma once
+#ifndef __SLCAN_H__
+#define __SLCAN_H__
+
+#include "can.h"
+
+// SLCAN (LAWICEL) gateway over USB CDC
+#define SLCAN_VERSION       "V0101"
+// max command length (without '\r')
+#define SLCAN_CMDSZ         (31)
+// max frame string length: "T" + 8 ID + 1 DLC + 16 data + 4 timestamp + '\r'
+#define SLCAN_FRAMESZ       (31)
+
+// status flags (command 'F')
+#define SLCAN_FLAG_RXFULL   (1 << 0)
+#define SLCAN_FLAG_TXFULL   (1 << 1)
+#define SLCAN_FLAG_ERRWARN  (1 << 2)
+#define SLCAN_FLAG_OVERRUN  (1 << 3)
+#define SLCAN_FLAG_ERRPASV  (1 << 5)
+#define SLCAN_FLAG_ARBLOST  (1 << 6)
+#define SLCAN_FLAG_BUSERR   (1 << 7)
+
+typedef enum{
+    SLCAN_CLOSED,
+    SLCAN_OPENED,
+    SLCAN_LISTEN        // opened in silent mode
+} slcan_state;
+
+extern volatile uint32_t slcan_txdropped;
+
+slcan_state slcan_getstate();
+int slcan_frame2str(const CAN_message *m, char *buf);
+int slcan_str2frame(const char *str, CAN_message *m);
+void slcan_rx(const uint8_t *data, int len);
+void slcan_proc();
+
+#endif // __SLCAN_H__
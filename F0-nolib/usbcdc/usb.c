@@ -21,6 +21,8 @@
  *
  */
 
+#include <string.h> // memcpy, memmove
+
 #include "usb.h"
 #include "usb_lib.h"
 #include "usart.h"
@@ -28,7 +30,16 @@
 
 
 static uint8_t buffer[BUFFSIZE+1];
-static uint8_t len, rcvflag = 0;
+// incoming data (read by USB_receive); ovfl==1 when EP2 is NAKed for lack of space
+static uint8_t incoming[USB_RXBUFSZ];
+static volatile uint16_t ilen = 0;
+static volatile uint8_t ovfl = 0;
+// outgoing data ring: all that was written between two IN transactions goes in one packet
+static uint8_t txring[USB_TXRINGSZ];
+static uint16_t txhead = 0, txtail = 0;
+static volatile uint8_t txbusy = 0; // ==1 while EP3 buffer isn't read by host
+static uint8_t txzlp = 0; // ==1 if last packet was full and no more data: send zero-length packet
+static int8_t usbON = 0;
 
 // interrupt IN handler (never used?)
 static uint16_t EP1_Handler(ep_t ep){
@@ -47,21 +58,22 @@ static uint16_t EP1_Handler(ep_t ep){
 // data IN/OUT handler
 static uint16_t EP2_Handler(ep_t ep){
     if(ep.rx_flag){
-        if(ep.rx_cnt > 0 && ep.rx_cnt < BUFFSIZE){
-            rcvflag = 1;
-            len = EP_Read(2, buffer);
-            buffer[len] = 0;
-            #ifdef EBUG
-            MSG("read: ");
-            if(len) SEND((char*)buffer);
-            #endif
+        int rd = ep.rx_cnt, rest = USB_RXBUFSZ - ilen;
+        if(rd){
+            if(rd <= rest){
+                ilen += EP_Read(2, &incoming[ilen]);
+            }else{ // no space: leave data in endpoint buffer & NAK until USB_receive
+                ovfl = 1;
+                return SET_NAK_RX(ep.status);
+            }
         }
         // end of transaction: clear DTOGs
         ep.status = CLEAR_DTOG_RX(ep.status);
         ep.status = CLEAR_DTOG_TX(ep.status);
         ep.status = SET_STALL_TX(ep.status);
-    }else if (ep.tx_flag){
+    }else if (ep.tx_flag){ // EP3: host read the packet
         ep.status = KEEP_STAT_TX(ep.status);
+        txbusy = 0;
     }
     ep.status = SET_VALID_RX(ep.status);
     return ep.status;
@@ -88,8 +100,24 @@ void USB_setup(){
     NVIC_EnableIRQ(USB_IRQn);
 }
 
+// send next packet from ring if EP3 is free
+static void USB_transmit(){
+    static uint8_t pkt[USB_PKTSZ];
+    if(txbusy) return;
+    uint16_t n = 0, t = txtail;
+    while(t != txhead && n < USB_PKTSZ){
+        pkt[n++] = txring[t];
+        if(++t == USB_TXRINGSZ) t = 0;
+    }
+    if(n == 0 && !txzlp) return;
+    txtail = t;
+    // full packet without continuation should be followed by ZLP to finish host transfer
+    txzlp = (n == USB_PKTSZ && t == txhead);
+    txbusy = 1;
+    EP_Write(3, pkt, n);
+}
+
 void usb_proc(){
-    static int8_t usbON = 0;
     if(USB_GetState() == USB_CONFIGURE_STATE){ // USB configured - activate other endpoints
         if(!usbON){ // endpoints not activated
             MSG("Configured; activate other endpoints\n");
@@ -101,29 +129,88 @@ void usb_proc(){
             EP_Init(1, EP_TYPE_INTERRUPT, 192, 192, EP1_Handler);
             EP_Init(2, EP_TYPE_BULK, 256, 256, EP2_Handler); // OUT - receive data
             EP_Init(3, EP_TYPE_BULK, 320, 320, EP2_Handler); // IN - transmit data
+            txhead = txtail = 0;
+            txbusy = txzlp = 0;
+            ilen = 0; ovfl = 0;
             usbON = 1;
         }else{
-            if(rcvflag){
-                /*
-                 * don't process received data here: if it would come too fast you will loose a part
-                 * It would be a good idea to collect incoming data in greater buffer and process it
-                 * later (EX: echo "text" > /dev/ttyUSB1 will split into two writings!
-                 */
-                rcvflag = 0;
-            }
             if(SETLINECODING()){
                 SEND("got new linecoding");
                 CLRLINECODING();
             }
+            USB_transmit();
         }
     }else{
         usbON = 0;
     }
 }
 
-void USB_send(char *buf){
-    uint16_t l = 0;
-    char *p = buf;
+/**
+ * @brief USB_configured - check USB state
+ * @return 1 if USB endpoints are ready
+ */
+int USB_configured(){
+    return usbON;
+}
+
+/**
+ * @brief USB_txspace - free space in transmit ring
+ */
+int USB_txspace(){
+    int l = (int)txtail - (int)txhead - 1;
+    if(l < 0) l += USB_TXRINGSZ;
+    return l;
+}
+
+/**
+ * @brief USB_sendn - put data into transmit ring (sent by usb_proc)
+ * @param buf - data
+ * @param len - its length
+ * @return amount of bytes put (less than len if there's no space or USB isn't configured)
+ */
+int USB_sendn(const uint8_t *buf, int len){
+    if(!usbON) return 0;
+    int n = USB_txspace();
+    if(len > n) len = n;
+    uint16_t h = txhead;
+    for(n = 0; n < len; ++n){
+        txring[h] = buf[n];
+        if(++h == USB_TXRINGSZ) h = 0;
+    }
+    txhead = h;
+    return len;
+}
+
+void USB_send(const char *buf){
+    int l = 0;
+    const char *p = buf;
     while(*p++) ++l;
-    EP_Write(3, (uint8_t*)buf, l);
+    USB_sendn((const uint8_t*)buf, l);
+}
+
+/**
+ * @brief USB_receive - get data received from host
+ * @param buf - buffer for data
+ * @param bufsize - its size
+ * @return amount of bytes read
+ */
+int USB_receive(uint8_t *buf, int bufsize){
+    if(bufsize < 1 || !ilen) return 0;
+    USB->CNTR = 0; // don't let interrupt change buffer
+    int sz = (ilen > bufsize) ? bufsize : ilen, rest = ilen - sz;
+    memcpy(buf, incoming, sz);
+    if(rest > 0) memmove(incoming, &incoming[sz], rest);
+    ilen = rest;
+    if(ovfl && USB_RXBUFSZ - ilen >= USB_PKTSZ){ // take data waiting in endpoint buffer & allow next packet
+        ilen += EP_Read(2, &incoming[ilen]);
+        ovfl = 0;
+        uint16_t epstatus = USB->EPnR[2];
+        epstatus = SET_VALID_RX(epstatus);
+        epstatus = KEEP_STAT_TX(epstatus);
+        epstatus = KEEP_DTOG_RX(epstatus);
+        epstatus = KEEP_DTOG_TX(epstatus);
+        USB->EPnR[2] = epstatus;
+    }
+    USB->CNTR = USB_CNTR_RESETM | USB_CNTR_CTRM;
+    return sz;
 }
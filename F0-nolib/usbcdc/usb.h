@@ -26,10 +26,20 @@
 
 #include "hardware.h"
 
-#define BUFFSIZE   (64)
+#define BUFFSIZE        (64)
+// max packet size of bulk endpoints
+#define USB_PKTSZ       (64)
+// buffer for incoming data
+#define USB_RXBUFSZ     (128)
+// outgoing data ring
+#define USB_TXRINGSZ    (256)
 
 void USB_setup();
 void usb_proc();
-void USB_send(char *buf);
+int USB_configured();
+int USB_txspace();
+int USB_sendn(const uint8_t *buf, int len);
+void USB_send(const char *buf);
+int USB_receive(uint8_t *buf, int bufsize);
 
 #endif // __USB_H__
@@ -54,10 +54,78 @@ void iwdg_setup(){
     IWDG->KR = IWDG_REFRESH; /* (6) */
 }
 
+char *u2str(uint32_t val);
+
+// USB throughput benchmark: amount of data & its state
+#define BENCH_SIZE  (102400)
+static uint8_t bench_on = 0;
+static uint32_t bench_rest = 0, bench_start = 0, bench_drop = 0;
+
+static void bench_proc(){
+    // 63 symbols + '\n'
+    static const char line[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!\n";
+    while(bench_rest && USB_TXRINGSZ - 1 - USB_txpending() > (int)sizeof(line)){
+        IWDG->KR = IWDG_REFRESH;
+        USB_send(line);
+        bench_rest -= (bench_rest > sizeof(line) - 1) ? sizeof(line) - 1 : bench_rest;
+    }
+    if(bench_rest || USB_txpending()) return;
+    uint32_t T = Tms - bench_start;
+    if(!T) T = 1;
+    bench_on = 0;
+    USB_send("\nSent ");
+    USB_send(u2str(BENCH_SIZE));
+    USB_send(" bytes for ");
+    USB_send(u2str(T));
+    USB_send("ms: ");
+    USB_send(u2str((uint32_t)((uint64_t)BENCH_SIZE * 1000 / T)));
+    USB_send(" bytes/s, dropped ");
+    USB_send(u2str(USB_txdropped - bench_drop));
+    USB_send("\n");
+}
+
+// USB loopback mode: all received data is sent back; BREAK or control lines change stops it
+static uint8_t loopback = 0;
+static uint32_t loop_bytes = 0, loop_start = 0;
+
+static void loopback_proc(){
+    const uint8_t *data;
+    int l = USB_rxpeek(&data);
+    if(!l) return;
+    // don't take more data than transmit ring could hold: host will be NAKed meanwhile
+    int room = USB_TXRINGSZ - 1 - USB_txpending();
+    if(l > room) l = room;
+    if(l < 1) return;
+    if(!loop_bytes) loop_start = Tms;
+    loop_bytes += USB_write(data, l);
+    USB_rxskip(l);
+}
+
+static void loopback_stop(){
+    if(!loopback) return;
+    loopback = 0;
+    uint32_t T = Tms - loop_start;
+    if(!T) T = 1;
+    newline(); SEND("Loopback: "); printu(loop_bytes); SEND(" bytes for "); printu(T);
+    SEND("ms ("); printu((uint32_t)((uint64_t)loop_bytes * 1000 / T)); SEND(" bytes/s)");
+}
+
 char *parse_cmd(char *buf){
     IWDG->KR = IWDG_REFRESH;
     if(buf[1] != '\n') return buf;
     switch(*buf){
+        case 'B':
+            bench_on = 1;
+            bench_rest = BENCH_SIZE;
+            bench_start = Tms;
+            bench_drop = USB_txdropped;
+            return NULL;
+        break;
+        case 'E':
+            loopback = 1;
+            loop_bytes = 0;
+            return "Loopback mode, send BREAK to stop\n";
+        break;
         case 'p':
             pin_toggle(USBPU_port, USBPU_pin);
             USB_send("USB pullup is ");
@@ -84,6 +152,8 @@ char *parse_cmd(char *buf){
         break;
         default: // help
             return
+            "'B' - USB transmission benchmark (send 100kB)\n"
+            "'E' - USB loopback (echo) mode for throughput tests\n"
             "'p' - toggle USB pullup\n"
             "'L' - send long string over USB\n"
             "'R' - software reset\n"
@@ -182,15 +252,17 @@ int main(void){
             }*/
         }
         usb_proc();
+        if(bench_on) bench_proc();
         char *txt, *ans;
-        if((txt = get_USB())){
+        if(loopback) loopback_proc();
+        else if((txt = get_USB())){
             ans = parse_cmd(txt);
             if(ans) USB_send(ans);
         }
         int n = 0;
         if(newrate){SEND("new speed: "); printu(newrate); n = 1; newrate = 0;}
-        if(cl!=0xffff){SEND("controls: "); printuhex(cl); n = 1; cl = 0xffff;}
-        if(br){SEND("break"); n = 1; br = 0;}
+        if(cl!=0xffff){SEND("controls: "); printuhex(cl); n = 1; cl = 0xffff; loopback_stop();}
+        if(br){SEND("break"); n = 1; br = 0; loopback_stop();}
         if(n) newline();
     }
     return 0;
@@ -24,12 +24,46 @@
 #include "usb_lib.h"
 #include "usart.h"
 
-// incoming buffer size
-#define IDATASZ     (256)
-static uint8_t incoming_data[IDATASZ];
+// receive ring: EP2 handler puts data here right from packet memory
+#define RXRINGMASK  (USB_RXRINGSZ - 1)
+static uint8_t rxring[USB_RXRINGSZ];
+static volatile uint16_t rxhead = 0, rxtail = 0; // write (IRQ) and read (USB_receive) positions
 static uint8_t ovfl = 0;
-static uint16_t idatalen = 0;
-static volatile uint8_t tx_succesfull = 0;
+
+// transmit ring: USB_send() puts data here, EP3 IN interrupt sends next packet
+#define TXRINGMASK  (USB_TXRINGSZ - 1)
+static uint8_t txring[USB_TXRINGSZ];
+static volatile uint16_t txhead = 0, txtail = 0; // write (USB_send) and read (IRQ) positions
+static volatile uint8_t txbusy = 0; // length of packet in pending IN transaction
+static volatile uint8_t txnext = 0; // length of packet prepared in second buffer (double-buffered EP3)
+volatile uint32_t USB_txdropped = 0;
+
+/**
+ * @brief tx_getpacket - put next packet from transmit ring right into EP3 buffer
+ * @return packet length
+ */
+static uint16_t tx_getpacket(){
+    uint16_t t = txtail, h = txhead;
+    if(t == h) return 0;
+    pma_iter_t it;
+    EP_WriteIter(3, &it);
+    while(t != h && it.len < USB_TXBUFSZ - 1){ // short packet ends transfer: no need in ZLP
+        pma_putbyte(&it, txring[t]);
+        t = (t + 1) & TXRINGMASK;
+    }
+    EP_WriteCommit(&it);
+    txtail = t;
+    return it.len;
+}
+
+// put byte into transmit ring, @return 0 if it is full
+static inline int tx_putchar(uint16_t *h, uint8_t c){
+    uint16_t nxt = (*h + 1) & TXRINGMASK;
+    if(nxt == txtail) return 0;
+    txring[*h] = c;
+    *h = nxt;
+    return 1;
+}
 
 // interrupt IN handler (never used?)
 static uint16_t EP1_Handler(ep_t ep){
@@ -43,27 +77,71 @@ static uint16_t EP1_Handler(ep_t ep){
     return ep.status;
 }
 
+// prepare next packet in application buffer of double-buffered EP3
+static void tx_prepare(){
+    if(!txnext) txnext = (uint8_t)tx_getpacket();
+}
+
 // data IN/OUT handler
 static uint16_t EP23_Handler(ep_t ep){
     if(ep.rx_flag){
-        int rd = ep.rx_cnt, rest = IDATASZ - idatalen;
+        int rd = ep.rx_cnt, rest = RXRINGMASK - ((rxhead - rxtail) & RXRINGMASK);
         if(rd){
             if(rd <= rest){
-                idatalen += EP_Read(2, (uint16_t*)&incoming_data[idatalen]);
+                pma_iter_t it;
+                uint16_t h = rxhead;
+                EP_ReadIter(2, &it);
+                while(pma_getbyte(&it, &rxring[h])) h = (h + 1) & RXRINGMASK;
+                rxhead = h;
                 ovfl = 0;
             }else{
-                ep.status = SET_NAK_RX(ep.status);
+                // double-buffered EP will NAK by itself when both buffers are full
+                if(!ep.dblbuf) ep.status = SET_NAK_RX(ep.status);
                 ovfl = 1;
                 return ep.status;
             }
         }
-    }else if (ep.tx_flag){
-        tx_succesfull = 1;
+    }else if (ep.tx_flag){ // previous packet sent - send next
+        if(ep.dblbuf){ // next packet is ready: send it & prepare following
+            txbusy = txnext;
+            txnext = 0;
+            if(txbusy){
+                EP_DblSwitch(3);
+                tx_prepare();
+            }
+            return KEEP_STAT_TX(ep.status);
+        }
+        uint16_t l = tx_getpacket();
+        if(l) ep.status = SET_VALID_TX(ep.status);
+        else ep.status = KEEP_STAT_TX(ep.status);
+        txbusy = (uint8_t)l;
     }
     ep.status = SET_VALID_RX(ep.status);
     return ep.status;
 }
 
+// start transmission if there's no pending IN transaction
+static void tx_start(){
+    uint32_t oldcntr = USB->CNTR;
+    USB->CNTR = 0;
+    if(endpoints[3].dblbuf){
+        tx_prepare();
+        if(!txbusy && txnext){
+            txbusy = txnext;
+            txnext = 0;
+            EP_DblSwitch(3);
+            tx_prepare();
+        }
+    }else if(!txbusy){
+        uint16_t l = tx_getpacket();
+        if(l){
+            txbusy = (uint8_t)l;
+            EP_StartTx(3);
+        }
+    }
+    USB->CNTR = oldcntr;
+}
+
 void USB_setup(){
     NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
     NVIC_DisableIRQ(USB_HP_CAN1_TX_IRQn);
@@ -84,9 +162,18 @@ void usb_proc(){
         case USB_STATE_CONFIGURED:
             // make new BULK endpoint
             // Buffer have 1024 bytes, but last 256 we use for CAN bus (30.2 of RM: USB main features)
+            txhead = txtail = 0;
+            txbusy = txnext = 0;
+            rxhead = rxtail = 0; // data & NAK state of previous session
+            ovfl = 0;
             EP_Init(1, EP_TYPE_INTERRUPT, USB_EP1BUFSZ, 0, EP1_Handler); // IN1 - transmit
+#ifdef USB_DBLBUF
+            EP_InitDbl(2, EP_DBL_OUT, USB_RXBUFSZ, EP23_Handler); // OUT2 - receive data
+            EP_InitDbl(3, EP_DBL_IN, USB_TXBUFSZ, EP23_Handler); // IN3 - transmit data
+#else
             EP_Init(2, EP_TYPE_BULK, 0, USB_RXBUFSZ, EP23_Handler); // OUT2 - receive data
             EP_Init(3, EP_TYPE_BULK, USB_TXBUFSZ, 0, EP23_Handler); // IN3 - transmit data
+#endif
             USB_Dev.USB_Status = USB_STATE_CONNECTED;
             DBG("Connected");
         break;
@@ -101,50 +188,90 @@ void usb_proc(){
     }
 }
 
-void USB_send(const char *buf){
-    if(!usbON) return; // USB disconnected
-    uint16_t l = 0, ctr = 0;
-    const char *p = buf;
-    while(*p++) ++l;
-    while(l){
-        uint16_t s = (l > USB_TXBUFSZ) ? USB_TXBUFSZ : l;
-        tx_succesfull = 0;
-        EP_Write(3, (uint8_t*)&buf[ctr], s);
-        uint32_t ctra = 1000000;
-        while(--ctra && tx_succesfull == 0){
-            IWDG->KR = IWDG_REFRESH;
-        }
-        if(tx_succesfull == 0){usbON = 0; DBG("USB disconnected"); return;} // usb is OFF?
-        l -= s;
-        ctr += s;
-    }
+/**
+ * @brief USB_write - put data into transmit ring (without waiting)
+ * @param buf - data to send
+ * @param len - its length
+ * @return amount of bytes queued (the rest is dropped if ring is full)
+ */
+int USB_write(const uint8_t *buf, int len){
+    if(!usbON) return 0; // USB disconnected
+    uint16_t h = txhead;
+    int l = 0;
+    while(l < len && tx_putchar(&h, buf[l])) ++l;
+    USB_txdropped += len - l; // ring is full
+    txhead = h;
+    tx_start();
+    return l;
 }
 
 /**
- * @brief USB_receive
- * @param buf (i) - buffer for received data
- * @param bufsize - its size
- * @return amount of received bytes
+ * @brief USB_send - put string into transmit ring (without waiting)
+ * @param buf - string to send
+ * @return amount of bytes queued
  */
-int USB_receive(char *buf, int bufsize){
-    if(bufsize < 1 || !idatalen) return 0;
+int USB_send(const char *buf){
+    int len = 0;
+    while(buf[len]) ++len;
+    return USB_write((const uint8_t*)buf, len);
+}
+
+/**
+ * @brief USB_txpending
+ * @return amount of bytes not received by host yet
+ */
+int USB_txpending(){
+    return ((txhead - txtail) & TXRINGMASK) + txbusy + txnext;
+}
+
+/**
+ * @brief USB_rxpeek - get received data without copying
+ * @param data (o) - pointer to first byte
+ * @return amount of data available by this pointer (till the end of receive ring)
+ */
+int USB_rxpeek(const uint8_t **data){
+    uint16_t h = rxhead, t = rxtail;
+    *data = &rxring[t];
+    if(h >= t) return h - t;
+    return USB_RXRINGSZ - t;
+}
+
+/**
+ * @brief USB_rxskip - remove data from receive ring (after USB_rxpeek())
+ * @param n - amount of bytes
+ */
+void USB_rxskip(int n){
+    if(n < 1) return;
+    rxtail = (rxtail + n) & RXRINGMASK;
+    if(!ovfl) return;
+    // there was no place for last packet: try to take it now
     uint32_t oldcntr = USB->CNTR;
     USB->CNTR = 0;
-    int sz = (idatalen > bufsize) ? bufsize : idatalen, rest = idatalen - sz;
-    for(int i = 0; i < sz; ++i) buf[i] = incoming_data[i];
-    if(rest > 0){
-        uint8_t *ptr = &incoming_data[sz];
-        for(int i = 0; i < rest; ++i) incoming_data[i] = *ptr++;
-        idatalen = rest;
-    }else idatalen = 0;
-    if(ovfl){
-        EP23_Handler(endpoints[2]);
+    EP23_Handler(endpoints[2]);
+    if(!ovfl && !endpoints[2].dblbuf){ // double-buffered EP got its buffer back in EP_Read()
         uint16_t epstatus = USB->EPnR[2];
         epstatus = CLEAR_DTOG_RX(epstatus);
         epstatus = SET_VALID_RX(epstatus);
         USB->EPnR[2] = epstatus;
     }
     USB->CNTR = oldcntr;
-    return sz;
 }
 
+/**
+ * @brief USB_receive
+ * @param buf (i) - buffer for received data
+ * @param bufsize - its size
+ * @return amount of received bytes
+ */
+int USB_receive(char *buf, int bufsize){
+    int sz = 0;
+    while(sz < bufsize){
+        const uint8_t *data;
+        int l = USB_rxpeek(&data);
+        if(!l) break;
+        if(l > bufsize - sz) l = bufsize - sz;
+        for(int i = 0; i < l; ++i) buf[sz++] = data[i];
+        USB_rxskip(l);
+    }
+    return sz;
+}
@@ -27,10 +27,23 @@
 #include "hardware.h"
 
 #define BUFFSIZE   (64)
+// use double-buffered bulk endpoints (comment to use single-buffered)
+#define USB_DBLBUF
+// transmit ring buffer size (power of 2)
+#define USB_TXRINGSZ    (1024)
+// receive ring buffer size (power of 2)
+#define USB_RXRINGSZ    (256)
+
+// bytes dropped by USB_send() due to full transmit ring
+extern volatile uint32_t USB_txdropped;
 
 void USB_setup();
 void usb_proc();
-void USB_send(const char *buf);
+int USB_send(const char *buf);
+int USB_write(const uint8_t *buf, int len);
+int USB_txpending();
 int USB_receive(char *buf, int bufsize);
+int USB_rxpeek(const uint8_t **data);
+void USB_rxskip(int n);
 
 #endif // __USB_H__
@@ -440,9 +440,68 @@ int EP_Init(uint8_t number, uint8_t type, uint16_t txsz, uint16_t rxsz, uint16_t
     lastaddr += rxsz;
     USB_BTABLE->EP[number].USB_COUNT_RX = countrx << 10;
     endpoints[number].func = func;
+    endpoints[number].dblbuf = EP_DBL_NONE;
     return 0;
 }
 
+/**
+ * Double-buffered BULK endpoint initialisation
+ * Both BTABLE buffers are used for one direction: USB_ADDR_TX/USB_COUNT_TX are buffer 0,
+ * USB_ADDR_RX/USB_COUNT_RX are buffer 1. Hardware uses buffer DTOG (DTOG_RX for OUT, DTOG_TX for IN),
+ * application - buffer SW_BUF (DTOG_TX for OUT, DTOG_RX for IN); when they are equal EP NAKs.
+ * So OUT endpoint could receive next packet while application reads previous and IN endpoint
+ * could send next packet just after previous one was sent.
+ * @param number - EP num (1...7)
+ * @param dir - EP_DBL_OUT or EP_DBL_IN
+ * @param bufsz - size of each buffer
+ * @param uint16_t (*func)(ep_t *ep) - EP handler function
+ * @return 0 if all OK
+ */
+int EP_InitDbl(uint8_t number, uint8_t dir, uint16_t bufsz, uint16_t (*func)(ep_t ep)){
+    if(number == 0 || number >= STM32ENDPOINTS) return 4; // EP0 is control
+    if(dir != EP_DBL_OUT && dir != EP_DBL_IN) return 5;
+    if(bufsz > USB_BTABLE_SIZE/2) return 1; // buffer too large
+    if(lastaddr + 2*bufsz >= USB_BTABLE_SIZE) return 2; // out of btable
+    uint16_t cnt = 0; // counter value (BL_SIZE/NUM_BLOCK for OUT)
+    if(dir == EP_DBL_OUT){
+        if(bufsz & 1 || bufsz > 512) return 3; // wrong rx buffer size
+        if(bufsz < 64) cnt = bufsz / 2;
+        else{
+            if(bufsz & 0x1f) return 3; // should be multiple of 32
+            cnt = 31 + bufsz / 32;
+        }
+        cnt <<= 10;
+    }
+    USB->EPnR[number] = (EP_TYPE_BULK << 9) | USB_EPnR_EP_KIND | (number & USB_EPnR_EA);
+    // DTOG=0; OUT: STAT_RX=VALID, SW_BUF=1; IN: STAT_TX=VALID, SW_BUF=0 (nothing to send)
+    if(dir == EP_DBL_OUT) USB->EPnR[number] ^= USB_EPnR_STAT_RX | USB_EPnR_DTOG_TX;
+    else USB->EPnR[number] ^= USB_EPnR_STAT_TX;
+    USB_BTABLE->EP[number].USB_ADDR_TX = lastaddr;
+    endpoints[number].tx_buf = (uint16_t *)(USB_BTABLE_BASE + lastaddr*2);
+    lastaddr += bufsz;
+    USB_BTABLE->EP[number].USB_COUNT_TX = cnt;
+    USB_BTABLE->EP[number].USB_ADDR_RX = lastaddr;
+    endpoints[number].rx_buf = (uint16_t *)(USB_BTABLE_BASE + lastaddr*2);
+    lastaddr += bufsz;
+    USB_BTABLE->EP[number].USB_COUNT_RX = cnt;
+    endpoints[number].txbufsz = bufsz;
+    endpoints[number].func = func;
+    endpoints[number].dblbuf = dir;
+    return 0;
+}
+
+/**
+ * Toggle SW_BUF of double-buffered EP: give application buffer to USB and take other one
+ * (OUT: free already read buffer; IN: send just written buffer)
+ * @param number - EP number
+ */
+void EP_DblSwitch(uint8_t number){
+    uint16_t swbuf = (endpoints[number].dblbuf == EP_DBL_OUT) ? USB_EPnR_DTOG_TX : USB_EPnR_DTOG_RX;
+    // write 1 to CTR bits (no effect) and 0 to all toggle bits except SW_BUF
+    USB->EPnR[number] = (USB->EPnR[number] & (USB_EPnR_EP_TYPE | USB_EPnR_EP_KIND | USB_EPnR_EA))
+                        | USB_EPnR_CTR_RX | USB_EPnR_CTR_TX | swbuf;
+}
+
 //extern int8_t dump;
 // standard IRQ handler
 void usb_lp_can_rx0_isr(){
@@ -473,7 +532,10 @@ void usb_lp_can_rx0_isr(){
         endpoints[n].setup_flag = (epstatus & USB_EPnR_SETUP) ? 1 : 0;
         endpoints[n].tx_flag = (epstatus & USB_EPnR_CTR_TX) ? 1 : 0;
         // copy received bytes amount
-        endpoints[n].rx_cnt = USB_BTABLE->EP[n].USB_COUNT_RX & 0x3FF; // low 10 bits is counter
+        if(endpoints[n].dblbuf == EP_DBL_OUT && (epstatus & USB_EPnR_DTOG_TX)) // SW_BUF==1 -> packet is in buffer 0
+            endpoints[n].rx_cnt = USB_BTABLE->EP[n].USB_COUNT_TX & 0x3FF;
+        else
+            endpoints[n].rx_cnt = USB_BTABLE->EP[n].USB_COUNT_RX & 0x3FF; // low 10 bits is counter
         // check direction
         if(USB->ISTR & USB_ISTR_DIR){ // OUT interrupt - receive data, CTR_RX==1 (if CTR_TX == 1 - two pending transactions: receive following by transmit)
             if(n == 0){ // control endpoint
@@ -508,8 +570,19 @@ void usb_lp_can_rx0_isr(){
     USB->ISTR = 0;
 }
 
+// PMA buffer for data to transmit & its counter register (application buffer for double-buffered EP)
+static __IO uint32_t *txbuffer(uint8_t number, __IO uint32_t **cnt){
+    if(endpoints[number].dblbuf == EP_DBL_IN && (USB->EPnR[number] & USB_EPnR_DTOG_RX)){ // SW_BUF==1
+        *cnt = &USB_BTABLE->EP[number].USB_COUNT_RX;
+        return (__IO uint32_t *)endpoints[number].rx_buf;
+    }
+    *cnt = &USB_BTABLE->EP[number].USB_COUNT_TX;
+    return (__IO uint32_t *)endpoints[number].tx_buf;
+}
+
 /**
  * Write data to EP buffer (called from IRQ handler)
+ * for double-buffered EP data is written into application buffer, call EP_DblSwitch() to send it
  * @param number - EP number
  * @param *buf - array with data
  * @param size - its size
@@ -520,22 +593,23 @@ void EP_WriteIRQ(uint8_t number, const uint8_t *buf, uint16_t size){
     uint16_t N2 = (size + 1) >> 1;
     // the buffer is 16-bit, so we should copy data as it would be uint16_t
     uint16_t *buf16 = (uint16_t *)buf;
-    uint32_t *out = (uint32_t *)endpoints[number].tx_buf;
+    __IO uint32_t *cnt, *out = txbuffer(number, &cnt);
     for(i = 0; i < N2; ++i, ++out){
         *out = buf16[i];
     }
-    USB_BTABLE->EP[number].USB_COUNT_TX = size;
+    *cnt = size;
 }
 
 /**
- * Write data to EP buffer (called outside IRQ handler)
+ * Start transmission of data written into EP buffer (called outside IRQ handler)
  * @param number - EP number
- * @param *buf - array with data
- * @param size - its size
  */
-void EP_Write(uint8_t number, const uint8_t *buf, uint16_t size){
+void EP_StartTx(uint8_t number){
+    if(endpoints[number].dblbuf){
+        EP_DblSwitch(number);
+        return;
+    }
     uint16_t status = USB->EPnR[number];
-    EP_WriteIRQ(number, buf, size);
     //status = SET_NAK_RX(status);
     status = SET_VALID_TX(status);
     status = KEEP_DTOG_TX(status);
@@ -543,6 +617,47 @@ void EP_Write(uint8_t number, const uint8_t *buf, uint16_t size){
     USB->EPnR[number] = status;
 }
 
+/**
+ * Write data to EP buffer (called outside IRQ handler)
+ * @param number - EP number
+ * @param *buf - array with data
+ * @param size - its size
+ */
+void EP_Write(uint8_t number, const uint8_t *buf, uint16_t size){
+    EP_WriteIRQ(number, buf, size);
+    EP_StartTx(number);
+}
+
+/*
+ * Prepare writing of data right into EP buffer (by pma_putbyte())
+ * @param *it - iterator to initialize
+ */
+void EP_WriteIter(uint8_t number, pma_iter_t *it){
+    it->word = txbuffer(number, &it->count);
+    it->len = 0;
+    it->odd = 0;
+}
+
+/*
+ * Finish writing by pma_putbyte(): store last byte and data length
+ * @param *it - iterator
+ */
+void EP_WriteCommit(pma_iter_t *it){
+    if(it->odd) *it->word = it->half;
+    *it->count = it->len;
+}
+
+// PMA buffer with received data; double-buffered EP gets previous buffer back
+// before reading, so next packet could be received meanwhile
+static __IO uint32_t *rxbuffer(uint8_t number){
+    __IO uint32_t *in = (__IO uint32_t *)endpoints[number].rx_buf;
+    if(endpoints[number].dblbuf == EP_DBL_OUT){
+        if(USB->EPnR[number] & USB_EPnR_DTOG_TX) in = (__IO uint32_t *)endpoints[number].tx_buf; // SW_BUF==1 -> buffer 0
+        EP_DblSwitch(number);
+    }
+    return in;
+}
+
 /*
  * Copy data from EP buffer into user buffer area
  * @param *buf - user array for data
@@ -550,10 +665,21 @@ void EP_Write(uint8_t number, const uint8_t *buf, uint16_t size){
  */
 int EP_Read(uint8_t number, uint16_t *buf){
     int n = (endpoints[number].rx_cnt + 1) >> 1;
-    uint32_t *in = (uint32_t *)endpoints[number].rx_buf;
-    if(n){
-        for(int i = 0; i < n; ++i, ++in)
-            buf[i] = *(uint16_t*)in;
-    }
+    __IO uint32_t *in = rxbuffer(number);
+    for(int i = 0; i < n; ++i, ++in)
+        buf[i] = (uint16_t)*in;
     return endpoints[number].rx_cnt;
 }
+
+/*
+ * Prepare reading of received data right from EP buffer (by pma_getbyte())
+ * Single-buffered EP should be read before leaving its handler (buffer will be overwritten by next packet)
+ * @param *it - iterator to initialize
+ * @return amount of data in buffer
+ */
+int EP_ReadIter(uint8_t number, pma_iter_t *it){
+    it->word = rxbuffer(number);
+    it->len = endpoints[number].rx_cnt;
+    it->odd = 0;
+    return it->len;
+}
@@ -113,6 +113,11 @@ typedef enum{
 #define EP_TYPE_ISO                     0x02
 #define EP_TYPE_INTERRUPT               0x03
 
+// double-buffered bulk endpoint direction (ep_t.dblbuf)
+#define EP_DBL_NONE                     0
+#define EP_DBL_OUT                      1
+#define EP_DBL_IN                       2
+
 #define LANG_US (uint16_t)0x0409
 
 #define USB_STRING(name, str)                  \
@@ -148,17 +153,52 @@ typedef struct {
 
 // endpoints state
 typedef struct __ep_t{
-    uint16_t *tx_buf;           // transmission buffer address
+    uint16_t *tx_buf;           // transmission buffer address (buffer 0 for double-buffered EP)
     uint16_t txbufsz;           // transmission buffer size
-    uint16_t *rx_buf;           // reception buffer address
+    uint16_t *rx_buf;           // reception buffer address (buffer 1 for double-buffered EP)
     uint16_t (*func)();         // endpoint action function
     uint16_t status;            // status flags
     unsigned rx_cnt  : 10;      // received data counter
     unsigned tx_flag : 1;       // transmission flag
     unsigned rx_flag : 1;       // reception flag
     unsigned setup_flag : 1;    // this is setup packet (only for EP0)
+    unsigned dblbuf : 2;        // EP_DBL_NONE or direction of double-buffered EP
 } ep_t;
 
+// in-place reader of packet memory: each 32-bit PMA word holds 2 bytes of data
+typedef struct{
+    __IO uint32_t *word;        // next PMA word
+    uint16_t half;              // data of current word
+    uint16_t len;               // rest of data
+    uint8_t odd;                // ==1 if next byte is high byte of `half`
+    __IO uint32_t *count;       // counter register (for writing)
+} pma_iter_t;
+
+// get next byte from PMA, @return 0 if there's no more data
+static inline int pma_getbyte(pma_iter_t *it, uint8_t *b){
+    if(!it->len) return 0;
+    --it->len;
+    if(it->odd){
+        *b = (uint8_t)(it->half >> 8);
+    }else{
+        it->half = (uint16_t)*it->word++;
+        *b = (uint8_t)it->half;
+    }
+    it->odd ^= 1;
+    return 1;
+}
+
+// put next byte into PMA (size isn't checked!)
+static inline void pma_putbyte(pma_iter_t *it, uint8_t b){
+    ++it->len;
+    if(it->odd){
+        *it->word++ = it->half | (uint16_t)(b << 8);
+    }else{
+        it->half = b;
+    }
+    it->odd ^= 1;
+}
+
 // USB status & its address
 typedef struct {
     uint8_t  USB_Status;
@@ -195,9 +235,15 @@ extern uint8_t usbON;
 void USB_Init();
 void USB_ResetState();
 int EP_Init(uint8_t number, uint8_t type, uint16_t txsz, uint16_t rxsz, uint16_t (*func)(ep_t ep));
+int EP_InitDbl(uint8_t number, uint8_t dir, uint16_t bufsz, uint16_t (*func)(ep_t ep));
+void EP_DblSwitch(uint8_t number);
 void EP_WriteIRQ(uint8_t number, const uint8_t *buf, uint16_t size);
 void EP_Write(uint8_t number, const uint8_t *buf, uint16_t size);
+void EP_StartTx(uint8_t number);
+void EP_WriteIter(uint8_t number, pma_iter_t *it);
+void EP_WriteCommit(pma_iter_t *it);
 int EP_Read(uint8_t number, uint16_t *buf);
+int EP_ReadIter(uint8_t number, pma_iter_t *it);
 usb_LineCoding getLineCoding();
 
 void linecoding_handler(usb_LineCoding *lc);
@@ -0,0 +1,586 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// this file should be included JUST ONCE!
+// only in fonts.c
+// generated by scrtest/fontrle.c from font16.h, don't edit
+
+#define FONT16BYTES         32
+#define FONT16HEIGHT        16
+#define FONT16BASELINE      0
+
+// offsets of symbols in table
+const uint16_t font16rle_offsets[SYMBOLS_AMOUNT] = {
+       0,    3,   16,   25,   62,   97,  133,  161,  172,  189,  206,  216,  227,  238,  245,  254,
+     265,  289,  305,  337,  364,  385,  408,  436,  458,  486,  511,  522,  537,  552,  563,  578,
+     597,  630,  656,  684,  711,  734,  761,  774,  804,  819,  826,  838,  868,  877,  900,  925,
+     948,  967,  992, 1026, 1052, 1065, 1082, 1105, 1134, 1161, 1182, 1208, 1219, 1243, 1254, 1267,
+    1274, 1283, 1298, 1315, 1330, 1347, 1363, 1376, 1394, 1407, 1418, 1432, 1450, 1457, 1475, 1486,
+    1501, 1518, 1535, 1546, 1561, 1577, 1588, 1599, 1622, 1637, 1660, 1675, 1691, 1698, 1714, 1723,
+    1726, 1729, 1732, 1735, 1738, 1741, 1744, 1747, 1750, 1753, 1756, 1759, 1762, 1765, 1768, 1771,
+    1774, 1777, 1780, 1783, 1786, 1789, 1792, 1795, 1798, 1801, 1804, 1807, 1810, 1813, 1816, 1819,
+    1822, 1825, 1828, 1831, 1850, 1853, 1856, 1859, 1862, 1865, 1868, 1871, 1874, 1877, 1880, 1883,
+    1886, 1889, 1892, 1895, 1923, 1926, 1929, 1932, 1935, 1938, 1941, 1944, 1947, 1950, 1953, 1956,
+    1959, 1987, 2002, 2020, 2033, 2055, 2071, 2098, 2107, 2122, 2137, 2155, 2170, 2183, 2204, 2215,
+    2230, 2239, 2255, 2272, 2287, 2296, 2319, 2348, 2364, 2379, 2398, 2413, 2426, 2442, 2457, 2469,
+    2492, 2523, 2549, 2578, 2591, 2615, 2642, 2671, 2684, 2711, 2736, 2761, 2791, 2809, 2832, 2847,
+    2870, 2883, 2911, 2930, 2957, 2970, 2994, 3027, 3055, 3074, 3097, 3116, 3131, 3158, 3173, 3188,
+};
+
+// symbol width & PackBits stream of its bitmap (3213 bytes instead of 7392)
+// (bitmap bytes are by columns: the first bytes of all rows, then the second ones etc)
+const uint8_t font16rle_table[3213] = {
+    // 0x20
+    0x04, 0x9f, 0x00,
+    // 0x21 - '!'
+    0x04, 0x89, 0xe0, 0x00, 0x40, 0x81, 0x00, 0x02, 0x40, 0xe0, 0x40, 0x8f, 0x00,
+    // 0x22 - '"'
+    0x08, 0x04, 0x44, 0xee, 0x66, 0x44, 0x88, 0x9a, 0x00,
+    // 0x23 - '#'
+    0x0f, 0x00, 0x00, 0x81, 0x03, 0x81, 0x06, 0x01, 0x3f, 0x7f, 0x81, 0x18, 0x01, 0x7f, 0xff, 0x81,
+    0x61, 0x81, 0xc3, 0x81, 0x00, 0x81, 0x0c, 0x81, 0x18, 0x01, 0xfc, 0xf8, 0x81, 0x60, 0x01, 0xf8,
+    0xf0, 0x81, 0x80, 0x82, 0x00,
+    // 0x24 - '$'
+    0x0d, 0x01, 0x0f, 0x33, 0x81, 0x62, 0x03, 0x32, 0x0e, 0x07, 0x03, 0x82, 0x02, 0x08, 0x62, 0xc2,
+    0x72, 0x1f, 0x07, 0x00, 0x80, 0xc0, 0x40, 0x82, 0x00, 0x01, 0x80, 0xe0, 0x82, 0x70, 0x03, 0x60,
+    0xe0, 0xc0, 0x00,
+    // 0x25 - '%'
+    0x10, 0x01, 0x30, 0x78, 0x82, 0xcc, 0x02, 0x78, 0x31, 0x01, 0x81, 0x03, 0x81, 0x06, 0x81, 0x0c,
+    0x03, 0x18, 0x30, 0x18, 0x30, 0x81, 0x60, 0x81, 0xc0, 0x81, 0x80, 0x02, 0x00, 0x18, 0x7e, 0x82,
+    0x66, 0x01, 0x3c, 0x18,
+    // 0x26 - '&'
+    0x0c, 0x81, 0x00, 0x01, 0x3e, 0x7f, 0x81, 0x63, 0x07, 0x3e, 0x3c, 0x6c, 0xce, 0xc7, 0xc3, 0x7f,
+    0x3c, 0x89, 0x00, 0x05, 0x80, 0xc0, 0x80, 0xc0, 0xe0, 0x40, 0x81, 0x00,
+    // 0x27 - '''
+    0x05, 0x00, 0x60, 0x81, 0xf0, 0x02, 0x60, 0x40, 0x80, 0x99, 0x00,
+    // 0x28 - '('
+    0x07, 0x02, 0x04, 0x18, 0x30, 0x81, 0x60, 0x85, 0xe0, 0x81, 0x60, 0x02, 0x30, 0x18, 0x04, 0x8f,
+    0x00,
+    // 0x29 - ')'
+    0x07, 0x02, 0x80, 0x60, 0x30, 0x81, 0x18, 0x85, 0x1c, 0x81, 0x18, 0x02, 0x30, 0x60, 0x80, 0x8f,
+    0x00,
+    // 0x2a - '*'
+    0x08, 0x05, 0x00, 0x54, 0x38, 0xfe, 0x38, 0x54, 0x99, 0x00,
+    // 0x2b - '+'
+    0x09, 0x81, 0x00, 0x82, 0x18, 0x81, 0xff, 0x82, 0x18, 0x95, 0x00,
+    // 0x2c - ','
+    0x04, 0x8a, 0x00, 0x04, 0x40, 0xe0, 0x60, 0x40, 0x80, 0x8f, 0x00,
+    // 0x2d - '-'
+    0x06, 0x86, 0x00, 0x81, 0xf8, 0x96, 0x00,
+    // 0x2e - '.'
+    0x04, 0x8c, 0x00, 0x02, 0x40, 0xe0, 0x40, 0x8f, 0x00,
+    // 0x2f - '/'
+    0x05, 0x81, 0x00, 0x82, 0x30, 0x84, 0x60, 0x82, 0xc0, 0x92, 0x00,
+    // 0x30 - '0'
+    0x0b, 0x03, 0x1c, 0x3f, 0x77, 0x73, 0x86, 0xe1, 0x04, 0x61, 0x71, 0x7b, 0x3f, 0x0e, 0x81, 0x00,
+    0x81, 0x80, 0x87, 0xc0, 0x81, 0x80, 0x81, 0x00,
+    // 0x31 - '1'
+    0x08, 0x07, 0x04, 0x0e, 0x1e, 0x3e, 0x6e, 0xce, 0x8e, 0x1e, 0x84, 0x1c, 0x82, 0x1e, 0x8f, 0x00,
+    // 0x32 - '2'
+    0x0b, 0x01, 0x1f, 0x7b, 0x81, 0xe1, 0x07, 0x61, 0x01, 0x03, 0x07, 0x0e, 0x1c, 0x38, 0x70, 0x81,
+    0xe0, 0x81, 0xff, 0x01, 0x00, 0x80, 0x83, 0xc0, 0x00, 0x80, 0x85, 0x00, 0x81, 0x80, 0x00, 0x00,
+    // 0x33 - '3'
+    0x0a, 0x02, 0x3c, 0x66, 0xc3, 0x81, 0x03, 0x03, 0x06, 0x1c, 0x06, 0x03, 0x81, 0x01, 0x00, 0x61,
+    0x81, 0xc1, 0x01, 0x63, 0x3e, 0x88, 0x00, 0x84, 0x80, 0x81, 0x00,
+    // 0x34 - '4'
+    0x0b, 0x0a, 0x00, 0x01, 0x03, 0x07, 0x0d, 0x19, 0x31, 0x61, 0xc1, 0xff, 0x7f, 0x84, 0x01, 0x88,
+    0x80, 0x81, 0xc0, 0x84, 0x80,
+    // 0x35 - '5'
+    0x0a, 0x81, 0xff, 0x83, 0xc0, 0x02, 0xfc, 0x7e, 0x07, 0x82, 0x01, 0x81, 0xc1, 0x02, 0x67, 0x3c,
+    0x80, 0x87, 0x00, 0x84, 0x80, 0x81, 0x00,
+    // 0x36 - '6'
+    0x0a, 0x03, 0x1f, 0x31, 0x61, 0x60, 0x81, 0xc0, 0x02, 0xcc, 0xbf, 0xe3, 0x82, 0xc1, 0x81, 0xe1,
+    0x02, 0x73, 0x3c, 0x00, 0x81, 0x80, 0x84, 0x00, 0x85, 0x80, 0x81, 0x00,
+    // 0x37 - '7'
+    0x0a, 0x81, 0xff, 0x03, 0x03, 0x07, 0x06, 0x0e, 0x81, 0x0c, 0x00, 0x1c, 0x82, 0x18, 0x00, 0x38,
+    0x82, 0x30, 0x82, 0x80, 0x8c, 0x00,
+    // 0x38 - '8'
+    0x0a, 0x01, 0x3e, 0x63, 0x82, 0xc1, 0x00, 0x63, 0x81, 0x3e, 0x00, 0x63, 0x83, 0xc1, 0x02, 0xe3,
+    0x7f, 0x3e, 0x81, 0x00, 0x82, 0x80, 0x83, 0x00, 0x84, 0x80, 0x81, 0x00,
+    // 0x39 - '9'
+    0x0a, 0x02, 0x1c, 0x77, 0xe3, 0x82, 0xc1, 0x02, 0xe3, 0x7f, 0x3d, 0x81, 0x01, 0x04, 0x03, 0xc3,
+    0xc7, 0x6e, 0x3c, 0x81, 0x00, 0x89, 0x80, 0x83, 0x00,
+    // 0x3a - ':'
+    0x04, 0x83, 0x00, 0x82, 0xe0, 0x82, 0x00, 0x82, 0xe0, 0x92, 0x00,
+    // 0x3b - ';'
+    0x03, 0x83, 0x00, 0x81, 0xc0, 0x83, 0x00, 0x81, 0xc0, 0x81, 0x40, 0x00, 0x80, 0x90, 0x00,
+    // 0x3c - '<'
+    0x09, 0x82, 0x00, 0x08, 0x01, 0x07, 0x1e, 0x78, 0xe0, 0x78, 0x1e, 0x07, 0x01, 0x93, 0x00,
+    // 0x3d - '='
+    0x08, 0x84, 0x00, 0x81, 0xfe, 0x81, 0x00, 0x81, 0xfe, 0x94, 0x00,
+    // 0x3e - '>'
+    0x09, 0x82, 0x00, 0x08, 0x80, 0xe0, 0x78, 0x1e, 0x07, 0x1e, 0x78, 0xe0, 0x80, 0x93, 0x00,
+    // 0x3f - '?'
+    0x09, 0x81, 0x00, 0x06, 0x3c, 0x7e, 0xe3, 0xc3, 0x07, 0x0e, 0x1c, 0x81, 0x18, 0x00, 0x00, 0x81,
+    0x18, 0x91, 0x00,
+    // 0x40 - '@'
+    0x10, 0x05, 0x07, 0x1f, 0x38, 0x73, 0x6f, 0xec, 0x83, 0xd8, 0x0b, 0xdf, 0x6f, 0x70, 0x38, 0x1f,
+    0x07, 0xe0, 0xf8, 0x1c, 0xbc, 0xf6, 0x76, 0x82, 0x66, 0x06, 0xec, 0xf8, 0x70, 0x06, 0x1c, 0xf8,
+    0xe0,
+    // 0x41 - 'A'
+    0x0c, 0x81, 0x00, 0x81, 0x0e, 0x82, 0x1b, 0x81, 0x31, 0x01, 0x3f, 0x7f, 0x81, 0x60, 0x00, 0xc0,
+    0x88, 0x00, 0x82, 0x80, 0x82, 0xc0, 0x00, 0x60, 0x81, 0x00,
+    // 0x42 - 'B'
+    0x0b, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc1, 0x81, 0xff, 0x00, 0xc1, 0x81, 0xc0, 0x81, 0xff, 0x84,
+    0x00, 0x83, 0x80, 0x01, 0x00, 0x80, 0x82, 0xc0, 0x00, 0x80, 0x82, 0x00,
+    // 0x43 - 'C'
+    0x0b, 0x81, 0x00, 0x02, 0x1f, 0x7f, 0x61, 0x85, 0xc0, 0x02, 0x61, 0x7f, 0x1f, 0x84, 0x00, 0x02,
+    0x80, 0xc0, 0x80, 0x83, 0x00, 0x02, 0x80, 0xc0, 0x80, 0x82, 0x00,
+    // 0x44 - 'D'
+    0x0b, 0x81, 0x00, 0x02, 0xfe, 0xff, 0xc1, 0x85, 0xc0, 0x02, 0xc1, 0xff, 0xfe, 0x84, 0x00, 0x81,
+    0x80, 0x85, 0xc0, 0x81, 0x80, 0x82, 0x00,
+    // 0x45 - 'E'
+    0x0a, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x83, 0x00, 0x81,
+    0x80, 0x82, 0x00, 0x81, 0x80, 0x82, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0x46 - 'F'
+    0x09, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xfe, 0x84, 0xc0, 0x91, 0x00,
+    // 0x47 - 'G'
+    0x0b, 0x81, 0x00, 0x02, 0x1f, 0x7f, 0x61, 0x82, 0xc0, 0x81, 0xc7, 0x03, 0xc0, 0x61, 0x7f, 0x1f,
+    0x84, 0x00, 0x02, 0x80, 0xc0, 0x80, 0x81, 0x00, 0x83, 0xc0, 0x00, 0x80, 0x82, 0x00,
+    // 0x48 - 'H'
+    0x0a, 0x81, 0x00, 0x84, 0xc1, 0x81, 0xff, 0x84, 0xc1, 0x83, 0x00, 0x8b, 0x80, 0x81, 0x00,
+    // 0x49 - 'I'
+    0x03, 0x81, 0x00, 0x8b, 0xc0, 0x91, 0x00,
+    // 0x4a - 'J'
+    0x09, 0x81, 0x00, 0x87, 0x03, 0x03, 0xc3, 0xe7, 0x7e, 0x3c, 0x91, 0x00,
+    // 0x4b - 'K'
+    0x0b, 0x81, 0x00, 0x08, 0xc0, 0xc1, 0xc3, 0xc6, 0xcc, 0xde, 0xf6, 0xe3, 0xc3, 0x81, 0xc1, 0x00,
+    0xc0, 0x83, 0x00, 0x01, 0xc0, 0x80, 0x86, 0x00, 0x00, 0x80, 0x81, 0xc0, 0x81, 0x00,
+    // 0x4c - 'L'
+    0x09, 0x81, 0x00, 0x89, 0xc0, 0x81, 0xff, 0x91, 0x00,
+    // 0x4d - 'M'
+    0x0c, 0x81, 0x00, 0x81, 0xe0, 0x81, 0xf1, 0x00, 0xd1, 0x82, 0xdb, 0x82, 0xce, 0x00, 0xc4, 0x83,
+    0x00, 0x83, 0xe0, 0x87, 0x60, 0x81, 0x00,
+    // 0x4e - 'N'
+    0x0b, 0x81, 0x00, 0x01, 0xc0, 0xe0, 0x81, 0xf0, 0x00, 0xd8, 0x81, 0xcc, 0x00, 0xc6, 0x81, 0xc3,
+    0x01, 0xc1, 0xc0, 0x83, 0x00, 0x8b, 0xc0, 0x81, 0x00,
+    // 0x4f - 'O'
+    0x0b, 0x81, 0x00, 0x02, 0x1e, 0x7f, 0x61, 0x85, 0xc0, 0x02, 0x61, 0x7f, 0x1e, 0x84, 0x00, 0x81,
+    0x80, 0x85, 0xc0, 0x81, 0x80, 0x82, 0x00,
+    // 0x50 - 'P'
+    0x0a, 0x81, 0x00, 0x06, 0xfe, 0xff, 0xc3, 0xc1, 0xc3, 0xff, 0xfe, 0x84, 0xc0, 0x85, 0x00, 0x82,
+    0x80, 0x88, 0x00,
+    // 0x51 - 'Q'
+    0x0b, 0x81, 0x00, 0x02, 0x1e, 0x7f, 0x61, 0x84, 0xc0, 0x03, 0xcc, 0x67, 0x7f, 0x1d, 0x84, 0x00,
+    0x81, 0x80, 0x85, 0xc0, 0x82, 0x80, 0x01, 0xc0, 0x00,
+    // 0x52 - 'R'
+    0x0c, 0x81, 0x00, 0x81, 0xff, 0x06, 0xc1, 0xc0, 0xc1, 0xff, 0xfe, 0xc7, 0xc3, 0x81, 0xc1, 0x00,
+    0xc0, 0x84, 0x00, 0x00, 0x80, 0x82, 0xc0, 0x00, 0x80, 0x81, 0x00, 0x81, 0x80, 0x01, 0xc0, 0xe0,
+    0x81, 0x00,
+    // 0x53 - 'S'
+    0x0a, 0x81, 0x00, 0x0b, 0x3e, 0x7f, 0xc3, 0xc1, 0xf0, 0x7e, 0x1f, 0x03, 0xc1, 0xe3, 0x7f, 0x3e,
+    0x85, 0x00, 0x81, 0x80, 0x82, 0x00, 0x82, 0x80, 0x83, 0x00,
+    // 0x54 - 'T'
+    0x0b, 0x81, 0x00, 0x81, 0xff, 0x89, 0x0c, 0x83, 0x00, 0x81, 0xc0, 0x8b, 0x00,
+    // 0x55 - 'U'
+    0x0b, 0x81, 0x00, 0x88, 0xc0, 0x02, 0xe1, 0x7f, 0x3f, 0x83, 0x00, 0x89, 0xc0, 0x00, 0x80, 0x82,
+    0x00,
+    // 0x56 - 'V'
+    0x0c, 0x81, 0x00, 0x81, 0xc0, 0x81, 0x60, 0x82, 0x31, 0x81, 0x1b, 0x82, 0x0e, 0x83, 0x00, 0x81,
+    0x60, 0x81, 0xc0, 0x82, 0x80, 0x86, 0x00,
+    // 0x57 - 'W'
+    0x10, 0x81, 0x00, 0x02, 0xc3, 0xe3, 0x63, 0x81, 0x66, 0x82, 0x36, 0x83, 0x1c, 0x83, 0x00, 0x81,
+    0x86, 0x00, 0x8c, 0x81, 0xcc, 0x82, 0xd8, 0x00, 0x78, 0x82, 0x70, 0x81, 0x00,
+    // 0x58 - 'X'
+    0x0a, 0x81, 0x00, 0x04, 0xc1, 0xe3, 0x63, 0x36, 0x3e, 0x81, 0x1c, 0x04, 0x3e, 0x36, 0x63, 0xe3,
+    0xc1, 0x83, 0x00, 0x81, 0x80, 0x87, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0x59 - 'Y'
+    0x0b, 0x81, 0x00, 0x02, 0xc0, 0xe1, 0x61, 0x81, 0x33, 0x00, 0x1e, 0x85, 0x0c, 0x83, 0x00, 0x81,
+    0xc0, 0x00, 0x80, 0x8a, 0x00,
+    // 0x5a - 'Z'
+    0x0a, 0x81, 0x00, 0x81, 0x7f, 0x07, 0x03, 0x06, 0x0e, 0x0c, 0x18, 0x38, 0x30, 0x60, 0x81, 0xff,
+    0x83, 0x00, 0x81, 0x80, 0x87, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0x5b - '['
+    0x05, 0x00, 0x00, 0x81, 0xf0, 0x89, 0xc0, 0x81, 0xf0, 0x90, 0x00,
+    // 0x5c
+    0x08, 0x81, 0xc0, 0x00, 0xe0, 0x81, 0x60, 0x00, 0x70, 0x81, 0x30, 0x00, 0x38, 0x81, 0x18, 0x00,
+    0x1c, 0x81, 0x0c, 0x01, 0x0e, 0x06, 0x8f, 0x00,
+    // 0x5d - ']'
+    0x05, 0x00, 0x00, 0x81, 0xf0, 0x89, 0x30, 0x81, 0xf0, 0x90, 0x00,
+    // 0x5e - '^'
+    0x09, 0x81, 0x00, 0x00, 0x18, 0x81, 0x3c, 0x81, 0x66, 0x00, 0xc3, 0x97, 0x00,
+    // 0x5f - '_'
+    0x09, 0x8c, 0x00, 0x81, 0xff, 0x90, 0x00,
+    // 0x60 - '`'
+    0x04, 0x04, 0x00, 0xe0, 0x60, 0x30, 0x08, 0x9a, 0x00,
+    // 0x61 - 'a'
+    0x09, 0x84, 0x00, 0x08, 0x7c, 0xfe, 0xc6, 0x1e, 0x7e, 0xe6, 0xc6, 0xfe, 0x7b, 0x91, 0x00,
+    // 0x62 - 'b'
+    0x09, 0x81, 0x00, 0x82, 0xc0, 0x02, 0xdc, 0xfe, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0xfe, 0xdc, 0x91,
+    0x00,
+    // 0x63 - 'c'
+    0x08, 0x84, 0x00, 0x02, 0x3c, 0x7e, 0xe6, 0x82, 0xc0, 0x02, 0xe6, 0x7e, 0x3c, 0x91, 0x00,
+    // 0x64 - 'd'
+    0x09, 0x81, 0x00, 0x82, 0x03, 0x02, 0x3b, 0x7f, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0x7f, 0x3b, 0x91,
+    0x00,
+    // 0x65 - 'e'
+    0x08, 0x84, 0x00, 0x02, 0x38, 0x7c, 0xc6, 0x81, 0xfe, 0x03, 0xc0, 0xe6, 0x7c, 0x38, 0x91, 0x00,
+    // 0x66 - 'f'
+    0x07, 0x81, 0x00, 0x02, 0x3c, 0x7c, 0x60, 0x81, 0xf8, 0x86, 0x60, 0x91, 0x00,
+    // 0x67 - 'g'
+    0x09, 0x83, 0x00, 0x02, 0x3b, 0x7f, 0xe7, 0x82, 0xc3, 0x05, 0xe7, 0x7f, 0x3b, 0xc3, 0xff, 0x7e,
+    0x8f, 0x00,
+    // 0x68 - 'h'
+    0x09, 0x81, 0x00, 0x82, 0xc0, 0x02, 0xde, 0xff, 0xe3, 0x85, 0xc3, 0x91, 0x00,
+    // 0x69 - 'i'
+    0x03, 0x81, 0x00, 0x81, 0xc0, 0x00, 0x00, 0x88, 0xc0, 0x91, 0x00,
+    // 0x6a - 'j'
+    0x04, 0x81, 0x00, 0x81, 0x60, 0x00, 0x00, 0x88, 0x60, 0x01, 0xe0, 0xc0, 0x8f, 0x00,
+    // 0x6b - 'k'
+    0x08, 0x81, 0x00, 0x82, 0xc0, 0x02, 0xc6, 0xcc, 0xd8, 0x81, 0xf8, 0x01, 0xec, 0xcc, 0x81, 0xc6,
+    0x91, 0x00,
+    // 0x6c - 'l'
+    0x03, 0x81, 0x00, 0x8b, 0xc0, 0x91, 0x00,
+    // 0x6d - 'm'
+    0x0d, 0x84, 0x00, 0x02, 0xdc, 0xff, 0xe7, 0x85, 0xc6, 0x86, 0x00, 0x01, 0xe0, 0xf0, 0x86, 0x30,
+    0x81, 0x00,
+    // 0x6e - 'n'
+    0x09, 0x84, 0x00, 0x02, 0xde, 0xff, 0xe3, 0x85, 0xc3, 0x91, 0x00,
+    // 0x6f - 'o'
+    0x09, 0x84, 0x00, 0x02, 0x3c, 0x7e, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0x7e, 0x3c, 0x91, 0x00,
+    // 0x70 - 'p'
+    0x09, 0x84, 0x00, 0x02, 0xde, 0xff, 0xe3, 0x82, 0xc3, 0x02, 0xe7, 0xfe, 0xdc, 0x81, 0xc0, 0x8f,
+    0x00,
+    // 0x71 - 'q'
+    0x09, 0x83, 0x00, 0x02, 0x3b, 0x7f, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0x7f, 0x3b, 0x82, 0x03, 0x8f,
+    0x00,
+    // 0x72 - 'r'
+    0x06, 0x84, 0x00, 0x02, 0xd8, 0xf8, 0xe0, 0x85, 0xc0, 0x91, 0x00,
+    // 0x73 - 's'
+    0x08, 0x84, 0x00, 0x08, 0x7c, 0xfe, 0xc6, 0xf0, 0x7c, 0x1e, 0xc6, 0xfe, 0x7c, 0x91, 0x00,
+    // 0x74 - 't'
+    0x06, 0x81, 0x00, 0x00, 0x20, 0x81, 0x60, 0x81, 0xf8, 0x84, 0x60, 0x01, 0x78, 0x38, 0x91, 0x00,
+    // 0x75 - 'u'
+    0x09, 0x84, 0x00, 0x85, 0xc3, 0x02, 0xc7, 0xff, 0x7b, 0x91, 0x00,
+    // 0x76 - 'v'
+    0x08, 0x84, 0x00, 0x82, 0xc6, 0x82, 0x6c, 0x82, 0x38, 0x91, 0x00,
+    // 0x77 - 'w'
+    0x0e, 0x84, 0x00, 0x81, 0xc7, 0x00, 0x67, 0x82, 0x6d, 0x82, 0x38, 0x86, 0x00, 0x81, 0x18, 0x00,
+    0x30, 0x82, 0xb0, 0x82, 0xe0, 0x81, 0x00,
+    // 0x78 - 'x'
+    0x08, 0x84, 0x00, 0x02, 0xc6, 0xee, 0x6c, 0x82, 0x38, 0x02, 0x6c, 0xee, 0xc6, 0x91, 0x00,
+    // 0x79 - 'y'
+    0x0a, 0x84, 0x00, 0x00, 0xc1, 0x81, 0x63, 0x81, 0x36, 0x00, 0x3e, 0x81, 0x1c, 0x02, 0x18, 0x78,
+    0x70, 0x84, 0x00, 0x00, 0x80, 0x89, 0x00,
+    // 0x7a - 'z'
+    0x08, 0x84, 0x00, 0x81, 0xfe, 0x04, 0x0c, 0x1c, 0x38, 0x70, 0x60, 0x81, 0xfe, 0x91, 0x00,
+    // 0x7b - '{'
+    0x07, 0x02, 0x00, 0x1c, 0x3c, 0x83, 0x30, 0x81, 0xe0, 0x83, 0x30, 0x01, 0x3c, 0x1c, 0x90, 0x00,
+    // 0x7c - '|'
+    0x03, 0x00, 0x00, 0x8d, 0xc0, 0x90, 0x00,
+    // 0x7d - '}'
+    0x07, 0x02, 0x00, 0xe0, 0xf0, 0x83, 0x30, 0x81, 0x1c, 0x83, 0x30, 0x01, 0xf0, 0xe0, 0x90, 0x00,
+    // 0x7e - '~'
+    0x09, 0x81, 0x00, 0x02, 0x71, 0xff, 0x8e, 0x9a, 0x00,
+    // 0x7f
+    0x01, 0x9f, 0x00,
+    // 0x80
+    0x01, 0x9f, 0x00,
+    // 0x81
+    0x01, 0x9f, 0x00,
+    // 0x82
+    0x01, 0x9f, 0x00,
+    // 0x83
+    0x01, 0x9f, 0x00,
+    // 0x84
+    0x01, 0x9f, 0x00,
+    // 0x85
+    0x01, 0x9f, 0x00,
+    // 0x86
+    0x01, 0x9f, 0x00,
+    // 0x87
+    0x01, 0x9f, 0x00,
+    // 0x88
+    0x01, 0x9f, 0x00,
+    // 0x89
+    0x01, 0x9f, 0x00,
+    // 0x8a
+    0x01, 0x9f, 0x00,
+    // 0x8b
+    0x01, 0x9f, 0x00,
+    // 0x8c
+    0x01, 0x9f, 0x00,
+    // 0x8d
+    0x01, 0x9f, 0x00,
+    // 0x8e
+    0x01, 0x9f, 0x00,
+    // 0x8f
+    0x01, 0x9f, 0x00,
+    // 0x90
+    0x01, 0x9f, 0x00,
+    // 0x91
+    0x01, 0x9f, 0x00,
+    // 0x92
+    0x01, 0x9f, 0x00,
+    // 0x93
+    0x01, 0x9f, 0x00,
+    // 0x94
+    0x01, 0x9f, 0x00,
+    // 0x95
+    0x01, 0x9f, 0x00,
+    // 0x96
+    0x01, 0x9f, 0x00,
+    // 0x97
+    0x01, 0x9f, 0x00,
+    // 0x98
+    0x01, 0x9f, 0x00,
+    // 0x99
+    0x01, 0x9f, 0x00,
+    // 0x9a
+    0x01, 0x9f, 0x00,
+    // 0x9b
+    0x01, 0x9f, 0x00,
+    // 0x9c
+    0x01, 0x9f, 0x00,
+    // 0x9d
+    0x01, 0x9f, 0x00,
+    // 0x9e
+    0x01, 0x9f, 0x00,
+    // 0x9f
+    0x01, 0x9f, 0x00,
+    // 0xa0
+    0x01, 0x9f, 0x00,
+    // 0xa1
+    0x01, 0x9f, 0x00,
+    // 0xa2
+    0x01, 0x9f, 0x00,
+    // 0xa3
+    0x08, 0x81, 0x00, 0x81, 0x6c, 0x03, 0x00, 0x38, 0x7c, 0xc6, 0x81, 0xfe, 0x03, 0xc0, 0xe6, 0x7c,
+    0x38, 0x91, 0x00,
+    // 0xa4
+    0x01, 0x9f, 0x00,
+    // 0xa5
+    0x01, 0x9f, 0x00,
+    // 0xa6
+    0x01, 0x9f, 0x00,
+    // 0xa7
+    0x01, 0x9f, 0x00,
+    // 0xa8
+    0x0a, 0x9f, 0x00,
+    // 0xa9
+    0x01, 0x9f, 0x00,
+    // 0xaa
+    0x01, 0x9f, 0x00,
+    // 0xab
+    0x01, 0x9f, 0x00,
+    // 0xac
+    0x01, 0x9f, 0x00,
+    // 0xad
+    0x01, 0x9f, 0x00,
+    // 0xae
+    0x01, 0x9f, 0x00,
+    // 0xaf
+    0x01, 0x9f, 0x00,
+    // 0xb0
+    0x01, 0x9f, 0x00,
+    // 0xb1
+    0x01, 0x9f, 0x00,
+    // 0xb2
+    0x01, 0x9f, 0x00,
+    // 0xb3
+    0x0a, 0x01, 0x36, 0x00, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x83, 0x00,
+    0x81, 0x80, 0x82, 0x00, 0x81, 0x80, 0x82, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0xb4
+    0x01, 0x9f, 0x00,
+    // 0xb5
+    0x01, 0x9f, 0x00,
+    // 0xb6
+    0x01, 0x9f, 0x00,
+    // 0xb7
+    0x01, 0x9f, 0x00,
+    // 0xb8
+    0x08, 0x9f, 0x00,
+    // 0xb9
+    0x01, 0x9f, 0x00,
+    // 0xba
+    0x01, 0x9f, 0x00,
+    // 0xbb
+    0x01, 0x9f, 0x00,
+    // 0xbc
+    0x01, 0x9f, 0x00,
+    // 0xbd
+    0x01, 0x9f, 0x00,
+    // 0xbe
+    0x01, 0x9f, 0x00,
+    // 0xbf
+    0x01, 0x9f, 0x00,
+    // 0xc0
+    0x0c, 0x84, 0x00, 0x02, 0xc7, 0xcf, 0xdc, 0x81, 0xf8, 0x03, 0xd8, 0xdc, 0xcf, 0xc7, 0x86, 0x00,
+    0x02, 0x80, 0xc0, 0xe0, 0x82, 0x60, 0x02, 0xe0, 0xc0, 0x80, 0x81, 0x00,
+    // 0xc1
+    0x09, 0x84, 0x00, 0x08, 0x7c, 0xfe, 0xc6, 0x1e, 0x7e, 0xe6, 0xc6, 0xfe, 0x7b, 0x91, 0x00,
+    // 0xc2
+    0x09, 0x07, 0x00, 0x02, 0x7e, 0xfc, 0xc0, 0xfc, 0xfe, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0x7e, 0x3c,
+    0x91, 0x00,
+    // 0xc3
+    0x0a, 0x84, 0x00, 0x86, 0xc3, 0x81, 0xff, 0x81, 0x01, 0x8b, 0x00, 0x83, 0x80,
+    // 0xc4
+    0x0c, 0x84, 0x00, 0x01, 0x1f, 0x3f, 0x83, 0x31, 0x00, 0x61, 0x81, 0xff, 0x81, 0xc0, 0x84, 0x00,
+    0x86, 0x80, 0x81, 0xe0, 0x81, 0x60,
+    // 0xc5
+    0x08, 0x84, 0x00, 0x02, 0x38, 0x7c, 0xc6, 0x81, 0xfe, 0x03, 0xc0, 0xe6, 0x7c, 0x38, 0x91, 0x00,
+    // 0xc6
+    0x0d, 0x82, 0x00, 0x81, 0x06, 0x01, 0x3f, 0x7f, 0x84, 0xc6, 0x01, 0x7f, 0x3f, 0x81, 0x06, 0x84,
+    0x00, 0x01, 0xc0, 0xe0, 0x84, 0x30, 0x01, 0xe0, 0xc0, 0x81, 0x00,
+    // 0xc7
+    0x08, 0x84, 0x00, 0x81, 0xfe, 0x86, 0xc0, 0x91, 0x00,
+    // 0xc8
+    0x08, 0x84, 0x00, 0x02, 0xc6, 0xee, 0x6c, 0x82, 0x38, 0x02, 0x6c, 0xee, 0xc6, 0x91, 0x00,
+    // 0xc9
+    0x09, 0x84, 0x00, 0x06, 0xc3, 0xc7, 0xcf, 0xdf, 0xfb, 0xf3, 0xe3, 0x81, 0xc3, 0x91, 0x00,
+    // 0xca
+    0x09, 0x0b, 0x00, 0x24, 0x3c, 0x18, 0x00, 0xc3, 0xc7, 0xcf, 0xdf, 0xfb, 0xf3, 0xe3, 0x81, 0xc3,
+    0x91, 0x00,
+    // 0xcb
+    0x08, 0x84, 0x00, 0x81, 0xc6, 0x00, 0xcc, 0x81, 0xf0, 0x00, 0xcc, 0x82, 0xc6, 0x91, 0x00,
+    // 0xcc
+    0x09, 0x84, 0x00, 0x01, 0x3f, 0x7f, 0x84, 0x63, 0x01, 0xe3, 0xc3, 0x91, 0x00,
+    // 0xcd
+    0x0c, 0x84, 0x00, 0x81, 0xe0, 0x81, 0xf1, 0x81, 0xdb, 0x81, 0xce, 0x00, 0xc4, 0x86, 0x00, 0x83,
+    0xe0, 0x84, 0x60, 0x81, 0x00,
+    // 0xce
+    0x09, 0x84, 0x00, 0x82, 0xc3, 0x81, 0xff, 0x83, 0xc3, 0x91, 0x00,
+    // 0xcf
+    0x09, 0x84, 0x00, 0x02, 0x3c, 0x7e, 0xe7, 0x82, 0xc3, 0x02, 0xe7, 0x7e, 0x3c, 0x91, 0x00,
+    // 0xd0
+    0x09, 0x84, 0x00, 0x81, 0xff, 0x86, 0xc3, 0x91, 0x00,
+    // 0xd1
+    0x09, 0x84, 0x00, 0x01, 0x7f, 0xff, 0x81, 0xc3, 0x04, 0xff, 0x7f, 0x33, 0x63, 0xc3, 0x91, 0x00,
+    // 0xd2
+    0x09, 0x84, 0x00, 0x02, 0xde, 0xff, 0xe3, 0x82, 0xc3, 0x02, 0xe7, 0xfe, 0xdc, 0x81, 0xc0, 0x8f,
+    0x00,
+    // 0xd3
+    0x08, 0x84, 0x00, 0x02, 0x3c, 0x7e, 0xe6, 0x82, 0xc0, 0x02, 0xe6, 0x7e, 0x3c, 0x91, 0x00,
+    // 0xd4
+    0x09, 0x84, 0x00, 0x81, 0xff, 0x86, 0x18, 0x91, 0x00,
+    // 0xd5
+    0x0b, 0x84, 0x00, 0x81, 0xc0, 0x81, 0x61, 0x81, 0x33, 0x81, 0x1e, 0x02, 0x0c, 0x78, 0x70, 0x84,
+    0x00, 0x81, 0xc0, 0x81, 0x80, 0x86, 0x00,
+    // 0xd6
+    0x0d, 0x84, 0x00, 0x01, 0xc6, 0x66, 0x81, 0x36, 0x02, 0x0f, 0x36, 0x66, 0x81, 0xc6, 0x86, 0x00,
+    0x01, 0x30, 0x60, 0x81, 0xc0, 0x02, 0x00, 0xc0, 0x60, 0x81, 0x30, 0x81, 0x00,
+    // 0xd7
+    0x08, 0x84, 0x00, 0x02, 0xfc, 0xfe, 0xc6, 0x81, 0xfc, 0x81, 0xc6, 0x01, 0xfe, 0xfc, 0x91, 0x00,
+    // 0xd8
+    0x09, 0x84, 0x00, 0x82, 0xc0, 0x01, 0xfe, 0xff, 0x81, 0xc3, 0x01, 0xff, 0xfe, 0x91, 0x00,
+    // 0xd9
+    0x0c, 0x84, 0x00, 0x82, 0xc0, 0x01, 0xfe, 0xff, 0x81, 0xc3, 0x01, 0xff, 0xfe, 0x86, 0x00, 0x88,
+    0x60, 0x81, 0x00,
+    // 0xda
+    0x09, 0x84, 0x00, 0x08, 0x7e, 0xff, 0x03, 0x0e, 0x0f, 0x03, 0xc3, 0xff, 0x7e, 0x91, 0x00,
+    // 0xdb
+    0x0b, 0x84, 0x00, 0x86, 0xcc, 0x81, 0xff, 0x86, 0x00, 0x88, 0xc0, 0x81, 0x00,
+    // 0xdc
+    0x09, 0x84, 0x00, 0x02, 0x7e, 0xff, 0xc3, 0x81, 0x0f, 0x03, 0x03, 0xc3, 0xff, 0x7e, 0x91, 0x00,
+    // 0xdd
+    0x0c, 0x84, 0x00, 0x86, 0xcc, 0x81, 0xff, 0x86, 0x00, 0x87, 0xc0, 0x00, 0xe0, 0x81, 0x60,
+    // 0xde
+    0x09, 0x84, 0x00, 0x83, 0xc3, 0x01, 0xff, 0x7f, 0x82, 0x03, 0x91, 0x00,
+    // 0xdf
+    0x0b, 0x84, 0x00, 0x81, 0xf0, 0x00, 0x30, 0x81, 0x3f, 0x81, 0x30, 0x81, 0x3f, 0x89, 0x00, 0x00,
+    0x80, 0x83, 0xc0, 0x00, 0x80, 0x81, 0x00,
+    // 0xe0
+    0x0e, 0x81, 0x00, 0x02, 0xc1, 0xc7, 0xc6, 0x81, 0xcc, 0x81, 0xfc, 0x81, 0xcc, 0x02, 0xc6, 0xc7,
+    0xc1, 0x83, 0x00, 0x02, 0xc0, 0xf0, 0x30, 0x85, 0x18, 0x02, 0x30, 0xf0, 0xc0, 0x81, 0x00,
+    // 0xe1
+    0x0c, 0x81, 0x00, 0x81, 0x0e, 0x82, 0x1b, 0x81, 0x31, 0x01, 0x3f, 0x7f, 0x81, 0x60, 0x00, 0xc0,
+    0x88, 0x00, 0x82, 0x80, 0x82, 0xc0, 0x00, 0x60, 0x81, 0x00,
+    // 0xe2
+    0x0b, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x00, 0xc1, 0x81, 0xc0, 0x81, 0xff, 0x83,
+    0x00, 0x81, 0x80, 0x83, 0x00, 0x00, 0x80, 0x82, 0xc0, 0x00, 0x80, 0x82, 0x00,
+    // 0xe3
+    0x0b, 0x81, 0x00, 0x89, 0xc1, 0x81, 0xff, 0x83, 0x00, 0x89, 0x80, 0x83, 0xc0,
+    // 0xe4
+    0x0d, 0x81, 0x00, 0x01, 0x0f, 0x1f, 0x82, 0x18, 0x83, 0x30, 0x00, 0x60, 0x81, 0xff, 0x81, 0xc0,
+    0x81, 0x00, 0x89, 0xc0, 0x81, 0xf0, 0x81, 0x30,
+    // 0xe5
+    0x0a, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x82, 0xc0, 0x81, 0xff, 0x83, 0x00, 0x81,
+    0x80, 0x82, 0x00, 0x81, 0x80, 0x82, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0xe6
+    0x0f, 0x81, 0x00, 0x03, 0x03, 0x1f, 0x7f, 0x63, 0x83, 0xc3, 0x03, 0x63, 0x7f, 0x1f, 0x03, 0x84,
+    0x00, 0x02, 0xe0, 0xf8, 0x18, 0x83, 0x0c, 0x02, 0x18, 0xf8, 0xe0, 0x82, 0x00,
+    // 0xe7
+    0x0a, 0x81, 0x00, 0x81, 0xff, 0x89, 0xc0, 0x83, 0x00, 0x81, 0x80, 0x8b, 0x00,
+    // 0xe8
+    0x0a, 0x81, 0x00, 0x04, 0xc1, 0xe3, 0x63, 0x36, 0x3e, 0x81, 0x1c, 0x04, 0x3e, 0x36, 0x63, 0xe3,
+    0xc1, 0x83, 0x00, 0x81, 0x80, 0x87, 0x00, 0x81, 0x80, 0x81, 0x00,
+    // 0xe9
+    0x0b, 0x81, 0x00, 0x01, 0xc0, 0xc1, 0x81, 0xc3, 0x00, 0xc6, 0x81, 0xcc, 0x00, 0xd8, 0x81, 0xf0,
+    0x01, 0xe0, 0xc0, 0x83, 0x00, 0x8b, 0xc0, 0x81, 0x00,
+    // 0xea
+    0x0b, 0x03, 0x1e, 0x0c, 0xc0, 0xc1, 0x81, 0xc3, 0x00, 0xc6, 0x81, 0xcc, 0x00, 0xd8, 0x81, 0xf0,
+    0x01, 0xe0, 0xc0, 0x83, 0x00, 0x8b, 0xc0, 0x81, 0x00,
+    // 0xeb
+    0x0b, 0x81, 0x00, 0x08, 0xc0, 0xc1, 0xc3, 0xc6, 0xcc, 0xde, 0xf6, 0xe3, 0xc3, 0x81, 0xc1, 0x00,
+    0xc0, 0x83, 0x00, 0x01, 0xc0, 0x80, 0x86, 0x00, 0x00, 0x80, 0x81, 0xc0, 0x81, 0x00,
+    // 0xec
+    0x0a, 0x81, 0x00, 0x02, 0x1f, 0x3f, 0x31, 0x86, 0x61, 0x01, 0xe1, 0xc1, 0x83, 0x00, 0x8b, 0x80,
+    0x81, 0x00,
+    // 0xed
+    0x0c, 0x81, 0x00, 0x81, 0xe0, 0x81, 0xf1, 0x00, 0xd1, 0x82, 0xdb, 0x82, 0xce, 0x00, 0xc4, 0x83,
+    0x00, 0x83, 0xe0, 0x87, 0x60, 0x81, 0x00,
+    // 0xee
+    0x0a, 0x81, 0x00, 0x84, 0xc1, 0x81, 0xff, 0x84, 0xc1, 0x83, 0x00, 0x8b, 0x80, 0x81, 0x00,
+    // 0xef
+    0x0b, 0x81, 0x00, 0x02, 0x1e, 0x7f, 0x61, 0x85, 0xc0, 0x02, 0x61, 0x7f, 0x1e, 0x84, 0x00, 0x81,
+    0x80, 0x85, 0xc0, 0x81, 0x80, 0x82, 0x00,
+    // 0xf0
+    0x0a, 0x81, 0x00, 0x81, 0xff, 0x89, 0xc1, 0x83, 0x00, 0x8b, 0x80, 0x81, 0x00,
+    // 0xf1
+    0x0c, 0x81, 0x00, 0x0b, 0x1f, 0x3f, 0x70, 0x60, 0x70, 0x3f, 0x0f, 0x1c, 0x38, 0x30, 0x70, 0xe0,
+    0x83, 0x00, 0x81, 0xe0, 0x82, 0x60, 0x81, 0xe0, 0x84, 0x60, 0x81, 0x00,
+    // 0xf2
+    0x0a, 0x81, 0x00, 0x06, 0xfe, 0xff, 0xc3, 0xc1, 0xc3, 0xff, 0xfe, 0x84, 0xc0, 0x85, 0x00, 0x82,
+    0x80, 0x88, 0x00,
+    // 0xf3
+    0x0b, 0x81, 0x00, 0x02, 0x1f, 0x7f, 0x61, 0x85, 0xc0, 0x02, 0x61, 0x7f, 0x1f, 0x84, 0x00, 0x02,
+    0x80, 0xc0, 0x80, 0x83, 0x00, 0x02, 0x80, 0xc0, 0x80, 0x82, 0x00,
+    // 0xf4
+    0x0b, 0x81, 0x00, 0x81, 0xff, 0x89, 0x0c, 0x83, 0x00, 0x81, 0xc0, 0x8b, 0x00,
+    // 0xf5
+    0x0b, 0x81, 0x00, 0x81, 0xc0, 0x81, 0x61, 0x81, 0x33, 0x81, 0x1e, 0x81, 0x0c, 0x01, 0x78, 0x70,
+    0x83, 0x00, 0x81, 0xc0, 0x81, 0x80, 0x89, 0x00,
+    // 0xf6
+    0x0d, 0x81, 0x00, 0x00, 0xc6, 0x82, 0x66, 0x01, 0x36, 0x0f, 0x81, 0x36, 0x81, 0x66, 0x81, 0xc6,
+    0x83, 0x00, 0x00, 0x30, 0x82, 0x60, 0x01, 0xc0, 0x00, 0x81, 0xc0, 0x81, 0x60, 0x81, 0x30, 0x81,
+    0x00,
+    // 0xf7
+    0x0b, 0x81, 0x00, 0x81, 0xff, 0x82, 0xc1, 0x81, 0xff, 0x00, 0xc1, 0x81, 0xc0, 0x81, 0xff, 0x84,
+    0x00, 0x83, 0x80, 0x01, 0x00, 0x80, 0x82, 0xc0, 0x00, 0x80, 0x82, 0x00,
+    // 0xf8
+    0x0a, 0x81, 0x00, 0x84, 0xc0, 0x06, 0xfe, 0xff, 0xc3, 0xc1, 0xc3, 0xff, 0xfe, 0x8a, 0x00, 0x82,
+    0x80, 0x83, 0x00,
+    // 0xf9
+    0x0d, 0x81, 0x00, 0x84, 0xc0, 0x06, 0xfe, 0xff, 0xc3, 0xc1, 0xc3, 0xff, 0xfe, 0x83, 0x00, 0x86,
+    0x30, 0x82, 0xb0, 0x81, 0x30, 0x81, 0x00,
+    // 0xfa
+    0x09, 0x81, 0x00, 0x03, 0x3e, 0x7f, 0xc3, 0x03, 0x81, 0x1e, 0x05, 0x07, 0x03, 0xc3, 0xe7, 0x7e,
+    0x3c, 0x91, 0x00,
+    // 0xfb
+    0x0d, 0x81, 0x00, 0x89, 0xc6, 0x81, 0xff, 0x83, 0x00, 0x89, 0x30, 0x81, 0xf0, 0x81, 0x00,
+    // 0xfc
+    0x0b, 0x81, 0x00, 0x04, 0x1e, 0x7f, 0xe1, 0xc0, 0x00, 0x81, 0x0f, 0x04, 0x00, 0xc0, 0xe1, 0x7f,
+    0x1e, 0x84, 0x00, 0x81, 0x80, 0x85, 0xc0, 0x81, 0x80, 0x82, 0x00,
+    // 0xfd
+    0x0e, 0x81, 0x00, 0x89, 0xc6, 0x81, 0xff, 0x83, 0x00, 0x89, 0x30, 0x81, 0xf8, 0x81, 0x18,
+    // 0xfe
+    0x0b, 0x81, 0x00, 0x84, 0xc0, 0x02, 0xe0, 0x7f, 0x3f, 0x87, 0x00, 0x8b, 0xc0, 0x81, 0x00,
+    // 0xff
+    0x0c, 0x81, 0x00, 0x81, 0xf0, 0x82, 0x30, 0x81, 0x3f, 0x82, 0x30, 0x81, 0x3f, 0x88, 0x00, 0x06,
+    0x80, 0xc0, 0xe0, 0x60, 0xe0, 0xc0, 0x80, 0x81, 0x00,
+};
@@ -297,13 +297,24 @@ done
 #define XXXXXXXX        0xff
 
 // here are fonts themself
+#ifdef FONTS_RLE
+// compressed fonts (scrtest/fontrle.c makes them from plain)
+#include "font14rle.h"
+#include "font16rle.h"
+
+static const afont FONTS[] = {
+    [FONT14] = {font14rle_table, FONT14HEIGHT, FONT14BYTES, FONT14BASELINE, font14rle_offsets},
+    [FONT16] = {font16rle_table, FONT16HEIGHT, FONT16BYTES, FONT16BASELINE, font16rle_offsets}
+};
+#else
 #include "font14.h"
 #include "font16.h"
 
 static const afont FONTS[] = {
-    [FONT14] = {font14_table, FONT14HEIGHT, FONT14BYTES, FONT14BASELINE},
-    [FONT16] = {font16_table, FONT16HEIGHT, FONT16BYTES, FONT16BASELINE}
+    [FONT14] = {font14_table, FONT14HEIGHT, FONT14BYTES, FONT14BASELINE, NULL},
+    [FONT16] = {font16_table, FONT16HEIGHT, FONT16BYTES, FONT16BASELINE, NULL}
 };
+#endif
 
 const afont *curfont = &FONTS[FONT14];
 
@@ -324,11 +335,55 @@ uint8_t fontbaseline(){return curfont->baseline;}
 uint8_t fontbytes(){return curfont->bytes;}
 */
 
+/**
+ * @brief font_char - get symbol data
+ * @param Char - symbol
+ * @return pointer to symbol width followed by its bitmap (plain or compressed) or NULL
+ */
 const uint8_t *font_char(uint8_t Char){
     if(Char < FIRST_SYMBOL_CODE) return NULL;
+    if(curfont->offsets) return &curfont->font[curfont->offsets[Char - FIRST_SYMBOL_CODE]];
     return &curfont->font[(Char - FIRST_SYMBOL_CODE)*(curfont->bytes+1)];
 }
 
+/**
+ * @brief font_rows - unpack symbol bitmap into rows
+ * @param Char - symbol
+ * @param rows (o) - curfont->height rows of symbol, bit 31 is its left column
+ * @return symbol width (0 if there's no such symbol)
+ *
+ * Compressed symbol is PackBits stream of its plain bitmap taken by byte columns (first bytes
+ * of all rows, then second etc): control byte n < 128 is followed by n+1 literal bytes,
+ * n >= 128 - by one byte repeated n-127 times.
+ */
+uint8_t font_rows(uint8_t Char, uint32_t *rows){
+    const uint8_t *data = font_char(Char);
+    if(!data) return 0;
+    uint8_t w = *data++, h = curfont->height, lw = curfont->bytes / h; // width of symbol row in bytes
+    if(!curfont->offsets){
+        for(uint8_t row = 0; row < h; ++row){
+            uint32_t r = 0;
+            for(uint8_t i = 0; i < lw; ++i) r |= (uint32_t)*data++ << (24 - 8*i);
+            rows[row] = r;
+        }
+        return w;
+    }
+    for(uint8_t row = 0; row < h; ++row) rows[row] = 0;
+    int i = 0, total = curfont->bytes;
+    while(i < total){
+        uint8_t n = *data++;
+        if(n & 0x80){ // repeated byte
+            uint8_t b = *data++;
+            for(n -= 0x7f; n && i < total; --n, ++i)
+                if(b) rows[i % h] |= (uint32_t)b << (24 - 8*(i / h));
+        }else{ // literal bytes
+            for(++n; n && i < total; --n, ++i)
+                rows[i % h] |= (uint32_t)*data++ << (24 - 8*(i / h));
+        }
+    }
+    return w;
+}
+
 char *u2str(uint32_t val){
     static char bufa[11];
     char bufb[10];
@@ -26,6 +26,9 @@
 #define FIRST_SYMBOL_CODE 32
 // total amount of symbols - all without first 32
 #define SYMBOLS_AMOUNT      (256-FIRST_SYMBOL_CODE)
+// max font height & width (glyph row should fit in 32 bits with 7 bits shift)
+#define FONT_MAXHEIGHT      32
+#define FONT_MAXWIDTH       24
 
 // type for font choosing
 typedef enum{
@@ -40,6 +43,7 @@ int choose_font(font_t newfont);
 uint8_t fontbaseline();
 uint8_t fontbytes(); */
 const uint8_t *font_char(uint8_t Char);
+uint8_t font_rows(uint8_t Char, uint32_t *rows);
 
 
 typedef struct{
@@ -47,6 +51,7 @@ typedef struct{
     uint8_t height;     // full font matrix height
     uint8_t bytes;      // amount of bytes in font matrix
     uint8_t baseline;   // baseline position (coordinate from bottom line)
+    const uint16_t *offsets; // offsets of symbols in compressed font (NULL for plain)
 } afont;
 
 extern const afont *curfont;
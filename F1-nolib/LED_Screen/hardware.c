@@ -22,6 +22,7 @@
  */
 
 #include "hardware.h"
+#include "scan.h"
 #include "spi.h"
 
 static inline void gpio_setup(){
@@ -32,17 +33,58 @@ static inline void gpio_setup(){
     // Set led as opendrain output
     GPIOC->CRH = CRH(13, CNF_ODOUTPUT|MODE_SLOW);
     // USB pullup (PA15) - opendrain output
-    // SCREEN PINs: A,B - PB6,PB7; SCLK - PA6; nOE - PA13
+    // SCREEN PINs: A,B - PB6,PB7; SCLK - PA6; nOE - PA1
     GPIOA->CRH = CRH(15, CNF_PPOUTPUT|MODE_SLOW);// | CRH(13, CNF_PPOUTPUT|MODE_SLOW);
     // turn off SWJ/JTAG (PA13 is in use)
    // AFIO->MAPR = AFIO_MAPR_SWJ_CFG_DISABLE;
     GPIOB->CRL = CRL(6, CNF_PPOUTPUT|MODE_SLOW) | CRL(7, CNF_PPOUTPUT|MODE_SLOW);
-    GPIOA->CRL = CRL(6, CNF_PPOUTPUT|MODE_SLOW) | CRL(4, CNF_PPOUTPUT|MODE_SLOW);
+    GPIOA->CRL = CRL(6, CNF_PPOUTPUT|MODE_SLOW) | CRL(1, CNF_AFPP|MODE_FAST);
+}
+
+/**
+ * @brief bcm_setup - BCM_TIM in one pulse mode: PWM2 on CH2 with CCR2=1 gives active nOE
+ *        during ARR ticks after start; only overflow generates update interrupt
+ */
+static inline void bcm_setup(){
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    BCM_TIM->CR1 = TIM_CR1_OPM | TIM_CR1_URS;
+    BCM_TIM->PSC = 72000000 / BCM_FREQ - 1;
+    BCM_TIM->ARR = 2;
+    BCM_TIM->CCR2 = 1;
+    BCM_TIM->CCMR1 = TIM_CCMR1_OC2M_2; // forced inactive until ShowScreen()
+    BCM_TIM->CCER = TIM_CCER_CC2E;
+    BCM_TIM->EGR = TIM_EGR_UG; // load prescaler
+    BCM_TIM->SR = 0;
+    BCM_TIM->DIER = TIM_DIER_UIE;
+    NVIC_SetPriority(TIM2_IRQn, 0); // the same as SPI DMA: handlers shouldn't preempt each other
+    NVIC_EnableIRQ(TIM2_IRQn);
+    // cycles counter to measure CPU load of screen interrupts
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+/**
+ * @brief marquee_setup - MARQUEE_TIM is stopped until MarqueeSpeed(); its interrupt is less
+ *        urgent than screen scan
+ */
+static inline void marquee_setup(){
+    RCC->APB1ENR |= RCC_APB1ENR_TIM3EN;
+    MARQUEE_TIM->CR1 = TIM_CR1_URS;
+    MARQUEE_TIM->PSC = 72000000 / MARQUEE_FREQ - 1;
+    MARQUEE_TIM->ARR = MARQUEE_FREQ - 1;
+    MARQUEE_TIM->EGR = TIM_EGR_UG; // load prescaler
+    MARQUEE_TIM->SR = 0;
+    MARQUEE_TIM->DIER = TIM_DIER_UIE;
+    NVIC_SetPriority(TIM3_IRQn, 1);
+    NVIC_EnableIRQ(TIM3_IRQn);
 }
 
 void hw_setup(){
     gpio_setup();
     spi_setup();
+    bcm_setup();
+    marquee_setup();
 }
 
 // SPI1 DMA Tx interrupt
@@ -51,5 +93,6 @@ void dma1_channel3_isr(){
     DMA1->IFCR |= DMA_IFCR_CTCIF3; /* Clear TC flag */
     SPI_status = SPI_READY;
     DMA_SPI_Channel->CCR &=~ DMA_CCR_EN; // turn off DMA for further reconfiguration
+    bcm_spi_done();
   }
 }
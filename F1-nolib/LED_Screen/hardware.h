@@ -42,7 +42,7 @@
 
 // SPI DMA channel
 #define DMA_SPI_Channel DMA1_Channel3
-// SCREEN PINs: A,B - PB6,PB7; SCLK - PA6; nOE - PA13
+// SCREEN PINs: A,B - PB6,PB7; SCLK - PA6; nOE - PA1 (TIM2_CH2, BCM pulses)
 #define A_port      GPIOB
 #define A_pin       (1<<6)
 #define B_port      GPIOB
@@ -51,7 +51,14 @@
 #define SCLK_pin    (1<<6)
 #define nOE_port    GPIOA
 //#define nOE_pin     (1<<13)
-#define nOE_pin     (1<<4)
+//#define nOE_pin     (1<<4)
+#define nOE_pin     (1<<1)
+// BCM timer: 1MHz, one pulse of active nOE level on CH2 for each bitplane
+#define BCM_TIM     TIM2
+#define BCM_FREQ    1000000
+// marquee timer: 10kHz, update interrupt on each scroll step
+#define MARQUEE_TIM     TIM3
+#define MARQUEE_FREQ    10000
 #define SET(x)      pin_set(x ## _port, x ## _pin)
 #define CLEAR(x)    pin_clear(x ## _port, x ## _pin)
 #define TOGGLE(x)   pin_toggle(x ## _port, x ## _pin)
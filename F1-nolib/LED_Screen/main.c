@@ -21,6 +21,8 @@
 
 #include "fonts.h"
 #include "hardware.h"
+#include "marquee.h"
+#include "scan.h"
 #include "screen.h"
 #include "usb.h"
 #include "usb_lib.h"
@@ -55,9 +57,76 @@ void iwdg_setup(){
     IWDG->KR = IWDG_REFRESH; /* (6) */
 }
 
-static uint8_t countms = 0;
+static uint8_t countms = 0, kern = 0;
+// marquee scrolling speed (px/s)
+static uint16_t mqspeed = MARQUEE_DEFSPEED;
+// screen interrupts load (1/10 of percent) & framerate by last second
+static uint32_t scrload = 0, scrfps = 0;
+
+// draw gradient from 0 to SCREEN_MAXLEVEL
+static void gradient(){
+    for(int16_t x = 0; x < SCREEN_WIDTH; ++x){
+        uint8_t lvl = x * (SCREEN_MAXLEVEL + 1) / SCREEN_WIDTH;
+        for(int16_t y = 0; y < SCREEN_HEIGHT; ++y) DrawPixLevel(x, y, lvl);
+    }
+}
+
+static uint8_t hexdigit(char c){
+    if(c >= '0' && c <= '9') return c - '0';
+    if(c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if(c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return 0xff;
+}
+
+// "P chain rows serpentine" - set panels geometry
+static char *setgeometry(char *buf){
+    uint32_t v[3];
+    for(int i = 0; i < 3; ++i){
+        while(*buf == ' ') ++buf;
+        if(*buf < '0' || *buf > '9') return "Format: P chain rows serpentine\n";
+        v[i] = 0;
+        while(*buf >= '0' && *buf <= '9' && v[i] < 1000) v[i] = v[i]*10 + *buf++ - '0';
+    }
+    ScreenOFF();
+    if(v[0] > 255 || v[1] > 255 || SetGeometry(v[0], v[1], v[2])) return "Wrong geometry\n";
+    ConvertScreenBuf();
+    return "OK\n";
+}
+
+// "V speed" - set marquee speed
+static char *setspeed(char *buf){
+    uint32_t v = 0;
+    while(*buf == ' ') ++buf;
+    if(*buf < '0' || *buf > '9') return "Format: V speed\n";
+    while(*buf >= '0' && *buf <= '9' && v < 100000) v = v*10 + *buf++ - '0';
+    if(!v || v > MARQUEE_MAXSPEED) return "Wrong speed\n";
+    mqspeed = v;
+    MarqueeSpeed(mqspeed);
+    return "OK\n";
+}
+
+// "M text" - scroll text in the bottom line
+static char *marquee(char *buf){
+    char *nl = buf;
+    while(*nl && *nl != '\n') ++nl;
+    *nl = 0;
+    MarqueeSpeed(0);
+    if(!MarqueeText(SCREEN_HEIGHT-1-curfont->baseline, buf)) return "Can't show marquee\n";
+    ConvertScreenBuf();
+    MarqueeSpeed(mqspeed);
+    return "OK\n";
+}
 
 char *parse_cmd(char *buf){
+    if(buf[0] == 'B' && buf[1] && buf[2] == '\n'){ // Bx - brightness
+        uint8_t lvl = hexdigit(buf[1]);
+        if(lvl > SCREEN_MAXLEVEL) return "Wrong level\n";
+        SetBrightness(lvl);
+        return "OK\n";
+    }
+    if(buf[0] == 'P' && buf[1] == ' ') return setgeometry(buf + 1);
+    if(buf[0] == 'M' && buf[1] == ' ') return marquee(buf + 2);
+    if(buf[0] == 'V' && buf[1] == ' ') return setspeed(buf + 1);
     if(buf[1] != '\n'){
         PutStringAt(0, SCREEN_HEIGHT-1-curfont->baseline, buf);
         ConvertScreenBuf();
@@ -90,6 +159,43 @@ char *parse_cmd(char *buf){
             ScreenOFF();
             FillScreen(0);
             return "OK\n";
+        case 'G':
+            gradient();
+            ConvertScreenBuf();
+            ShowScreen();
+            return "OK\n";
+        break;
+        case 'K':
+            kern = !kern;
+            SetKerning(kern);
+            return kern ? "Kerning on\n" : "Kerning off\n";
+        break;
+        case 'L':
+            USB_send("Screen CPU load: ");
+            USB_send(u2str(scrload / 10));
+            USB_send(".");
+            USB_send(u2str(scrload % 10));
+            USB_send("%, framerate: ");
+            USB_send(u2str(scrfps));
+            USB_send("Hz\n");
+            return NULL;
+        break;
+        case 'g':
+            USB_send("Geometry: ");
+            USB_send(u2str(geometry->chain));
+            USB_send(" panels in row, ");
+            USB_send(u2str(geometry->rows));
+            USB_send(" rows");
+            if(geometry->serpentine) USB_send(", serpentine");
+            USB_send("\n");
+            return NULL;
+        break;
+        case 'm':
+            MarqueeSpeed(0);
+            MarqueeClear();
+            ConvertScreenBuf();
+            return "Marquee off\n";
+        break;
         case 'p':
             pin_toggle(USBPU_port, USBPU_pin);
             USB_send("USB pullup is ");
@@ -122,10 +228,18 @@ char *parse_cmd(char *buf){
             "'0' - fill 0\n"
             "'1' - fill 1\n"
             "'2,3' - select font\n"
+            "'Bx' - set brightness to x (hex, 0..max)\n"
             "'C' - clear screen\n"
+            "'G' - show gradient\n"
+            "'K' - turn on/off kerning\n"
+            "'g' - show panels geometry\n"
+            "'L' - screen CPU load & framerate\n"
+            "'M text' - scroll text in the bottom line, 'm' - stop it\n"
+            "'P c r s' - set geometry: c panels in row, r rows, s - serpentine (0/1)\n"
             "'p' - toggle USB pullup\n"
             "'R' - software reset\n"
             "'S' - show screen\n"
+            "'V speed' - marquee speed (px/s)\n"
             "'W' - test watchdog\n"
             "'Zz' -start/stop counting ms\n"
             ;
@@ -155,7 +269,7 @@ char *get_USB(){
 }
 
 int main(void){
-    uint32_t lastT = 0, mscnt = 0, Tmscnt = 0;
+    uint32_t lastT = 0, lastL = 0, mscnt = 0, Tmscnt = 0;
     sysreset();
     StartHSE();
     SysTick_Config(72000);
@@ -175,6 +289,10 @@ int main(void){
             LED_blink(LED0);
             lastT = Tms;
         }
+        if(Tms - lastL > 999){ // 72000 cycles per 1ms -> 72000 per 0.1%
+            scrload = getScreenCycles(&scrfps) / 72000;
+            lastL = Tms;
+        }
         if(countms){
             if(!Tmscnt){
                 Tmscnt = Tms;
@@ -193,7 +311,6 @@ int main(void){
             Tmscnt = 0;
         }
         IWDG->KR = IWDG_REFRESH;
-        process_screen();
         usb_proc();
         char *txt, *ans;
         if((txt = get_USB())){
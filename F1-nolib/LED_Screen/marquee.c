@@ -0,0 +1,46 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hardware.h"
+#include "marquee.h"
+#include "screen.h"
+
+/*
+ * Marquee is scrolled by MARQUEE_TIM interrupts: each one moves text by one pixel and converts
+ * it into back DMA buffer, so speed doesn't depend on main loop.
+ */
+
+/**
+ * @brief MarqueeSpeed - set scrolling speed
+ * @param speed - pixels per second (0 - stop, greater than MARQUEE_MAXSPEED are truncated)
+ */
+void MarqueeSpeed(uint16_t speed){
+    MARQUEE_TIM->CR1 &= ~TIM_CR1_CEN;
+    if(!speed) return;
+    if(speed > MARQUEE_MAXSPEED) speed = MARQUEE_MAXSPEED;
+    MARQUEE_TIM->ARR = MARQUEE_FREQ / speed - 1;
+    MARQUEE_TIM->EGR = TIM_EGR_UG;
+    MARQUEE_TIM->CR1 |= TIM_CR1_CEN;
+}
+
+void tim3_isr(){
+    if(MARQUEE_TIM->SR & TIM_SR_UIF){
+        MARQUEE_TIM->SR = ~TIM_SR_UIF;
+        MarqueeStep();
+    }
+}
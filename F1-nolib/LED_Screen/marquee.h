@@ -17,27 +17,15 @@
  */
 
 #pragma once
-#ifndef SCREEN_H__
-#define SCREEN_H__
+#ifndef MARQUEE_H__
+#define MARQUEE_H__
 
 #include <stdint.h>
 
-// display size in px
-// PANEL_WIDTH is width of one panel
-#define PANEL_WIDTH         32
-// SCREEN_WIDTH is total screen width
-#define SCREEN_WIDTH        64
-#define SCREEN_HEIGHT       16
-#define SCREENBUF_SZ        (SCREEN_WIDTH*SCREEN_HEIGHT/8)
+// max scrolling speed (px/s): faster steps couldn't be seen with framerate ~250Hz
+#define MARQUEE_MAXSPEED    250
+#define MARQUEE_DEFSPEED    32
 
-// screen is positive (1->on, 0->off)
-#define SCREEN_IS_NEGATIVE  0
+void MarqueeSpeed(uint16_t speed);
 
-void FillScreen(uint8_t setclear);
-void DrawPix(int16_t X, int16_t Y, uint8_t pix);
-uint8_t DrawCharAt(int16_t X, int16_t Y, uint8_t Char);
-void ConvertScreenBuf();
-uint8_t PutStringAt(int16_t X, int16_t Y, char *str);
-uint8_t *getScreenBuf();
-uint8_t *getDmaBuf(uint8_t N);
-#endif // SCREEN_H__
+#endif // MARQUEE_H__
@@ -0,0 +1,126 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "hardware.h"
+#include "scan.h"
+#include "screen.h"
+#include "spi.h"
+
+/*
+ * Binary code modulation: each quarter is shown SCREEN_PLANES times, bitplane p - during
+ * BCM_UNIT<<p ticks of BCM_TIM (its one pulse drives nOE). Data of next bitplane is sent
+ * by SPI DMA while current one is shown, so next slot starts when both the DMA transfer
+ * and the nOE pulse are over (interrupts of both have the same priority). DMA buffers are
+ * swapped before the first slot of frame, so it's never mixed from different pictures.
+ */
+#define BCM_SPIDONE     1
+#define BCM_OEDONE      2
+static volatile uint8_t bcm_flags = 0;
+static volatile uint8_t bcm_on = 0;
+static uint8_t scanQ = 0, scanP = 0; // quarter & bitplane in shift registers
+// statistics: cycles spent in interrupts & amount of full frames
+static volatile uint32_t bcm_cycles = 0, bcm_frames = 0;
+
+// latch sent data, show it & start transmission of next slot
+static void bcm_next(){
+    bcm_flags = 0;
+    while(SPI1->SR & SPI_SR_BSY); // last byte is still in shift register
+    SET(SCLK); // lock data
+    // set address bits
+    if(scanQ & 1) SET(A);
+    else CLEAR(A);
+    if(scanQ & 2) SET(B);
+    else CLEAR(B);
+    BCM_TIM->ARR = BCM_UNIT << scanP;
+    BCM_TIM->EGR = TIM_EGR_UG;
+    BCM_TIM->CR1 |= TIM_CR1_CEN; // turn ON screen
+    if(++scanP == SCREEN_PLANES){
+        scanP = 0;
+        if(++scanQ > 3){ // roll next
+            scanQ = 0;
+            ++bcm_frames;
+            ScreenSwap(); // new frame is taken from back buffer if it's ready
+        }
+    }
+    CLEAR(SCLK);
+    SPI_transmit(getDmaBuf(scanQ, scanP), DMABUF_SZ);
+}
+
+static inline void bcm_event(uint8_t flag){
+    uint32_t t0 = DWT->CYCCNT;
+    bcm_flags |= flag;
+    if(bcm_on && bcm_flags == (BCM_SPIDONE | BCM_OEDONE)) bcm_next();
+    bcm_cycles += DWT->CYCCNT - t0;
+}
+
+/**
+ * @brief bcm_spi_done - SPI DMA transfer is over (called from its interrupt)
+ */
+void bcm_spi_done(){
+    bcm_event(BCM_SPIDONE);
+}
+
+// the end of nOE pulse
+void tim2_isr(){
+    if(BCM_TIM->SR & TIM_SR_UIF){
+        BCM_TIM->SR = ~TIM_SR_UIF;
+        bcm_event(BCM_OEDONE);
+    }
+}
+
+/**
+ * @brief ShowScreen - turn on data transmission
+ */
+void ShowScreen(){
+    if(bcm_on) return;
+    if(SPI_status == SPI_NOTREADY) spi_setup();
+    if(SPI_status != SPI_READY) return; // SPI busy - try next time
+    scanQ = 0; scanP = 0;
+    ScreenSync(1);
+    bcm_flags = BCM_OEDONE;
+    BCM_TIM->CCMR1 = TIM_CCMR1_OC2M_2 | TIM_CCMR1_OC2M_1 | TIM_CCMR1_OC2M_0; // PWM2
+    bcm_on = 1;
+    CLEAR(SCLK);
+    SPI_transmit(getDmaBuf(0, 0), DMABUF_SZ);
+}
+
+void ScreenOFF(){
+    //USB_send("OFF\n");
+    bcm_on = 0;
+    BCM_TIM->CR1 &= ~TIM_CR1_CEN;
+    BCM_TIM->CCMR1 = TIM_CCMR1_OC2M_2; // forced inactive: screen is off
+    CLEAR(SCLK);
+    CLEAR(A);
+    CLEAR(B);
+    ScreenSync(0);
+}
+
+/**
+ * @brief getScreenCycles - statistics of BCM engine
+ * @param frames (o) - amount of frames shown since previous call
+ * @return amount of CPU cycles spent in its interrupts since previous call
+ */
+uint32_t getScreenCycles(uint32_t *frames){
+    uint32_t c, f;
+    __disable_irq();
+    c = bcm_cycles; bcm_cycles = 0;
+    f = bcm_frames; bcm_frames = 0;
+    __enable_irq();
+    if(frames) *frames = f;
+    return c;
+}
@@ -0,0 +1,37 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef SCAN_H__
+#define SCAN_H__
+
+#include <stdint.h>
+
+// time of the least significant bitplane, BCM timer ticks (us); for two panels it isn't less than
+// SPI transmission of DMABUF_SZ bytes (57us @4.5MHz), so quarter is shown 15*64us and
+// framerate is near 250Hz. Longer chains need more time to transmit bitplane: screen is dark
+// while waiting for it, so framerate is 1/(4*sum(max(BCM_UNIT<<p, transmission time))),
+// e.g. ~135Hz for 16 panels (`make bench` in scrtest)
+#define BCM_UNIT            64
+
+void ShowScreen();
+void ScreenOFF();
+void bcm_spi_done();
+uint32_t getScreenCycles(uint32_t *frames);
+
+#endif // SCAN_H__
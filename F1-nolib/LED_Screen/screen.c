@@ -16,13 +16,9 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
-#include <string.h> // memset, memcpy
-#include <stdio.h>
+#include <stddef.h>
 #include "fonts.h"
-#include "hardware.h"
 #include "screen.h"
-#include "spi.h"
-//#include "usb.h"
 
 // !!!FOR LITTLE-ENDIAN!!!
 
@@ -30,36 +26,239 @@
 // Y coordinate - from top to bottom!
 // (0,0) is top left corner
 
-// all-screen buffer
-static uint8_t screenbuf[SCREENBUF_SZ];
-// buffers for DMA - for each of four parts
-static uint8_t dmabuf[4][DMABUF_SZ];
+// screen width in bytes
+#define SCREEN_W8           (SCREEN_WIDTH/8)
+
+static screen_geometry geom = {
+    .width = SCREEN_CHAIN*PANEL_WIDTH, .height = SCREEN_ROWS*PANEL_HEIGHT,
+    .chain = SCREEN_CHAIN, .rows = SCREEN_ROWS, .serpentine = 0, .panels = SCREEN_CHAIN*SCREEN_ROWS
+};
+const screen_geometry *geometry = &geom;
+
+// buffers are words to convert them by words, byte access is through these macros
+// all-screen buffer: bitplanes of pixels brightness (plane 0 is the least significant bit)
+static uint32_t screenbuf[SCREEN_PLANES][SCREENBUF_MAXSZ/4];
+#define SCRBYTES(p)         ((uint8_t*)screenbuf[p])
+// buffers for DMA - front (scanned) & back ones, for each of four parts & each bitplane
+static uint32_t dmabuf[2][4][SCREEN_PLANES][DMABUF_MAXSZ/4];
+#define DMABYTES(b, q, p)   ((uint8_t*)dmabuf[b][q][p])
+// dirty rectangle (inclusive) to convert; dirtyX0 > dirtyX1 if nothing changed
+static int16_t dirtyX0 = 0, dirtyY0 = 0, dirtyX1 = SCREEN_CHAIN*PANEL_WIDTH-1, dirtyY1 = SCREEN_ROWS*PANEL_HEIGHT-1;
+
+/*
+ * Conversion goes into back buffer, which becomes front at the start of next frame
+ * (ScreenSwap() from scan interrupt); when screen isn't scanned, front one is converted.
+ * Each buffer has its own rectangle of changes it lacks, so converting into back one brings
+ * it up to date. Marquee interrupt converts only its band (when ConvertScreenBuf isn't
+ * running, else it leaves that job to it), swap is never requested while conversion is in
+ * progress.
+ */
+typedef struct{
+    int16_t X0, Y0, X1, Y1; // inclusive, X0 > X1 if empty
+} rect;
+static rect lack[2] = {{0, 0, -1, -1}, {0, 0, -1, -1}};
+static volatile uint8_t front = 0, swapreq = 0, converting = 0, mqpending = 0;
+static uint8_t scansync = 0;
+
+/*
+ * Marquee: text strip (bit 31 of word is the left pixel) is shown in band of screen rows
+ * instead of screenbuf; screen column 0 shows strip column `offset`, strip wraps around.
+ * Strip is text & blank gap of screen width, so text goes out before it appears again.
+ */
+static uint32_t strip[MARQUEE_HEIGHT][MARQUEE_MAXLEN/32 + 1];
+static struct{
+    volatile uint8_t on;
+    uint8_t level;              // brightness of text
+    int16_t Y;                  // top row of strip on screen
+    int16_t Y0, Y1;             // band rows (on screen)
+    uint16_t len;               // length of strip (px)
+    volatile uint16_t offset;   // strip column in screen column 0
+} mq;
 
 /**
- * @brief FillScreen - fill screen buffer with 0 or 1
+ * @brief SetGeometry - change panels configuration (screen should be off); screen buffer is
+ *        cleared
+ * @param chain      - panels in row
+ * @param rows       - rows of panels
+ * @param serpentine - !=0 for serpentine layout
+ * @return 0 if all OK
+ */
+uint8_t SetGeometry(uint8_t chain, uint8_t rows, uint8_t serpentine){
+    if(!chain || !rows || chain * rows > SCREEN_MAXPANELS) return 1;
+    mq.on = 0;
+    // old rectangles could be out of new screen
+    dirtyX0 = 0; dirtyX1 = -1;
+    lack[0].X0 = lack[1].X0 = 0;
+    lack[0].X1 = lack[1].X1 = -1;
+    geom.chain = chain;
+    geom.rows = rows;
+    geom.serpentine = serpentine ? 1 : 0;
+    geom.panels = chain * rows;
+    geom.width = chain * PANEL_WIDTH;
+    geom.height = rows * PANEL_HEIGHT;
+    FillScreen(0);
+    return 0;
+}
+// brightness of pixels drawn by DrawPix
+static uint8_t penlevel = SCREEN_MAXLEVEL;
+// kerning of text
+static uint8_t kerning = 0;
+
+/**
+ * @brief FillScreen - fill screen buffer with 0 or current brightness
  * @param setclear   - !=1 to set & ==0 to reset
  */
 void FillScreen(uint8_t setclear){
-    uint8_t pattern = 0;
-    if(setclear) pattern = 0xff;
-    if(SCREEN_IS_NEGATIVE) pattern = ~pattern;
-    for(int i = 0; i < SCREENBUF_SZ; ++i) screenbuf[i] = pattern;
+    for(int p = 0; p < SCREEN_PLANES; ++p){
+        uint8_t pattern = 0;
+        if(setclear && (penlevel & (1<<p))) pattern = 0xff;
+        if(SCREEN_IS_NEGATIVE) pattern = ~pattern;
+        uint32_t *ptr = screenbuf[p], word = pattern * 0x01010101U;
+        for(int i = 0; i < SCREENBUF_SZ/4; ++i) ptr[i] = word;
         // memset -> halt
-    //memset(screenbuf, pattern, SCREENBUF_SZ);
+    }
+    MarkDirty(0, 0, SCREEN_WIDTH-1, SCREEN_HEIGHT-1);
+}
+
+/**
+ * @brief MarkDirty - add rectangle to region which should be converted by ConvertScreenBuf
+ * @param X0, Y0 - top left corner
+ * @param X1, Y1 - bottom right corner (inclusive)
+ */
+void MarkDirty(int16_t X0, int16_t Y0, int16_t X1, int16_t Y1){
+    if(X0 < 0) X0 = 0;
+    if(Y0 < 0) Y0 = 0;
+    if(X1 > SCREEN_WIDTH-1) X1 = SCREEN_WIDTH-1;
+    if(Y1 > SCREEN_HEIGHT-1) Y1 = SCREEN_HEIGHT-1;
+    if(X0 > X1 || Y0 > Y1) return; // outside of screen
+    if(dirtyX0 > dirtyX1){ // clean
+        dirtyX0 = X0; dirtyX1 = X1;
+        dirtyY0 = Y0; dirtyY1 = Y1;
+        return;
+    }
+    if(X0 < dirtyX0) dirtyX0 = X0;
+    if(X1 > dirtyX1) dirtyX1 = X1;
+    if(Y0 < dirtyY0) dirtyY0 = Y0;
+    if(Y1 > dirtyY1) dirtyY1 = Y1;
+}
+
+/**
+ * @brief SetBrightness - set brightness of pixels drawn by DrawPix, FillScreen & text functions
+ * @param level - 0..SCREEN_MAXLEVEL (greater values are truncated)
+ */
+void SetBrightness(uint8_t level){
+    if(level > SCREEN_MAXLEVEL) level = SCREEN_MAXLEVEL;
+    penlevel = level;
+}
+
+/**
+ * @brief DrawPixLevel - set brightness of pixel
+ * @param X, Y  - pixel coordinates (could be outside of screen)
+ * @param level - brightness (0 - off, SCREEN_MAXLEVEL - max)
+ */
+void DrawPixLevel(int16_t X, int16_t Y, uint8_t level){
+    if(X < 0 || X > SCREEN_WIDTH-1 || Y < 0 || Y > SCREEN_HEIGHT-1) return; // outside of screen
+    // now calculate coordinate of pixel
+    int idx = Y*SCREEN_W8 + X/8;
+    uint8_t mask = 1 << (7 - (X%8)); // only for little-endian
+    if(SCREEN_IS_NEGATIVE) level = ~level;
+    for(int p = 0; p < SCREEN_PLANES; ++p){
+        if(level & (1<<p)) SCRBYTES(p)[idx] |= mask;
+        else SCRBYTES(p)[idx] &= ~mask;
+    }
+    if(dirtyX0 > dirtyX1){
+        dirtyX0 = dirtyX1 = X;
+        dirtyY0 = dirtyY1 = Y;
+        return;
+    }
+    if(X < dirtyX0) dirtyX0 = X;
+    else if(X > dirtyX1) dirtyX1 = X;
+    if(Y < dirtyY0) dirtyY0 = Y;
+    else if(Y > dirtyY1) dirtyY1 = Y;
 }
 
 /**
  * @brief DrawPix - set or clear pixel
  * @param X, Y - pixel coordinates (could be outside of screen)
- * @param pix - == 1 to set and 0 to clear
+ * @param pix - != 0 to set (with current brightness) and 0 to clear
  */
 void DrawPix(int16_t X, int16_t Y, uint8_t pix){
-    if(X < 0 || X > SCREEN_WIDTH-1 || Y < 0 || Y > SCREEN_HEIGHT-1) return; // outside of screen
-    // now calculate coordinate of pixel
-    uint8_t *ptr = &screenbuf[Y*SCREEN_WIDTH/8 + X/8];
-    if(SCREEN_IS_NEGATIVE)pix = !pix;
-    if(pix) *ptr |= 1 << (7 - (X%8));  // only for little-endian
-    else *ptr &= ~(1 << (7 - (X%8))); // only for little-endian
+    DrawPixLevel(X, Y, pix ? penlevel : 0);
+}
+
+/**
+ * @brief blit_glyph - draw symbol rows: lit pixels with current brightness, others - with 0
+ * @param X, Y   - left upper corner
+ * @param rows   - symbol rows (bit 31 is column 0)
+ * @param w, h   - symbol size (w <= FONT_MAXWIDTH)
+ * @param transp - amount of left columns with transparent background (kerned with previous symbol)
+ */
+static void blit_glyph(int16_t X, int16_t Y, const uint32_t *rows, uint8_t w, uint8_t h, uint8_t transp){
+    // clipping: rows r0..r1-1 & columns c0..c1-1 are on screen
+    int16_t r0 = (Y < 0) ? -Y : 0, r1 = (Y + h > SCREEN_HEIGHT) ? SCREEN_HEIGHT - Y : h;
+    int16_t c0 = (X < 0) ? -X : 0, c1 = (X + w > SCREEN_WIDTH) ? SCREEN_WIDTH - X : w;
+    if(r0 >= r1 || c0 >= c1) return;
+    MarkDirty(X + c0, Y + r0, X + c1 - 1, Y + r1 - 1);
+    // first byte of symbol row on screen (could be negative) and shift of column 0 in it
+    int16_t B = (X >= 0) ? X / 8 : -((7 - X) / 8);
+    uint8_t shift = X - 8*B;
+    uint32_t colmask = (0xffffffffU >> c0) & ~(0xffffffffU >> c1);
+    uint32_t bgmask = colmask & (0xffffffffU >> transp); // where background is drawn
+    colmask >>= shift; bgmask >>= shift;
+    // bytes k0..k1-1 of four are on screen
+    int16_t k0 = (B < 0) ? -B : 0, k1 = (B + 4 > SCREEN_W8) ? SCREEN_W8 - B : 4;
+    // bytes of lit pixels & background for each plane
+    uint8_t litpat[SCREEN_PLANES], bgpat = SCREEN_IS_NEGATIVE ? 0xff : 0;
+    for(int p = 0; p < SCREEN_PLANES; ++p){
+        litpat[p] = (penlevel & (1<<p)) ? 0xff : 0;
+        if(SCREEN_IS_NEGATIVE) litpat[p] = ~litpat[p];
+    }
+    for(int16_t r = r0; r < r1; ++r){
+        uint32_t bits = rows[r] >> shift;
+        uint32_t lit = bits & colmask, bg = bgmask & ~bits, mask = lit | bg;
+        int idx = (Y + r)*SCREEN_W8 + B;
+        for(int16_t k = k0; k < k1; ++k){
+            uint8_t m = mask >> (24 - 8*k);
+            if(!m) continue;
+            uint8_t l = lit >> (24 - 8*k), b = bg >> (24 - 8*k);
+            for(int p = 0; p < SCREEN_PLANES; ++p){
+                uint8_t *ptr = &SCRBYTES(p)[idx + k];
+                *ptr = (*ptr & ~m) | (l & litpat[p]) | (b & bgpat);
+            }
+        }
+    }
+}
+
+/**
+ * @brief kern - kerning of symbols pair: the least gap between them (checking neighbour rows
+ *        of the first too) shrinks to KERN_GAP
+ * @param a, wa - rows & width of first symbol
+ * @param b     - rows of second symbol
+ * @return shift of second symbol to the left
+ */
+static uint8_t kern(const uint32_t *a, uint8_t wa, const uint32_t *b){
+    int16_t h = curfont->height, mingap = FONT_MAXWIDTH * 2;
+    for(int16_t r = 0; r < h; ++r){
+        if(!b[r]) continue;
+        uint32_t ar = a[r];
+        if(r) ar |= a[r-1];
+        if(r < h - 1) ar |= a[r+1];
+        if(!ar) continue;
+        int16_t gap = wa - 32 + __builtin_ctz(ar) + __builtin_clz(b[r]);
+        if(gap < mingap) mingap = gap;
+    }
+    mingap -= KERN_GAP;
+    if(mingap <= 0 || mingap >= FONT_MAXWIDTH) return 0; // touching or nothing in common rows
+    if(mingap > wa / 2) mingap = wa / 2;
+    return (uint8_t)mingap;
+}
+
+/**
+ * @brief SetKerning - turn on/off kerning in PutStringAt
+ * @param on - !=0 to turn on
+ */
+void SetKerning(uint8_t on){
+    kerning = on;
 }
 
 /**
@@ -69,47 +268,216 @@ void DrawPix(int16_t X, int16_t Y, uint8_t pix){
  * @return char width
  */
 uint8_t DrawCharAt(int16_t X, int16_t Y, uint8_t Char){
-    const uint8_t *curchar = font_char(Char);
-    if(!curchar) return 0;
+    uint32_t rows[FONT_MAXHEIGHT];
+    uint8_t w = font_rows(Char, rows);
+    if(!w) return 0;
     // now change Y coordinate to left upper corner of font
     Y += 1 - curfont->height + curfont->baseline;
-    // height and width of letter in pixels
-    uint8_t h = curfont->height, w = *curchar++; // now curchar is pointer to bits array
-    uint8_t lw = curfont->bytes / h; // width of letter in bytes
-    for(uint8_t row = 0; row <= h; ++row){
-        for(uint8_t col = 0; col < w; ++col){
-            DrawPix(X + col, Y + row, curchar[row*lw + (col/8)] & (1 << (7 - (col%8)))); // only for little-endian
-        }
-    }
+    blit_glyph(X, Y, rows, w, curfont->height, 0);
     return w;
 }
 
+// reverse bits order: byte order & bits in each byte (for rotated panels)
+static inline uint32_t rbit32(uint32_t x){
+#ifdef __ARM_ARCH_7M__
+    __asm__("rbit %0, %1" : "=r"(x) : "r"(x));
+    return x;
+#else
+    x = ((x >> 1) & 0x55555555) | ((x & 0x55555555) << 1);
+    x = ((x >> 2) & 0x33333333) | ((x & 0x33333333) << 2);
+    x = ((x >> 4) & 0x0f0f0f0f) | ((x & 0x0f0f0f0f) << 4);
+    x = ((x >> 8) & 0x00ff00ff) | ((x & 0x00ff00ff) << 8);
+    return (x >> 16) | (x << 16);
+#endif
+}
+
+// 32 strip pixels of row from column pos (row has one more word after the strip end)
+static inline uint32_t strip_bits(const uint32_t *row, uint16_t pos){
+    uint16_t i = pos / 32, sh = pos % 32;
+    uint32_t x = row[i] << sh;
+    if(sh) x |= row[i+1] >> (32 - sh);
+    return x;
+}
+
+// bitplane p of marquee strip row r in panel column pcol (as word of screenbuf)
+static uint32_t strip_word(uint8_t p, int r, int pcol){
+    uint32_t pix = 0;
+    if(mq.level & (1<<p)){
+        const uint32_t *row = strip[r];
+        uint16_t pos = mq.offset + pcol*PANEL_WIDTH;
+        if(pos >= mq.len) pos -= mq.len;
+        pix = strip_bits(row, pos);
+        uint16_t n = mq.len - pos;
+        if(n < 32) pix = (pix & ~(0xffffffffU >> n)) | (strip_bits(row, 0) >> n); // wrap around
+        pix = __builtin_bswap32(pix); // left pixel is MSB of the first byte
+    }
+    return SCREEN_IS_NEGATIVE ? ~pix : pix;
+}
+
+// word of bitplane p of screen row y in panel column pcol: marquee band is taken from strip
+static inline uint32_t panel_row(uint8_t p, int y, int pcol){
+    if(mq.on && y >= mq.Y0 && y <= mq.Y1) return strip_word(p, y - mq.Y, pcol);
+    return screenbuf[p][y*(SCREEN_W8/4) + pcol];
+}
+
+/*
+ * Each quarter of panel gets 16 bytes: 4 bytes of each its column (byte of X) from rows
+ * Y = 12+partNo, 8+partNo, 4+partNo, partNo (from bottom to top), so 4x4 bytes of four columns
+ * by four rows are transposed by words. Panels are sent in chain order, row of panel is one
+ * word of screen row. Rotated panel has reversed rows order & bits order (of whole row).
+ */
 /**
- * @brief ConvertScreenBuf - convert scscreenbuf into dmabuf
- *
-void ConvertScreenBuf(){
-    const uint8_t colW = PANEL_WIDTH / 8, panels = SCREEN_WIDTH/PANEL_WIDTH; // screen width in bytes, panels amount
-    for(uint8_t partNo = 0; partNo < 4; ++ partNo){ // cycle by strings
-        uint8_t *dmaptr = dmabuf[partNo];
-        for(uint8_t panel = 0; panel < panels; ++panel){
-            int X = panel * colW;
-            for(int Y = SCREEN_HEIGHT-4+partNo; Y >= 0; Y -= 4){ // and cycle by Y
-                memcpy(dmaptr, &screenbuf[X + Y*(SCREEN_WIDTH/8)], colW);
-                dmaptr += colW;
+ * @brief convert_panel - convert panel into its place of DMA buffers
+ * @param buf    - DMA buffer
+ * @param p      - bitplane
+ * @param prow   - row of panels
+ * @param pcol   - column of panels (word number in screen row)
+ * @param bandonly - !=0 to convert only marquee rows keeping others (buffer byte is one row)
+ */
+static void convert_panel(uint8_t buf, uint8_t p, int prow, int pcol, uint8_t bandonly){
+    int W4 = SCREEN_W8/4; // screen row in words
+    int idx = prow * geom.chain + pcol; // panel number in chain
+    uint8_t rotated = geom.serpentine && (prow & 1);
+    if(rotated) idx = prow * geom.chain + geom.chain - 1 - pcol;
+    int y0 = prow*PANEL_HEIGHT;
+    uint8_t inband = mq.on && mq.Y0 < y0 + PANEL_HEIGHT && mq.Y1 >= y0;
+    const uint32_t *panel = &screenbuf[p][y0*W4 + pcol];
+    for(int q = 0; q < 4; ++q){
+        uint32_t r0, r1, r2, r3, M = 0xffffffff; // M - bytes of output words to change
+        if(inband){ // the same rows as below, marquee band is taken from strip
+            int y = rotated ? y0 + 3 - q : y0 + 12 + q, dy = rotated ? 4 : -4;
+            if(bandonly){
+                M = 0;
+                for(int k = 0; k < 4; ++k)
+                    if(y + k*dy >= mq.Y0 && y + k*dy <= mq.Y1) M |= 0xff << (8*k);
+                if(!M) continue;
+            }
+            r0 = panel_row(p, y, pcol); r1 = panel_row(p, y + dy, pcol);
+            r2 = panel_row(p, y + 2*dy, pcol); r3 = panel_row(p, y + 3*dy, pcol);
+            if(rotated){
+                r0 = rbit32(r0); r1 = rbit32(r1); r2 = rbit32(r2); r3 = rbit32(r3);
             }
+        }else if(rotated){ // its quarter q shows our rows 3-q, 7-q, 11-q, 15-q
+            const uint32_t *row = &panel[(3 - q)*W4];
+            r0 = rbit32(row[0]); r1 = rbit32(row[4*W4]); r2 = rbit32(row[8*W4]); r3 = rbit32(row[12*W4]);
+        }else{
+            const uint32_t *row = &panel[(12 + q)*W4];
+            r0 = row[0]; r1 = row[-4*W4]; r2 = row[-8*W4]; r3 = row[-12*W4];
+        }
+        uint32_t a = (r0 & 0x00ff00ff) | ((r1 & 0x00ff00ff) << 8);
+        uint32_t b = ((r0 & 0xff00ff00) >> 8) | (r1 & 0xff00ff00);
+        uint32_t c = (r2 & 0x00ff00ff) | ((r3 & 0x00ff00ff) << 8);
+        uint32_t d = ((r2 & 0xff00ff00) >> 8) | (r3 & 0xff00ff00);
+        uint32_t *out = &dmabuf[buf][q][p][4*idx]; // 4 words of panel, word per column
+        if(M == 0xffffffff){
+            out[0] = (a & 0xffff) | (c << 16);
+            out[1] = (b & 0xffff) | (d << 16);
+            out[2] = (a >> 16) | (c & 0xffff0000);
+            out[3] = (b >> 16) | (d & 0xffff0000);
+        }else{
+            out[0] = (out[0] & ~M) | (((a & 0xffff) | (c << 16)) & M);
+            out[1] = (out[1] & ~M) | (((b & 0xffff) | (d << 16)) & M);
+            out[2] = (out[2] & ~M) | (((a >> 16) | (c & 0xffff0000)) & M);
+            out[3] = (out[3] & ~M) | (((b >> 16) | (d & 0xffff0000)) & M);
         }
     }
 }
-*/
-void ConvertScreenBuf(){
-    for(uint8_t partNo = 0; partNo < 4; ++ partNo){ // cycle by strings
-        uint8_t *dmaptr = dmabuf[partNo];
-        for(int X = 0; X < SCREEN_WIDTH/8; ++X){
-            for(int Y = SCREEN_HEIGHT-4+partNo; Y >= 0; Y -= 4){ // and cycle by Y
-                *dmaptr++ = screenbuf[X + Y*(SCREEN_WIDTH/8)];
-            }
+
+// convert panels of rectangle into DMA buffer b
+static void convert_rect(uint8_t b, const rect *r, uint8_t bandonly){
+    int C0 = r->X0 / PANEL_WIDTH, C1 = r->X1 / PANEL_WIDTH;
+    int R0 = r->Y0 / PANEL_HEIGHT, R1 = r->Y1 / PANEL_HEIGHT;
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p)
+        for(int prow = R0; prow <= R1; ++prow)
+            for(int pcol = C0; pcol <= C1; ++pcol)
+                convert_panel(b, p, prow, pcol, bandonly);
+}
+
+static void add_rect(rect *r, int16_t X0, int16_t Y0, int16_t X1, int16_t Y1){
+    if(r->X0 > r->X1){
+        r->X0 = X0; r->X1 = X1;
+        r->Y0 = Y0; r->Y1 = Y1;
+        return;
+    }
+    if(X0 < r->X0) r->X0 = X0;
+    if(X1 > r->X1) r->X1 = X1;
+    if(Y0 < r->Y0) r->Y0 = Y0;
+    if(Y1 > r->Y1) r->Y1 = Y1;
+}
+
+// convert into back buffer all it lacks & marquee band, then request swap (if screen isn't
+// scanned, front buffer is converted: nobody sees it)
+static void convert_back(){
+    swapreq = 0; // front can't change until the end
+    uint8_t b = scansync ? !front : front;
+    rect *r = &lack[b];
+    if(r->X0 <= r->X1){
+        convert_rect(b, r, 0);
+        r->X0 = 0; r->X1 = -1;
+    }
+    if(mq.on){
+        rect band = {0, mq.Y0, SCREEN_WIDTH-1, mq.Y1};
+        convert_rect(b, &band, 0);
+    }
+    if(scansync) swapreq = 1;
+}
+
+// marquee step: screenbuf could be changed but not converted yet, so back buffer gets copy of
+// front one (if it lacks something) and only marquee rows are converted
+static void marquee_back(){
+    swapreq = 0;
+    uint8_t b = scansync ? !front : front;
+    rect *r = &lack[b];
+    if(b != front && r->X0 <= r->X1){
+        for(int q = 0; q < 4; ++q) for(int p = 0; p < SCREEN_PLANES; ++p){
+            uint32_t *src = dmabuf[front][q][p], *dst = dmabuf[b][q][p];
+            for(int i = 0; i < DMABUF_SZ/4; ++i) dst[i] = src[i];
         }
+        *r = lack[front];
+    }
+    rect band = {0, mq.Y0, SCREEN_WIDTH-1, mq.Y1};
+    convert_rect(b, &band, 1);
+    if(scansync) swapreq = 1;
+}
+
+/**
+ * @brief ConvertScreenBuf - convert dirty region of screenbuf into back DMA buffer (each
+ *        bitplane), it will be shown from the next frame
+ */
+void ConvertScreenBuf(){
+    converting = 1;
+    if(dirtyX0 <= dirtyX1){
+        add_rect(&lack[0], dirtyX0, dirtyY0, dirtyX1, dirtyY1);
+        add_rect(&lack[1], dirtyX0, dirtyY0, dirtyX1, dirtyY1);
+        dirtyX0 = SCREEN_WIDTH; dirtyX1 = -1;
+    }
+    rect *r = &lack[scansync ? !front : front];
+    if(r->X0 <= r->X1 || mqpending){
+        do{ // marquee steps while converting
+            mqpending = 0;
+            convert_back();
+        }while(mqpending);
     }
+    converting = 0;
+}
+
+/**
+ * @brief ScreenSwap - make back buffer front if it's ready (called by scan engine at the
+ *        beginning of frame)
+ */
+void ScreenSwap(){
+    if(!swapreq) return;
+    front = !front;
+    swapreq = 0;
+}
+
+/**
+ * @brief ScreenSync - turn on/off synchronization of buffers swap with scan
+ * @param on - !=0 if screen is scanned (buffers are swapped by ScreenSwap), else immediately
+ */
+void ScreenSync(uint8_t on){
+    scansync = on;
+    if(!on) ScreenSwap();
 }
 
 /**
@@ -120,111 +488,106 @@ void ConvertScreenBuf(){
  */
 uint8_t PutStringAt(int16_t X, int16_t Y, char *str){
     if(!str) return 0;
+    uint32_t rows[2][FONT_MAXHEIGHT]; // current & previous symbols
+    uint8_t cur = 0, prevw = 0, h = curfont->height;
     int16_t Xold = X;
+    Y += 1 - h + curfont->baseline;
     while(*str){
-        X += DrawCharAt(X, Y, *str++);
+        uint8_t w = font_rows(*str++, rows[cur]), k = 0;
+        if(!w) continue;
+        if(kerning && prevw) k = kern(rows[!cur], prevw, rows[cur]);
+        X -= k;
+        blit_glyph(X, Y, rows[cur], w, h, k);
+        X += w;
+        prevw = w;
+        cur = !cur;
     }
     return X - Xold;
 }
 
-uint8_t *getScreenBuf(){return screenbuf;}
-uint8_t *getDmaBuf(uint8_t N){
-    if(N > 3) return NULL;
-    return dmabuf[N];
+// OR symbol rows into strip @ column X
+static void strip_blit(int16_t X, const uint32_t *rows, uint8_t w, uint8_t h){
+    uint16_t i = X / 32, sh = X % 32;
+    uint32_t colmask = ~(0xffffffffU >> w);
+    for(uint8_t r = 0; r < h; ++r){
+        uint32_t bits = rows[r] & colmask;
+        strip[r][i] |= bits >> sh;
+        if(sh) strip[r][i+1] |= bits << (32 - sh);
+    }
 }
 
-extern volatile uint32_t Tms;
-typedef enum{ // screen states
-    SCREEN_RELAX,       // nothing to do (screen is off)
-    SCREEN_SPIACTIVE,   // SPI transmission active
-    SCREEN_WAIT,        // pause - current quarter is ON
-    SCREEN_UPDATENXT    // update next quarter
-} screen_state;
-
-static screen_state ScrnState = SCREEN_RELAX;
-
 /**
- * @brief process_screen - screen state machine processing
+ * @brief MarqueeText - render text into marquee strip & show it instead of screen rows of
+ *        this text (with current brightness); text enters from the right side of screen,
+ *        it's scrolled by MarqueeStep()
+ * @param Y   - baseline of text
+ * @param str - text (it's truncated by MARQUEE_MAXLEN - SCREEN_WIDTH pixels)
+ * @return text width in pixels (0 if marquee is off: no text or it's out of screen)
  */
-void process_screen(){
-    static uint32_t Tscr_last = 0;
-    static uint8_t currentQ = 0; // current quarter
-    switch(ScrnState){
-        case SCREEN_SPIACTIVE: // SPI transmission active
-            if(SPI_status == SPI_READY){
-                //USB_send("SPI ready\n");
-                Tscr_last = Tms;
-                ScrnState = SCREEN_WAIT;
-                SET(SCLK); // lock data
-                SET(nOE);  // turn ON screen
-            }
-        break;
-        case SCREEN_WAIT: // wait
-            if(Tms - Tscr_last > SCREEN_PAUSE){
-                //USB_send("Pause ends\n");
-                ScrnState = SCREEN_UPDATENXT;
-            }
-        break;
-        case SCREEN_UPDATENXT:
-            if(SPI_status == SPI_NOTREADY){
-                //USB_send("SPI not ready - setup\n");
-                spi_setup();
-                return;
-            }
-            if(SPI_status != SPI_READY){
-                //USB_send("SPI busy\n");
-                return; // SPI not ready - try next time
-            }
-            if(SPI_transmit(dmabuf[currentQ], DMABUF_SZ)){
-                //USB_send("SPI error\n");
-                return; // transmission error - try next time
-            }
-            //USB_send("\n\nSend next\n");
-            ScrnState = SCREEN_SPIACTIVE;
-            // now prepare selectors
-            CLEAR(SCLK);
-            CLEAR(nOE); // turn off screen
-            switch(currentQ){ // set address bits
-                case 0:
-                    CLEAR(A);
-                    CLEAR(B);
-                break;
-                case 1:
-                    SET(A);
-                    CLEAR(B);
-                break;
-                case 2:
-                    CLEAR(A);
-                    SET(B);
-                break;
-                case 3:
-                    SET(A);
-                    SET(B);
-                break;
-            }
-            if(++currentQ > 3) currentQ = 0; // roll next
-        break;
-        default:
-            return;
+uint16_t MarqueeText(int16_t Y, char *str){
+    MarqueeClear();
+    uint8_t h = curfont->height;
+    if(!str || h > MARQUEE_HEIGHT || SCREEN_WIDTH >= MARQUEE_MAXLEN) return 0;
+    Y += 1 - h + curfont->baseline;
+    int16_t Y0 = (Y < 0) ? 0 : Y, Y1 = (Y + h > SCREEN_HEIGHT) ? SCREEN_HEIGHT - 1 : Y + h - 1;
+    if(Y0 > Y1) return 0;
+    for(int r = 0; r < MARQUEE_HEIGHT; ++r)
+        for(int i = 0; i < MARQUEE_MAXLEN/32 + 1; ++i) strip[r][i] = 0;
+    uint32_t rows[2][FONT_MAXHEIGHT]; // current & previous symbols
+    uint8_t cur = 0, prevw = 0;
+    int16_t X = 0, maxX = MARQUEE_MAXLEN - SCREEN_WIDTH;
+    while(*str){
+        uint8_t w = font_rows(*str++, rows[cur]), k = 0;
+        if(!w) continue;
+        if(kerning && prevw) k = kern(rows[!cur], prevw, rows[cur]);
+        if(X - k + w > maxX) break;
+        X -= k;
+        strip_blit(X, rows[cur], w, h);
+        X += w;
+        prevw = w;
+        cur = !cur;
     }
+    if(!X) return 0;
+    mq.level = penlevel;
+    mq.Y = Y; mq.Y0 = Y0; mq.Y1 = Y1;
+    mq.len = X + SCREEN_WIDTH;
+    mq.offset = X; // screen shows blank gap
+    mq.on = 1;
+    MarkDirty(0, Y0, SCREEN_WIDTH-1, Y1);
+    return X;
+}
+
+/**
+ * @brief MarqueeClear - turn off marquee, its band shows screen buffer again
+ */
+void MarqueeClear(){
+    if(!mq.on) return;
+    mq.on = 0;
+    MarkDirty(0, mq.Y0, SCREEN_WIDTH-1, mq.Y1);
 }
 
 /**
- * @brief ShowScreen - turn on data transmission
+ * @brief MarqueeStep - scroll marquee by one pixel to the left & convert it into back buffer
+ *        (called from timer interrupt, its rate is the scrolling speed)
  */
-void ShowScreen(){
-    ScrnState = SCREEN_UPDATENXT;
+void MarqueeStep(){
+    if(!mq.on) return;
+    uint16_t o = mq.offset + 1;
+    mq.offset = (o < mq.len) ? o : 0;
+    if(converting) mqpending = 1; // ConvertScreenBuf will convert band again
+    else marquee_back();
 }
 
-void ScreenOFF(){
-    //USB_send("OFF\n");
-    CLEAR(SCLK);
-    CLEAR(nOE);
-    CLEAR(A);
-    CLEAR(B);
-    ScrnState = SCREEN_RELAX;
+uint8_t *getScreenBuf(uint8_t plane){
+    if(plane >= SCREEN_PLANES) return NULL;
+    return SCRBYTES(plane);
+}
+uint8_t *getDmaBuf(uint8_t N, uint8_t plane){
+    if(N > 3 || plane >= SCREEN_PLANES) return NULL;
+    return DMABYTES(front, N, plane);
 }
 
 void setdmabuf0(uint8_t pattern, uint8_t N){
-    for(int i = 0; i < N; ++i) dmabuf[0][i] = pattern;
+    uint8_t *ptr = DMABYTES(front, 0, 0);
+    for(int i = 0; i < N; ++i) ptr[i] = pattern;
 }
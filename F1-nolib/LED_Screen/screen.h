@@ -22,31 +22,75 @@
 
 #include <stdint.h>
 
-// display size in px
-// PANEL_WIDTH is width of one panel
+// panel size in px
 #define PANEL_WIDTH         32
-// SCREEN_WIDTH is total screen width
-#define SCREEN_WIDTH        64
-#define SCREEN_HEIGHT       16
-#define SCREENBUF_SZ        (SCREEN_WIDTH*SCREEN_HEIGHT/8)
+#define PANEL_HEIGHT        16
+// bytes of one panel bitplane
+#define PANEL_BYTES         (PANEL_WIDTH*PANEL_HEIGHT/8)
+// max amount of panels (buffers are static; could be changed by -D for host tests)
+#ifndef SCREEN_MAXPANELS
+#define SCREEN_MAXPANELS    16
+#endif
+// default geometry: panels in chain row, rows
+#define SCREEN_CHAIN        2
+#define SCREEN_ROWS         1
+
+/*
+ * Panels are connected in one chain: from left to right in the first (top) row, then in the
+ * second etc. In serpentine layout odd rows are chained from right to left, their panels are
+ * rotated by 180 degrees.
+ */
+typedef struct{
+    uint16_t width;     // screen size (px)
+    uint16_t height;
+    uint8_t chain;      // panels in row
+    uint8_t rows;       // rows of panels
+    uint8_t serpentine; // !=0 for serpentine layout
+    uint8_t panels;     // total amount of panels
+} screen_geometry;
+
+extern const screen_geometry *geometry;
+
+// current screen size
+#define SCREEN_WIDTH        (geometry->width)
+#define SCREEN_HEIGHT       (geometry->height)
+// sizes of bitplane and its quarter (DMA buffer)
+#define SCREENBUF_SZ        (geometry->panels*PANEL_BYTES)
 #define DMABUF_SZ           (SCREENBUF_SZ/4)
+#define SCREENBUF_MAXSZ     (SCREEN_MAXPANELS*PANEL_BYTES)
+#define DMABUF_MAXSZ        (SCREENBUF_MAXSZ/4)
+
+// amount of bitplanes (3 - 8 brightness levels, 4 - 16 levels)
+#define SCREEN_PLANES       4
+#define SCREEN_MAXLEVEL     ((1<<SCREEN_PLANES) - 1)
+
+// least gap between symbols (px) when kerning is on
+#define KERN_GAP            1
 
-// pause to show a quater of screen - 10ms (25Hz framerate)
-#define SCREEN_PAUSE        3
+// marquee strip: max height (rows) & length (px, text and blank gap of screen width)
+#define MARQUEE_HEIGHT      PANEL_HEIGHT
+#define MARQUEE_MAXLEN      1024
 
 // screen is positive (1->on, 0->off)
 #define SCREEN_IS_NEGATIVE  1
 
+uint8_t SetGeometry(uint8_t chain, uint8_t rows, uint8_t serpentine);
 void FillScreen(uint8_t setclear);
+void SetBrightness(uint8_t level);
+void DrawPixLevel(int16_t X, int16_t Y, uint8_t level);
 void DrawPix(int16_t X, int16_t Y, uint8_t pix);
 uint8_t DrawCharAt(int16_t X, int16_t Y, uint8_t Char);
+void SetKerning(uint8_t on);
+void MarkDirty(int16_t X0, int16_t Y0, int16_t X1, int16_t Y1);
 void ConvertScreenBuf();
 uint8_t PutStringAt(int16_t X, int16_t Y, char *str);
-uint8_t *getScreenBuf();
-uint8_t *getDmaBuf(uint8_t N);
-void process_screen();
-void ShowScreen();
-void ScreenOFF();
+void ScreenSwap();
+void ScreenSync(uint8_t on);
+uint16_t MarqueeText(int16_t Y, char *str);
+void MarqueeClear();
+void MarqueeStep();
+uint8_t *getScreenBuf(uint8_t plane);
+uint8_t *getDmaBuf(uint8_t N, uint8_t plane);
 
 void setdmabuf0(uint8_t pattern, uint8_t N);
 
@@ -0,0 +1,146 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// benchmark & check of ConvertScreenBuf for different panels geometry; model of framerate
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fonts.h"
+#include "screen.h"
+#include "tick.h"
+
+#define NFULL       2000
+#define NPARTIAL    20000
+
+// BCM timing (see scan.c): LSB plane time & overhead of switching to next slot (us)
+#define BCM_UNIT        64
+#define BCM_OVERHEAD    3
+
+static uint8_t refbuf[4][DMABUF_MAXSZ];
+
+static inline int pix(uint8_t plane, int x, int y){
+    return (getScreenBuf(plane)[y*(SCREEN_WIDTH/8) + x/8] >> (7 - x%8)) & 1;
+}
+
+// pixel by pixel conversion of one bitplane
+static void ref_convert(uint8_t plane){
+    const screen_geometry *g = geometry;
+    for(int prow = 0; prow < g->rows; ++prow) for(int pcol = 0; pcol < g->chain; ++pcol){
+        int rotated = g->serpentine && (prow & 1);
+        int idx = prow * g->chain + (rotated ? g->chain - 1 - pcol : pcol);
+        for(int q = 0; q < 4; ++q) for(int c = 0; c < 4; ++c) for(int k = 0; k < 4; ++k){
+            uint8_t byte = 0;
+            for(int b = 0; b < 8; ++b){
+                int x = 8*c + b, y = 12 + q - 4*k; // pixel of panel
+                if(rotated){
+                    x = PANEL_WIDTH - 1 - x;
+                    y = PANEL_HEIGHT - 1 - y;
+                }
+                byte |= pix(plane, pcol*PANEL_WIDTH + x, prow*PANEL_HEIGHT + y) << (7 - b);
+            }
+            refbuf[q][idx*16 + c*4 + k] = byte;
+        }
+    }
+}
+
+// compare dmabuf with reference conversion
+static int check(const char *what){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+        ref_convert(p);
+        for(uint8_t q = 0; q < 4; ++q){
+            if(memcmp(refbuf[q], getDmaBuf(q, p), DMABUF_SZ)){
+                fprintf(stderr, "%dx%d: %s - wrong conversion of plane %d quarter %d\n",
+                        SCREEN_WIDTH, SCREEN_HEIGHT, what, p, q);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void randomfill(){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+        uint8_t *ptr = getScreenBuf(p);
+        for(int i = 0; i < SCREENBUF_SZ; ++i) ptr[i] = random();
+    }
+    MarkDirty(0, 0, SCREEN_WIDTH-1, SCREEN_HEIGHT-1);
+}
+
+// check & benchmark for given geometry
+static int bench(uint8_t chain, uint8_t rows, uint8_t serp){
+    uint64_t t0, tfull = 0, tpart = 0;
+    int16_t charh = curfont->height;
+    if(SetGeometry(chain, rows, serp)){
+        fprintf(stderr, "Can't set geometry %dx%d\n", chain, rows);
+        return 1;
+    }
+    // check: full conversion & incremental conversion after drawing of pixels and chars
+    randomfill();
+    ConvertScreenBuf();
+    if(check("full")) return 1;
+    for(int i = 0; i < 1000; ++i){
+        int16_t X = random() % (SCREEN_WIDTH + 20) - 10, Y = random() % (SCREEN_HEIGHT + 20) - 10;
+        SetBrightness(random() % (SCREEN_MAXLEVEL + 1));
+        if(i & 1) DrawPixLevel(X, Y, random() % (SCREEN_MAXLEVEL + 1));
+        else DrawCharAt(X, Y, 'A' + i % 26);
+        ConvertScreenBuf();
+        if(check("partial")) return 1;
+    }
+    // full update
+    for(int i = 0; i < NFULL; ++i){
+        randomfill();
+        t0 = tick();
+        ConvertScreenBuf();
+        tfull += tick() - t0;
+    }
+    // partial update: one char in random place
+    SetBrightness(SCREEN_MAXLEVEL);
+    for(int i = 0; i < NPARTIAL; ++i){
+        DrawCharAt(random() % (SCREEN_WIDTH - 8), charh - 1 + random() % (SCREEN_HEIGHT - charh + 1), 'A' + i % 26);
+        t0 = tick();
+        ConvertScreenBuf();
+        tpart += tick() - t0;
+    }
+    if(check("benchmark")) return 1;
+    printf("%3dx%-3d (%2dx%d%s): full update %6.0f %s, one char %4.0f %s\n",
+           SCREEN_WIDTH, SCREEN_HEIGHT, chain, rows, serp ? ", serpentine" : "",
+           (double)tfull / NFULL, UNITS, (double)tpart / NPARTIAL, UNITS);
+    return 0;
+}
+
+// framerate of BCM: each slot lasts max(nOE pulse, transmission of next bitplane)
+static double framerate(int panels, double spifreq){
+    double ttx = panels * PANEL_BYTES / 4 * 8 / spifreq * 1e6 + BCM_OVERHEAD, T = 0.;
+    for(int p = 0; p < SCREEN_PLANES; ++p){
+        double t = BCM_UNIT << p;
+        T += (t > ttx) ? t : ttx;
+    }
+    return 1e6 / (4. * T);
+}
+
+int main(){
+    srandom(1);
+    if(bench(2, 1, 0) || bench(4, 1, 0) || bench(4, 2, 0) || bench(4, 2, 1) || bench(8, 2, 1)
+       || bench(8, 4, 0) || bench(8, 4, 1)) return 1;
+    printf("\nFramerate (Hz) of %d bitplanes by chain length, SPI clock 4.5/9/18MHz:\n", SCREEN_PLANES);
+    for(int n = 1; n <= 32; n *= 2)
+        printf("%2d panels (%4d bytes/plane): %4.0f %4.0f %4.0f\n", n, n * PANEL_BYTES / 4,
+               framerate(n, 4.5e6), framerate(n, 9e6), framerate(n, 18e6));
+    return 0;
+}
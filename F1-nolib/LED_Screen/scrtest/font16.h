@@ -1,4322 +0,0 @@
-/*
- * This file is part of the LED_screen project.
- * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
- *
- * This program is free software: you can redistribute it and/or modify
- * it under the terms of the GNU General Public License as published by
- * the Free Software Foundation, either version 3 of the License, or
- * (at your option) any later version.
- *
- * This program is distributed in the hope that it will be useful,
- * but WITHOUT ANY WARRANTY; without even the implied warranty of
- * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
- * GNU General Public License for more details.
- *
- * You should have received a copy of the GNU General Public License
- * along with this program.  If not, see <http://www.gnu.org/licenses/>.
- */
-
-// this file should be included JUST ONCE!
-// only in fonts.c
-
-// font14: matrix 16x16 bits -> 32 bytes per symbol
-#define FONT16BYTES         32
-#define FONT16HEIGHT        16
-#define FONT16BASELINE      0
-
-// Font 16px height, full matrix is 32x32px
-// first number is symbol width, another are symbol data
-const uint8_t font16_table[SYMBOLS_AMOUNT *(FONT16BYTES+1)] = {
-    // 0x20 - ' '
-       4,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________
-    // 0x21
-     ,
-        4,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        _X______,________,
-        ________,________,
-        ________,________,
-        _X______,________,
-        XXX_____,________,
-        _X______,________
-    // 0x22
-     ,
-        8,
-        _X___X__,________,
-        XXX_XXX_,________,
-        _XX__XX_,________,
-        _X___X__,________,
-        X___X___,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________
-    // 0x23
-     ,
-       15,
-        ________,________,
-        ______XX,____XX__,
-        ______XX,____XX__,
-        _____XX_,___XX___,
-        _____XX_,___XX___,
-        __XXXXXX,XXXXXX__,
-        _XXXXXXX,XXXXX___,
-        ___XX___,_XX_____,
-        ___XX___,_XX_____,
-        _XXXXXXX,XXXXX___,
-        XXXXXXXX,XXXX____,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        XX____XX,________,
-        XX____XX,________,
-        ________,________
-    // 0x24
-     ,
-       13,
-        ____XXXX,________,
-        __XX__XX,X_______,
-        _XX___X_,XX______,
-        _XX___X_,_X______,
-        __XX__X_,________,
-        ____XXX_,________,
-        _____XXX,________,
-        ______XX,X_______,
-        ______X_,XXX_____,
-        ______X_,_XXX____,
-        ______X_,_XXX____,
-        _XX___X_,_XXX____,
-        XX____X_,_XX_____,
-        _XXX__X_,XXX_____,
-        ___XXXXX,XX______,
-        _____XXX,________
-
-    // 0x25
-     ,
-       16,
-       __XX____,___XX___,
-       _XXXX___,__XX____,
-       XX__XX__,_XX_____,
-       XX__XX__,_XX_____,
-       XX__XX__,XX______,
-       _XXXX___,XX______,
-       __XX___X,X_______,
-       _______X,X_______,
-       ______XX,________,
-       ______XX,___XX___,
-       _____XX_,_XXXXXX_,
-       _____XX_,_XX__XX_,
-       ____XX__,_XX__XX_,
-       ____XX__,_XX__XX_,
-       ___XX___,__XXXX__,
-       __XX____,___XX___
-    // 0x26
-     ,
-       12,
-       ________,________,
-       ________,________,
-       __XXXXX_,________,
-       _XXXXXXX,________,
-       _XX___XX,________,
-       _XX___XX,________,
-       __XXXXX_,________,
-       __XXXX__,________,
-       _XX_XX__,X_______,
-       XX__XXX_,XX______,
-       XX___XXX,X_______,
-       XX____XX,XX______,
-       _XXXXXXX,XXX_____,
-       __XXXX__,_X______,
-       ________,________,
-       ________,________
-    // 0x27
-     ,
-       5,
-       _XX_____,________,
-       XXXX____,________,
-       XXXX____,________,
-       _XX_____,________,
-       _X______,________,
-       X_______,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x28
-     ,
-       7,
-        _____X__,________,
-        ___XX___,________,
-        __XX____,________,
-        _XX_____,________,
-        _XX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        XXX_____,________,
-        _XX_____,________,
-        _XX_____,________,
-        __XX____,________,
-        ___XX___,________,
-        _____X__,________
-        // 0x29
-     ,
-       7,
-        X_______,________,
-        _XX_____,________,
-        __XX____,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        ___XX___,________,
-        ___XX___,________,
-        __XX____,________,
-        _XX_____,________,
-        X_______,________
-    // 0x2A
-     ,
-       8,
-       ________,________,
-       _X_X_X__,________,
-       __XXX___,________,
-       XXXXXXX_,________,
-       __XXX___,________,
-       _X_X_X__,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x2B
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ___XX___,________,
-       ___XX___,________,
-       ___XX___,________,
-       XXXXXXXX,________,
-       XXXXXXXX,________,
-       ___XX___,________,
-       ___XX___,________,
-       ___XX___,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x2C
-     ,
-       4,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       _X______,________,
-       XXX_____,________,
-       _XX_____,________,
-       _X______,________,
-       X_______,________
-    // 0x2D
-     ,
-       6,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXXXX___,________,
-       XXXXX___,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x2E
-     ,
-       4,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       _X______,________,
-       XXX_____,________,
-       _X______,________
-    // 0x2F
-     ,
-       5,
-       ________,________,
-       ________,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x30
-     ,
-        11,
-        ___XXX__,________,
-        __XXXXXX,________,
-        _XXX_XXX,X_______,
-        _XXX__XX,X_______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        _XX____X,XX______,
-        _XXX___X,X_______,
-        _XXXX_XX,X_______,
-        __XXXXXX,________,
-        ____XXX_,________
-    // 0x31
-     ,
-       8,
-       _____X__,________,
-       ____XXX_,________,
-       ___XXXX_,________,
-       __XXXXX_,________,
-       _XX_XXX_,________,
-       XX__XXX_,________,
-       X___XXX_,________,
-       ___XXXX_,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       ___XXXX_,________,
-       ___XXXX_,________,
-       ___XXXX_,________
-    // 0x32
-     ,
-       11,
-        ___XXXXX,________,
-        _XXXX_XX,X_______,
-        XXX____X,XX______,
-        XXX____X,XX______,
-        _XX____X,XX______,
-        _______X,XX______,
-        ______XX,X_______,
-        _____XXX,________,
-        ____XXX_,________,
-        ___XXX__,________,
-        __XXX___,________,
-        _XXX____,________,
-        XXX_____,________,
-        XXX_____,X_______,
-        XXXXXXXX,X_______,
-        XXXXXXXX,________
-    // 0x33
-     ,
-       10,
-        __XXXX__,________,
-        _XX__XX_,________,
-        XX____XX,________,
-        ______XX,________,
-        ______XX,________,
-        _____XX_,________,
-        ___XXX__,________,
-        _____XX_,________,
-        ______XX,________,
-        _______X,X_______,
-        _______X,X_______,
-        _XX____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        _XX___XX,________,
-        __XXXXX_,________
-    // 0x34
-     ,
-       11,
-        ________,X_______,
-        _______X,X_______,
-        ______XX,X_______,
-        _____XXX,X_______,
-        ____XX_X,X_______,
-        ___XX__X,X_______,
-        __XX___X,X_______,
-        _XX____X,X_______,
-        XX_____X,X_______,
-        XXXXXXXX,XX______,
-        _XXXXXXX,XX______,
-        _______X,X_______,
-        _______X,X_______,
-        _______X,X_______,
-        _______X,X_______,
-        _______X,X_______
-    // 0x35
-     ,
-       10,
-        XXXXXXXX,X_______,
-        XXXXXXXX,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXX__,________,
-        _XXXXXX_,________,
-        _____XXX,________,
-        _______X,X_______,
-        _______X,X_______,
-        _______X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        _XX__XXX,________,
-        __XXXX__,________
-    // 0x36
-     ,
-       10,
-        ___XXXXX,________,
-        __XX___X,X_______,
-        _XX____X,X_______,
-        _XX_____,________,
-        XX______,________,
-        XX______,________,
-        XX__XX__,________,
-        X_XXXXXX,________,
-        XXX___XX,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XXX____X,X_______,
-        XXX____X,X_______,
-        _XXX__XX,________,
-        __XXXX__,________
-    // 0x37
-     ,
-       10,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        ______XX,X_______,
-        _____XXX,________,
-        _____XX_,________,
-        ____XXX_,________,
-        ____XX__,________,
-        ____XX__,________,
-        ___XXX__,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        __XXX___,________,
-        __XX____,________,
-        __XX____,________,
-        __XX____,________
-    // 0x38
-     ,
-       10,
-        __XXXXX_,________,
-        _XX___XX,________,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        _XX___XX,________,
-        __XXXXX_,________,
-        __XXXXX_,________,
-        _XX___XX,________,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XXX___XX,X_______,
-        _XXXXXXX,________,
-        __XXXXX_,________
-    // 0x39
-     ,
-       10,
-        ___XXX__,________,
-        _XXX_XXX,________,
-        XXX___XX,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XXX___XX,X_______,
-        _XXXXXXX,X_______,
-        __XXXX_X,X_______,
-        _______X,X_______,
-        _______X,X_______,
-        ______XX,X_______,
-        XX____XX,________,
-        XX___XXX,________,
-        _XX_XXX_,________,
-        __XXXX__,________
-    // 0x3A
-     ,
-       4,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXX_____,________,
-       XXX_____,________,
-       XXX_____,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXX_____,________,
-       XXX_____,________,
-       XXX_____,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x3B
-     ,
-       3,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       _X______,________,
-       _X______,________,
-       X_______,________,
-       ________,________
-    // 0x3C
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       _______X,________,
-       _____XXX,________,
-       ___XXXX_,________,
-       _XXXX___,________,
-       XXX_____,________,
-       _XXXX___,________,
-       ___XXXX_,________,
-       _____XXX,________,
-       _______X,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x3D
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       ________,________,
-       ________,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x3E
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       X_______,________,
-       XXX_____,________,
-       _XXXX___,________,
-       ___XXXX_,________,
-       _____XXX,________,
-       ___XXXX_,________,
-       _XXXX___,________,
-       XXX_____,________,
-       X_______,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x3F
-     ,
-       9,
-       ________,________,
-       ________,________,
-       __XXXX__,________,
-       _XXXXXX_,________,
-       XXX___XX,________,
-       XX____XX,________,
-       _____XXX,________,
-       ____XXX_,________,
-       ___XXX__,________,
-       ___XX___,________,
-       ___XX___,________,
-       ________,________,
-       ___XX___,________,
-       ___XX___,________,
-       ________,________,
-       ________,________
-    // 0x40
-     ,
-       16,
-       _____XXX,XXX_____,
-       ___XXXXX,XXXXX___,
-       __XXX___,___XXX__,
-       _XXX__XX,X_XXXX__,
-       _XX_XXXX,XXXX_XX_,
-       XXX_XX__,_XXX_XX_,
-       XX_XX___,_XX__XX_,
-       XX_XX___,_XX__XX_,
-       XX_XX___,_XX__XX_,
-       XX_XX___,XXX_XX__,
-       XX_XXXXX,XXXXX___,
-       _XX_XXXX,_XXX____,
-       _XXX____,_____XX_,
-       __XXX___,___XXX__,
-       ___XXXXX,XXXXX___,
-       _____XXX,XXX_____
-    // 0x41
-     ,
-       12,
-       ________,________,
-       ________,________,
-       ____XXX_,________,
-       ____XXX_,________,
-       ___XX_XX,________,
-       ___XX_XX,________,
-       ___XX_XX,________,
-       __XX___X,X_______,
-       __XX___X,X_______,
-       __XXXXXX,X_______,
-       _XXXXXXX,XX______,
-       _XX_____,XX______,
-       _XX_____,XX______,
-       XX______,_XX_____,
-       ________,________,
-       ________,________
-    // 0x42
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XXXXXXXX,________,
-       XXXXXXXX,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XXXXXXXX,________,
-       XXXXXXXX,X_______,
-       XX_____X,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XXXXXXXX,X_______,
-       XXXXXXXX,________,
-       ________,________,
-       ________,________
-    // 0x43
-     ,
-       11,
-       ________,________,
-       ________,________,
-       ___XXXXX,________,
-       _XXXXXXX,X_______,
-       _XX____X,XX______,
-       XX______,X_______,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,X_______,
-       _XX____X,XX______,
-       _XXXXXXX,X_______,
-       ___XXXXX,________,
-       ________,________,
-       ________,________
-    // 0x44
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XXXXXXX_,________,
-       XXXXXXXX,X_______,
-       XX_____X,X_______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX_____X,X_______,
-       XXXXXXXX,X_______,
-       XXXXXXX_,________,
-       ________,________,
-       ________,________
-    // 0x45
-     ,
-       10,
-       ________,________,
-       ________,________,
-       XXXXXXXX,X_______,
-       XXXXXXXX,X_______,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXXXXXXX,X_______,
-       XXXXXXXX,X_______,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXXXXXXX,X_______,
-       XXXXXXXX,X_______,
-       ________,________,
-       ________,________
-    // 0x46
-     ,
-       9,
-       ________,________,
-       ________,________,
-       XXXXXXXX,________,
-       XXXXXXXX,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x47
-     ,
-       11,
-       ________,________,
-       ________,________,
-       ___XXXXX,________,
-       _XXXXXXX,X_______,
-       _XX____X,XX______,
-       XX______,X_______,
-       XX______,________,
-       XX______,________,
-       XX___XXX,XX______,
-       XX___XXX,XX______,
-       XX______,XX______,
-       _XX____X,XX______,
-       _XXXXXXX,X_______,
-       ___XXXXX,________,
-       ________,________,
-       ________,________
-    // 0x48
-     ,
-       10,
-       ________,________,
-       ________,________,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XXXXXXXX,X_______,
-       XXXXXXXX,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       XX_____X,X_______,
-       ________,________,
-       ________,________
-    // 0x49
-     ,
-       3,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x4A
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       _XXXXXX_,________,
-       __XXXX__,________,
-       ________,________,
-       ________,________
-    // 0x4B
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XX______,XX______,
-       XX_____X,X_______,
-       XX____XX,________,
-       XX___XX_,________,
-       XX__XX__,________,
-       XX_XXXX_,________,
-       XXXX_XX_,________,
-       XXX___XX,________,
-       XX____XX,________,
-       XX_____X,X_______,
-       XX_____X,XX______,
-       XX______,XX______,
-       ________,________,
-       ________,________
-    // 0x4C
-     ,
-       9,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXXXXXXX,________,
-       XXXXXXXX,________,
-       ________,________,
-       ________,________
-    // 0x4D
-     ,
-       12,
-       ________,________,
-       ________,________,
-       XXX_____,XXX_____,
-       XXX_____,XXX_____,
-       XXXX___X,XXX_____,
-       XXXX___X,XXX_____,
-       XX_X___X,_XX_____,
-       XX_XX_XX,_XX_____,
-       XX_XX_XX,_XX_____,
-       XX_XX_XX,_XX_____,
-       XX__XXX_,_XX_____,
-       XX__XXX_,_XX_____,
-       XX__XXX_,_XX_____,
-       XX___X__,_XX_____,
-       ________,________,
-       ________,________
-    // 0x4E
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XX______,XX______,
-       XXX_____,XX______,
-       XXXX____,XX______,
-       XXXX____,XX______,
-       XX_XX___,XX______,
-       XX__XX__,XX______,
-       XX__XX__,XX______,
-       XX___XX_,XX______,
-       XX____XX,XX______,
-       XX____XX,XX______,
-       XX_____X,XX______,
-       XX______,XX______,
-       ________,________,
-       ________,________
-    // 0x4F
-     ,
-       11,
-       ________,________,
-       ________,________,
-       ___XXXX_,________,
-       _XXXXXXX,X_______,
-       _XX____X,X_______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       _XX____X,X_______,
-       _XXXXXXX,X_______,
-       ___XXXX_,________,
-       ________,________,
-       ________,________
-    // 0x50
-     ,
-       10,
-       ________,________,
-       ________,________,
-       XXXXXXX_,________,
-       XXXXXXXX,________,
-       XX____XX,X_______,
-       XX_____X,X_______,
-       XX____XX,X_______,
-       XXXXXXXX,________,
-       XXXXXXX_,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x51
-     ,
-       11,
-       ________,________,
-       ________,________,
-       ___XXXX_,________,
-       _XXXXXXX,X_______,
-       _XX____X,X_______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX__XX__,XX______,
-       _XX__XXX,X_______,
-       _XXXXXXX,X_______,
-       ___XXX_X,X_______,
-       ________,XX______,
-       ________,________
-    // 0x52
-     ,
-       12,
-       ________,________,
-       ________,________,
-       XXXXXXXX,________,
-       XXXXXXXX,X_______,
-       XX_____X,XX______,
-       XX______,XX______,
-       XX_____X,XX______,
-       XXXXXXXX,X_______,
-       XXXXXXX_,________,
-       XX___XXX,________,
-       XX____XX,X_______,
-       XX_____X,X_______,
-       XX_____X,XX______,
-       XX______,XXX_____,
-       ________,________,
-       ________,________
-    // 0x53
-     ,
-       10,
-       ________,________,
-       ________,________,
-       __XXXXX_,________,
-       _XXXXXXX,________,
-       XX____XX,X_______,
-       XX_____X,X_______,
-       XXXX____,________,
-       _XXXXXX_,________,
-       ___XXXXX,________,
-       ______XX,X_______,
-       XX_____X,X_______,
-       XXX___XX,X_______,
-       _XXXXXXX,________,
-       __XXXXX_,________,
-       ________,________,
-       ________,________
-    // 0x54
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XXXXXXXX,XX______,
-       XXXXXXXX,XX______,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ________,________,
-       ________,________
-    // 0x55
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XX______,XX______,
-       XXX____X,XX______,
-       _XXXXXXX,X_______,
-       __XXXXXX,________,
-       ________,________,
-       ________,________
-    // 0x56
-     ,
-       12,
-       ________,________,
-       ________,________,
-       XX______,_XX_____,
-       XX______,_XX_____,
-       _XX_____,XX______,
-       _XX_____,XX______,
-       __XX___X,X_______,
-       __XX___X,X_______,
-       __XX___X,X_______,
-       ___XX_XX,________,
-       ___XX_XX,________,
-       ____XXX_,________,
-       ____XXX_,________,
-       ____XXX_,________,
-       ________,________,
-       ________,________
-    // 0x57
-     ,
-       16,
-       ________,________,
-       ________,________,
-       XX____XX,X____XX_,
-       XXX___XX,X____XX_,
-       _XX___XX,X___XX__,
-       _XX__XX_,XX__XX__,
-       _XX__XX_,XX__XX__,
-       __XX_XX_,XX_XX___,
-       __XX_XX_,XX_XX___,
-       __XX_XX_,XX_XX___,
-       ___XXX__,_XXXX___,
-       ___XXX__,_XXX____,
-       ___XXX__,_XXX____,
-       ___XXX__,_XXX____,
-       ________,________,
-       ________,________
-    // 0x58
-     ,
-       10,
-       ________,________,
-       ________,________,
-       XX_____X,X_______,
-       XXX___XX,X_______,
-       _XX___XX,________,
-       __XX_XX_,________,
-       __XXXXX_,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       __XXXXX_,________,
-       __XX_XX_,________,
-       _XX___XX,________,
-       XXX___XX,X_______,
-       XX_____X,X_______,
-       ________,________,
-       ________,________
-    // 0x59
-     ,
-       11,
-       ________,________,
-       ________,________,
-       XX______,XX______,
-       XXX____X,XX______,
-       _XX____X,X_______,
-       __XX__XX,________,
-       __XX__XX,________,
-       ___XXXX_,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ____XX__,________,
-       ________,________,
-       ________,________
-    // 0x5A
-     ,
-       10,
-       ________,________,
-       ________,________,
-       _XXXXXXX,X_______,
-       _XXXXXXX,X_______,
-       ______XX,________,
-       _____XX_,________,
-       ____XXX_,________,
-       ____XX__,________,
-       ___XX___,________,
-       __XXX___,________,
-       __XX____,________,
-       _XX_____,________,
-       XXXXXXXX,X_______,
-       XXXXXXXX,X_______,
-       ________,________,
-       ________,________
-    // 0x5B
-     ,
-       5,
-       ________,________,
-       XXXX____,________,
-       XXXX____,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXXX____,________,
-       XXXX____,________,
-       ________,________
-    // 0x5C
-     ,
-       8,
-      XX______,________,
-      XX______,________,
-      XXX_____,________,
-      _XX_____,________,
-      _XX_____,________,
-      _XXX____,________,
-      __XX____,________,
-      __XX____,________,
-      __XXX___,________,
-      ___XX___,________,
-      ___XX___,________,
-      ___XXX__,________,
-      ____XX__,________,
-      ____XX__,________,
-      ____XXX_,________,
-      _____XX_,________
-    // 0x5D
-     ,
-       5,
-       ________,________,
-       XXXX____,________,
-       XXXX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       XXXX____,________,
-       XXXX____,________,
-       ________,________
-    // 0x5E
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ___XX___,________,
-       __XXXX__,________,
-       __XXXX__,________,
-       _XX__XX_,________,
-       _XX__XX_,________,
-       XX____XX,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x5F
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXXXXXXX,________,
-       XXXXXXXX,________,
-       ________,________
-    // 0x60
-     ,
-       4,
-       ________,________,
-       XXX_____,________,
-       _XX_____,________,
-       __XX____,________,
-       ____X___,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x61
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       _XXXXX__,________,
-       XXXXXXX_,________,
-       XX___XX_,________,
-       ___XXXX_,________,
-       _XXXXXX_,________,
-       XXX__XX_,________,
-       XX___XX_,________,
-       XXXXXXX_,________,
-       _XXXX_XX,________,
-       ________,________,
-       ________,________
-    // 0x62
-     ,
-       9,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX_XXX__,________,
-       XXXXXXX_,________,
-       XXX__XXX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       XXXXXXX_,________,
-       XX_XXX__,________,
-       ________,________,
-       ________,________
-    // 0x63
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       __XXXX__,________,
-       _XXXXXX_,________,
-       XXX__XX_,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XXX__XX_,________,
-       _XXXXXX_,________,
-       __XXXX__,________,
-       ________,________,
-       ________,________
-    // 0x64
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________,
-       __XXX_XX,________,
-       _XXXXXXX,________,
-       XXX__XXX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       _XXXXXXX,________,
-       __XXX_XX,________,
-       ________,________,
-       ________,________
-    // 0x65
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       __XXX___,________,
-       _XXXXX__,________,
-       XX___XX_,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       XX______,________,
-       XXX__XX_,________,
-       _XXXXX__,________,
-       __XXX___,________,
-       ________,________,
-       ________,________
-    // 0x66
-     ,
-       7,
-       ________,________,
-       ________,________,
-       __XXXX__,________,
-       _XXXXX__,________,
-       _XX_____,________,
-       XXXXX___,________,
-       XXXXX___,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       ________,________,
-       ________,________
-    // 0x67
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       __XXX_XX,________,
-       _XXXXXXX,________,
-       XXX__XXX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       _XXXXXXX,________,
-       __XXX_XX,________,
-       XX____XX,________,
-       XXXXXXXX,________,
-       _XXXXXX_,________
-    // 0x68
-     ,
-       9,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX_XXXX_,________,
-       XXXXXXXX,________,
-       XXX___XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       ________,________,
-       ________,________
-    // 0x69
-     ,
-       3,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x6A
-     ,
-       4,
-       ________,________,
-       ________,________,
-       _XX_____,________,
-       _XX_____,________,
-       ________,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       XXX_____,________,
-       XX______,________
-    // 0x6B
-     ,
-       8,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX___XX_,________,
-       XX__XX__,________,
-       XX_XX___,________,
-       XXXXX___,________,
-       XXXXX___,________,
-       XXX_XX__,________,
-       XX__XX__,________,
-       XX___XX_,________,
-       XX___XX_,________,
-       ________,________,
-       ________,________
-    // 0x6C
-     ,
-       3,
-       ________,________,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x6D
-     ,
-       13,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX_XXX__,XXX_____,
-       XXXXXXXX,XXXX____,
-       XXX__XXX,__XX____,
-       XX___XX_,__XX____,
-       XX___XX_,__XX____,
-       XX___XX_,__XX____,
-       XX___XX_,__XX____,
-       XX___XX_,__XX____,
-       XX___XX_,__XX____,
-       ________,________,
-       ________,________
-    // 0x6E
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX_XXXX_,________,
-       XXXXXXXX,________,
-       XXX___XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       ________,________,
-       ________,________
-    // 0x6F
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       __XXXX__,________,
-       _XXXXXX_,________,
-       XXX__XXX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       _XXXXXX_,________,
-       __XXXX__,________,
-       ________,________,
-       ________,________
-    // 0x70
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX_XXXX_,________,
-       XXXXXXXX,________,
-       XXX___XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       XXXXXXX_,________,
-       XX_XXX__,________,
-       XX______,________,
-       XX______,________
-    // 0x71
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       __XXX_XX,________,
-       _XXXXXXX,________,
-       XXX__XXX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XXX__XXX,________,
-       _XXXXXXX,________,
-       __XXX_XX,________,
-       ______XX,________,
-       ______XX,________,
-       ______XX,________
-    // 0x72
-     ,
-       6,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX_XX___,________,
-       XXXXX___,________,
-       XXX_____,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________,
-       ________,________
-    // 0x73
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       _XXXXX__,________,
-       XXXXXXX_,________,
-       XX___XX_,________,
-       XXXX____,________,
-       _XXXXX__,________,
-       ___XXXX_,________,
-       XX___XX_,________,
-       XXXXXXX_,________,
-       _XXXXX__,________,
-       ________,________,
-       ________,________
-    // 0x74
-     ,
-       6,
-       ________,________,
-       ________,________,
-       __X_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       XXXXX___,________,
-       XXXXX___,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XX_____,________,
-       _XXXX___,________,
-       __XXX___,________,
-       ________,________,
-       ________,________
-    // 0x75
-     ,
-       9,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX____XX,________,
-       XX___XXX,________,
-       XXXXXXXX,________,
-       _XXXX_XX,________,
-       ________,________,
-       ________,________
-    // 0x76
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX___XX_,________,
-       XX___XX_,________,
-       XX___XX_,________,
-       _XX_XX__,________,
-       _XX_XX__,________,
-       _XX_XX__,________,
-       __XXX___,________,
-       __XXX___,________,
-       __XXX___,________,
-       ________,________,
-       ________,________
-    // 0x77
-     ,
-       14,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX___XXX,___XX___,
-       XX___XXX,___XX___,
-       _XX__XXX,__XX____,
-       _XX_XX_X,X_XX____,
-       _XX_XX_X,X_XX____,
-       _XX_XX_X,X_XX____,
-       __XXX___,XXX_____,
-       __XXX___,XXX_____,
-       __XXX___,XXX_____,
-       ________,________,
-       ________,________
-    // 0x78
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX___XX_,________,
-       XXX_XXX_,________,
-       _XX_XX__,________,
-       __XXX___,________,
-       __XXX___,________,
-       __XXX___,________,
-       _XX_XX__,________,
-       XXX_XXX_,________,
-       XX___XX_,________,
-       ________,________,
-       ________,________
-    // 0x79
-     ,
-       10,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XX_____X,X_______,
-       _XX___XX,________,
-       _XX___XX,________,
-       __XX_XX_,________,
-       __XX_XX_,________,
-       __XXXXX_,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       ___XX___,________,
-       _XXXX___,________,
-       _XXX____,________
-    // 0x7A
-     ,
-       8,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       ____XX__,________,
-       ___XXX__,________,
-       __XXX___,________,
-       _XXX____,________,
-       _XX_____,________,
-       XXXXXXX_,________,
-       XXXXXXX_,________,
-       ________,________,
-       ________,________
-    // 0x7B
-     ,
-       7,
-       ________,________,
-       ___XXX__,________,
-       __XXXX__,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       XXX_____,________,
-       XXX_____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XXXX__,________,
-       ___XXX__,________,
-       ________,________
-    // 0x7C
-     ,
-       3,
-       ________,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       XX______,________,
-       ________,________
-    // 0x7D
-     ,
-       7,
-       ________,________,
-       XXX_____,________,
-       XXXX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       ___XXX__,________,
-       ___XXX__,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       __XX____,________,
-       XXXX____,________,
-       XXX_____,________,
-       ________,________
-    // 0x7E
-     ,
-       9,
-       ________,________,
-       ________,________,
-       _XXX___X,________,
-       XXXXXXXX,________,
-       X___XXX_,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x7F
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x80
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x81
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x82
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x83
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x84
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x85
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x86
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x87
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x88
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x89
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8A
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8B
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8C
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8D
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8E
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x8F
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x90
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x91
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x92
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x93
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x94
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x95
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x96
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x97
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x98
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x99
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9A
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9B
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9C
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9D
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9E
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0x9F
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA0
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA1
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA2
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA3 - 
-     ,
-       8,
-        ________,________,
-        ________,________,
-        _XX_XX__,________,
-        _XX_XX__,________,
-        ________,________,
-        __XXX___,________,
-        _XXXXX__,________,
-        XX___XX_,________,
-        XXXXXXX_,________,
-        XXXXXXX_,________,
-        XX______,________,
-        XXX__XX_,________,
-        _XXXXX__,________,
-        __XXX___,________,
-        ________,________,
-        ________,________
-    // 0xA4
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA5
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA6
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA7
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xA8
-     ,
-       10,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________
-    // 0xA9
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAA
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAB
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAC
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAD
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAE
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xAF
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB0
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB1
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB2
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB3 - 
-     ,
-       10,
-        __XX_XX_,________,
-        ________,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        ________,________,
-        ________,________
-    // 0xB4
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB5
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB6
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB7
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xB8
-     ,
-       8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________
-    // 0xB9
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBA
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBB
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBC
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBD
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBE
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xBF
-     ,
-       1,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________,
-       ________,________
-    // 0xC0 - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX___XXX,X_______,
-        XX__XXXX,XX______,
-        XX_XXX__,XXX_____,
-        XXXXX___,_XX_____,
-        XXXXX___,_XX_____,
-        XX_XX___,_XX_____,
-        XX_XXX__,XXX_____,
-        XX__XXXX,XX______,
-        XX___XXX,X_______,
-        ________,________,
-        ________,________
-    // 0xC1 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        _XXXXX__,________,
-        XXXXXXX_,________,
-        XX___XX_,________,
-        ___XXXX_,________,
-        _XXXXXX_,________,
-        XXX__XX_,________,
-        XX___XX_,________,
-        XXXXXXX_,________,
-        _XXXX_XX,________,
-        ________,________,
-        ________,________
-    // 0xC2 - 
-     ,
-        9,
-        ________,________,
-        ______X_,________,
-        _XXXXXX_,________,
-        XXXXXX__,________,
-        XX______,________,
-        XXXXXX__,________,
-        XXXXXXX_,________,
-        XXX__XXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXX__XXX,________,
-        _XXXXXX_,________,
-        __XXXX__,________,
-        ________,________,
-        ________,________
-    // 0xC3 - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        _______X,X_______,
-        _______X,X_______
-    // 0xC4 - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ___XXXXX,X_______,
-        __XXXXXX,X_______,
-        __XX___X,X_______,
-        __XX___X,X_______,
-        __XX___X,X_______,
-        __XX___X,X_______,
-        _XX____X,X_______,
-        XXXXXXXX,XXX_____,
-        XXXXXXXX,XXX_____,
-        XX______,_XX_____,
-        XX______,_XX_____
-    // 0xC5 - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        __XXX___,________,
-        _XXXXX__,________,
-        XX___XX_,________,
-        XXXXXXX_,________,
-        XXXXXXX_,________,
-        XX______,________,
-        XXX__XX_,________,
-        _XXXXX__,________,
-        __XXX___,________,
-        ________,________,
-        ________,________
-    // 0xC6 - 
-     ,
-        13,
-        ________,________,
-        ________,________,
-        ________,________,
-        _____XX_,________,
-        _____XX_,________,
-        __XXXXXX,XX______,
-        _XXXXXXX,XXX_____,
-        XX___XX_,__XX____,
-        XX___XX_,__XX____,
-        XX___XX_,__XX____,
-        XX___XX_,__XX____,
-        XX___XX_,__XX____,
-        _XXXXXXX,XXX_____,
-        __XXXXXX,XX______,
-        _____XX_,________,
-        _____XX_,________
-    // 0xC7 - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXXXXXX_,________,
-        XXXXXXX_,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        ________,________,
-        ________,________
-    // 0xC8 - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX___XX_,________,
-        XXX_XXX_,________,
-        _XX_XX__,________,
-        __XXX___,________,
-        __XXX___,________,
-        __XXX___,________,
-        _XX_XX__,________,
-        XXX_XXX_,________,
-        XX___XX_,________,
-        ________,________,
-        ________,________
-    // 0xC9 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX____XX,________,
-        XX___XXX,________,
-        XX__XXXX,________,
-        XX_XXXXX,________,
-        XXXXX_XX,________,
-        XXXX__XX,________,
-        XXX___XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-     // 0xCA - 
-     ,
-        9,
-        ________,________,
-        __X__X__,________,
-        __XXXX__,________,
-        ___XX___,________,
-        ________,________,
-        XX____XX,________,
-        XX___XXX,________,
-        XX__XXXX,________,
-        XX_XXXXX,________,
-        XXXXX_XX,________,
-        XXXX__XX,________,
-        XXX___XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-    // 0xCB - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX___XX_,________,
-        XX___XX_,________,
-        XX__XX__,________,
-        XXXX____,________,
-        XXXX____,________,
-        XX__XX__,________,
-        XX___XX_,________,
-        XX___XX_,________,
-        XX___XX_,________,
-        ________,________,
-        ________,________
-    // 0xCC - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        __XXXXXX,________,
-        _XXXXXXX,________,
-        _XX___XX,________,
-        _XX___XX,________,
-        _XX___XX,________,
-        _XX___XX,________,
-        _XX___XX,________,
-        XXX___XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-    // 0xCD - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXX_____,XXX_____,
-        XXX_____,XXX_____,
-        XXXX___X,XXX_____,
-        XXXX___X,XXX_____,
-        XX_XX_XX,_XX_____,
-        XX_XX_XX,_XX_____,
-        XX__XXX_,_XX_____,
-        XX__XXX_,_XX_____,
-        XX___X__,_XX_____,
-        ________,________,
-        ________,________
-    // 0xCE - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        XXXXXXXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-    // 0xCF - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        __XXXX__,________,
-        _XXXXXX_,________,
-        XXX__XXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXX__XXX,________,
-        _XXXXXX_,________,
-        __XXXX__,________,
-        ________,________,
-        ________,________
-    // 0xD0 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXXXXXXX,________,
-        XXXXXXXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-    // 0xD1 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        _XXXXXXX,________,
-        XXXXXXXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        _XXXXXXX,________,
-        __XX__XX,________,
-        _XX___XX,________,
-        XX____XX,________,
-        ________,________,
-        ________,________
-    // 0xD2 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX_XXXX_,________,
-        XXXXXXXX,________,
-        XXX___XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXX__XXX,________,
-        XXXXXXX_,________,
-        XX_XXX__,________,
-        XX______,________,
-        XX______,________
-    // 0xD3 - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        __XXXX__,________,
-        _XXXXXX_,________,
-        XXX__XX_,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXX__XX_,________,
-        _XXXXXX_,________,
-        __XXXX__,________,
-        ________,________,
-        ________,________
-    // 0xD4 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXXXXXXX,________,
-        XXXXXXXX,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        ___XX___,________,
-        ________,________,
-        ________,________
-    // 0xD5 - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX______,XX______,
-        XX______,XX______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        __XX__XX,________,
-        __XX__XX,________,
-        ___XXXX_,________,
-        ___XXXX_,________,
-        ____XX__,________,
-        _XXXX___,________,
-        _XXX____,________
-    // 0xD6 - 
-     ,
-        13,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX___XX_,__XX____,
-        _XX__XX_,_XX_____,
-        __XX_XX_,XX______,
-        __XX_XX_,XX______,
-        ____XXXX,________,
-        __XX_XX_,XX______,
-        _XX__XX_,_XX_____,
-        XX___XX_,__XX____,
-        XX___XX_,__XX____,
-        ________,________,
-        ________,________
-    // 0xD7 - 
-     ,
-        8,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXXXXX__,________,
-        XXXXXXX_,________,
-        XX___XX_,________,
-        XXXXXX__,________,
-        XXXXXX__,________,
-        XX___XX_,________,
-        XX___XX_,________,
-        XXXXXXX_,________,
-        XXXXXX__,________,
-        ________,________,
-        ________,________
-    // 0xD8 - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXX_,________,
-        XXXXXXXX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        XXXXXXX_,________,
-        ________,________,
-        ________,________
-    // 0xD9 - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX______,_XX_____,
-        XX______,_XX_____,
-        XX______,_XX_____,
-        XXXXXXX_,_XX_____,
-        XXXXXXXX,_XX_____,
-        XX____XX,_XX_____,
-        XX____XX,_XX_____,
-        XXXXXXXX,_XX_____,
-        XXXXXXX_,_XX_____,
-        ________,________,
-        ________,________
-    // 0xDA - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        _XXXXXX_,________,
-        XXXXXXXX,________,
-        ______XX,________,
-        ____XXX_,________,
-        ____XXXX,________,
-        ______XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        _XXXXXX_,________,
-        ________,________,
-        ________,________
-    // 0xDB - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XXXXXXXX,XX______,
-        XXXXXXXX,XX______,
-        ________,________,
-        ________,________
-    // 0xDC - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        _XXXXXX_,________,
-        XXXXXXXX,________,
-        XX____XX,________,
-        ____XXXX,________,
-        ____XXXX,________,
-        ______XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        _XXXXXX_,________,
-        ________,________,
-        ________,________
-    // 0xDD - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XXXXXXXX,XX______,
-        XXXXXXXX,XXX_____,
-        ________,_XX_____,
-        ________,_XX_____
-    // 0xDE - 
-     ,
-        9,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XX____XX,________,
-        XXXXXXXX,________,
-        _XXXXXXX,________,
-        ______XX,________,
-        ______XX,________,
-        ______XX,________,
-        ________,________,
-        ________,________
-    // 0xDF - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        ________,________,
-        XXXX____,________,
-        XXXX____,________,
-        __XX____,________,
-        __XXXXXX,X_______,
-        __XXXXXX,XX______,
-        __XX____,XX______,
-        __XX____,XX______,
-        __XXXXXX,XX______,
-        __XXXXXX,X_______,
-        ________,________,
-        ________,________
-    // 0xE0 - 
-     ,
-        14,
-        ________,________,
-        ________,________,
-        XX_____X,XX______,
-        XX___XXX,XXXX____,
-        XX___XX_,__XX____,
-        XX__XX__,___XX___,
-        XX__XX__,___XX___,
-        XXXXXX__,___XX___,
-        XXXXXX__,___XX___,
-        XX__XX__,___XX___,
-        XX__XX__,___XX___,
-        XX___XX_,__XX____,
-        XX___XXX,XXXX____,
-        XX_____X,XX______,
-        ________,________,
-        ________,________
-    // 0xE1 - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        ____XXX_,________,
-        ____XXX_,________,
-        ___XX_XX,________,
-        ___XX_XX,________,
-        ___XX_XX,________,
-        __XX___X,X_______,
-        __XX___X,X_______,
-        __XXXXXX,X_______,
-        _XXXXXXX,XX______,
-        _XX_____,XX______,
-        _XX_____,XX______,
-        XX______,_XX_____,
-        ________,________,
-        ________,________
-    // 0xE2 - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXXX,________,
-        XXXXXXXX,X_______,
-        XX_____X,XX______,
-        XX______,XX______,
-        XX______,XX______,
-        XXXXXXXX,X_______,
-        XXXXXXXX,________,
-        ________,________,
-        ________,________
-    // 0xE3 - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XXXXXXXX,XX______,
-        XXXXXXXX,XX______,
-        ________,XX______,
-        ________,XX______
-    // 0xE4 - 
-     ,
-        13,
-        ________,________,
-        ________,________,
-        ____XXXX,XX______,
-        ___XXXXX,XX______,
-        ___XX___,XX______,
-        ___XX___,XX______,
-        ___XX___,XX______,
-        __XX____,XX______,
-        __XX____,XX______,
-        __XX____,XX______,
-        __XX____,XX______,
-        _XX_____,XX______,
-        XXXXXXXX,XXXX____,
-        XXXXXXXX,XXXX____,
-        XX______,__XX____,
-        XX______,__XX____
-    // 0xE5 - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        ________,________,
-        ________,________
-    // 0xE6 - 
-     ,
-        15,
-        ________,________,
-        ________,________,
-        ______XX,________,
-        ___XXXXX,XXX_____,
-        _XXXXXXX,XXXXX___,
-        _XX___XX,___XX___,
-        XX____XX,____XX__,
-        XX____XX,____XX__,
-        XX____XX,____XX__,
-        XX____XX,____XX__,
-        _XX___XX,___XX___,
-        _XXXXXXX,XXXXX___,
-        ___XXXXX,XXX_____,
-        ______XX,________,
-        ________,________,
-        ________,________
- // 0xD5
-    // 0xE7 - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        XX______,________,
-        ________,________,
-        ________,________
-    // 0xE8 - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        XX_____X,X_______,
-        XXX___XX,X_______,
-        _XX___XX,________,
-        __XX_XX_,________,
-        __XXXXX_,________,
-        ___XXX__,________,
-        ___XXX__,________,
-        __XXXXX_,________,
-        __XX_XX_,________,
-        _XX___XX,________,
-        XXX___XX,X_______,
-        XX_____X,X_______,
-        ________,________,
-        ________,________
-    // 0xE9 - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        XX______,XX______,
-        XX_____X,XX______,
-        XX____XX,XX______,
-        XX____XX,XX______,
-        XX___XX_,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX_XX___,XX______,
-        XXXX____,XX______,
-        XXXX____,XX______,
-        XXX_____,XX______,
-        XX______,XX______,
-        ________,________,
-        ________,________
-    // 0xEA - 
-     ,
-        11,
-        ___XXXX_,________,
-        ____XX__,________,
-        XX______,XX______,
-        XX_____X,XX______,
-        XX____XX,XX______,
-        XX____XX,XX______,
-        XX___XX_,XX______,
-        XX__XX__,XX______,
-        XX__XX__,XX______,
-        XX_XX___,XX______,
-        XXXX____,XX______,
-        XXXX____,XX______,
-        XXX_____,XX______,
-        XX______,XX______,
-        ________,________,
-        ________,________
-    // 0xEB - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        XX______,XX______,
-        XX_____X,X_______,
-        XX____XX,________,
-        XX___XX_,________,
-        XX__XX__,________,
-        XX_XXXX_,________,
-        XXXX_XX_,________,
-        XXX___XX,________,
-        XX____XX,________,
-        XX_____X,X_______,
-        XX_____X,XX______,
-        XX______,XX______,
-        ________,________,
-        ________,________
-    // 0xEC - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        ___XXXXX,X_______,
-        __XXXXXX,X_______,
-        __XX___X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        _XX____X,X_______,
-        XXX____X,X_______,
-        XX_____X,X_______,
-        ________,________,
-        ________,________
-    // 0xED - 
-     ,
-        12,
-        ________,________,
-        ________,________,
-        XXX_____,XXX_____,
-        XXX_____,XXX_____,
-        XXXX___X,XXX_____,
-        XXXX___X,XXX_____,
-        XX_X___X,_XX_____,
-        XX_XX_XX,_XX_____,
-        XX_XX_XX,_XX_____,
-        XX_XX_XX,_XX_____,
-        XX__XXX_,_XX_____,
-        XX__XXX_,_XX_____,
-        XX__XXX_,_XX_____,
-        XX___X__,_XX_____,
-        ________,________,
-        ________,________
-    // 0xEE - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        ________,________,
-        ________,________
-    // 0xEF - 
-     ,
-        11,
-        ________,________,
-        ________,________,
-        ___XXXX_,________,
-        _XXXXXXX,X_______,
-        _XX____X,X_______,
-        XX______,XX______,
-        XX______,XX______,
-        XX______,XX______,
-        XX______,XX______,
-        XX______,XX______,
-        XX______,XX______,
-        _XX____X,X_______,
-        _XXXXXXX,X_______,
-        ___XXXX_,________,
-        ________,________,
-        ________,________
-    // 0xF0 - 
-     ,
-        10,
-        ________,________,
-        ________,________,
-        XXXXXXXX,X_______,
-        XXXXXXXX,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        XX_____X,X_______,
-        ________,________,
-        ________,________
-    // 0xF1 - 
-     ,
-          12,
-          ________,________,
-          ________,________,
-          ___XXXXX,XXX_____,
-          __XXXXXX,XXX_____,
-          _XXX____,_XX_____,
-          _XX_____,_XX_____,
-          _XXX____,_XX_____,
-          __XXXXXX,XXX_____,
-          ____XXXX,XXX_____,
-          ___XXX__,_XX_____,
-          __XXX___,_XX_____,
-          __XX____,_XX_____,
-          _XXX____,_XX_____,
-          XXX_____,_XX_____,
-          ________,________,
-          ________,________
-    // 0xF2 - 
-     ,
-          10,
-          ________,________,
-          ________,________,
-          XXXXXXX_,________,
-          XXXXXXXX,________,
-          XX____XX,X_______,
-          XX_____X,X_______,
-          XX____XX,X_______,
-          XXXXXXXX,________,
-          XXXXXXX_,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          ________,________,
-          ________,________
-    // 0xF3 - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          ___XXXXX,________,
-          _XXXXXXX,X_______,
-          _XX____X,XX______,
-          XX______,X_______,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,X_______,
-          _XX____X,XX______,
-          _XXXXXXX,X_______,
-          ___XXXXX,________,
-          ________,________,
-          ________,________
-    // 0xF4 - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          XXXXXXXX,XX______,
-          XXXXXXXX,XX______,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ____XX__,________,
-          ________,________,
-          ________,________
-    // 0xF5 - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          XX______,XX______,
-          XX______,XX______,
-          _XX____X,X_______,
-          _XX____X,X_______,
-          __XX__XX,________,
-          __XX__XX,________,
-          ___XXXX_,________,
-          ___XXXX_,________,
-          ____XX__,________,
-          ____XX__,________,
-          _XXXX___,________,
-          _XXX____,________,
-          ________,________,
-          ________,________
-    // 0xF6 - 
-     ,
-          13,
-          ________,________,
-          ________,________,
-          XX___XX_,__XX____,
-          _XX__XX_,_XX_____,
-          _XX__XX_,_XX_____,
-          _XX__XX_,_XX_____,
-          __XX_XX_,XX______,
-          ____XXXX,________,
-          __XX_XX_,XX______,
-          __XX_XX_,XX______,
-          _XX__XX_,_XX_____,
-          _XX__XX_,_XX_____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          ________,________,
-          ________,________
-    // 0xF7 - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          XXXXXXXX,________,
-          XXXXXXXX,X_______,
-          XX_____X,X_______,
-          XX_____X,X_______,
-          XX_____X,X_______,
-          XXXXXXXX,________,
-          XXXXXXXX,X_______,
-          XX_____X,XX______,
-          XX______,XX______,
-          XX______,XX______,
-          XXXXXXXX,X_______,
-          XXXXXXXX,________,
-          ________,________,
-          ________,________
-    // 0xF8 - 
-     ,
-          10,
-          ________,________,
-          ________,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XX______,________,
-          XXXXXXX_,________,
-          XXXXXXXX,________,
-          XX____XX,X_______,
-          XX_____X,X_______,
-          XX____XX,X_______,
-          XXXXXXXX,________,
-          XXXXXXX_,________,
-          ________,________,
-          ________,________
-    // 0xF9 - 
-     ,
-          13,
-          ________,________,
-          ________,________,
-          XX______,__XX____,
-          XX______,__XX____,
-          XX______,__XX____,
-          XX______,__XX____,
-          XX______,__XX____,
-          XXXXXXX_,__XX____,
-          XXXXXXXX,__XX____,
-          XX____XX,X_XX____,
-          XX_____X,X_XX____,
-          XX____XX,X_XX____,
-          XXXXXXXX,__XX____,
-          XXXXXXX_,__XX____,
-          ________,________,
-          ________,________
-    // 0xFA - 
-     ,
-          9,
-          ________,________,
-          ________,________,
-          __XXXXX_,________,
-          _XXXXXXX,________,
-          XX____XX,________,
-          ______XX,________,
-          ___XXXX_,________,
-          ___XXXX_,________,
-          _____XXX,________,
-          ______XX,________,
-          XX____XX,________,
-          XXX__XXX,________,
-          _XXXXXX_,________,
-          __XXXX__,________,
-          ________,________,
-          ________,________
-    // 0xFB - 
-     ,
-          13,
-          ________,________,
-          ________,________,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XXXXXXXX,XXXX____,
-          XXXXXXXX,XXXX____,
-          ________,________,
-          ________,________
-    // 0xFC - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          ___XXXX_,________,
-          _XXXXXXX,X_______,
-          XXX____X,X_______,
-          XX______,XX______,
-          ________,XX______,
-          ____XXXX,XX______,
-          ____XXXX,XX______,
-          ________,XX______,
-          XX______,XX______,
-          XXX____X,X_______,
-          _XXXXXXX,X_______,
-          ___XXXX_,________,
-          ________,________,
-          ________,________
-    // 0xFD - 
-     ,
-          14,
-          ________,________,
-          ________,________,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XX___XX_,__XX____,
-          XXXXXXXX,XXXXX___,
-          XXXXXXXX,XXXXX___,
-          ________,___XX___,
-          ________,___XX___
-    // 0xFE - 
-     ,
-          11,
-          ________,________,
-          ________,________,
-          XX______,XX______,
-          XX______,XX______,
-          XX______,XX______,
-          XX______,XX______,
-          XX______,XX______,
-          XXX_____,XX______,
-          _XXXXXXX,XX______,
-          __XXXXXX,XX______,
-          ________,XX______,
-          ________,XX______,
-          ________,XX______,
-          ________,XX______,
-          ________,________,
-          ________,________
-    // 0xFF - 
-     ,
-          12,
-          ________,________,
-          ________,________,
-          XXXX____,________,
-          XXXX____,________,
-          __XX____,________,
-          __XX____,________,
-          __XX____,________,
-          __XXXXXX,X_______,
-          __XXXXXX,XX______,
-          __XX____,XXX_____,
-          __XX____,_XX_____,
-          __XX____,XXX_____,
-          __XXXXXX,XX______,
-          __XXXXXX,X_______,
-          ________,________,
-          ________,________
-};
-
-/*
-32 (0x20) -     64 (0x40) - @   96 (0x60) - `  128 (0x80) -   160 (0xa0) -   192 (0xc0) -   224 (0xe0) - 
-33 (0x21) - !   65 (0x41) - A   97 (0x61) - a  129 (0x81) -   161 (0xa1) -   193 (0xc1) -   225 (0xe1) - 
-34 (0x22) - "   66 (0x42) - B   98 (0x62) - b  130 (0x82) -   162 (0xa2) -   194 (0xc2) -   226 (0xe2) - 
-35 (0x23) - #   67 (0x43) - C   99 (0x63) - c  131 (0x83) -   163 (0xa3) -   195 (0xc3) -   227 (0xe3) - 
-36 (0x24) - $   68 (0x44) - D  100 (0x64) - d  132 (0x84) -   164 (0xa4) -   196 (0xc4) -   228 (0xe4) - 
-37 (0x25) - %   69 (0x45) - E  101 (0x65) - e  133 (0x85) -   165 (0xa5) -   197 (0xc5) -   229 (0xe5) - 
-38 (0x26) - &   70 (0x46) - F  102 (0x66) - f  134 (0x86) -   166 (0xa6) -   198 (0xc6) -   230 (0xe6) - 
-39 (0x27) - '   71 (0x47) - G  103 (0x67) - g  135 (0x87) -   167 (0xa7) -   199 (0xc7) -   231 (0xe7) - 
-40 (0x28) - (   72 (0x48) - H  104 (0x68) - h  136 (0x88) -   168 (0xa8) -   200 (0xc8) -   232 (0xe8) - 
-41 (0x29) - )   73 (0x49) - I  105 (0x69) - i  137 (0x89) -   169 (0xa9) -   201 (0xc9) -   233 (0xe9) - 
-42 (0x2a) - *   74 (0x4a) - J  106 (0x6a) - j  138 (0x8a) -   170 (0xaa) -   202 (0xca) -   234 (0xea) - 
-43 (0x2b) - +   75 (0x4b) - K  107 (0x6b) - k  139 (0x8b) -   171 (0xab) -   203 (0xcb) -   235 (0xeb) - 
-44 (0x2c) - ,   76 (0x4c) - L  108 (0x6c) - l  140 (0x8c) -   172 (0xac) -   204 (0xcc) -   236 (0xec) - 
-45 (0x2d) - -   77 (0x4d) - M  109 (0x6d) - m  141 (0x8d) -   173 (0xad) -   205 (0xcd) -   237 (0xed) - 
-46 (0x2e) - .   78 (0x4e) - N  110 (0x6e) - n  142 (0x8e) -   174 (0xae) -   206 (0xce) -   238 (0xee) - 
-47 (0x2f) - /   79 (0x4f) - O  111 (0x6f) - o  143 (0x8f) -   175 (0xaf) -   207 (0xcf) -   239 (0xef) - 
-48 (0x30) - 0   80 (0x50) - P  112 (0x70) - p  144 (0x90) -   176 (0xb0) -   208 (0xd0) -   240 (0xf0) - 
-49 (0x31) - 1   81 (0x51) - Q  113 (0x71) - q  145 (0x91) -   177 (0xb1) -   209 (0xd1) -   241 (0xf1) - 
-50 (0x32) - 2   82 (0x52) - R  114 (0x72) - r  146 (0x92) -   178 (0xb2) -   210 (0xd2) -   242 (0xf2) - 
-51 (0x33) - 3   83 (0x53) - S  115 (0x73) - s  147 (0x93) -   179 (0xb3) -   211 (0xd3) -   243 (0xf3) - 
-52 (0x34) - 4   84 (0x54) - T  116 (0x74) - t  148 (0x94) -   180 (0xb4) -   212 (0xd4) -   244 (0xf4) - 
-53 (0x35) - 5   85 (0x55) - U  117 (0x75) - u  149 (0x95) -   181 (0xb5) -   213 (0xd5) -   245 (0xf5) - 
-54 (0x36) - 6   86 (0x56) - V  118 (0x76) - v  150 (0x96) -   182 (0xb6) -   214 (0xd6) -   246 (0xf6) - 
-55 (0x37) - 7   87 (0x57) - W  119 (0x77) - w  151 (0x97) -   183 (0xb7) -   215 (0xd7) -   247 (0xf7) - 
-56 (0x38) - 8   88 (0x58) - X  120 (0x78) - x  152 (0x98) -   184 (0xb8) -   216 (0xd8) -   248 (0xf8) - 
-57 (0x39) - 9   89 (0x59) - Y  121 (0x79) - y  153 (0x99) -   185 (0xb9) -   217 (0xd9) -   249 (0xf9) - 
-58 (0x3a) - :   90 (0x5a) - Z  122 (0x7a) - z  154 (0x9a) -    186 (0xba) -   218 (0xda) -   250 (0xfa) - 
-59 (0x3b) - ;   91 (0x5b) - [  123 (0x7b) - {  155 (0x9b) -   187 (0xbb) -   219 (0xdb) -   251 (0xfb) - 
-60 (0x3c) - <   92 (0x5c) - \  124 (0x7c) - |  156 (0x9c) -   188 (0xbc) -   220 (0xdc) -   252 (0xfc) - 
-61 (0x3d) - =   93 (0x5d) - ]  125 (0x7d) - }  157 (0x9d) -   189 (0xbd) -   221 (0xdd) -   253 (0xfd) - 
-62 (0x3e) - >   94 (0x5e) - ^  126 (0x7e) - ~  158 (0x9e) -   190 (0xbe) -   222 (0xde) -   254 (0xfe) - 
-63 (0x3f) - ?   95 (0x5f) - _  127 (0x7f) -    159 (0x9f) -   191 (0xbf) -   223 (0xdf) -   255 (0xff) - 
-*/
@@ -0,0 +1,116 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// make PackBits-compressed fonts ../font14rle.h & ../font16rle.h from plain fonts of ../fonts.c
+// (it should be built without FONTS_RLE); ../genlist only emits `#define ____XXXX` bit patterns
+// used by plain font tables and can't make fonts
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "fonts.h"
+
+#define MAXOUT  (SYMBOLS_AMOUNT * 64)
+
+// PackBits: n < 128 - n+1 literal bytes follow, n >= 128 - next byte repeats n-127 times
+static int packbits(const uint8_t *in, int len, uint8_t *out){
+    int i = 0, o = 0;
+    while(i < len){
+        int run = 1;
+        while(i + run < len && run < 128 && in[i + run] == in[i]) ++run;
+        if(run > 1){
+            out[o++] = 0x7f + run;
+            out[o++] = in[i];
+            i += run;
+            continue;
+        }
+        // literal bytes till next run
+        int j = i;
+        while(j < len && j - i < 128 && !(j + 1 < len && in[j] == in[j + 1])) ++j;
+        out[o++] = j - i - 1;
+        while(i < j) out[o++] = in[i++];
+    }
+    return o;
+}
+
+static int mkfont(const char *name, font_t font){
+    static uint8_t data[MAXOUT];
+    uint16_t offsets[SYMBOLS_AMOUNT];
+    char fname[64], NAME[16];
+    int len = 0;
+    if(choose_font(font) || curfont->offsets) return 1;
+    int bytes = curfont->bytes, height = curfont->height, baseline = curfont->baseline;
+    int lw = bytes / height;
+    for(int i = 0; i < SYMBOLS_AMOUNT; ++i){
+        const uint8_t *sym = font_char(i + FIRST_SYMBOL_CODE);
+        uint8_t bycols[FONT_MAXHEIGHT * 4]; // bitmap by byte columns: right ones are mostly empty
+        for(int k = 0; k < lw; ++k)
+            for(int r = 0; r < height; ++r)
+                bycols[k * height + r] = sym[1 + r * lw + k];
+        offsets[i] = len;
+        data[len++] = sym[0]; // width
+        len += packbits(bycols, bytes, data + len);
+    }
+    for(int i = 0; name[i] && i < 15; ++i) NAME[i] = name[i] - ((name[i] >= 'a' && name[i] <= 'z') ? 32 : 0);
+    NAME[strlen(name)] = 0;
+    snprintf(fname, sizeof(fname), "../%srle.h", name);
+    FILE *f = fopen(fname, "w");
+    if(!f){
+        perror(fname);
+        return 1;
+    }
+    fprintf(f, "/*\n * This file is part of the LED_screen project.\n"
+               " * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>.\n"
+               " *\n * This program is free software: you can redistribute it and/or modify\n"
+               " * it under the terms of the GNU General Public License as published by\n"
+               " * the Free Software Foundation, either version 3 of the License, or\n"
+               " * (at your option) any later version.\n *\n"
+               " * This program is distributed in the hope that it will be useful,\n"
+               " * but WITHOUT ANY WARRANTY; without even the implied warranty of\n"
+               " * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the\n"
+               " * GNU General Public License for more details.\n *\n"
+               " * You should have received a copy of the GNU General Public License\n"
+               " * along with this program.  If not, see <http://www.gnu.org/licenses/>.\n */\n\n"
+               "// this file should be included JUST ONCE!\n// only in fonts.c\n"
+               "// generated by scrtest/fontrle.c from %s.h, don't edit\n\n", name);
+    fprintf(f, "#define %sBYTES         %d\n#define %sHEIGHT        %d\n#define %sBASELINE      %d\n\n",
+            NAME, bytes, NAME, height, NAME, baseline);
+    fprintf(f, "// offsets of symbols in table\nconst uint16_t %srle_offsets[SYMBOLS_AMOUNT] = {", name);
+    for(int i = 0; i < SYMBOLS_AMOUNT; ++i)
+        fprintf(f, "%s%4d,", (i % 16) ? " " : "\n    ", offsets[i]);
+    fprintf(f, "\n};\n\n// symbol width & PackBits stream of its bitmap (%d bytes instead of %d)\n"
+               "// (bitmap bytes are by columns: the first bytes of all rows, then the second ones etc)\n"
+               "const uint8_t %srle_table[%d] = {", len, SYMBOLS_AMOUNT * (bytes + 1), name, len);
+    for(int i = 0; i < SYMBOLS_AMOUNT; ++i){
+        int end = (i < SYMBOLS_AMOUNT - 1) ? offsets[i + 1] : len, c = i + FIRST_SYMBOL_CODE;
+        fprintf(f, "\n    // 0x%02x", c);
+        if(c > 32 && c < 127 && c != '\\') fprintf(f, " - '%c'", c);
+        for(int j = offsets[i]; j < end; ++j)
+            fprintf(f, "%s0x%02x,", ((j - offsets[i]) % 16) ? " " : "\n    ", data[j]);
+    }
+    fprintf(f, "\n};\n");
+    fclose(f);
+    printf("%s: %d -> %d bytes\n", name, SYMBOLS_AMOUNT * (bytes + 1), len + (int)sizeof(offsets));
+    return 0;
+}
+
+int main(){
+    if(mkfont("font14", FONT14)) return 1;
+    if(mkfont("font16", FONT16)) return 1;
+    return 0;
+}
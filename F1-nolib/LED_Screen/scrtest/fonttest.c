@@ -0,0 +1,174 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// check of glyph renderer & compressed fonts against old per-pixel DrawCharAt, its speed
+// fonts.c is linked twice: plain and compressed (its symbols have prefix rle_)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fonts.h"
+#include "screen.h"
+#include "tick.h"
+
+#define NCHECK      20000
+#define NBENCH      100000
+
+// compressed fonts
+extern const afont *rle_curfont;
+int rle_choose_font(font_t newfont);
+uint8_t rle_font_rows(uint8_t Char, uint32_t *rows);
+
+static uint8_t saved[SCREEN_PLANES][SCREENBUF_MAXSZ], result[SCREEN_PLANES][SCREENBUF_MAXSZ];
+
+// old DrawCharAt with fixed number of rows (was `row <= h`: extra row from next symbol)
+static uint8_t ref_DrawCharAt(int16_t X, int16_t Y, uint8_t Char){
+    const uint8_t *curchar = font_char(Char);
+    if(!curchar) return 0;
+    Y += 1 - curfont->height + curfont->baseline;
+    uint8_t h = curfont->height, w = *curchar++;
+    uint8_t lw = curfont->bytes / h;
+    for(uint8_t row = 0; row < h; ++row){
+        for(uint8_t col = 0; col < w; ++col){
+            DrawPix(X + col, Y + row, curchar[row*lw + (col/8)] & (1 << (7 - (col%8))));
+        }
+    }
+    return w;
+}
+
+static void scrsave(uint8_t buf[SCREEN_PLANES][SCREENBUF_MAXSZ]){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p) memcpy(buf[p], getScreenBuf(p), SCREENBUF_SZ);
+}
+static void scrrestore(uint8_t buf[SCREEN_PLANES][SCREENBUF_MAXSZ]){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p) memcpy(getScreenBuf(p), buf[p], SCREENBUF_SZ);
+}
+static int scrcmp(uint8_t buf[SCREEN_PLANES][SCREENBUF_MAXSZ]){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p) if(memcmp(buf[p], getScreenBuf(p), SCREENBUF_SZ)) return 1;
+    return 0;
+}
+static void randomfill(){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+        uint8_t *ptr = getScreenBuf(p);
+        for(int i = 0; i < SCREENBUF_SZ; ++i) ptr[i] = random();
+    }
+}
+static void selfont(font_t f){
+    choose_font(f);
+    rle_choose_font(f);
+}
+
+// compressed symbols should be the same as plain
+static int check_rle(){
+    uint32_t rows[FONT_MAXHEIGHT], rlerows[FONT_MAXHEIGHT];
+    for(font_t f = FONT14; f < FONT_T_MAX; ++f){
+        selfont(f);
+        for(int c = FIRST_SYMBOL_CODE; c < 256; ++c){
+            uint8_t w = font_rows(c, rows);
+            if(w != rle_font_rows(c, rlerows) || memcmp(rows, rlerows, curfont->height * sizeof(uint32_t))){
+                fprintf(stderr, "font %d: compressed symbol 0x%02x differs\n", f, c);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+// DrawCharAt & PutStringAt should give the same as old per-pixel drawing
+static int check_render(){
+    char str[8];
+    for(int i = 0; i < NCHECK; ++i){
+        selfont(random() % FONT_T_MAX);
+        SetBrightness(random() % (SCREEN_MAXLEVEL + 1));
+        int16_t X = random() % (SCREEN_WIDTH + 40) - 30, Y = random() % (SCREEN_HEIGHT + 40) - 10;
+        int l = random() % (sizeof(str) - 1);
+        for(int j = 0; j < l; ++j) str[j] = FIRST_SYMBOL_CODE + random() % SYMBOLS_AMOUNT;
+        str[l] = 0;
+        randomfill();
+        scrsave(saved);
+        int16_t x = X;
+        for(int j = 0; j < l; ++j) x += ref_DrawCharAt(x, Y, (uint8_t)str[j]);
+        scrsave(result);
+        scrrestore(saved);
+        uint8_t w = PutStringAt(X, Y, str);
+        if(w != (uint8_t)(x - X) || scrcmp(result)){
+            fprintf(stderr, "Different output: string of %d symbols at (%d, %d)\n", l, X, Y);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// kerned text shouldn't lose any pixel of its symbols (text should fit the screen)
+static int check_kerning(const char *str){
+    int16_t Y = SCREEN_HEIGHT - 1 - curfont->baseline;
+    SetBrightness(SCREEN_MAXLEVEL);
+    FillScreen(0);
+    uint8_t wplain = PutStringAt(0, Y, (char*)str);
+    SetKerning(1);
+    FillScreen(0);
+    uint8_t wkern = PutStringAt(0, Y, (char*)str);
+    scrsave(result);
+    SetKerning(0);
+    // count lit pixels: they should be the same
+    int lit[2] = {0, 0};
+    for(int n = 0; n < 2; ++n){
+        uint8_t *buf = n ? getScreenBuf(0) : result[0];
+        if(n){
+            FillScreen(0);
+            PutStringAt(0, Y, (char*)str);
+        }
+        for(int i = 0; i < SCREENBUF_SZ; ++i) lit[n] += __builtin_popcount((uint8_t)(SCREEN_IS_NEGATIVE ? ~buf[i] : buf[i]));
+    }
+    printf("\"%s\": width %d, kerned %d\n", str, wplain, wkern);
+    if(wkern > wplain || lit[0] != lit[1]){
+        fprintf(stderr, "Kerning of \"%s\" failed\n", str);
+        return 1;
+    }
+    return 0;
+}
+
+int main(){
+    uint32_t rows[FONT_MAXHEIGHT];
+    uint64_t t0, tref = 0, tnew = 0, tplain = 0, trle = 0;
+    srandom(1);
+    if(check_rle() || check_render()) return 1;
+    selfont(FONT14);
+    if(check_kerning("AVAT") || check_kerning("Ty, LT") || check_kerning("1/4")) return 1;
+    // speed
+    for(int i = 0; i < NBENCH; ++i){
+        uint8_t c = 'A' + i % 58;
+        int16_t X = i % (SCREEN_WIDTH - 16), Y = SCREEN_HEIGHT - 1 - curfont->baseline;
+        t0 = tick();
+        ref_DrawCharAt(X, Y, c);
+        tref += tick() - t0;
+        t0 = tick();
+        DrawCharAt(X, Y, c);
+        tnew += tick() - t0;
+        t0 = tick();
+        font_rows(c, rows);
+        tplain += tick() - t0;
+        t0 = tick();
+        rle_font_rows(c, rows);
+        trle += tick() - t0;
+    }
+    printf("DrawCharAt: per-pixel %.0f %s, rows blitting %.0f %s (x%.1f)\n", (double)tref / NBENCH, UNITS,
+           (double)tnew / NBENCH, UNITS, (double)tref / tnew);
+    printf("symbol unpacking: plain %.0f %s, compressed %.0f %s\n", (double)tplain / NBENCH, UNITS,
+           (double)trle / NBENCH, UNITS);
+    return 0;
+}
@@ -33,7 +33,7 @@ void chcolr(int n){
 }
 
 void dumpbuf(){
-    uint8_t *buf = getScreenBuf();
+    uint8_t *buf = getScreenBuf(0);
     printf(WHITE "   ");
     for(int x = 0; x < 4; ++x){
         printf("%d... ...", x);
@@ -57,26 +57,12 @@ void dumpbuf(){
     }
 }
 
-static uint8_t dmabuf[4][SCREENBUF_SZ/4];
-void CSB(){
-    uint8_t *screenbuf = getScreenBuf();
-    for(uint8_t partNo = 0; partNo < 4; ++ partNo){ // cycle by strings
-        uint8_t *dmaptr = dmabuf[partNo];
-        for(int X = 0; X < SCREEN_WIDTH/8; ++X){
-            for(int Y = SCREEN_HEIGHT-4+partNo; Y >= 0; Y -= 4){ // and cycle by Y
-                *dmaptr++ = screenbuf[X + Y*(SCREEN_WIDTH/8)];
-            }
-        }
-    }
-
-}
-
 void dumpdmastr(uint8_t n){
     if(n > 3) return;
     printf("\n");
     chcolr(n);
     printf("BUF[%d]:\n", n);
-    uint8_t *ptr = dmabuf[n];
+    uint8_t *ptr = getDmaBuf(n, 0);
     for(int y = 0; y < 4; ++y){
         printf("%02d|", y);
         for(int x = 0; x < 4; ++x){
@@ -99,14 +85,14 @@ int main(int argc, char **argv){
     printf("\n\nFONT14:\n\n");
     PutStringAt(0, 15-curfont->baseline, argv[1]);
     dumpbuf();
-    CSB(); //ConvertScreenBuf();
+    ConvertScreenBuf();
     for(uint8_t i = 0; i < 4; ++i) dumpdmastr(i);
 /*
     printf("\n\nFONT16:\n\n");
     choose_font(FONT16);
     PutStringAt(0, 15-curfont->baseline, argv[1]);
     dumpbuf();
-//    CSB(); //ConvertScreenBuf();
+//    ConvertScreenBuf();
 //    for(uint8_t i = 0; i < 4; ++i) dumpdmastr(i);
 */
     return 0;
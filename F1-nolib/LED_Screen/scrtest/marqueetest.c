@@ -0,0 +1,183 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// check of marquee & double buffering of DMA buffers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "fonts.h"
+#include "screen.h"
+
+static uint8_t refbuf[4][DMABUF_MAXSZ];
+static uint8_t savebuf[SCREEN_PLANES][SCREENBUF_MAXSZ];
+
+static inline int pix(uint8_t plane, int x, int y){
+    return (getScreenBuf(plane)[y*(SCREEN_WIDTH/8) + x/8] >> (7 - x%8)) & 1;
+}
+
+// pixel by pixel conversion of one bitplane (the same as in bench.c)
+static void ref_convert(uint8_t plane){
+    const screen_geometry *g = geometry;
+    for(int prow = 0; prow < g->rows; ++prow) for(int pcol = 0; pcol < g->chain; ++pcol){
+        int rotated = g->serpentine && (prow & 1);
+        int idx = prow * g->chain + (rotated ? g->chain - 1 - pcol : pcol);
+        for(int q = 0; q < 4; ++q) for(int c = 0; c < 4; ++c) for(int k = 0; k < 4; ++k){
+            uint8_t byte = 0;
+            for(int b = 0; b < 8; ++b){
+                int x = 8*c + b, y = 12 + q - 4*k; // pixel of panel
+                if(rotated){
+                    x = PANEL_WIDTH - 1 - x;
+                    y = PANEL_HEIGHT - 1 - y;
+                }
+                byte |= pix(plane, pcol*PANEL_WIDTH + x, prow*PANEL_HEIGHT + y) << (7 - b);
+            }
+            refbuf[q][idx*16 + c*4 + k] = byte;
+        }
+    }
+}
+
+/*
+ * compare front DMA buffer with screen where marquee text (baseline Y, width W) is drawn by
+ * PutStringAt shifted by offset (and its copy after blank gap); bandh = 0 if marquee is off
+ */
+static int check(const char *what, int16_t Y, char *text, int16_t W, int offset, int bandh){
+    int ret = 0;
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p) memcpy(savebuf[p], getScreenBuf(p), SCREENBUF_SZ);
+    if(bandh){
+        int16_t top = Y + 1 - curfont->height + curfont->baseline, len = W + SCREEN_WIDTH;
+        for(int16_t y = top; y < top + bandh; ++y)
+            for(int16_t x = 0; x < SCREEN_WIDTH; ++x) DrawPixLevel(x, y, 0);
+        PutStringAt(-offset, Y, text);
+        PutStringAt(len - offset, Y, text);
+    }
+    for(uint8_t p = 0; p < SCREEN_PLANES && !ret; ++p){
+        ref_convert(p);
+        for(uint8_t q = 0; q < 4; ++q){
+            if(memcmp(refbuf[q], getDmaBuf(q, p), DMABUF_SZ)){
+                fprintf(stderr, "%dx%d: %s (offset %d) - wrong plane %d quarter %d\n",
+                        SCREEN_WIDTH, SCREEN_HEIGHT, what, offset, p, q);
+                ret = 1;
+                break;
+            }
+        }
+    }
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p) memcpy(getScreenBuf(p), savebuf[p], SCREENBUF_SZ);
+    return ret;
+}
+
+static void randomfill(){
+    for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+        uint8_t *ptr = getScreenBuf(p);
+        for(int i = 0; i < SCREENBUF_SZ; ++i) ptr[i] = random();
+    }
+    MarkDirty(0, 0, SCREEN_WIDTH-1, SCREEN_HEIGHT-1);
+}
+
+// scrolling over the whole strip with static content around
+static int test(uint8_t chain, uint8_t rows, uint8_t serp, int16_t top){
+    char *text = "Marquee: AVATAR 1/4";
+    if(SetGeometry(chain, rows, serp)){
+        fprintf(stderr, "Can't set geometry %dx%d\n", chain, rows);
+        return 1;
+    }
+    int16_t h = curfont->height, Y = top - 1 + h - curfont->baseline; // baseline
+    ScreenSync(0);
+    randomfill();
+    SetBrightness(5);
+    int16_t W = MarqueeText(Y, text);
+    if(!W){
+        fprintf(stderr, "%dx%d: no marquee\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+        return 1;
+    }
+    ConvertScreenBuf();
+    if(check("start", Y, text, W, W, h)) return 1;
+    // not scanned: front is converted at once
+    for(int i = 1; i <= W + SCREEN_WIDTH + 40; ++i){
+        MarqueeStep();
+        if(check("not scanned", Y, text, W, (W + i) % (W + SCREEN_WIDTH), h)) return 1;
+    }
+    // scanned: changes appear after swap only & are kept when marquee swaps buffers
+    ScreenSync(1);
+    int offset = (W + W + SCREEN_WIDTH + 40) % (W + SCREEN_WIDTH);
+    for(int i = 0; i < 300; ++i){
+        int16_t X = random() % SCREEN_WIDTH, Yp = random() % SCREEN_HEIGHT;
+        int idx = Yp*(SCREEN_WIDTH/8) + X/8;
+        uint8_t old[SCREEN_PLANES], new[SCREEN_PLANES], front[SCREEN_PLANES];
+        for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+            old[p] = getScreenBuf(p)[idx];
+            front[p] = getDmaBuf(i % 4, p)[i % DMABUF_SZ];
+        }
+        DrawPixLevel(X, Yp, random() % (SCREEN_MAXLEVEL + 1));
+        switch(i % 3){
+            case 0: // converted: shown from the next frame
+                ConvertScreenBuf();
+                for(uint8_t p = 0; p < SCREEN_PLANES; ++p)
+                    if(front[p] != getDmaBuf(i % 4, p)[i % DMABUF_SZ]){
+                        fprintf(stderr, "%dx%d: front buffer changed\n", SCREEN_WIDTH, SCREEN_HEIGHT);
+                        return 1;
+                    }
+                MarqueeStep();
+            break;
+            case 1: // several marquee steps between frames
+                ConvertScreenBuf();
+                MarqueeStep();
+                if(++offset == W + SCREEN_WIDTH) offset = 0;
+                MarqueeStep();
+            break;
+            default: // not converted: marquee steps shouldn't show it
+                MarqueeStep();
+                if(++offset == W + SCREEN_WIDTH) offset = 0;
+                MarqueeStep();
+            break;
+        }
+        if(++offset == W + SCREEN_WIDTH) offset = 0;
+        ScreenSwap();
+        ScreenSwap(); // the next frame without changes
+        if(i % 3 == 2) for(uint8_t p = 0; p < SCREEN_PLANES; ++p){
+            new[p] = getScreenBuf(p)[idx];
+            getScreenBuf(p)[idx] = old[p];
+        }
+        if(check("scanned", Y, text, W, offset, h)) return 1;
+        if(i % 3 == 2) for(uint8_t p = 0; p < SCREEN_PLANES; ++p) getScreenBuf(p)[idx] = new[p];
+    }
+    ScreenSync(0);
+    // band shows screen buffer again
+    MarqueeClear();
+    ConvertScreenBuf();
+    if(check("cleared", 0, NULL, 0, 0, 0)) return 1;
+    printf("%3dx%-3d (%2dx%d%s), band from row %3d: OK, strip of %d px\n", SCREEN_WIDTH,
+           SCREEN_HEIGHT, chain, rows, serp ? ", serpentine" : "", top, W + SCREEN_WIDTH);
+    return 0;
+}
+
+int main(){
+    choose_font(FONT16);
+    SetKerning(1);
+    if(test(2, 1, 0, 0)) return 1;
+    if(test(1, 1, 0, 0)) return 1;
+    if(test(2, 1, 0, -5)) return 1; // clipped band
+    if(test(3, 2, 0, 11)) return 1; // band crosses panels rows
+    if(test(4, 3, 1, 21)) return 1;
+    if(test(8, 2, 1, 16)) return 1;
+    choose_font(FONT14);
+    SetKerning(0);
+    if(test(4, 2, 1, 7)) return 1;
+    if(test(4, 2, 1, 20)) return 1;
+    return 0;
+}
@@ -0,0 +1,40 @@
+/*
+ * This file is part of the LED_screen project.
+ * Copyright 2019 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+#ifndef TICK_H__
+#define TICK_H__
+
+#include <stdint.h>
+#include <time.h>
+
+// time counter for benchmarks: TSC on x86, ns on others
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define UNITS   "cycles"
+static inline uint64_t tick(){return __rdtsc();}
+#else
+#define UNITS   "ns"
+static inline uint64_t tick(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + t.tv_nsec;
+}
+#endif
+
+#endif // TICK_H__
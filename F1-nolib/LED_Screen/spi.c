@@ -54,10 +54,10 @@ void spi_setup(){
 /**
  * @brief SPI_transmit - transmit data over SPI DMA
  * @param buf - data to transmit
- * @param len - its length
+ * @param len - its length (up to 65535)
  * @return 0 if all OK
  */
-uint8_t SPI_transmit(const uint8_t *buf, uint8_t len){
+uint8_t SPI_transmit(const uint8_t *buf, uint16_t len){
     if(!buf || !len) return 1; // bad data format
     if(SPI_status != SPI_READY) return 2; // spi not ready to transmit data
     DMA_SPI_Channel->CMAR = (uint32_t)buf;
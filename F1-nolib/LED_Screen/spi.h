@@ -28,9 +28,12 @@ typedef enum{
     SPI_BUSY
 } spiStatus;
 
+// SPI clock: Fpclk/16
+#define SPI_FREQ    (72000000/16)
+
 extern spiStatus SPI_status;
 
 void spi_setup();
-uint8_t SPI_transmit(const uint8_t *buf, uint8_t len);
+uint8_t SPI_transmit(const uint8_t *buf, uint16_t len);
 
 #endif // SPI_H__
@@ -28,9 +28,39 @@
 static uint8_t incoming_data[IDATASZ];
 static uint8_t ovfl = 0;
 static uint16_t idatalen = 0;
-static volatile uint8_t tx_succesfull = 0;
 static int8_t usbON = 0; // ==1 when USB fully configured
 
+// transmit ring: USB_send() puts data here, EP3 IN interrupt sends next packet
+#define TXRINGMASK  (USB_TXRINGSZ - 1)
+static uint8_t txring[USB_TXRINGSZ];
+static volatile uint16_t txhead = 0, txtail = 0; // write (USB_send) and read (IRQ) positions
+static volatile uint8_t txbusy = 0; // length of packet in pending IN transaction
+volatile uint32_t USB_txdropped = 0;
+
+/**
+ * @brief tx_getpacket - take next packet from transmit ring
+ * @param pkt - buffer for data (not less than USB_TXBUFSZ-1 bytes)
+ * @return packet length
+ */
+static uint16_t tx_getpacket(uint8_t *pkt){
+    uint16_t t = txtail, h = txhead, l = 0;
+    while(t != h && l < USB_TXBUFSZ - 1){ // short packet ends transfer: no need in ZLP
+        pkt[l++] = txring[t];
+        t = (t + 1) & TXRINGMASK;
+    }
+    txtail = t;
+    return l;
+}
+
+// put byte into transmit ring, @return 0 if it is full
+static inline int tx_putchar(uint16_t *h, uint8_t c){
+    uint16_t nxt = (*h + 1) & TXRINGMASK;
+    if(nxt == txtail) return 0;
+    txring[*h] = c;
+    *h = nxt;
+    return 1;
+}
+
 // interrupt IN handler (never used?)
 static uint16_t EP1_Handler(ep_t ep){
     if (ep.rx_flag){
@@ -61,14 +91,34 @@ static uint16_t EP23_Handler(ep_t ep){
         ep.status = CLEAR_DTOG_RX(ep.status);
         ep.status = CLEAR_DTOG_TX(ep.status);
         ep.status = SET_STALL_TX(ep.status);
-    }else if (ep.tx_flag){
-        ep.status = KEEP_STAT_TX(ep.status);
-        tx_succesfull = 1;
+    }else if (ep.tx_flag){ // previous packet sent - send next
+        uint16_t pkt[USB_TXBUFSZ/2];
+        uint16_t l = tx_getpacket((uint8_t*)pkt);
+        if(l){
+            EP_WriteIRQ(3, (uint8_t*)pkt, l);
+            ep.status = SET_VALID_TX(ep.status);
+        }else ep.status = KEEP_STAT_TX(ep.status);
+        txbusy = (uint8_t)l;
     }
     ep.status = SET_VALID_RX(ep.status);
     return ep.status;
 }
 
+// start transmission if there's no pending IN transaction
+static void tx_start(){
+    uint32_t oldcntr = USB->CNTR;
+    USB->CNTR = 0;
+    if(!txbusy){
+        uint16_t pkt[USB_TXBUFSZ/2];
+        uint16_t l = tx_getpacket((uint8_t*)pkt);
+        if(l){
+            txbusy = (uint8_t)l;
+            EP_Write(3, (uint8_t*)pkt, l);
+        }
+    }
+    USB->CNTR = oldcntr;
+}
+
 void USB_setup(){
     NVIC_DisableIRQ(USB_LP_CAN1_RX0_IRQn);
     NVIC_DisableIRQ(USB_HP_CAN1_TX_IRQn);
@@ -90,6 +140,8 @@ void usb_proc(){
         if(!usbON){ // endpoints not activated
             // make new BULK endpoint
             // Buffer have 1024 bytes, but last 256 we use for CAN bus (30.2 of RM: USB main features)
+            txhead = txtail = 0;
+            txbusy = 0;
             EP_Init(1, EP_TYPE_INTERRUPT, 10, 0, EP1_Handler); // IN1 - transmit
             EP_Init(2, EP_TYPE_BULK, 0, USB_RXBUFSZ, EP23_Handler); // OUT2 - receive data
             EP_Init(3, EP_TYPE_BULK, USB_TXBUFSZ, 0, EP23_Handler); // IN3 - transmit data
@@ -100,32 +152,33 @@ void usb_proc(){
     }
 }
 
-void USB_send(const char *buf){
+/**
+ * @brief USB_send - put string into transmit ring (without waiting)
+ * @param buf - string to send
+ * @return amount of bytes queued (the rest is dropped if ring is full)
+ */
+int USB_send(const char *buf){
     if(!USB_configured()){
-        return;
+        return 0;
     }
-    char tmpbuf[USB_TXBUFSZ];
-    uint16_t l = 0, ctr = 0;
-    const char *p = buf;
-    while(*p++) ++l;
-    while(l){
-        uint16_t proc = 0, s  = (l > USB_TXBUFSZ - 1) ? USB_TXBUFSZ - 1: l;
-        for(int i = 0; i < s; ++i, ++proc){
-            char c = buf[ctr+proc];
-            /*
-            if(c == '\n' && the_conf.defflags & FLAG_STRENDRN){ // add '\r' before '\n'
-                tmpbuf[i++] = '\r';
-                if(i == s) ++s;
-            }*/
-            tmpbuf[i] = c;
-        }
-        tx_succesfull = 0;
-        EP_Write(3, (uint8_t*)tmpbuf, s);
-        uint32_t ctra = 1000000;
-        while(--ctra && tx_succesfull == 0);
-        l -= proc;
-        ctr += proc;
+    uint16_t h = txhead;
+    int l = 0;
+    while(*buf && tx_putchar(&h, (uint8_t)*buf)){
+        ++buf;
+        ++l;
     }
+    while(*buf++) ++USB_txdropped; // ring is full
+    txhead = h;
+    tx_start();
+    return l;
+}
+
+/**
+ * @brief USB_txpending
+ * @return amount of bytes not received by host yet
+ */
+int USB_txpending(){
+    return ((txhead - txtail) & TXRINGMASK) + txbusy;
 }
 
 /**
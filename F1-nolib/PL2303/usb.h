@@ -27,10 +27,16 @@
 #include "hardware.h"
 
 #define BUFFSIZE   (64)
+// transmit ring buffer size (power of 2)
+#define USB_TXRINGSZ    (1024)
+
+// bytes dropped by USB_send() due to full transmit ring
+extern volatile uint32_t USB_txdropped;
 
 void USB_setup();
 void usb_proc();
-void USB_send(const char *buf);
+int USB_send(const char *buf);
+int USB_txpending();
 int USB_receive(char *buf, int bufsize);
 int USB_configured();
 
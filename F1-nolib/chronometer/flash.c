@@ -46,7 +46,9 @@
 
 // max amount of records stored: Config & Logs
 uint32_t maxCnum = FLASH_BLOCK_SIZE / sizeof(user_conf);
-uint32_t maxLnum = FLASH_BLOCK_SIZE / sizeof(user_conf);
+uint32_t maxLnum = 0;
+uint32_t logNpages = 0; // amount of flash pages for logs
+uint32_t log_badrec = 0; // amount of broken records (bad CRC) met @ start
 
 // common structure for all datatypes stored
 /*typedef struct {
@@ -73,6 +75,7 @@ __attribute__ ((section(".myvars"))) const user_conf *Flash_Data;
 
 static int erase_flash(const void*, const void*);
 static int write2flash(const void*, const void*, uint32_t);
+static void log_buildidx();
 
 const user_conf *Flash_Data = (const user_conf *)&__varsstart;
 const event_log *logsstart = (event_log*) &__logsstart;
@@ -81,7 +84,21 @@ TODO("Add to event_log a comment - up to 8 chars")
 user_conf the_conf = USERCONF_INITIALIZER;
 
 static int currentconfidx = -1; // index of current configuration
-static int currentlogidx = -1; // index of current logs record
+
+// RAM index of logs pages
+typedef struct{
+    uint32_t seq;               // page sequence number (0 - page is free or broken)
+    uint32_t tmin : 17;         // min time of day (s) on page (LOG_TNONE if no valid time)
+    uint32_t nrec : 7;          // amount of records written (including broken)
+    uint32_t trigmask : 8;      // bit mask of triggers met on page
+    uint32_t tmax : 17;         // max time of day (s) on page
+} logpage_idx;
+static logpage_idx logidx[LOG_MAXPAGES];
+static int loghead = -1;        // page being written (-1 if there's no logs)
+static uint32_t logfreepages = 0; // pages without logs
+
+#define LOGPAGE(n)      ((const uint8_t*)logsstart + (n)*FLASH_BLOCK_SIZE)
+#define LOGREC(n, i)    ((const event_log*)(LOGPAGE(n) + sizeof(logpage_hdr)) + (i))
 
 /**
  * @brief binarySearch - binary search in flash for last non-empty cell
@@ -120,7 +137,9 @@ void flashstorage_init(){
     if(FLASH_SIZE > 0 && FLASH_SIZE < 20000){
         uint32_t flsz = FLASH_SIZE * 1024; // size in bytes
         flsz -= (uint32_t)logsstart - FLASH_BASE;
-        maxLnum = flsz / sizeof(event_log);
+        logNpages = flsz / FLASH_BLOCK_SIZE;
+        if(logNpages > LOG_MAXPAGES) logNpages = LOG_MAXPAGES;
+        maxLnum = logNpages * LOGS_PER_PAGE;
 //SEND("\nmaxLnum="); printu(1, maxLnum);
     }
     // -1 if there's no data at all & flash is clear; maxnum-1 if flash is full
@@ -128,7 +147,7 @@ void flashstorage_init(){
     if(currentconfidx > -1){
         memcpy(&the_conf, &Flash_Data[currentconfidx], sizeof(user_conf));
     }
-    currentlogidx = binarySearch((int)maxLnum-2, (const uint8_t*)logsstart, sizeof(event_log));
+    log_buildidx();
 }
 
 // store new configuration
@@ -144,6 +163,131 @@ int store_userconf(){
     return write2flash((const void*)&Flash_Data[currentconfidx], &the_conf, sizeof(the_conf));
 }
 
+/**
+ * @brief crc16 - CRC-16/CCITT-FALSE
+ * @param buf - data
+ * @param len - its length
+ * @return CRC
+ */
+static uint16_t crc16(const uint8_t *buf, int len){
+    uint16_t crc = 0xffff;
+    while(len--){
+        crc ^= (uint16_t)(*buf++) << 8;
+        for(int i = 0; i < 8; ++i){
+            if(crc & 0x8000) crc = (uint16_t)((crc << 1) ^ 0x1021);
+            else crc <<= 1;
+        }
+    }
+    return crc;
+}
+
+// CRC of event log record: all data after `crc` field
+static uint16_t log_crc(const event_log *l){
+    return crc16((const uint8_t*)&l->trigno, sizeof(event_log) - 4);
+}
+
+static int log_valid(const event_log *l){
+    if(l->elog_sz != sizeof(event_log) || l->trigno >= TRIGGERS_AMOUNT) return 0;
+    return (l->crc == log_crc(l));
+}
+
+/**
+ * @brief log_tod - time of day of record
+ * @param l - record
+ * @return seconds from midnight or LOG_TNONE if time wasn't valid
+ */
+uint32_t log_tod(const event_log *l){
+    const curtime *T = &l->shottime.Time;
+    if(T->H > 23 || T->M > 59 || T->S > 59) return LOG_TNONE;
+    return T->H * 3600 + T->M * 60 + T->S;
+}
+
+// add record data to page index
+static void log_addidx(logpage_idx *p, const event_log *l){
+    p->trigmask |= 1 << l->trigno;
+    uint32_t t = log_tod(l);
+    if(t == LOG_TNONE) return;
+    if(t < p->tmin) p->tmin = t;
+    if(t > p->tmax) p->tmax = t;
+}
+
+// clear index of page n
+static void log_clridx(int n){
+    logpage_idx *p = &logidx[n];
+    memset(p, 0, sizeof(logpage_idx));
+    p->tmin = LOG_TNONE;
+}
+
+/**
+ * @brief log_buildidx - scan all logs pages and build their index
+ * The page being written is the page with max sequence number, the next page is the oldest
+ */
+static void log_buildidx(){
+    uint32_t maxseq = 0;
+    loghead = -1;
+    log_badrec = 0;
+    logfreepages = 0;
+    for(int n = 0; n < (int)logNpages; ++n){
+        IWDG->KR = IWDG_REFRESH;
+        log_clridx(n);
+        const logpage_hdr *h = (const logpage_hdr*)LOGPAGE(n);
+        if(h->magic != LOG_MAGIC || h->recsz != sizeof(event_log) || h->seq == 0 || h->seq == 0xffffffff){
+            ++logfreepages;
+            continue;
+        }
+        logpage_idx *p = &logidx[n];
+        p->seq = h->seq;
+        // records are written one by one, so the first empty one is the end of data
+        for(uint32_t i = 0; i < LOGS_PER_PAGE; ++i){
+            const event_log *l = LOGREC(n, i);
+            if(l->elog_sz == 0xffff) break;
+            ++p->nrec;
+            if(!log_valid(l)) ++log_badrec;
+            else log_addidx(p, l);
+        }
+        if(p->seq > maxseq){
+            maxseq = p->seq;
+            loghead = n;
+        }
+    }
+}
+
+// check if page n is fully erased
+static int log_pageblank(int n){
+    const uint32_t *ptr = (const uint32_t*)LOGPAGE(n);
+    for(int i = 0; i < FLASH_BLOCK_SIZE / 4; ++i)
+        if(ptr[i] != 0xffffffff) return 0;
+    return 1;
+}
+
+/**
+ * @brief log_newpage - take the page next to current, erase it if need and write its header
+ * @return 0 if all OK
+ */
+static int log_newpage(){
+    if(logNpages == 0) return 1;
+    uint32_t seq = 1;
+    int n = 0;
+    if(loghead > -1){
+        seq = logidx[loghead].seq + 1;
+        n = (loghead + 1) % (int)logNpages;
+    }
+    logpage_idx *p = &logidx[n];
+    if(p->nrec){ // reclaim the oldest page
+        sendstring("\n\nWARNING!\nOldest ");
+        sendstring(u2str(p->nrec));
+        sendstring(" logs erased!\n\n");
+    }
+    if(!p->seq && logfreepages) --logfreepages;
+    log_clridx(n);
+    if(!log_pageblank(n) && erase_flash(LOGPAGE(n), LOGPAGE(n + 1))) return 1;
+    logpage_hdr h = {.magic = LOG_MAGIC, .recsz = sizeof(event_log), .seq = seq};
+    if(write2flash(LOGPAGE(n), &h, sizeof(h))) return 1;
+    p->seq = seq;
+    loghead = n;
+    return 0;
+}
+
 /**
  * @brief store_log - save log record L into flash memory
  * @param L - event log (or NULL to delete flash)
@@ -151,25 +295,114 @@ int store_userconf(){
  */
 int store_log(event_log *L){
     if(!L){
-        currentlogidx = -1;
-        return erase_flash(logsstart, NULL);
+        for(int n = 0; n < (int)logNpages; ++n) log_clridx(n);
+        loghead = -1;
+        logfreepages = logNpages;
+        return erase_flash(logsstart, LOGPAGE(logNpages));
     }
-    if(currentlogidx > (int)maxLnum - 3){ // there's no more place
-        /*currentlogidx = 0;
-        DBG("Need to erase flash!");
-        if(erase_flash(logsstart, NULL)) return 1;*/
-        // prevent automatic logs erasing!
-        sendstring("\n\nERROR!\nCan't save logs: delete old manually!!!\n");
-        return 1;
-    }else ++currentlogidx; // take next data position (0 - within first run after firmware flashing)
-    // put warning if there's little space
-    if(currentlogidx + the_conf.NLfreeWarn > (int)maxLnum - 3){
-        uint32_t nfree = maxLnum - 2 - (uint32_t)currentlogidx;
-        sendstring("\n\nWARNING!\nCan store only ");
-        sendstring(u2str(nfree));
-        sendstring(" logs!\n\n");
+    if(loghead < 0 || logidx[loghead].nrec >= LOGS_PER_PAGE){
+        if(log_newpage()){
+            sendstring("\n\nERROR!\nCan't prepare flash page for logs!\n");
+            return 1;
+        }
+    }
+    logpage_idx *p = &logidx[loghead];
+    // put warning if there's little space before the oldest logs will be erased
+    if(logfreepages && the_conf.NLfreeWarn){
+        uint32_t nfree = LOGS_PER_PAGE - p->nrec - 1 + logfreepages * LOGS_PER_PAGE;
+        if(nfree < the_conf.NLfreeWarn){
+            sendstring("\n\nWARNING!\nCan store only ");
+            sendstring(u2str(nfree));
+            sendstring(" logs before erasing the oldest!\n\n");
+        }
+    }
+    L->elog_sz = sizeof(event_log);
+    L->crc = log_crc(L);
+    const event_log *dst = LOGREC(loghead, p->nrec);
+    ++p->nrec; // even if writing failed this cell is spoiled
+    if(write2flash(dst, L, sizeof(event_log))) return 1;
+    log_addidx(p, L);
+    return 0;
+}
+
+/**
+ * @brief log_amount - amount of log records stored
+ */
+uint32_t log_amount(){
+    uint32_t N = 0;
+    for(int n = 0; n < (int)logNpages; ++n) N += logidx[n].nrec;
+    return N;
+}
+
+// number of `k`th page from the oldest or -1
+static int log_page(uint32_t k){
+    if(loghead < 0 || k >= logNpages) return -1;
+    return (loghead + 1 + (int)k) % (int)logNpages;
+}
+
+// check if time of day `t` is in filter range
+static int log_tmatch(const logfilter *f, uint32_t t){
+    if(f->tfrom == LOG_TNONE) return 1;
+    if(t == LOG_TNONE) return 0;
+    if(f->tfrom <= f->tto) return (t >= f->tfrom && t <= f->tto);
+    return (t >= f->tfrom || t <= f->tto);
+}
+
+// check by index if page `p` could have records matching filter
+static int log_pagematch(const logfilter *f, const logpage_idx *p){
+    if(!p->nrec) return 0;
+    if(f->trig > -1 && !(p->trigmask & (1 << f->trig))) return 0;
+    if(f->tfrom == LOG_TNONE) return 1;
+    if(p->tmin > p->tmax) return 0; // no valid time on page
+    if(f->tfrom <= f->tto) return (p->tmin <= f->tto && p->tmax >= f->tfrom);
+    return (p->tmax >= f->tfrom || p->tmin <= f->tto);
+}
+
+/**
+ * @brief log_filterinit - prepare filter to walk logs from the oldest
+ * @param f - filter
+ * @param tfrom, tto - time of day range, s (tfrom == LOG_TNONE for all records)
+ * @param trig - trigger number (-1 for all)
+ */
+void log_filterinit(logfilter *f, uint32_t tfrom, uint32_t tto, int trig){
+    f->tfrom = tfrom;
+    f->tto = tto;
+    f->trig = (int8_t)trig;
+    f->page = 0;
+    f->rec = 0;
+    f->scanned = 0;
+}
+
+/**
+ * @brief log_next - find next record matching filter
+ * @param f - filter
+ * @param number - (if not NULL) unique number of record found
+ * @return record or NULL if there's no more
+ */
+const event_log *log_next(logfilter *f, uint32_t *number){
+    int n;
+    while((n = log_page(f->page)) > -1){
+        const logpage_idx *p = &logidx[n];
+        if(f->rec == 0){ // new page: check index
+            if(!log_pagematch(f, p)){
+                ++f->page;
+                continue;
+            }
+            ++f->scanned;
+        }
+        while(f->rec < p->nrec){
+            const event_log *l = LOGREC(n, f->rec++);
+            IWDG->KR = IWDG_REFRESH;
+            if(!log_valid(l)) continue;
+            if(f->trig > -1 && l->trigno != f->trig) continue;
+            if(!log_tmatch(f, log_tod(l))) continue;
+            if(number) *number = (p->seq - 1) * LOGS_PER_PAGE + f->rec - 1;
+            return l;
+        }
+        ++f->page;
+        f->rec = 0;
     }
-    return write2flash(&logsstart[currentlogidx], L, sizeof(event_log));
+    return NULL;
 }
 
 /**
@@ -179,26 +412,46 @@ int store_log(event_log *L){
  * @return 0 if all OK, 1 if there's no logs in flash
  */
 int dump_log(int start, int Nlogs){
-    if(currentlogidx < 0) return 1;
+    int total = (int)log_amount(), n;
     if(start < 0){
-        start += currentlogidx + 1;
+        start += total;
         if(start < 0) start = 0;
     }
-    if(start > currentlogidx) return 1;
-    int nlast;
-    if(Nlogs > 0){
-        nlast = start + Nlogs - 1;
-        if(nlast > currentlogidx) nlast = currentlogidx;
-    }else nlast = currentlogidx;
-    ++nlast;
-    const event_log *l = logsstart + start;
-    for(int i = start; i < nlast; ++i, ++l){
-        IWDG->KR = IWDG_REFRESH;
-        sendstring(get_trigger_shot(i, l));
+    if(start >= total) return 1;
+    logfilter f;
+    log_filterinit(&f, LOG_TNONE, 0, -1);
+    // skip whole pages
+    while((n = log_page(f.page)) > -1 && (int)logidx[n].nrec <= start){
+        start -= logidx[n].nrec;
+        ++f.page;
     }
+    f.rec = (uint16_t)start;
+    const event_log *l;
+    uint32_t number;
+    for(int i = 0; (Nlogs <= 0 || i < Nlogs) && (l = log_next(&f, &number)); ++i)
+        sendstring(get_trigger_shot((int)number, l));
     return 0;
 }
 
+/**
+ * @brief dump_logtime - dump records by time of day range
+ * @param tfrom, tto - time range (s from midnight), if tto < tfrom range passes midnight
+ * @param trig - trigger number (-1 for all)
+ * @return 0 if found something
+ */
+int dump_logtime(uint32_t tfrom, uint32_t tto, int trig){
+    logfilter f;
+    log_filterinit(&f, tfrom, tto, trig);
+    const event_log *l;
+    uint32_t number;
+    int ret = 1;
+    while((l = log_next(&f, &number))){
+        sendstring(get_trigger_shot((int)number, l));
+        ret = 0;
+    }
+    return ret;
+}
+
 static int write2flash(const void *start, const void *wrdata, uint32_t stor_size){
     int ret = 0;
     if (FLASH->CR & FLASH_CR_LOCK){ // unloch flash
@@ -274,7 +527,7 @@ static int erase_flash(const void *start, const void *end){
         /* (5) Clear EOP flag by software by writing EOP at 1 */
         /* (6) Reset the PER Bit to disable the page erase */
         FLASH->CR |= FLASH_CR_PER; /* (1) */
-        FLASH->AR = (uint32_t)Flash_Data + i*FLASH_BLOCK_SIZE; /* (2) */
+        FLASH->AR = (uint32_t)start + i*FLASH_BLOCK_SIZE; /* (2) */
         FLASH->CR |= FLASH_CR_STRT; /* (3) */
         while(!(FLASH->SR & FLASH_SR_EOP));
         FLASH->SR |= FLASH_SR_EOP; /* (5)*/
@@ -55,22 +55,54 @@ typedef struct __attribute__((packed, aligned(4))){
 #define FLAG_GPSPROXY           (1 << 2)
 // USART3 works as regular TTY instead of LIDAR
 #define FLAG_NOLIDAR            (1 << 3)
+// USART n (1..3) receives by RXNE interrupts instead of circular DMA
+#define FLAG_NORXDMA(n)         (1 << (3 + (n)))
+
+/*
+ * Logs are stored in flash pages (FLASH_BLOCK_SIZE each) used in a ring:
+ * each page begins with header, next are records. When there's no free pages,
+ * the oldest one (with least sequence number) is erased and reused.
+ */
+typedef struct __attribute__((packed, aligned(4))){
+    uint16_t magic;             // LOG_MAGIC
+    uint16_t recsz;             // sizeof(event_log) when page was formatted
+    uint32_t seq;               // page sequence number (1 for first page, grows by 1 for each next)
+} logpage_hdr;
+
+#define LOG_MAGIC               (0x474C)
+// max amount of pages for logs (RAM index size)
+#define LOG_MAXPAGES            (128)
+// "no time" in index (time isn't valid)
+#define LOG_TNONE               (0x1ffff)
 
 /*
  * struct to save events logs
  */
 typedef struct __attribute__((packed, aligned(4))){
-    uint16_t elog_sz;
+    uint16_t elog_sz;           // sizeof(event_log): record is written
+    uint16_t crc;               // CRC16 of data below
     uint8_t trigno;
     trigtime shottime;
     int16_t triglen;
     uint16_t lidar_dist;
 } event_log;
 
+#define LOGS_PER_PAGE           ((FLASH_BLOCK_SIZE - sizeof(logpage_hdr)) / sizeof(event_log))
+
+// logs search & dump: filter by time of day and trigger number
+typedef struct{
+    uint32_t tfrom;             // first second of day (LOG_TNONE - don't check time)
+    uint32_t tto;               // last second of day (if tto < tfrom range passes midnight)
+    int8_t trig;                // trigger number or -1 for all
+    uint16_t page;              // pages passed from the oldest
+    uint16_t rec;               // next record on current page
+    uint16_t scanned;           // amount of pages read (others skipped by index)
+} logfilter;
+
 extern user_conf the_conf;
 extern const user_conf *Flash_Data;
 extern const event_log *logsstart;
-extern uint32_t maxCnum, maxLnum;
+extern uint32_t maxCnum, maxLnum, logNpages, log_badrec;
 // data from ld-file
 extern uint32_t _varslen, __varsstart, __logsstart;
 
@@ -78,7 +110,12 @@ extern uint32_t _varslen, __varsstart, __logsstart;
 void flashstorage_init();
 int store_userconf();
 int store_log(event_log *L);
+uint32_t log_amount();
+void log_filterinit(logfilter *f, uint32_t tfrom, uint32_t tto, int trig);
+const event_log *log_next(logfilter *f, uint32_t *number);
+uint32_t log_tod(const event_log *l);
 int dump_log(int start, int Nlogs);
+int dump_logtime(uint32_t tfrom, uint32_t tto, int trig);
 
 #ifdef EBUG
 void dump_userconf();
@@ -132,12 +132,24 @@ static inline void adc_setup(){
 void hw_setup(){
     gpio_setup();
     adc_setup();
+    tstamp_setup();
 }
 
 static trigtime trgtm;
+/**
+ * @brief gettrigtime - get current time as trigger time
+ * @param t (o) - time
+ */
+void gettrigtime(trigtime *t){
+    t->usec = tstamp2time(tstamp_now(), &t->Time);
+    t->millis = t->usec / 1000;
+}
 void savetrigtime(){
-    trgtm.millis = Timer;
-    memcpy(&trgtm.Time, &current_time, sizeof(curtime));
+    gettrigtime(&trgtm);
+}
+// use time saved earlier as time of next trigger shot
+void settrigtime(const trigtime *t){
+    memcpy(&trgtm, t, sizeof(trigtime));
 }
 
 /**
@@ -186,7 +198,8 @@ void fillunshotms(){
 }
 
 void exti1_isr(){ // PPS - PA1
-    systick_correction();
+    pps_capture();
+    clock_pps();
     LED_off(); // turn off LED0 @ each PPS
     EXTI->PR = EXTI_PR_PR1;
 }
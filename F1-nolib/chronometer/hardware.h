@@ -74,7 +74,6 @@ uint8_t gettrig(uint8_t N);
 #endif
 void fillshotms(int i);
 void fillunshotms();
-void savetrigtime();
 #define GET_PPS()       ((GPIOA->IDR & (1<<1)) ? 1 : 0)
 
 // USB pullup - PA15
@@ -97,8 +96,13 @@ void savetrigtime();
 typedef struct{
     uint32_t millis;
     curtime Time;
+    uint32_t usec;  // microseconds from second beginning (TIM2 disciplined by PPS)
 } trigtime;
 
+void gettrigtime(trigtime *t);
+void savetrigtime();
+void settrigtime(const trigtime *t);
+
 // turn on/off LEDs:
 extern uint8_t LEDSon;
 // time of triggers shot
@@ -23,17 +23,99 @@
 uint16_t last_lidar_dist = 0;
 uint16_t last_lidar_stren = 0;
 uint16_t lidar_triggered_dist = 0;
+volatile uint32_t lidar_frames = 0, lidar_badcrc = 0, lidar_qlost = 0;
 
 extern uint32_t shotms[];
 
+// frame being received
+static uint8_t frbuf[LIDAR_FRAME_LEN];
+static uint8_t frlen = 0;
+// queue of decoded frames
+static lidar_frame frameq[LIDAR_FRAMEQSZ];
+static volatile uint8_t fqhead = 0, fqtail = 0;
+
+static void frame_ready(){
+    uint8_t h = fqhead, nxt = (h + 1) & (LIDAR_FRAMEQSZ - 1);
+    ++lidar_frames;
+    if(nxt == fqtail){ // main loop is too slow
+        ++lidar_qlost;
+        return;
+    }
+    lidar_frame *f = &frameq[h];
+    f->ticks = SysTick->VAL;
+    f->Tms = Tms;
+    gettrigtime(&f->tm);
+    f->dist = frbuf[2] | (frbuf[3] << 8);
+    f->stren = frbuf[4] | (frbuf[5] << 8);
+    __DMB();
+    fqhead = nxt;
+}
+
+/**
+ * @brief lidar_rxbyte - streaming decoder of TFmini frames (called from USART IRQ)
+ * Frame: 0x59, 0x59, Dist_L, Dist_H, Strength_L, Strength_H, Mode, Reserved, Checksum (low byte of sum)
+ * @param b - next byte from LIDAR
+ */
+void lidar_rxbyte(uint8_t b){
+    frbuf[frlen++] = b;
+    if(frlen < 3){ // header
+        if(b != LIDAR_FRAME_HEADER){
+            rxdropped[LIDAR_USART] += frlen;
+            frlen = 0;
+        }
+        return;
+    }
+    if(frlen < LIDAR_FRAME_LEN) return;
+    uint8_t sum = 0;
+    for(int i = 0; i < LIDAR_FRAME_LEN - 1; ++i) sum += frbuf[i];
+    if(sum == frbuf[LIDAR_FRAME_LEN - 1]){
+        frame_ready();
+        frlen = 0;
+        return;
+    }
+    ++lidar_badcrc;
+    // resynchronisation: header could be inside this frame
+    int i;
+    for(i = 1; i < LIDAR_FRAME_LEN; ++i){
+        if(frbuf[i] == LIDAR_FRAME_HEADER && (i == LIDAR_FRAME_LEN - 1 || frbuf[i+1] == LIDAR_FRAME_HEADER)) break;
+    }
+    rxdropped[LIDAR_USART] += i;
+    frlen = LIDAR_FRAME_LEN - i;
+    for(int j = 0; j < frlen; ++j) frbuf[j] = frbuf[i+j];
+}
+
+/**
+ * @brief lidar_rxdata - feed decoder by chunk of data
+ * @param data - data received
+ * @param len - its length
+ */
+void lidar_rxdata(const uint8_t *data, int len){
+    for(int i = 0; i < len; ++i) lidar_rxbyte(data[i]);
+}
+
+/**
+ * @brief lidar_getframe - get next decoded frame
+ * @param f (o) - frame
+ * @return 0 if queue is empty
+ */
+int lidar_getframe(lidar_frame *f){
+    uint8_t t = fqtail;
+    if(t == fqhead) return 0;
+    __DMB();
+    *f = frameq[t];
+    __DMB();
+    fqtail = (t + 1) & (LIDAR_FRAMEQSZ - 1);
+    return 1;
+}
+
 /**
- * @brief parse_lidar_data - parsing of string from lidar
- * @param txt - the string or NULL (if you want just check trigger state)
+ * @brief parse_lidar_data - check decoded frame for trigger
+ * @param f - the frame or NULL (if you want just check trigger state)
  * @return trigger state
  */
-uint8_t parse_lidar_data(char *txt){
+uint8_t parse_lidar_data(const lidar_frame *f){
     static uint8_t triggered = 0;
-    if(!txt){
+    if(!f){
         // clear trigger state after timeout -> need to monitor lidar
         uint32_t len = Tms - shotms[LIDAR_TRIGGER];
         //if(len > MAX_TRIG_LEN || len > (uint32_t)the_conf.trigpause[LIDAR_TRIGGER]){
@@ -43,8 +125,8 @@ uint8_t parse_lidar_data(char *txt){
         }
         return triggered;
     }
-    last_lidar_dist = txt[2] | (txt[3] << 8);
-    last_lidar_stren = txt[4] | (txt[5] << 8);
+    last_lidar_dist = f->dist;
+    last_lidar_stren = f->stren;
     if(last_lidar_stren < LIDAR_LOWER_STREN) return 0; // weak signal
     if(!lidar_triggered_dist){ // first run
         lidar_triggered_dist = last_lidar_dist;
@@ -64,7 +146,7 @@ uint8_t parse_lidar_data(char *txt){
         }
     }else{
         if(last_lidar_dist > the_conf.dist_min && last_lidar_dist < the_conf.dist_max){
-            savetrigtime();
+            settrigtime(&f->tm); // time when frame was received
             triggered = 1;
             lidar_triggered_dist = last_lidar_dist;
             fillshotms(LIDAR_TRIGGER);
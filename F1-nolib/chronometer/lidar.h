@@ -19,6 +19,7 @@
 #ifndef LIDAR_H__
 #define LIDAR_H__
 #include <stm32f1.h>
+#include "hardware.h"
 
 #define LIDAR_FRAME_LEN     (9)
 // frame header
@@ -29,11 +30,27 @@
 #define LIDAR_DIST_THRES    (100)
 #define LIDAR_MIN_DIST      (50)
 #define LIDAR_MAX_DIST      (1000)
+// decoded frames queue size (power of 2)
+#define LIDAR_FRAMEQSZ      (32)
+
+// decoded LIDAR frame with time of its last byte
+typedef struct{
+    uint16_t dist;          // distance, cm
+    uint16_t stren;         // signal strength
+    uint32_t Tms;           // Tms value
+    uint32_t ticks;         // SysTick->VAL value
+    trigtime tm;            // time for trigger
+} lidar_frame;
 
 extern uint16_t last_lidar_dist;
 extern uint16_t lidar_triggered_dist;
 extern uint16_t last_lidar_stren;
+// good frames, frames with bad checksum, frames lost due to queue overflow
+extern volatile uint32_t lidar_frames, lidar_badcrc, lidar_qlost;
 
-uint8_t parse_lidar_data(char *txt);
+void lidar_rxbyte(uint8_t b);
+void lidar_rxdata(const uint8_t *data, int len);
+int lidar_getframe(lidar_frame *f);
+uint8_t parse_lidar_data(const lidar_frame *f);
 
 #endif // LIDAR_H__
@@ -43,6 +43,7 @@ void sys_tick_handler(void){
     if(++Timer == 1000){ // increment milliseconds counter
         time_increment();
     }
+    clock_tick();
 }
 
 void iwdg_setup(){
@@ -81,8 +82,7 @@ char *parse_cmd(char *buf){
             LED1_on(); // LED1 on @dbg
         break;
         case 'a':
-            l.shottime.Time = current_time;
-            l.shottime.millis = Timer;
+            gettrigtime(&l.shottime);
             l.triglen = getADCval(1);
             if(store_log(&l)) SEND("Error storing");
             else SEND("Store OK");
@@ -235,6 +235,7 @@ void clstate_handler(uint16_t __attribute__((unused)) val){ // lesser bits of va
 void break_handler(){ // client disconnected
     DBG("Disconnected");
     USB_connected = 0;
+    USB_txflush(); // nobody will read it
 }
 
 int main(void){
@@ -289,25 +290,23 @@ int main(void){
             transmit_tbuf(GPS_USART);
             transmit_tbuf(LIDAR_USART);
 #ifdef EBUG
-            static int32_t oldctr = 0;
-            if(timecntr && timecntr != oldctr){
-                oldctr = timecntr;
-                SEND("ticksdiff=");
-                if(ticksdiff < 0){
+            static uint32_t oldcorr = 0;
+            if(last_corr_time != oldcorr){
+                oldcorr = last_corr_time;
+                SEND("clk_phase=");
+                if(clk_phase < 0){
                     SEND("-");
-                    printu(1, -ticksdiff);
-                }else printu(1, ticksdiff);
-                SEND(", timecntr=");
-                printu(1, timecntr);
-                SEND("\nlast_corr_time=");
-                printu(1, last_corr_time);
-                SEND(", Tms=");
-                printu(1, Tms1);
-                SEND("\nTimer=");
-                printu(1, timerval);
+                    printu(1, -clk_phase);
+                }else printu(1, clk_phase);
+                SEND(", clk_freq=");
+                if(clk_freq < 0){
+                    SEND("-");
+                    printu(1, -clk_freq);
+                }else printu(1, clk_freq);
+                SEND(", state=");
+                printu(1, clk_state);
                 SEND(", LOAD=");
                 printu(1, SysTick->LOAD);
-                usart_putchar(1, '\n');
                 newline(1);
             }
 #endif
@@ -321,7 +320,8 @@ int main(void){
             IWDG->KR = IWDG_REFRESH;
             parse_CMD(txt);
         }
-        if(usartrx(1)){ // usart1 received data, store it in buffer
+        // process all lines received since last iteration (but not more than queue size)
+        for(int i = 0; i < RXLINEQSZ && usartrx(1); ++i){ // usart1 received data
             r = usart_getline(1, &txt);
             IWDG->KR = IWDG_REFRESH;
             if(r){
@@ -336,7 +336,7 @@ int main(void){
                 }
             }
         }
-        if(usartrx(GPS_USART)){
+        for(int i = 0; i < RXLINEQSZ && usartrx(GPS_USART); ++i){
             IWDG->KR = IWDG_REFRESH;
             r = usart_getline(GPS_USART, &txt);
             if(r){
@@ -345,17 +345,22 @@ int main(void){
                 GPS_parse_answer(txt);
             }
         }
-        if(usartrx(LIDAR_USART)){
-            IWDG->KR = IWDG_REFRESH;
-            r = usart_getline(LIDAR_USART, &txt);
-            if(r){
-                if(the_conf.defflags & FLAG_NOLIDAR){
+        if(the_conf.defflags & FLAG_NOLIDAR){
+            for(int i = 0; i < RXLINEQSZ && usartrx(LIDAR_USART); ++i){
+                IWDG->KR = IWDG_REFRESH;
+                r = usart_getline(LIDAR_USART, &txt);
+                if(r){
                     usart_send(LIDAR_USART, txt);
                     if(*txt != '\n'){
                         parse_CMD(txt);
                     }
-                }else
-                    parse_lidar_data(txt);
+                }
+            }
+        }else{
+            lidar_frame frame;
+            for(int i = 0; i < LIDAR_FRAMEQSZ && lidar_getframe(&frame); ++i){
+                IWDG->KR = IWDG_REFRESH;
+                parse_lidar_data(&frame);
             }
         }
         chk_buzzer(); // should we turn off buzzer?
@@ -0,0 +1,159 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Benchmark counters & report; wrappers over firmware functions (see --wrap in Makefile)
+// give control to scheduler once per main loop iteration and check parsed data
+
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../flash.h"
+#include "../hardware.h"
+#include "../lidar.h"
+#include "../usart.h"
+#include "bench.h"
+#include "regs.h"
+#include "replay.h"
+
+uint64_t bench_loops = 0;
+FILE *bench_usart1out = NULL;
+int bench_rxmode = -1;
+int bench_resultfd = -1;
+
+static uint64_t txbytes[4], rxlost[4];
+static struct timespec hoststart;
+
+void __real_flashstorage_init();
+void __real_chk_buzzer();
+void __real_GPS_parse_answer(const char *string);
+uint8_t __real_parse_lidar_data(const lidar_frame *f);
+void __real_parse_CMD(char *cmd);
+void __real_show_trigger_shot(uint8_t trigger_shot);
+
+// configuration is read: change receive mode
+void __wrap_flashstorage_init(){
+    __real_flashstorage_init();
+    if(bench_rxmode < 0) return;
+    for(int i = 1; i < 4; ++i){
+        if(bench_rxmode) the_conf.defflags &= ~FLAG_NORXDMA(i);
+        else the_conf.defflags |= FLAG_NORXDMA(i);
+    }
+}
+
+// called once per main loop iteration
+void __wrap_chk_buzzer(){
+    ++bench_loops;
+    sim_poll();
+    __real_chk_buzzer();
+}
+
+void __wrap_GPS_parse_answer(const char *string){
+    replay_consumed(GPS_USART, string, (int)strlen(string));
+    __real_GPS_parse_answer(string);
+}
+
+// decoded frame is compared by header, distance & strength
+uint8_t __wrap_parse_lidar_data(const lidar_frame *f){
+    if(f){
+        char hdr[LIDAR_HDR_LEN] = {LIDAR_FRAME_HEADER, LIDAR_FRAME_HEADER,
+            f->dist & 0xff, f->dist >> 8, f->stren & 0xff, f->stren >> 8};
+        replay_consumed(LIDAR_USART, hdr, LIDAR_HDR_LEN);
+    }
+    return __real_parse_lidar_data(f);
+}
+
+// commands from USB are parsed too, but there's no USB traffic in simulator
+void __wrap_parse_CMD(char *cmd){
+    replay_consumed(1, cmd, (int)strlen(cmd));
+    __real_parse_CMD(cmd);
+}
+
+void __wrap_show_trigger_shot(uint8_t trigger_shot){
+    replay_trigshown(trigger_shot);
+    __real_show_trigger_shot(trigger_shot);
+}
+
+// USART transmitter started DMA transfer
+void bench_tx(int n, const uint8_t *data, int len){
+    if(n < 1 || n > 3 || len < 1) return;
+    txbytes[n] += len;
+    if(n == 1 && bench_usart1out) fwrite(data, 1, len, bench_usart1out);
+}
+
+// byte came when receiver or RXNE interrupt is off
+void bench_rxlost(int n){
+    if(n > 0 && n < 4) ++rxlost[n];
+}
+
+void bench_start(){
+    clock_gettime(CLOCK_MONOTONIC, &hoststart);
+}
+
+static void prlat(uint64_t min, uint64_t max, uint64_t sum, uint32_t N){
+    if(!N){
+        printf("%10s %10s %10s", "-", "-", "-");
+        return;
+    }
+    printf("%10.1f %10.1f %10.1f", SIM_CLK2US(min), SIM_CLK2US(sum) / N, SIM_CLK2US(max));
+}
+
+/**
+ * @brief bench_finish - print report and exit
+ * @param reason - NULL for normal end of simulation or reason of abnormal termination
+ */
+void bench_finish(const char *reason){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    double host = (double)(t.tv_sec - hoststart.tv_sec) + (t.tv_nsec - hoststart.tv_nsec) / 1e9;
+    double simt = (double)sim_clock / SIM_CPUFREQ;
+    if(bench_usart1out) fflush(bench_usart1out);
+    if(bench_resultfd > -1){
+        benchresult r = {.clocks = sim_clock, .isrclocks = sim_isrclocks, .loops = bench_loops};
+        if(write(bench_resultfd, &r, sizeof(r)) != sizeof(r)) perror("write()");
+    }
+    if(reason) printf("\nSimulation stopped: %s\n", reason);
+    printf("\nSimulated time:      %.3f s (host: %.3f s)\n", simt, host);
+    printf("Main loop:           %llu iterations, %.0f per second\n",
+           (unsigned long long)bench_loops, simt > 0. ? bench_loops / simt : 0.);
+    printf("Interrupts load:     %.2f%%\n", sim_clock ? 100. * sim_isrclocks / sim_clock : 0.);
+    printf("\n%-8s %8s %8s %8s %8s %8s %8s %10s %10s %10s %10s\n", "stream", "sent", "parsed",
+           "lost", "unknown", "rxlost", "fwdrop", "backlog,B", "lat_min,us", "lat_avg,us", "lat_max,us");
+    for(int i = 1; i < 4; ++i){
+        streamstat *s = &streams[i];
+        printf("%-8s %8u %8u %8u %8u %8llu %8u %10llu ", s->name, s->sent, s->parsed, s->lost,
+               s->unknown, (unsigned long long)rxlost[i], (unsigned)rxdropped[i],
+               (unsigned long long)s->backlog_max);
+        prlat(s->lat_min, s->lat_max, s->lat_sum, s->parsed);
+        printf("\n");
+    }
+    printf("%-8s %8u %8u %8u %8s %8s %8s %10s ", "TRIGGER", trigstats.fired, trigstats.shown,
+           trigstats.fired - trigstats.shown, "-", "-", "-", "-");
+    prlat(trigstats.lat_min, trigstats.lat_max, trigstats.lat_sum, trigstats.shown);
+    if(trigstats.stamped)
+        printf("\nTrigger timestamps:  %u checked, error min/avg(abs)/max: %.1f/%.1f/%.1f us",
+               trigstats.stamped, trigstats.err_min, trigstats.err_abssum / trigstats.stamped,
+               trigstats.err_max);
+    printf("\nLIDAR decoder:       %u frames, %u bad checksums, %u lost in queue",
+           (unsigned)lidar_frames, (unsigned)lidar_badcrc, (unsigned)lidar_qlost);
+    printf("\n\nTransmitted:         USART1 %llu, USART2 %llu, USART3 %llu bytes\n",
+           (unsigned long long)txbytes[1], (unsigned long long)txbytes[2], (unsigned long long)txbytes[3]);
+    fflush(stdout);
+    exit(reason ? 1 : 0);
+}
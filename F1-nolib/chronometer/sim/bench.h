@@ -0,0 +1,45 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef BENCH_H__
+#define BENCH_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+// main loop iterations
+extern uint64_t bench_loops;
+// file for USART1 output (NULL - don't save)
+extern FILE *bench_usart1out;
+// USARTs receive mode: -1 - as configured, 0 - RXNE interrupts, 1 - circular DMA
+extern int bench_rxmode;
+// descriptor to write benchresult to (-1 - none)
+extern int bench_resultfd;
+
+typedef struct{
+    uint64_t clocks;        // simulated time
+    uint64_t isrclocks;     // time in interrupts
+    uint64_t loops;         // main loop iterations
+} benchresult;
+
+void bench_tx(int n, const uint8_t *data, int len);
+void bench_rxlost(int n);
+void bench_start();
+void bench_finish(const char *reason) __attribute__((noreturn));
+
+#endif // BENCH_H__
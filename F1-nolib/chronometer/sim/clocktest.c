@@ -0,0 +1,163 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Test of clock discipline: firmware runs only interrupts (SysTick, TIM2 & PPS),
+// MCU oscillator has frequency error with slow wander, PPS has gaussian jitter
+// and could be lost for a while. Local time is compared with real one each second.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../hardware.h"
+#include "../time.h"
+#include "clocktest.h"
+#include "regs.h"
+#include "replay.h"
+
+// wander period (s)
+#define WANDER_PERIOD   (3600.)
+// time to settle after start or PPS gap (s)
+#define SETTLE_TIME     (120)
+// triggers around each second edge: within +-TRIG_WINDOW us (wider than step threshold), each TRIG_STEP us
+#define TRIG_WINDOW     (400)
+#define TRIG_STEP       (10)
+// max error of trigger time (us): much more than phase error, much less than a second
+#define TRIG_MAXERR     (100000.)
+
+static double gauss(){
+    double u1 = drand48(), u2 = drand48();
+    if(u1 < 1e-300) u1 = 1e-300;
+    return sqrt(-2. * log(u1)) * cos(2. * M_PI * u2);
+}
+
+// local time of second (us) minus real (wrapped into +-0.5s)
+static double local_error(){
+    double us = Timer * 1000. + (double)(SysTick->LOAD - SysTick->VAL) / (SYSTICK_DEFCONF / 1000);
+    if(us > 500000.) us -= 1000000.;
+    return us;
+}
+
+// trigger time (us from midnight)
+static double trig_us(){
+    trigtime t;
+    gettrigtime(&t);
+    return ((t.Time.H * 60. + t.Time.M) * 60. + t.Time.S) * 1e6 + t.usec;
+}
+
+typedef struct{
+    uint32_t N;
+    double sum2, max;
+} errstat;
+
+static void adderr(errstat *s, double e){
+    ++s->N;
+    s->sum2 += e*e;
+    if(fabs(e) > s->max) s->max = fabs(e);
+}
+
+static void prerr(const char *name, const errstat *s){
+    if(!s->N) return;
+    printf("%-20s %u s, RMS %.3f us, max %.3f us\n", name, s->N, sqrt(s->sum2 / s->N), s->max);
+}
+
+/**
+ * @brief clocktest - run clock discipline test and print report
+ * @param hours - test duration
+ * @param jitter - PPS jitter (RMS, us)
+ * @param ppm - oscillator frequency error
+ * @param wander - amplitude of oscillator frequency wander (ppm, period is 1 hour)
+ * @param gap - length of PPS loss in the middle of test (s)
+ * @return 0 if clock locked & recovered at the first PPS after gap, triggers near second edge
+ *      got right time
+ */
+int clocktest(double hours, double jitter, double ppm, double wander, double gap){
+    int Nsec = (int)(hours * 3600.), gapstart = Nsec / 2, gapend = gapstart + (int)gap;
+    int lockedat = -1, settled = -1;
+    errstat tracking = {0}, holdover = {0};
+    int recovered = -1; // seconds after PPS return till error is less than step threshold
+    uint32_t trigs = 0, trigbad = 0; // triggers near second edge & wrong of them
+    srand48(1);
+    sim_fixedstep = 1; // deterministic mode: one clock per register access
+    SysTick_Config(SYSTICK_DEFCONF);
+    hw_setup();
+    sim_drivepin(0, 1, 0, sim_clock); // PPS is low
+    current_time = (curtime){12, 0, 0};
+    // first second begins after 0.3s of work
+    double sec = SIM_MS2CLK(300.);
+    printf("Clock servo test:    %g hours, PPS jitter %g us RMS, oscillator %+g ppm, wander %g ppm, PPS gap %g s\n",
+           hours, jitter, ppm, wander, gap);
+    for(int s = 0; s < Nsec; ++s){
+        double y = (ppm + wander * sin(2. * M_PI * s / WANDER_PERIOD)) * 1e-6;
+        double edge = sec + gauss() * jitter * (SIM_CPUFREQ / 1e6);
+        int haspps = (s < gapstart || s >= gapend), ppsdone = !haspps, secdone = 0;
+        double e = 0., trig = sec - SIM_US2CLK(TRIG_WINDOW), prevus = -1.;
+        uint32_t steps = clk_steps;
+        // PPS edge, real second beginning & triggers around it in time order
+        while(!secdone || trig <= sec + SIM_US2CLK(TRIG_WINDOW)){
+            if(!ppsdone && edge <= trig && (secdone || edge < sec)){
+                sim_runto((uint64_t)edge);
+                sim_drivepin(0, 1, 1, (uint64_t)edge);
+                ppsdone = 1;
+            }else if(!secdone && sec <= trig){
+                sim_runto((uint64_t)sec);
+                e = local_error();
+                secdone = 1;
+            }else{
+                sim_runto((uint64_t)trig);
+                double us = trig_us();
+                // time between triggers should be the same as real one (if clock wasn't stepped)
+                if(prevus >= 0. && steps == clk_steps){
+                    ++trigs;
+                    if(fabs(us - prevus - TRIG_STEP) > TRIG_MAXERR) ++trigbad;
+                }
+                prevus = us;
+                steps = clk_steps;
+                trig += SIM_US2CLK(TRIG_STEP);
+            }
+        }
+        if(!ppsdone){
+            sim_runto((uint64_t)edge);
+            sim_drivepin(0, 1, 1, (uint64_t)edge);
+        }
+        if(haspps) sim_runto((uint64_t)(edge + SIM_MS2CLK(PPS_PULSE_MS)));
+        sim_drivepin(0, 1, 0, sim_clock);
+        if(lockedat < 0 && clk_state == CLK_LOCKED){
+            lockedat = s;
+            settled = s + SETTLE_TIME;
+        }
+        if(!haspps) adderr(&holdover, e);
+        else if(gap > 0. && s > gapend && recovered < 0 && fabs(e) < CLK_STEP / (SYSTICK_DEFCONF / 1000.))
+            recovered = s - gapend;
+        else if(settled > -1 && s >= settled && (s < gapstart || s >= gapend + SETTLE_TIME)) adderr(&tracking, e);
+        // the next real second in MCU clocks
+        sec += SIM_CPUFREQ * (1. + y);
+    }
+    double yend = ppm + wander * sin(2. * M_PI * Nsec / WANDER_PERIOD);
+    if(lockedat < 0) printf("Clock wasn't locked!\n");
+    else printf("Locked after:        %d s\n", lockedat);
+    prerr("Tracking error:", &tracking);
+    prerr("Holdover error:", &holdover);
+    if(gap > 0.) printf("Recovered after gap: %d s\n", recovered);
+    printf("Clock steps:         %u\n", (unsigned)clk_steps);
+    printf("Triggers near edge:  %u, wrong second: %u\n", (unsigned)trigs, (unsigned)trigbad);
+    printf("Frequency estimate:  %+.4f ppm (real %+.4f ppm)\n",
+           clk_freq / (SYSTICK_DEFCONF * 65536. / 1e6), yend);
+    // the first PPS after holdover should step clock at once
+    return lockedat < 0 || (gap > 0. && (recovered < 0 || recovered > 1)) || trigbad;
+}
@@ -0,0 +1,47 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host replacement of CMSIS core functions: PRIMASK is emulated by simulator
+
+#pragma once
+#ifndef __CORE_CMFUNC_H
+#define __CORE_CMFUNC_H
+
+#include <stdint.h>
+
+void sim_irqmask(uint32_t mask);
+uint32_t sim_getirqmask();
+
+static inline void __enable_irq(void){ sim_irqmask(0); }
+static inline void __disable_irq(void){ sim_irqmask(1); }
+static inline uint32_t __get_PRIMASK(void){ return sim_getirqmask(); }
+static inline void __set_PRIMASK(uint32_t priMask){ sim_irqmask(priMask & 1); }
+static inline void __enable_fault_irq(void){}
+static inline void __disable_fault_irq(void){}
+
+static inline uint32_t __get_CONTROL(void){ return 0; }
+static inline void __set_CONTROL(uint32_t control){ (void)control; }
+static inline uint32_t __get_IPSR(void){ return 0; }
+static inline uint32_t __get_APSR(void){ return 0; }
+static inline uint32_t __get_xPSR(void){ return 0; }
+static inline uint32_t __get_BASEPRI(void){ return 0; }
+static inline void __set_BASEPRI(uint32_t value){ (void)value; }
+static inline uint32_t __get_FAULTMASK(void){ return 0; }
+static inline void __set_FAULTMASK(uint32_t faultMask){ (void)faultMask; }
+
+#endif // __CORE_CMFUNC_H
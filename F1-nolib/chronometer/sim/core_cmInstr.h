@@ -0,0 +1,70 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host replacement of CMSIS core instructions: core_cm3.h is used as is,
+// but all ARM-specific assembler is changed to plain C or simulator calls
+
+#pragma once
+#ifndef __CORE_CMINSTR_H
+#define __CORE_CMINSTR_H
+
+#include <stdint.h>
+
+void sim_poll();
+void sim_dsb();
+
+static inline void __NOP(void){ __asm__ volatile ("nop"); }
+// sleeping: give the simulator a chance to fire next event
+static inline void __WFI(void){ sim_poll(); }
+static inline void __WFE(void){ sim_poll(); }
+static inline void __SEV(void){}
+static inline void __ISB(void){}
+// NVIC_SystemReset() calls __DSB() after writing SCB->AIRCR
+static inline void __DSB(void){ sim_dsb(); }
+static inline void __DMB(void){}
+
+static inline uint32_t __REV(uint32_t value){ return __builtin_bswap32(value); }
+static inline uint32_t __REV16(uint32_t value){
+    return ((value & 0xff00ff00) >> 8) | ((value & 0x00ff00ff) << 8);
+}
+static inline int32_t __REVSH(int32_t value){
+    return (int16_t)__builtin_bswap16((uint16_t)value);
+}
+static inline uint32_t __ROR(uint32_t op1, uint32_t op2){
+    op2 &= 31;
+    return op2 ? (op1 >> op2) | (op1 << (32 - op2)) : op1;
+}
+static inline uint32_t __RBIT(uint32_t value){
+    uint32_t result = 0;
+    for(int i = 0; i < 32; ++i, value >>= 1) result = (result << 1) | (value & 1);
+    return result;
+}
+static inline uint8_t __CLZ(uint32_t value){
+    return value ? (uint8_t)__builtin_clz(value) : 32;
+}
+
+// single core without preemption of the simulator: exclusive access always succeeds
+static inline uint8_t __LDREXB(volatile uint8_t *addr){ return *addr; }
+static inline uint16_t __LDREXH(volatile uint16_t *addr){ return *addr; }
+static inline uint32_t __LDREXW(volatile uint32_t *addr){ return *addr; }
+static inline uint32_t __STREXB(uint8_t value, volatile uint8_t *addr){ *addr = value; return 0; }
+static inline uint32_t __STREXH(uint16_t value, volatile uint16_t *addr){ *addr = value; return 0; }
+static inline uint32_t __STREXW(uint32_t value, volatile uint32_t *addr){ *addr = value; return 0; }
+static inline void __CLREX(void){}
+
+#endif // __CORE_CMINSTR_H
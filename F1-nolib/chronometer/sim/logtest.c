@@ -0,0 +1,160 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Test of events log store over simulated flash: N events (each 5 seconds,
+// midnight is in the middle of data kept) are stored so the oldest pages are
+// reclaimed; after restart the index is rebuilt and time range queries are
+// compared with brute force search; then one record is damaged.
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "../flash.h"
+#include "../time.h"
+#include "logtest.h"
+#include "regs.h"
+
+// period of events (s)
+#define EVT_PERIOD  (5)
+#define DAYSEC      (86400)
+
+static event_log *expected = NULL; // all events stored
+static int Nexp = 0, firstkept = 0, damaged = -1;
+
+static void mkevent(event_log *l, int i, uint32_t T0){
+    uint32_t t = (T0 + (uint32_t)i * EVT_PERIOD) % DAYSEC;
+    l->trigno = (uint8_t)(i % TRIGGERS_AMOUNT);
+    l->shottime.Time.H = (uint8_t)(t / 3600);
+    l->shottime.Time.M = (uint8_t)(t / 60 % 60);
+    l->shottime.Time.S = (uint8_t)(t % 60);
+    l->shottime.usec = (uint32_t)i * 7919 % 1000000;
+    l->shottime.millis = l->shottime.usec / 1000;
+    l->triglen = (int16_t)(i % 1000);
+    l->lidar_dist = (l->trigno == LIDAR_TRIGGER) ? (uint16_t)(i % 5000) : 0;
+}
+
+static int sameevent(const event_log *a, const event_log *b){
+    return a->trigno == b->trigno && a->shottime.Time.H == b->shottime.Time.H &&
+           a->shottime.Time.M == b->shottime.Time.M && a->shottime.Time.S == b->shottime.Time.S &&
+           a->shottime.usec == b->shottime.usec && a->triglen == b->triglen &&
+           a->lidar_dist == b->lidar_dist;
+}
+
+static int inrange(uint32_t t, uint32_t tfrom, uint32_t tto){
+    if(tfrom <= tto) return t >= tfrom && t <= tto;
+    return t >= tfrom || t <= tto;
+}
+
+/**
+ * @brief query - compare search by index with brute force
+ * @return 0 if results are the same
+ */
+static int query(const char *name, uint32_t tfrom, uint32_t tto, int trig){
+    logfilter f;
+    log_filterinit(&f, tfrom, tto, trig);
+    const event_log *l;
+    uint32_t number;
+    int i = firstkept, found = 0, bad = 0;
+    while((l = log_next(&f, &number))){
+        // next expected
+        for(; i < Nexp; ++i){
+            if(i == damaged) continue;
+            if(trig > -1 && expected[i].trigno != trig) continue;
+            if(tfrom != LOG_TNONE && !inrange(log_tod(&expected[i]), tfrom, tto)) continue;
+            break;
+        }
+        if(i >= Nexp || number != (uint32_t)i || !sameevent(l, &expected[i])) ++bad;
+        else ++found;
+        ++i;
+    }
+    for(; i < Nexp; ++i){ // missed
+        if(i == damaged) continue;
+        if(trig > -1 && expected[i].trigno != trig) continue;
+        if(tfrom != LOG_TNONE && !inrange(log_tod(&expected[i]), tfrom, tto)) continue;
+        ++bad;
+    }
+    printf("%-20s %d records, %u of %u pages read: %s\n", name, found, f.scanned, logNpages, bad ? "FAILED" : "OK");
+    return !!bad;
+}
+
+/**
+ * @brief logtest - run events log store test and print report
+ * @param N - amount of records to store
+ * @return 0 if all OK
+ */
+int logtest(int N){
+    int ret = 0, failed = 0;
+    sim_fixedstep = 1;
+    SysTick_Config(SYSTICK_DEFCONF);
+    flashstorage_init();
+    the_conf.NLfreeWarn = 0;
+    the_conf.defflags |= FLAG_GPSPROXY; // USARTs aren't set up: messages only to USB (not connected)
+    printf("Log store test:      %d records, %u pages x %u records (%u max)\n",
+           N, logNpages, (unsigned)LOGS_PER_PAGE, maxLnum);
+    if(!maxLnum) return 1;
+    expected = calloc(N, sizeof(event_log));
+    if(!expected) return 1;
+    // midnight is in the middle of data kept
+    int kept = (N < (int)maxLnum) ? N : (int)maxLnum;
+    uint32_t T0 = (uint32_t)((2 * DAYSEC - (N - kept / 2) * EVT_PERIOD % DAYSEC) % DAYSEC);
+    uint64_t t0 = sim_clock;
+    for(Nexp = 0; Nexp < N; ++Nexp){
+        event_log l;
+        mkevent(&l, Nexp, T0);
+        expected[Nexp] = l;
+        if(store_log(&l)) ++failed;
+    }
+    printf("Stored:              %d records for %.1f s of MCU time, failed: %d\n",
+           N, SIM_CLK2US(sim_clock - t0) / 1e6, failed);
+    ret |= failed;
+    // restart: index is built by flash scan
+    uint32_t amount = log_amount();
+    flashstorage_init();
+    firstkept = N - (int)log_amount();
+    printf("After restart:       %u records (%u before), first is #%d, bad CRC: %u\n",
+           log_amount(), amount, firstkept, log_badrec);
+    if(amount != log_amount() || log_badrec) ret = 1;
+    ret |= query("Full dump:", LOG_TNONE, 0, -1);
+    ret |= query("23:50:00-00:10:00:", 23*3600 + 50*60, 10*60, -1);
+    ret |= query("23:00:00-23:30:00/1:", 23*3600, 23*3600 + 30*60, 1);
+    ret |= query("00:20:00-00:40:00:", 20*60, 40*60, -1);
+    ret |= query("12:00:00-13:00:00:", 12*3600, 13*3600, -1);
+    ret |= query("Trigger 3:", LOG_TNONE, 0, 3);
+    // damage one record in the middle of data kept & restart
+    damaged = firstkept + kept / 3;
+    uint32_t seq = (uint32_t)damaged / LOGS_PER_PAGE + 1, page = (seq - 1) % logNpages;
+    uint32_t addr = (uint32_t)logsstart + page * FLASH_BLOCK_SIZE + sizeof(logpage_hdr) +
+                    (damaged % LOGS_PER_PAGE) * sizeof(event_log) + 4;
+    while(*(uint8_t*)addr == 0) ++addr; // the first non-zero byte after CRC
+    uint8_t b = *(uint8_t*)addr;
+    sim_flash_damage(addr, b & -b);
+    flashstorage_init();
+    printf("Damaged record #%d:  bad CRC after restart: %u\n", damaged, log_badrec);
+    if(log_badrec != 1) ret = 1;
+    ret |= query("Full dump:", LOG_TNONE, 0, -1);
+    // wear leveling
+    uint32_t first = ((uint32_t)logsstart - FLASH_BASE) / FLASH_BLOCK_SIZE, emin = UINT32_MAX, emax = 0;
+    for(uint32_t p = first; p < first + logNpages; ++p){
+        if(sim_flash_erases[p] < emin) emin = sim_flash_erases[p];
+        if(sim_flash_erases[p] > emax) emax = sim_flash_erases[p];
+    }
+    printf("Page erases:         min %u, max %u\n", emin, emax);
+    printf("Log store test %s\n", ret ? "FAILED" : "passed");
+    free(expected);
+    return ret;
+}
@@ -0,0 +1,163 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Host simulator of chronometer firmware: runs firmware main() over simulated
+// registers and replays recorded or synthetic streams of events
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "bench.h"
+#include "clocktest.h"
+#include "logtest.h"
+#include "regs.h"
+#include "replay.h"
+
+int chrono_main();
+
+static void usage(const char *self){
+    printf("Usage: %s [options]\n"
+           "\t-r file\treplay events from file\n"
+           "\t-S sec\tsynthetic streams of given duration (default: 10s if no -r)\n"
+           "\t-l Hz\tLIDAR frames rate for synthetic streams (default: 100)\n"
+           "\t-p ms\tperiod of trigger pulses for synthetic streams (default: 1500, 0 - off)\n"
+           "\t-s sec\tstress test: back-to-back data over all USARTs\n"
+           "\t-b baud\tspeed of data sent to USARTs (default: as configured; 115200 for stress test)\n"
+           "\t-t sec\tsimulation time (default: last event + 1s)\n"
+           "\t-k N\thost to MCU slowdown factor (default: %g)\n"
+           "\t-d N\tdeterministic mode: N MCU clocks per register access\n"
+           "\t-o file\tsave USART1 output to file\n"
+           "\t-m mode\tUSARTs receive mode: irq (each byte interrupt) or dma\n"
+           "\t-C\tcompare interrupts load in both receive modes\n"
+           "\t-P hours\tclock discipline test (only interrupts are running)\n"
+           "\t-j us\tPPS jitter for clock test (RMS, default: 0.1)\n"
+           "\t-y ppm\toscillator frequency error for clock test (default: 20)\n"
+           "\t-w ppm\tamplitude of oscillator frequency wander for clock test (default: 1)\n"
+           "\t-g sec\tPPS loss in the middle of clock test (default: 300)\n"
+           "\t-L N\tevents log store test: store N records over simulated flash\n", self, sim_slowdown);
+    exit(1);
+}
+
+// run simulation in child process with given receive mode
+static int runmode(int mode, benchresult *r){
+    int fd[2];
+    if(pipe(fd)) return 1;
+    printf("\n===== Receive mode: %s =====\n", mode ? "circular DMA" : "RXNE interrupts");
+    fflush(stdout);
+    pid_t pid = fork();
+    if(pid < 0) return 1;
+    if(pid == 0){
+        close(fd[0]);
+        bench_rxmode = mode;
+        bench_resultfd = fd[1];
+        return -1;
+    }
+    close(fd[1]);
+    int ok = (read(fd[0], r, sizeof(benchresult)) == sizeof(benchresult));
+    close(fd[0]);
+    waitpid(pid, NULL, 0);
+    return !ok;
+}
+
+// percent of time spent in interrupts
+static double isrload(const benchresult *r){
+    return r->clocks ? 100. * r->isrclocks / r->clocks : 0.;
+}
+
+int main(int argc, char **argv){
+    const char *rname = NULL;
+    double synth = 0., stress = 0., lidar_hz = 100., trig_period = 1500., simtime = 0.;
+    double clkhours = 0., jitter = 0.1, ppm = 20., wander = 1., gap = 300.;
+    int opt, compare = 0, logrecs = 0;
+    while((opt = getopt(argc, argv, "r:S:s:b:l:p:t:k:d:o:m:CP:j:y:w:g:L:h")) != -1){
+        switch(opt){
+            case 'r': rname = optarg; break;
+            case 'S': synth = atof(optarg); break;
+            case 's': stress = atof(optarg); break;
+            case 'b': sim_rxbaud = (uint32_t)atoi(optarg); break;
+            case 'l': lidar_hz = atof(optarg); break;
+            case 'p': trig_period = atof(optarg); break;
+            case 't': simtime = atof(optarg); break;
+            case 'k': sim_slowdown = atof(optarg); break;
+            case 'd': sim_fixedstep = (uint32_t)atoi(optarg); break;
+            case 'o':
+                bench_usart1out = fopen(optarg, "w");
+                if(!bench_usart1out){
+                    perror(optarg);
+                    return 1;
+                }
+            break;
+            case 'm':
+                if(!strcmp(optarg, "irq")) bench_rxmode = 0;
+                else if(!strcmp(optarg, "dma")) bench_rxmode = 1;
+                else usage(argv[0]);
+            break;
+            case 'C': compare = 1; break;
+            case 'P': clkhours = atof(optarg); break;
+            case 'j': jitter = atof(optarg); break;
+            case 'y': ppm = atof(optarg); break;
+            case 'w': wander = atof(optarg); break;
+            case 'g': gap = atof(optarg); break;
+            case 'L': logrecs = atoi(optarg); break;
+            default: usage(argv[0]);
+        }
+    }
+    if(logrecs > 0){
+        if(regs_init()) return 1;
+        return logtest(logrecs);
+    }
+    if(clkhours > 0.){
+        if(regs_init()) return 1;
+        return clocktest(clkhours, jitter, ppm, wander, gap);
+    }
+    if(!rname && synth <= 0. && stress <= 0.) synth = 10.;
+    if(compare){
+        benchresult r[2];
+        int ret = 0;
+        for(int mode = 0; mode < 2 && ret >= 0; ++mode){
+            ret = runmode(mode, &r[mode]);
+            if(ret > 0) return 1;
+        }
+        if(ret == 0){ // parent
+            double l0 = isrload(&r[0]), l1 = isrload(&r[1]);
+            printf("\nInterrupts load: %.2f%% (RXNE) -> %.2f%% (DMA), CPU time saved: %.2f%%", l0, l1, l0 - l1);
+            if(l0 > 0.) printf(" (%.1f%% of interrupts time)", 100. * (l0 - l1) / l0);
+            printf("\nMain loop: %.0f -> %.0f iterations per second\n",
+                   r[0].clocks ? r[0].loops * (double)SIM_CPUFREQ / r[0].clocks : 0.,
+                   r[1].clocks ? r[1].loops * (double)SIM_CPUFREQ / r[1].clocks : 0.);
+            return 0;
+        }
+    }
+    if(regs_init()) return 1;
+    if(rname && replay_load(rname)) return 1;
+    if(synth > 0.) replay_synth(synth, lidar_hz, trig_period);
+    if(stress > 0.){
+        if(!sim_rxbaud) sim_rxbaud = 115200;
+        replay_stress(stress, sim_rxbaud);
+    }
+    replay_sort();
+    sim_drivepin(0, 1, 0, 0); // PPS is low
+    if(simtime > 0.) sim_endtime = SIM_MS2CLK(simtime * 1000.);
+    else sim_endtime = replay_lasttime() + SIM_MS2CLK(1000);
+    bench_start();
+    chrono_main();
+    bench_finish("firmware main() returned");
+}
@@ -0,0 +1,711 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Simulated register layer: memory at real peripheral addresses,
+// models of GPIO/EXTI, USART, DMA1, SysTick, TIM2, FLASH and IWDG
+// and scheduler which fires "interrupts" in time order
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+
+#include <stm32f1.h>
+#include "bench.h"
+#include "regs.h"
+#include "replay.h"
+
+uint64_t sim_clock = 0;
+uint64_t sim_isrclocks = 0;
+double sim_slowdown = 40.;
+uint32_t sim_fixedstep = 0;
+uint64_t sim_endtime = SIM_NEVER;
+uint32_t sim_rxbaud = 0;
+
+static double fclock = 0.;      // sim_clock with fractional part
+static uint64_t lasthost = 0;   // host time of last sim_advance()
+static int isr_active = 0;      // >0 inside interrupt handler
+static uint32_t irq_masked = 0; // PRIMASK
+
+typedef struct{
+    uintptr_t base;
+    size_t size;
+} memregion;
+
+static const memregion regions[] = {
+     {FLASH_BASE, SIM_FLASH_SIZE}   // main flash memory
+    ,{0x1FFFF000, 0x1000}           // system memory: flash size register
+    ,{PERIPH_BASE, 0x30000}         // APB1, APB2 & AHB (DMA, RCC, FLASH interface)
+    ,{SCS_BASE, 0x1000}             // SysTick, NVIC, SCB
+};
+
+static uint8_t flshadow[SIM_FLASH_SIZE]; // last programmed flash contents
+
+// `interrupt` handlers; they are weak, so NULL if firmware don't use them
+static void (*const usartisr[4])(void) = {NULL, usart1_isr, usart2_isr, usart3_isr};
+static void (*const dmaisr[8])(void) = {NULL, dma1_channel1_isr, dma1_channel2_isr,
+    dma1_channel3_isr, dma1_channel4_isr, dma1_channel5_isr, dma1_channel6_isr, dma1_channel7_isr};
+static USART_TypeDef *const usarts[4] = {NULL, USART1, USART2, USART3};
+static DMA_Channel_TypeDef *const dmach[8] = {NULL, DMA1_Channel1, DMA1_Channel2, DMA1_Channel3,
+    DMA1_Channel4, DMA1_Channel5, DMA1_Channel6, DMA1_Channel7};
+static GPIO_TypeDef *const gpios[3] = {GPIOA, GPIOB, GPIOC};
+
+static uint64_t hostns(){
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000ULL + (uint64_t)t.tv_nsec;
+}
+
+/**
+ * @brief regs_init - map "register file" and fill it with reset values
+ * @return 0 if all OK
+ */
+int regs_init(){
+    for(size_t i = 0; i < sizeof(regions)/sizeof(memregion); ++i){
+        void *p = mmap((void*)regions[i].base, regions[i].size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+        if(p != (void*)regions[i].base){
+            fprintf(stderr, "Can't map region @0x%08lx\n", (unsigned long)regions[i].base);
+            return 1;
+        }
+    }
+    if((uintptr_t)flshadow > UINT32_MAX){
+        fprintf(stderr, "Build without PIE: firmware keeps pointers in 32-bit registers\n");
+        return 1;
+    }
+    // erased flash
+    memset((void*)FLASH_BASE, 0xff, SIM_FLASH_SIZE);
+    memset(flshadow, 0xff, SIM_FLASH_SIZE);
+    *((uint16_t*)0x1FFFF7E0) = SIM_FLASH_SIZE / 1024;
+    // reset values & ready flags which firmware polls in loops
+    RCC->CR = RCC_CR_HSIRDY | RCC_CR_HSERDY | RCC_CR_PLLRDY;
+    RCC->CSR = RCC_CSR_LSIRDY;
+    ((FLASH_TypeDef*)FLASH_R_BASE)->CR = FLASH_CR_LOCK;
+    for(int i = 1; i < 4; ++i) usarts[i]->SR = USART_SR_TC | USART_SR_TXE;
+    for(int i = 0; i < 3; ++i){
+        gpios[i]->CRL = gpios[i]->CRH = 0x44444444; // floating inputs
+    }
+    lasthost = hostns();
+    return 0;
+}
+
+/**
+ * @brief sim_advance - advance simulated time by host time elapsed since previous call
+ */
+void sim_advance(){
+    if(sim_fixedstep){
+        sim_clock += sim_fixedstep;
+        fclock = (double)sim_clock;
+        return;
+    }
+    uint64_t t = hostns();
+    fclock += (double)(t - lasthost) * sim_slowdown * (SIM_CPUFREQ / 1e9);
+    sim_clock = (uint64_t)fclock;
+    lasthost = t;
+}
+
+// add fixed time (e.g. flash programming) to simulated time
+static void sim_addclocks(uint64_t c){
+    sim_clock += c;
+    fclock += (double)c;
+}
+
+void sim_irqmask(uint32_t mask){
+    irq_masked = mask;
+    if(!mask) sim_poll(); // fire pending events
+}
+
+uint32_t sim_getirqmask(){
+    return irq_masked;
+}
+
+// NVIC isn't emulated (CMSIS writes ISER/ICER as w1s/w1c), so interrupt fires
+// if it allowed in peripheral
+static void call_isr(void (*isr)(void)){
+    if(!isr) return;
+    uint64_t t0 = sim_clock;
+    if(!sim_fixedstep) lasthost = hostns(); // don't count simulator overhead
+    ++isr_active;
+    isr();
+    --isr_active;
+    sim_advance();
+    sim_isrclocks += sim_clock - t0;
+}
+
+void sim_dsb(){
+    if(SCB->AIRCR & SCB_AIRCR_SYSRESETREQ_Msk) bench_finish("software reset");
+}
+
+static void tim_capture(int rising, uint64_t t);
+
+/******************************** GPIO & EXTI ********************************/
+static uint16_t drvmask[3], drvlevel[3]; // pins driven by simulator (outer world)
+
+static void gpio_sync(){
+    for(int i = 0; i < 3; ++i){
+        GPIO_TypeDef *G = gpios[i];
+        uint32_t odr = G->ODR;
+        if(G->BRR){
+            odr &= ~G->BRR;
+            G->BRR = 0;
+        }
+        if(G->BSRR){ // set has priority over reset
+            odr = (odr & ~(G->BSRR >> 16)) | (G->BSRR & 0xffff);
+            G->BSRR = 0;
+        }
+        G->ODR = odr;
+        uint32_t outmask = 0;
+        for(int pin = 0; pin < 16; ++pin){
+            uint32_t cr = (pin < 8) ? G->CRL >> (4*pin) : G->CRH >> (4*(pin-8));
+            if(cr & 3) outmask |= 1 << pin; // MODE != 0 -> output
+        }
+        // inputs without external driver are pulled up/down by ODR
+        uint32_t in = (drvlevel[i] & drvmask[i]) | (odr & ~drvmask[i]);
+        G->IDR = ((odr & outmask) | (in & ~outmask)) & 0xffff;
+    }
+}
+
+static void exti_edge(int port, int pin, int rising){
+    uint32_t bit = 1 << pin;
+    if((int)((AFIO->EXTICR[pin >> 2] >> (4*(pin & 3))) & 0xf) != port) return;
+    if(!(EXTI->IMR & bit)) return;
+    if(!((rising ? EXTI->RTSR : EXTI->FTSR) & bit)) return;
+    EXTI->PR = bit;
+    void (*isr)(void);
+    if(pin < 5){
+        void (*const lowisr[5])(void) = {exti0_isr, exti1_isr, exti2_isr, exti3_isr, exti4_isr};
+        isr = lowisr[pin];
+    }else if(pin < 10) isr = exti9_5_isr;
+    else isr = exti15_10_isr;
+    call_isr(isr);
+    EXTI->PR = 0;
+}
+
+/**
+ * @brief sim_drivepin - set level of input pin by outer device
+ * @param port - 0..2 for GPIOA..GPIOC
+ * @param pin - 0..15
+ * @param level - 0/1 or -1 to release pin (it will be pulled up/down)
+ * @param t - time of level changing (for timer input capture)
+ */
+void sim_drivepin(int port, int pin, int level, uint64_t t){
+    if(port < 0 || port > 2 || pin < 0 || pin > 15) return;
+    uint16_t bit = (uint16_t)(1 << pin);
+    gpio_sync();
+    uint32_t old = gpios[port]->IDR & bit;
+    if(level < 0) drvmask[port] &= ~bit;
+    else{
+        drvmask[port] |= bit;
+        if(level) drvlevel[port] |= bit;
+        else drvlevel[port] &= ~bit;
+    }
+    gpio_sync();
+    uint32_t new = gpios[port]->IDR & bit;
+    if(old == new) return;
+    if(port == 0 && pin == 1) tim_capture(new ? 1 : 0, t); // PA1 - TIM2_CH2
+    exti_edge(port, pin, new ? 1 : 0);
+}
+
+/******************************** USART & DMA ********************************/
+typedef struct rxchunk{
+    struct rxchunk *next;
+    uint8_t *data;
+    int len, pos;
+    uint64_t start;     // data can't be sent earlier
+    void *tag;          // replay_delivered() argument
+} rxchunk;
+
+static struct{
+    rxchunk *head, *tail;
+    uint64_t next;      // time of next byte reception
+    uint64_t free;      // time when line will be free
+    int idlepend;       // IDLE flag should be set at `idle`
+    uint64_t idle;
+} rxq[4];
+
+static struct{
+    int busy;
+    uint64_t end;       // end of transfer
+    int en;             // Rx channel is enabled
+    uint32_t reload;    // its initial CNDTR
+} dmastate[8];
+
+static const uint32_t defspeed[4] = {0, 115200, 9600, 115200};
+
+// current USART speed (baud)
+uint32_t sim_usart_speed(int n){
+    if(n < 1 || n > 3) return 0;
+    uint32_t brr = usarts[n]->BRR;
+    if(!brr) return defspeed[n];
+    // USART1 is on APB2 (72MHz), USART2/3 - on APB1 (36MHz)
+    return (uint32_t)((n == 1 ? SIM_CPUFREQ : SIM_CPUFREQ/2) / brr);
+}
+
+// byte transmission time (1 start, 8 data, 1 stop bits), CPU clocks
+static uint64_t byteclocks(int n){
+    return 10ULL * SIM_CPUFREQ / sim_usart_speed(n);
+}
+
+// the same for receiver: sender speed could be forced
+static uint64_t rxbyteclocks(int n){
+    if(sim_rxbaud) return 10ULL * SIM_CPUFREQ / sim_rxbaud;
+    return byteclocks(n);
+}
+
+/**
+ * @brief sim_usart_rx - put data to USART receiver queue
+ * @param n - USART number
+ * @param data, len - data to send (copied)
+ * @param t - time of transmission start (if line is free)
+ * @param tag - replay_delivered() argument after last byte received
+ */
+void sim_usart_rx(int n, const uint8_t *data, int len, uint64_t t, void *tag){
+    if(n < 1 || n > 3 || len < 1) return;
+    rxchunk *c = malloc(sizeof(rxchunk));
+    c->data = malloc(len);
+    memcpy(c->data, data, len);
+    c->len = len;
+    c->pos = 0;
+    c->start = t;
+    c->tag = tag;
+    c->next = NULL;
+    if(rxq[n].tail){
+        rxq[n].tail->next = c;
+    }else{
+        rxq[n].head = c;
+        rxq[n].next = ((t > rxq[n].free) ? t : rxq[n].free) + rxbyteclocks(n);
+    }
+    rxq[n].tail = c;
+}
+
+static int usart_byaddr(uint32_t addr);
+static void dma_sync();
+
+// Rx DMA channel of USART n or 0
+static int dma_rxchannel(int n){
+    for(int ch = 1; ch < 8; ++ch){
+        DMA_Channel_TypeDef *C = dmach[ch];
+        if((C->CCR & DMA_CCR_EN) && !(C->CCR & DMA_CCR_DIR) && usart_byaddr(C->CPAR) == n) return ch;
+    }
+    return 0;
+}
+
+// DMA takes received byte
+static void dma_rxbyte(int ch, uint8_t b){
+    DMA_Channel_TypeDef *C = dmach[ch];
+    uint32_t flags = 0;
+    ((uint8_t*)(uintptr_t)C->CMAR)[dmastate[ch].reload - C->CNDTR] = b;
+    if(--C->CNDTR == dmastate[ch].reload / 2){
+        flags = DMA_ISR_HTIF1;
+        if(!(C->CCR & DMA_CCR_HTIE)) flags = 0;
+    }else if(!C->CNDTR){
+        flags = DMA_ISR_TCIF1;
+        if(!(C->CCR & DMA_CCR_TCIE)) flags = 0;
+        if(C->CCR & DMA_CCR_CIRC) C->CNDTR = dmastate[ch].reload;
+    }
+    if(!flags) return;
+    DMA1->ISR |= (DMA_ISR_GIF1 | flags) << (4*(ch-1));
+    call_isr(dmaisr[ch]);
+    DMA1->ISR &= ~DMA1->IFCR;
+    DMA1->IFCR = 0;
+}
+
+static void usart_rxbyte(int n, uint8_t b){
+    USART_TypeDef *U = usarts[n];
+    if((U->CR1 & (USART_CR1_UE | USART_CR1_RE)) != (USART_CR1_UE | USART_CR1_RE)){
+        bench_rxlost(n); // receiver is off
+        return;
+    }
+    rxq[n].idlepend = 1;
+    rxq[n].idle = rxq[n].next + byteclocks(n);
+    if(U->CR3 & USART_CR3_DMAR){
+        dma_sync();
+        int ch = dma_rxchannel(n);
+        if(ch && dmach[ch]->CNDTR){
+            dma_rxbyte(ch, b);
+            return;
+        }
+    }
+    if(U->SR & USART_SR_RXNE){ // previous byte wasn't read
+        U->SR |= USART_SR_ORE;
+        bench_rxlost(n);
+    }
+    U->DR = b;
+    U->SR |= USART_SR_RXNE;
+    if(U->CR1 & USART_CR1_RXNEIE){
+        call_isr(usartisr[n]);
+        U->SR &= ~(USART_SR_RXNE | USART_SR_ORE); // DR was read
+    }
+}
+
+// line was idle during one frame
+static void usart_idle(int n){
+    USART_TypeDef *U = usarts[n];
+    rxq[n].idlepend = 0;
+    if(!(U->CR1 & USART_CR1_IDLEIE)) return;
+    U->SR |= USART_SR_IDLE;
+    call_isr(usartisr[n]);
+    U->SR &= ~USART_SR_IDLE; // SR & DR were read
+}
+
+static void usart_rxnext(int n){
+    rxchunk *c = rxq[n].head;
+    uint64_t t = rxq[n].next;
+    usart_rxbyte(n, c->data[c->pos++]);
+    if(c->pos < c->len){
+        rxq[n].next = t + rxbyteclocks(n);
+        return;
+    }
+    rxq[n].free = t;
+    rxq[n].head = c->next;
+    if(!c->next) rxq[n].tail = NULL;
+    else rxq[n].next = ((c->next->start > t) ? c->next->start : t) + rxbyteclocks(n);
+    replay_delivered(c->tag, t);
+    free(c->data);
+    free(c);
+}
+
+// USART number by DMA peripheral address or 0
+static int usart_byaddr(uint32_t addr){
+    for(int i = 1; i < 4; ++i)
+        if(addr == (uint32_t)(uintptr_t)&usarts[i]->DR) return i;
+    return 0;
+}
+
+// start new DMA transfers
+static void dma_sync(){
+    for(int ch = 1; ch < 8; ++ch){
+        DMA_Channel_TypeDef *C = dmach[ch];
+        if(!(C->CCR & DMA_CCR_DIR) && usart_byaddr(C->CPAR)){ // Rx channels: remember CNDTR
+            if(!(C->CCR & DMA_CCR_EN)) dmastate[ch].en = 0;
+            else if(!dmastate[ch].en){
+                dmastate[ch].en = 1;
+                dmastate[ch].reload = C->CNDTR;
+            }
+            continue;
+        }
+        if(!(C->CCR & DMA_CCR_EN) || !C->CNDTR || dmastate[ch].busy) continue;
+        dmastate[ch].busy = 1;
+        dmastate[ch].end = sim_clock;
+        if(C->CPAR == (uint32_t)(uintptr_t)&ADC1->DR){ // fill ADC values once: Tsens & Vref
+            uint16_t *buf = (uint16_t*)(uintptr_t)C->CMAR;
+            for(uint32_t i = 0; i < C->CNDTR; ++i) buf[i] = (i & 1) ? 1490 : 1750;
+            dmastate[ch].end = SIM_NEVER; // circular
+            continue;
+        }
+        int n = usart_byaddr(C->CPAR);
+        if(!n) continue;
+        bench_tx(n, (const uint8_t*)(uintptr_t)C->CMAR, (int)C->CNDTR);
+        dmastate[ch].end = sim_clock + C->CNDTR * byteclocks(n);
+    }
+}
+
+static void dma_complete(int ch){
+    DMA_Channel_TypeDef *C = dmach[ch];
+    dmastate[ch].busy = 0;
+    C->CNDTR = 0;
+    DMA1->ISR |= (DMA_ISR_GIF1 | DMA_ISR_TCIF1) << (4*(ch-1));
+    if(C->CCR & DMA_CCR_TCIE) call_isr(dmaisr[ch]);
+    DMA1->ISR &= ~DMA1->IFCR;
+    DMA1->IFCR = 0;
+}
+
+/********************************** SysTick **********************************/
+static uint64_t st_next = SIM_NEVER;
+static uint32_t st_val = 0;
+static int st_on = 0;
+
+static void systick_sync(){
+    if(!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk)){
+        st_on = 0;
+        st_next = SIM_NEVER;
+        return;
+    }
+    uint64_t period = (SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+    if(!st_on || SysTick->VAL != st_val){ // just started or VAL was written
+        st_on = 1;
+        st_next = sim_clock + period;
+    }
+    uint64_t rest = (st_next > sim_clock) ? st_next - sim_clock : 1;
+    if(rest > period) rest = period;
+    st_val = (uint32_t)(rest - 1);
+    SysTick->VAL = st_val;
+}
+
+static void systick_fire(){
+    st_next += (SysTick->LOAD & SysTick_LOAD_RELOAD_Msk) + 1;
+    st_val = 0;
+    SysTick->VAL = 0;
+    if(SysTick->CTRL & SysTick_CTRL_TICKINT_Msk) call_isr(sys_tick_handler);
+}
+
+/*********************************** TIM2 ************************************/
+// free running upcounter with input capture on CH2; CNT is calculated on each access
+#define TIM2R   ((TIM_TypeDef*)TIM2_BASE)
+static uint64_t tim_base = 0;           // time when CNT was zero
+static uint64_t tim_next = SIM_NEVER;   // next overflow
+static uint32_t tim_div = 1;            // PSC+1 loaded by update event
+static uint16_t tim_sr = 0;
+static int tim_on = 0;
+
+static uint16_t tim_cnt(uint64_t t){
+    return (uint16_t)(((t - tim_base) / tim_div) % ((uint32_t)TIM2R->ARR + 1));
+}
+
+static void tim_sync(){
+    TIM_TypeDef *T = TIM2R;
+    tim_sr &= T->SR; // rc_w0: firmware writes zeros to clear flags
+    if(T->EGR & TIM_EGR_UG){ // reinit counter & load prescaler
+        T->EGR = 0;
+        T->CNT = 0;
+        tim_div = (uint32_t)T->PSC + 1;
+        tim_sr |= TIM_SR_UIF;
+        tim_on = 0;
+    }
+    if(!(T->CR1 & TIM_CR1_CEN)){
+        tim_on = 0;
+        tim_next = SIM_NEVER;
+        T->SR = tim_sr;
+        return;
+    }
+    uint64_t period = (uint64_t)tim_div * ((uint32_t)T->ARR + 1);
+    if(!tim_on){ // just started: continue from current CNT
+        tim_on = 1;
+        tim_base = sim_clock - (uint64_t)T->CNT * tim_div;
+        tim_next = tim_base + period;
+    }
+    // UIF is set right at overflow, interrupt will be called by scheduler
+    while(tim_next <= sim_clock){
+        tim_sr |= TIM_SR_UIF;
+        tim_base = tim_next;
+        tim_next += period;
+    }
+    T->CNT = tim_cnt(sim_clock);
+    T->SR = tim_sr;
+}
+
+// time of pending interrupt or next overflow
+static uint64_t tim_nexttime(){
+    if(!tim2_isr) return SIM_NEVER;
+    uint32_t irq = TIM2R->DIER & (TIM_DIER_UIE | TIM_DIER_CC1IE | TIM_DIER_CC2IE | TIM_DIER_CC3IE | TIM_DIER_CC4IE);
+    if(tim_sr & irq) return sim_clock;
+    return (irq & TIM_DIER_UIE) ? tim_next : SIM_NEVER;
+}
+
+static void tim_fire(){
+    tim_sync();
+    call_isr(tim2_isr);
+    tim_sync();
+}
+
+// PA1 edge at time t: capture counter by CH2 if it is configured as TI2 input
+static void tim_capture(int rising, uint64_t t){
+    TIM_TypeDef *T = TIM2R;
+    tim_sync();
+    if(!tim_on || t < tim_base) t = sim_clock;
+    if((T->CCMR1 & TIM_CCMR1_CC2S) != TIM_CCMR1_CC2S_0 || !(T->CCER & TIM_CCER_CC2E)) return;
+    if(rising == ((T->CCER & TIM_CCER_CC2P) ? 1 : 0)) return; // CC2P=1 - falling edge
+    if(tim_sr & TIM_SR_CC2IF) tim_sr |= TIM_SR_CC2OF;
+    tim_sr |= TIM_SR_CC2IF;
+    T->CCR2 = tim_on ? tim_cnt(t) : T->CNT;
+    T->SR = tim_sr;
+}
+
+TIM_TypeDef *sim_tim2(){
+    sim_advance();
+    tim_sync();
+    return TIM2R;
+}
+
+/******************************** FLASH & IWDG *******************************/
+// written w1c value doesn't contain this reserved bit
+#define FLASH_SR_SENTINEL   (1UL << 31)
+#define FLASH_SR_W1C        (FLASH_SR_EOP | FLASH_SR_PGERR | FLASH_SR_WRPRTERR)
+static uint32_t fl_sr = 0;
+uint32_t sim_flash_erases[SIM_FLASH_SIZE / SIM_FLASH_PAGE];
+
+// flash cell failure: clear bits `mask` in byte @ address `addr`
+void sim_flash_damage(uint32_t addr, uint8_t mask){
+    addr -= FLASH_BASE;
+    if(addr >= SIM_FLASH_SIZE) return;
+    ((uint8_t*)FLASH_BASE)[addr] &= ~mask;
+    flshadow[addr] &= ~mask;
+}
+
+// check what was written into flash after previous access
+static void flash_program(){
+    const uint16_t *mem = (const uint16_t*)FLASH_BASE;
+    uint16_t *shadow = (uint16_t*)flshadow;
+    if(!memcmp(mem, shadow, SIM_FLASH_SIZE)) return;
+    for(int i = 0; i < SIM_FLASH_SIZE/2; ++i){
+        if(mem[i] == shadow[i]) continue;
+        if(shadow[i] == 0xffff || mem[i] == 0){
+            shadow[i] = mem[i];
+            fl_sr |= FLASH_SR_EOP;
+        }else{ // can't write not erased cell
+            ((uint16_t*)FLASH_BASE)[i] = shadow[i];
+            fl_sr |= FLASH_SR_PGERR;
+        }
+        sim_addclocks(SIM_FLASH_TPROG);
+    }
+}
+
+FLASH_TypeDef *sim_flash(){
+    FLASH_TypeDef *F = (FLASH_TypeDef*)FLASH_R_BASE;
+    if(!(F->SR & FLASH_SR_SENTINEL)) fl_sr &= ~(F->SR & FLASH_SR_W1C);
+    else if(F->SR != (fl_sr | FLASH_SR_SENTINEL)) fl_sr &= ~(F->SR & FLASH_SR_W1C); // SR |= x
+    if(F->KEYR == FLASH_KEY2){
+        F->CR &= ~FLASH_CR_LOCK;
+        F->KEYR = 0;
+    }
+    uint32_t cr = F->CR;
+    if(!(cr & FLASH_CR_LOCK)){
+        if((cr & (FLASH_CR_PER | FLASH_CR_STRT)) == (FLASH_CR_PER | FLASH_CR_STRT)){
+            uint32_t addr = F->AR - FLASH_BASE;
+            if(addr < SIM_FLASH_SIZE){
+                addr &= ~(SIM_FLASH_PAGE - 1);
+                memset((uint8_t*)FLASH_BASE + addr, 0xff, SIM_FLASH_PAGE);
+                memset(flshadow + addr, 0xff, SIM_FLASH_PAGE);
+                ++sim_flash_erases[addr / SIM_FLASH_PAGE];
+                sim_addclocks(SIM_FLASH_TERASE);
+            }
+            F->CR &= ~FLASH_CR_STRT;
+            fl_sr |= FLASH_SR_EOP;
+        }
+        if(cr & FLASH_CR_PG) flash_program();
+    }
+    F->SR = fl_sr | FLASH_SR_SENTINEL;
+    return F;
+}
+
+static int wdg_on = 0;
+static uint64_t wdg_last = 0;
+
+IWDG_TypeDef *sim_iwdg(){
+    IWDG_TypeDef *I = (IWDG_TypeDef*)IWDG_BASE;
+    switch(I->KR){
+        case IWDG_START:
+            wdg_on = 1;
+            // fall through
+        case IWDG_REFRESH:
+            wdg_last = sim_clock;
+        break;
+    }
+    I->KR = 0;
+    sim_poll();
+    return I;
+}
+
+// watchdog timeout: LSI=40kHz, prescaler=4<<PR, counter=RLR
+static uint64_t wdg_timeout(){
+    IWDG_TypeDef *I = (IWDG_TypeDef*)IWDG_BASE;
+    uint64_t ticks = (4ULL << (I->PR & 7)) * ((I->RLR & 0xfff) + 1);
+    return ticks * SIM_CPUFREQ / 40000;
+}
+
+/********************************* scheduler *********************************/
+typedef enum{EV_NONE, EV_SYSTICK, EV_TIM, EV_REPLAY, EV_RX, EV_IDLE, EV_DMA} evsource;
+
+// find nearest event: return its time, source and index (USART or DMA channel)
+static uint64_t nextevent(evsource *what, int *idx){
+    uint64_t t = SIM_NEVER;
+    *what = EV_NONE;
+    if(st_next < t){ t = st_next; *what = EV_SYSTICK; }
+    uint64_t tt = tim_nexttime();
+    if(tt < t){ t = tt; *what = EV_TIM; }
+    uint64_t r = replay_nexttime();
+    if(r < t){ t = r; *what = EV_REPLAY; }
+    for(int i = 1; i < 4; ++i)
+        if(rxq[i].head && rxq[i].next < t){ t = rxq[i].next; *what = EV_RX; *idx = i; }
+    for(int i = 1; i < 4; ++i)
+        if(rxq[i].idlepend && rxq[i].idle < t){ t = rxq[i].idle; *what = EV_IDLE; *idx = i; }
+    for(int i = 1; i < 8; ++i)
+        if(dmastate[i].busy && dmastate[i].end < t){ t = dmastate[i].end; *what = EV_DMA; *idx = i; }
+    return t;
+}
+
+// update models by registers' contents changed by firmware
+static void sim_sync(){
+    gpio_sync();
+    systick_sync();
+    tim_sync();
+    dma_sync();
+}
+
+/**
+ * @brief sim_poll - advance time and call handlers of all events that are due
+ */
+void sim_poll(){
+    sim_advance();
+    if(isr_active || irq_masked) return;
+    if(sim_clock >= sim_endtime) bench_finish(NULL);
+    if(wdg_on && sim_clock - wdg_last > wdg_timeout()) bench_finish("watchdog reset");
+    while(1){
+        sim_sync();
+        evsource what;
+        int idx = 0;
+        if(nextevent(&what, &idx) > sim_clock) break;
+        switch(what){
+            case EV_SYSTICK:
+                systick_fire();
+            break;
+            case EV_TIM:
+                tim_fire();
+            break;
+            case EV_REPLAY:
+                replay_fire();
+            break;
+            case EV_RX:
+                usart_rxnext(idx);
+            break;
+            case EV_IDLE:
+                usart_idle(idx);
+            break;
+            case EV_DMA:
+                dma_complete(idx);
+            break;
+            default:
+            break;
+        }
+    }
+    if(!sim_fixedstep) lasthost = hostns();
+}
+
+/**
+ * @brief sim_runto - fire all events till time t without firmware main loop
+ * (time jumps from one event to another, each register access takes one clock)
+ * @param t - time to stop at
+ */
+void sim_runto(uint64_t t){
+    uint32_t step = sim_fixedstep;
+    sim_fixedstep = 1;
+    while(sim_clock < t){
+        evsource what;
+        int idx = 0;
+        sim_sync();
+        uint64_t next = nextevent(&what, &idx);
+        if(next > t) next = t;
+        if(next > sim_clock + 1){
+            sim_clock = next - 1; // sim_poll() will add one clock
+            fclock = (double)sim_clock;
+        }
+        sim_poll();
+    }
+    sim_fixedstep = step;
+}
@@ -0,0 +1,62 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef REGS_H__
+#define REGS_H__
+
+#include <stdint.h>
+
+// simulated MCU core clock
+#define SIM_CPUFREQ         (72000000ULL)
+#define SIM_MS2CLK(ms)      ((uint64_t)((ms) * (SIM_CPUFREQ / 1000.)))
+#define SIM_US2CLK(us)      ((uint64_t)((us) * (SIM_CPUFREQ / 1000000.)))
+#define SIM_CLK2US(c)       ((double)(c) / (SIM_CPUFREQ / 1000000.))
+#define SIM_NEVER           (UINT64_MAX)
+
+// simulated flash: 128k, flash size register says the same;
+// __varsstart/__logsstart given to linker should be inside (see Makefile)
+#define SIM_FLASH_SIZE      (128*1024)
+#define SIM_FLASH_PAGE      (1024)
+// typical page erase & halfword programming time (datasheet)
+#define SIM_FLASH_TERASE    SIM_MS2CLK(20)
+#define SIM_FLASH_TPROG     SIM_US2CLK(52.5)
+
+// current simulated time (CPU clocks)
+extern uint64_t sim_clock;
+// time spent in interrupt handlers
+extern uint64_t sim_isrclocks;
+// host->target slowdown (host ns are multiplied by it)
+extern double sim_slowdown;
+// !=0 for deterministic mode: clocks per each register layer access
+extern uint32_t sim_fixedstep;
+// end of simulation
+extern uint64_t sim_endtime;
+// !=0 to force speed of data sent to all USARTs (baud)
+extern uint32_t sim_rxbaud;
+// amount of erasings of each flash page
+extern uint32_t sim_flash_erases[SIM_FLASH_SIZE / SIM_FLASH_PAGE];
+
+int regs_init();
+void sim_advance();
+void sim_runto(uint64_t t);
+void sim_drivepin(int port, int pin, int level, uint64_t t);
+void sim_usart_rx(int n, const uint8_t *data, int len, uint64_t t, void *tag);
+uint32_t sim_usart_speed(int n);
+void sim_flash_damage(uint32_t addr, uint8_t mask);
+
+#endif // REGS_H__
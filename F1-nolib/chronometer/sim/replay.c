@@ -0,0 +1,376 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Recorded or synthetic streams of NMEA, LIDAR frames, console commands & triggers
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "../flash.h"
+#include "../hardware.h"
+#include "../lidar.h"
+#include "regs.h"
+#include "replay.h"
+
+typedef enum{
+     EV_PPS         // arg - level
+    ,EV_TRIG        // arg - trigger number, level - active or not
+    ,EV_RX          // u - data to send
+} evtype;
+
+// line or frame which firmware should parse
+typedef struct{
+    uint8_t port;
+    uint8_t state;      // 0 - waiting, 1 - parsed, 2 - lost
+    int len;            // length of data
+    int cmplen;         // amount of bytes to compare (without "\r\n")
+    uint64_t done;      // time of last byte reception
+    uint8_t *data;
+} unit;
+
+typedef struct{
+    uint64_t t;
+    uint32_t seq;       // for stable sorting
+    evtype type;
+    uint8_t arg;
+    uint8_t level;
+    unit *u;
+} event;
+
+static event *events = NULL;
+static int Nevents = 0, evalloc = 0, evidx = 0;
+
+// units in order of transmission for each USART
+static struct{
+    unit **list;
+    int n, alloc, head;
+} units[4];
+
+streamstat streams[4] = {{0}, {.name = "USART1"}, {.name = "GPS"}, {.name = "LIDAR"}};
+trigstat trigstats = {0};
+
+// digital triggers: PA13, PA14, PA4 (see hardware.c)
+static const uint8_t trigpin[DIGTRIG_AMOUNT] = {13, 14, 4};
+static uint64_t trig_released[DIGTRIG_AMOUNT], trig_shown[DIGTRIG_AMOUNT];
+// time of trigger activation and of PPS before it
+static uint64_t trig_pressed[DIGTRIG_AMOUNT], trig_pps[DIGTRIG_AMOUNT];
+static uint64_t pps_time = SIM_NEVER;
+
+static event *newevent(double ms, evtype type){
+    if(Nevents == evalloc){
+        evalloc += 1024;
+        events = realloc(events, evalloc * sizeof(event));
+    }
+    event *e = &events[Nevents];
+    memset(e, 0, sizeof(event));
+    e->t = SIM_MS2CLK(ms);
+    e->seq = (uint32_t)Nevents++;
+    e->type = type;
+    return e;
+}
+
+static void add_pps(double ms){
+    newevent(ms, EV_PPS)->level = 1;
+    newevent(ms + PPS_PULSE_MS, EV_PPS)->level = 0;
+}
+
+static void add_trig(double ms, int N, double len){
+    if(N < 0 || N >= DIGTRIG_AMOUNT) return;
+    event *e = newevent(ms, EV_TRIG);
+    e->arg = (uint8_t)N;
+    e->level = 1;
+    e = newevent(ms + len, EV_TRIG);
+    e->arg = (uint8_t)N;
+}
+
+static void add_data(double ms, int port, const uint8_t *data, int len, int cmplen){
+    unit *u = calloc(1, sizeof(unit));
+    u->port = (uint8_t)port;
+    u->len = len;
+    u->cmplen = cmplen;
+    u->data = malloc(len);
+    memcpy(u->data, data, len);
+    newevent(ms, EV_RX)->u = u;
+}
+
+// text line, `end` - line ending
+static void add_line(double ms, int port, const char *str, const char *end){
+    char buf[256];
+    int l = snprintf(buf, sizeof(buf) - 3, "%s", str);
+    if(l > (int)sizeof(buf) - 4) l = sizeof(buf) - 4;
+    strcpy(buf + l, end);
+    add_data(ms, port, (uint8_t*)buf, l + (int)strlen(end), l);
+}
+
+// TFmini frame: header, header, dist, strength, mode, reserved, checksum
+static void add_lidar(double ms, uint16_t dist, uint16_t stren){
+    uint8_t frame[LIDAR_FRAME_LEN] = {LIDAR_FRAME_HEADER, LIDAR_FRAME_HEADER,
+        dist & 0xff, dist >> 8, stren & 0xff, stren >> 8, 0, 0, 0};
+    for(int i = 0; i < LIDAR_FRAME_LEN - 1; ++i) frame[LIDAR_FRAME_LEN - 1] += frame[i];
+    add_data(ms, LIDAR_USART, frame, LIDAR_FRAME_LEN, LIDAR_HDR_LEN);
+}
+
+/**
+ * @brief replay_load - load recorded streams
+ * Each line of file is "time_ms event args", events:
+ *  pps                 - PPS pulse
+ *  gps NMEA            - NMEA sentence (without "\r\n")
+ *  usart1 text         - console line
+ *  lidar dist stren    - LIDAR frame
+ *  lidarraw XX XX ...  - raw bytes over LIDAR USART (hex)
+ *  trig N len_ms       - pulse on trigger N
+ * @param name - filename
+ * @return 0 if all OK
+ */
+int replay_load(const char *name){
+    FILE *f = fopen(name, "r");
+    if(!f){
+        perror(name);
+        return 1;
+    }
+    char line[512];
+    int lineno = 0;
+    while(fgets(line, sizeof(line), f)){
+        ++lineno;
+        char *nl = strpbrk(line, "\r\n");
+        if(nl) *nl = 0;
+        if(*line == '#' || !*line) continue;
+        double t;
+        char cmd[16];
+        int pos = 0;
+        if(sscanf(line, "%lf %15s %n", &t, cmd, &pos) < 2){
+            fprintf(stderr, "%s:%d: bad line\n", name, lineno);
+            continue;
+        }
+        char *arg = line + pos;
+        if(!strcmp(cmd, "pps")) add_pps(t);
+        else if(!strcmp(cmd, "gps")) add_line(t, GPS_USART, arg, "\r\n");
+        else if(!strcmp(cmd, "usart1")) add_line(t, 1, arg, "\n");
+        else if(!strcmp(cmd, "lidar")){
+            unsigned d, s;
+            if(sscanf(arg, "%u %u", &d, &s) == 2) add_lidar(t, (uint16_t)d, (uint16_t)s);
+        }else if(!strcmp(cmd, "lidarraw")){
+            uint8_t buf[256];
+            int l = 0, n;
+            unsigned b;
+            while(l < 256 && sscanf(arg, "%x%n", &b, &n) == 1){
+                buf[l++] = (uint8_t)b;
+                arg += n;
+            }
+            if(l) add_data(t, LIDAR_USART, buf, l, (l < LIDAR_HDR_LEN) ? l : LIDAR_HDR_LEN);
+        }else if(!strcmp(cmd, "trig")){
+            int N;
+            double len;
+            if(sscanf(arg, "%d %lf", &N, &len) == 2) add_trig(t, N, len);
+        }else fprintf(stderr, "%s:%d: unknown event '%s'\n", name, lineno, cmd);
+    }
+    fclose(f);
+    return 0;
+}
+
+static void add_rmc(double ms, int sec){
+    char buf[128];
+    int l = snprintf(buf, sizeof(buf), "$GPRMC,%02d%02d%02d.00,A,4340.59415,N,04127.47560,E,0.0,,290615,,,A",
+                     (12 + sec/3600) % 24, (sec/60) % 60, sec % 60);
+    uint8_t cs = 0;
+    for(int i = 1; i < l; ++i) cs ^= (uint8_t)buf[i];
+    snprintf(buf + l, sizeof(buf) - l, "*%02X", cs);
+    add_line(ms, GPS_USART, buf, "\r\n");
+}
+
+/**
+ * @brief replay_synth - generate synthetic traffic: PPS & RMC each second,
+ *      LIDAR frames (object in front of LIDAR for 0.3s each 7s),
+ *      pulses on digital triggers by turns and "time" command each 5s over USART1
+ * @param seconds - duration
+ * @param lidar_hz - LIDAR frames rate (0 - no LIDAR)
+ * @param trig_period - period of triggers' pulses (ms; 0 - no triggers)
+ */
+void replay_synth(double seconds, double lidar_hz, double trig_period){
+    double total = seconds * 1000.;
+    for(int s = 0; s < (int)seconds; ++s){
+        double t = s * 1000.;
+        add_pps(t);
+        add_rmc(t + 60., s);
+        if(s % 5 == 4) add_line(t + 500., 1, "time", "\n");
+    }
+    if(lidar_hz > 0.){
+        double period = 1000. / lidar_hz;
+        for(double t = 0.; t < total; t += period){
+            int phase = (int)t % 7000;
+            add_lidar(t, (phase >= 3000 && phase < 3300) ? 400 : 1500, 300);
+        }
+    }
+    if(trig_period > 0.){
+        int N = 0;
+        for(double t = trig_period; t < total; t += trig_period, ++N)
+            add_trig(t, N % DIGTRIG_AMOUNT, 80.);
+    }
+}
+
+/**
+ * @brief replay_stress - back-to-back traffic: RMC sentences over GPS USART, LIDAR frames
+ *      and bursts of `time` commands over USART1 (their answers are longer, so continuous
+ *      stream of commands would measure TX speed instead of receiver)
+ * @param seconds - duration
+ * @param baud - line speed
+ */
+void replay_stress(double seconds, uint32_t baud){
+    double byte = 10000. / baud; // ms per byte
+    double total = seconds * 1000.;
+    for(int s = 0; s < (int)seconds; ++s) add_pps(s * 1000.);
+    for(double t = 0.; t < total; t += byte * 68.){ // 66 bytes of RMC + gap
+        add_rmc(t, (int)(t / 1000.));
+    }
+    for(double t = 0.; t < total; t += byte * LIDAR_FRAME_LEN){
+        int phase = (int)t % 7000;
+        add_lidar(t, (phase >= 3000 && phase < 3300) ? 400 : 1500, 300);
+    }
+    for(double t = 0.; t < total; t += 100.){
+        for(int i = 0; i < 8; ++i) add_line(t, 1, "time", "\n");
+    }
+}
+
+static int evcmp(const void *a, const void *b){
+    const event *e1 = (const event*)a, *e2 = (const event*)b;
+    if(e1->t != e2->t) return (e1->t < e2->t) ? -1 : 1;
+    return (e1->seq < e2->seq) ? -1 : 1;
+}
+
+// sort events after all are loaded
+void replay_sort(){
+    qsort(events, Nevents, sizeof(event), evcmp);
+}
+
+uint64_t replay_lasttime(){
+    return Nevents ? events[Nevents - 1].t : 0;
+}
+
+uint64_t replay_nexttime(){
+    return (evidx < Nevents) ? events[evidx].t : SIM_NEVER;
+}
+
+void replay_fire(){
+    if(evidx >= Nevents) return;
+    event *e = &events[evidx++];
+    switch(e->type){
+        case EV_PPS:
+            if(e->level) pps_time = e->t;
+            sim_drivepin(0, 1, e->level, e->t);
+        break;
+        case EV_TRIG:
+            if(e->level){
+                ++trigstats.fired;
+                trig_pressed[e->arg] = e->t;
+                trig_pps[e->arg] = pps_time;
+                sim_drivepin(0, trigpin[e->arg], (the_conf.trigstate >> e->arg) & 1, e->t);
+            }else{
+                trig_released[e->arg] = e->t;
+                sim_drivepin(0, trigpin[e->arg], -1, e->t); // pulled up
+            }
+        break;
+        case EV_RX:{
+            unit *u = e->u;
+            int p = u->port;
+            if(units[p].n == units[p].alloc){
+                units[p].alloc += 256;
+                units[p].list = realloc(units[p].list, units[p].alloc * sizeof(unit*));
+            }
+            units[p].list[units[p].n++] = u;
+            ++streams[p].sent;
+            sim_usart_rx(p, u->data, u->len, e->t, u);
+        }
+        break;
+    }
+}
+
+// all bytes of unit received by USART
+void replay_delivered(void *tag, uint64_t t){
+    unit *u = (unit*)tag;
+    streamstat *s = &streams[u->port];
+    u->done = t;
+    s->delivered += u->len;
+    if(s->delivered - s->consumed > s->backlog_max) s->backlog_max = s->delivered - s->consumed;
+}
+
+static int unit_match(const unit *u, const char *data, int len){
+    if(len < u->cmplen || memcmp(u->data, data, u->cmplen)) return 0;
+    if(len == u->cmplen) return 1;
+    return data[u->cmplen] == '\n' || data[u->cmplen] == 0;
+}
+
+/**
+ * @brief replay_consumed - firmware parsed data from USART
+ * @param port - USART number
+ * @param data - line (ends with '\n' or 0) or frame
+ * @param len - max data length
+ */
+void replay_consumed(int port, const char *data, int len){
+    if(port < 1 || port > 3) return;
+    streamstat *s = &streams[port];
+    int i;
+    for(i = units[port].head; i < units[port].n; ++i){
+        unit *u = units[port].list[i];
+        if(!u->done){
+            i = units[port].n;
+            break;
+        }
+        if(unit_match(u, data, len)) break;
+    }
+    if(i == units[port].n){
+        ++s->unknown;
+        return;
+    }
+    for(int j = units[port].head; j < i; ++j){ // all previous are lost
+        unit *u = units[port].list[j];
+        u->state = 2;
+        ++s->lost;
+        s->consumed += u->len;
+    }
+    unit *u = units[port].list[i];
+    u->state = 1;
+    ++s->parsed;
+    s->consumed += u->len;
+    uint64_t lat = sim_clock - u->done;
+    if(s->parsed == 1 || lat < s->lat_min) s->lat_min = lat;
+    if(lat > s->lat_max) s->lat_max = lat;
+    s->lat_sum += lat;
+    units[port].head = i + 1;
+}
+
+// firmware reports about trigger shot (called from show_trigger_shot())
+void replay_trigshown(uint8_t tshot){
+    for(int i = 0; i < DIGTRIG_AMOUNT; ++i){
+        if(!(tshot & (1 << i))) continue;
+        if(trig_released[i] <= trig_shown[i]) continue; // not released yet
+        uint64_t lat = (sim_clock > trig_released[i]) ? sim_clock - trig_released[i] : 0;
+        trig_shown[i] = trig_released[i];
+        if(!trigstats.shown++ || lat < trigstats.lat_min) trigstats.lat_min = lat;
+        if(lat > trigstats.lat_max) trigstats.lat_max = lat;
+        trigstats.lat_sum += lat;
+        if(trig_pps[i] > trig_pressed[i]) continue; // no PPS before
+        // microseconds from PPS: firmware's and real
+        double err = (double)shottime[i].usec - SIM_CLK2US(trig_pressed[i] - trig_pps[i]);
+        while(err > 500000.) err -= 1000000.;
+        while(err < -500000.) err += 1000000.;
+        if(!trigstats.stamped++ || err < trigstats.err_min) trigstats.err_min = err;
+        if(trigstats.stamped == 1 || err > trigstats.err_max) trigstats.err_max = err;
+        trigstats.err_abssum += (err < 0.) ? -err : err;
+    }
+}
@@ -0,0 +1,65 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#pragma once
+#ifndef REPLAY_H__
+#define REPLAY_H__
+
+#include <stdint.h>
+
+// PPS pulse length (GPS_send_start_seq sets 10ms)
+#define PPS_PULSE_MS        (10)
+// LIDAR frames are compared by header, distance & strength (firmware don't keep the rest)
+#define LIDAR_HDR_LEN       (6)
+
+// statistics of data stream over one USART
+typedef struct{
+    const char *name;
+    uint32_t sent;          // lines/frames sent
+    uint32_t parsed;        // and recognized by firmware
+    uint32_t lost;          // and skipped
+    uint32_t unknown;       // firmware got data that wasn't sent
+    uint64_t delivered;     // bytes received by USART
+    uint64_t consumed;      // bytes of parsed or lost lines
+    uint64_t backlog_max;   // max(delivered - consumed)
+    uint64_t lat_min, lat_max, lat_sum; // latency of parsing (clocks)
+} streamstat;
+
+// statistics of triggers
+typedef struct{
+    uint32_t fired;         // pulses generated
+    uint32_t shown;         // and reported
+    uint64_t lat_min, lat_max, lat_sum; // delay between trigger release and report
+    uint32_t stamped;       // timestamps checked (there was PPS before trigger)
+    double err_min, err_max, err_abssum; // timestamp error (us)
+} trigstat;
+
+extern streamstat streams[4];
+extern trigstat trigstats;
+
+int replay_load(const char *name);
+void replay_synth(double seconds, double lidar_hz, double trig_period);
+void replay_stress(double seconds, uint32_t baud);
+void replay_sort();
+uint64_t replay_lasttime();
+uint64_t replay_nexttime();
+void replay_fire();
+void replay_delivered(void *tag, uint64_t t);
+void replay_consumed(int port, const char *data, int len);
+void replay_trigshown(uint8_t tshot);
+
+#endif // REPLAY_H__
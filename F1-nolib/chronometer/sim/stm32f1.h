@@ -0,0 +1,42 @@
+/*
+ * This file is part of the chronometer project.
+ * Copyright 2020 Edward V. Emelianov <edward.emelianoff@gmail.com>.
+ *
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Wrapper over ../../inc/Fx/stm32f1.h for host build.
+// All peripherals are plain memory mapped by simulator at their real addresses,
+// but FLASH, IWDG & TIM2 accesses are routed through simulator to emulate
+// write-1-to-clear flags, flash programming, running counter and to give a chance for
+// "interrupts" to fire (firmware refreshes watchdog everywhere)
+
+#pragma once
+#ifndef SIM_STM32F1_H__
+#define SIM_STM32F1_H__
+
+#include_next <stm32f1.h>
+
+FLASH_TypeDef *sim_flash();
+IWDG_TypeDef *sim_iwdg();
+TIM_TypeDef *sim_tim2();
+
+#undef FLASH
+#define FLASH   (sim_flash())
+#undef IWDG
+#define IWDG    (sim_iwdg())
+#undef TIM2
+#define TIM2    (sim_tim2())
+
+#endif // SIM_STM32F1_H__
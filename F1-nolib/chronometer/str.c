@@ -65,14 +65,28 @@ char *getchr(const char *str, char symbol){
 
 #define sendu(x) do{sendstring(u2str(x));}while(0)
 
-/*
 static void sendi(int32_t I){
     if(I < 0){
         sendchar('-');
         I = -I;
     }
     sendstring(u2str((uint32_t)I));
-}*/
+}
+
+// omit spaces and number at the beginning of `buf`, @return pointer to next symbol
+static const char *omitnum(const char *buf){
+    while(*buf == ' ' || *buf == '\t' || *buf == '=') ++buf;
+    if(*buf == '-') ++buf;
+    while(*buf >= '0' && *buf <= '9') ++buf;
+    return buf;
+}
+
+// convert time HHMMSS into seconds from midnight, @return -1 if bad
+static int32_t hhmmss2s(int32_t T){
+    int32_t H = T / 10000, M = (T / 100) % 100, S = T % 100;
+    if(T < 0 || H > 23 || M > 59 || S > 59) return -1;
+    return H * 3600 + M * 60 + S;
+}
 
 // echo '1' if true or '0' if false
 static void checkflag(uint8_t f){
@@ -106,6 +120,12 @@ static void showuserconf(){
     checkflag(f & FLAG_GPSPROXY);
     sendstring("\nLIDAR=");
     checkflag(!(f & FLAG_NOLIDAR));
+    sendstring("\nRXDMA={");
+    for(int i = 1; i <= USART_LAST; ++i){
+        if(i > 1) sendstring(", ");
+        checkflag(!(f & FLAG_NORXDMA(i)));
+    }
+    sendstring("}");
     sendstring("\n"); // <-- sendstring @ the end to initialize data transmission
 }
 
@@ -131,6 +151,7 @@ void parse_CMD(char *cmd){
                  CMD_DISTMIN   " - min distance threshold (cm)\n"
                  CMD_DISTMAX   " - max distance threshold (cm)\n"
                  CMD_DUMP      "N - dump 20 last stored events (no x), all (x<1) or x\n"
+                 CMD_DUMPTIME  " T0 T1 [N] - dump events from T0 to T1 (HHMMSS), only trigger N if given\n"
                  CMD_FLASH     " - FLASH info\n"
                  CMD_GPSPROXY  "S - GPS proxy over USART1 on/off\n"
                  CMD_GPSRESTART " - send Full Cold Restart to GPS\n"
@@ -142,6 +163,7 @@ void parse_CMD(char *cmd){
                  CMD_GETMCUTEMP " - MCU temperature\n"
                  CMD_NFREE     " - warn when free logs space less than this number (0 - not warn)\n"
                  CMD_RESET     " - reset MCU\n"
+                 CMD_RXDMA     "NS - USART N receives by DMA (1) or by each byte interrupt (0)\n"
                  CMD_SAVEEVTS  "S - save/don't save (1/0) trigger events into flash\n"
                  CMD_SHOWCONF  " - show current configuration\n"
                  CMD_STORECONF " - store new configuration in flash\n"
@@ -151,6 +173,7 @@ void parse_CMD(char *cmd){
                  CMD_TRGPAUSE  "NP - pause (P, ms) after trigger N shots\n"
                  CMD_TRGTIME   "N - show last trigger N time\n"
                  CMD_USARTSPD  "N - set USART1 speed to N\n"
+                 CMD_USARTSTAT " - show USARTs receive statistics\n"
                  CMD_GETVDD    " - Vdd value\n"
                  );
     }else if(CMP(cmd, CMD_PRINTTIME) == 0){ // print current time
@@ -278,9 +301,16 @@ void parse_CMD(char *cmd){
         }
         sendstring(str);
         if(Tms - last_corr_time < 1500)
-            sendstring(", PPS working\n");
+            sendstring(", PPS working");
         else
-            sendstring(", no PPS\n");
+            sendstring(", no PPS");
+        const char *clkstr[] = {"free run", "acquire", "locked", "holdover"};
+        sendstring("\nClock: "); sendstring(clkstr[clk_state]);
+        // phase in us, frequency in ppb: 1/65536 clock per ms is 100/472 ppb
+        sendstring(", phase="); sendi(clk_phase / (SYSTICK_DEFCONF / 1000));
+        sendstring("us, freq="); sendi(clk_freq * 100 / 472);
+        sendstring("ppb, steps="); sendu(clk_steps);
+        sendstring("\n");
     }else if(CMP(cmd, CMD_USARTSPD) == 0){ // USART speed
         GETNUM(CMD_USARTSPD);
         if(N < 400 || N > 3000000) goto bad_number;
@@ -334,8 +364,14 @@ void parse_CMD(char *cmd){
         sendstring(u2hex((uint32_t)logsstart));
         sendstring("\nLOGsize=");
         sendu(sizeof(event_log));
+        sendstring("\nNlogs_pages=");
+        sendu(logNpages);
         sendstring("\nNlogs_records=");
-        sendu(maxLnum - 1);
+        sendu(maxLnum);
+        sendstring("\nNlogs_stored=");
+        sendu(log_amount());
+        sendstring("\nNlogs_broken=");
+        sendu(log_badrec);
         sendstring("\n");
     }else if(CMP(cmd, CMD_SAVEEVTS) == 0){ // save all events
         if('0' == cmd[sizeof(CMD_SAVEEVTS) - 1]){
@@ -350,6 +386,18 @@ void parse_CMD(char *cmd){
             }
         }
         succeed = 1;
+    }else if(CMP(cmd, CMD_DUMPTIME) == 0){ // dump events by time range (check before CMD_DUMP!)
+        const char *ptr = cmd + sizeof(CMD_DUMPTIME) - 1;
+        int32_t tfrom, tto, trig = -1;
+        if(getnum(ptr, &tfrom)) goto bad_number;
+        ptr = omitnum(ptr);
+        if(getnum(ptr, &tto)) goto bad_number;
+        ptr = omitnum(ptr);
+        if(!getnum(ptr, &trig) && (trig < 0 || trig >= TRIGGERS_AMOUNT)) goto bad_number;
+        tfrom = hhmmss2s(tfrom);
+        tto = hhmmss2s(tto);
+        if(tfrom < 0 || tto < 0) goto bad_number;
+        if(dump_logtime((uint32_t)tfrom, (uint32_t)tto, trig)) sendstring("No such events!\n");
     }else if(CMP(cmd, CMD_DUMP) == 0){ // dump N last events
         if(getnum(cmd+sizeof(CMD_DUMP)-1, &N)) N = -20; // default - without N
         else N = -N;
@@ -404,6 +452,32 @@ void parse_CMD(char *cmd){
             }
         }
         succeed = 1;
+    }else if(CMP(cmd, CMD_RXDMA) == 0){ // USART receive mode
+        cmd += sizeof(CMD_RXDMA) - 1;
+        uint8_t Nt = (uint8_t)(*cmd++ - '0');
+        if(Nt < 1 || Nt > USART_LAST) goto bad_number;
+        uint8_t state = (uint8_t)(*cmd - '0');
+        if(state > 1) goto bad_number;
+        uint8_t oldval = the_conf.defflags;
+        if(state) the_conf.defflags &= ~FLAG_NORXDMA(Nt);
+        else the_conf.defflags |= FLAG_NORXDMA(Nt);
+        if(oldval != the_conf.defflags){
+            conf_modified = 1;
+            usart_rxmode(Nt);
+        }
+        succeed = 1;
+    }else if(CMP(cmd, CMD_USARTSTAT) == 0){ // lost bytes/lines & max ring usage
+        for(int i = 1; i <= USART_LAST; ++i){
+            sendstring("USART"); sendu(i);
+            sendstring(": dropped="); sendu(rxdropped[i]);
+            sendstring(", droplines="); sendu(rxdroplines[i]);
+            sendstring(", maxfill="); sendu(rxmaxfill[i]);
+            sendstring("\n");
+        }
+        sendstring("LIDAR: frames="); sendu(lidar_frames);
+        sendstring(", badcrc="); sendu(lidar_badcrc);
+        sendstring(", qlost="); sendu(lidar_qlost);
+        sendstring("\n");
     }else{
         sendstring("Bad command: ");
         sendstring(oldcmd);
@@ -428,7 +502,7 @@ void parse_CMD(char *cmd){
  * @return string with data
  */
 char *get_trigger_shot(int number, const event_log *logdata){
-    static char buf[64];
+    static char buf[128];
     char *bptr = buf;
     if(number > -1){
         bptr = strcp(bptr, u2str(number));
@@ -444,7 +518,7 @@ char *get_trigger_shot(int number, const event_log *logdata){
     }
     *bptr++ = '=';
     IWDG->KR = IWDG_REFRESH;
-    bptr = strcp(bptr, get_time(&logdata->shottime.Time, logdata->shottime.millis));
+    bptr = strcp(bptr, get_time_us(&logdata->shottime.Time, logdata->shottime.usec));
     bptr = strcp(bptr, ", len=");
     if(logdata->triglen < 0) bptr = strcp(bptr, ">1s");
     else bptr = strcp(bptr, u2str((uint32_t) logdata->triglen));
@@ -570,6 +644,12 @@ static char localbuffer[LOCBUFSZ];
 static uint8_t bufidx = 0;
 static void transmitlocbuf(){
     localbuffer[bufidx] = 0;
+    // USB_send() don't wait, so give host a chance to read previous data when
+    // transmit ring is almost full (e.g. log dump), but not longer than 50ms; don't wait
+    // if there's no host reading port
+    uint32_t T0 = Tms;
+    while(USB_configured() && USB_connected && USB_TXRINGSZ - USB_txpending() < 2*LOCBUFSZ
+          && Tms - T0 < 50) IWDG->KR = IWDG_REFRESH;
     USB_send(localbuffer);
     if(!(the_conf.defflags & FLAG_GPSPROXY)){ // USART1 isn't a GPS proxy
         usart_send(1, localbuffer);
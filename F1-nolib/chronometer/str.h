@@ -33,6 +33,7 @@
 #define CMD_DISTMAX     "distmax"
 #define CMD_DISTMIN     "distmin"
 #define CMD_DUMP        "dump"
+#define CMD_DUMPTIME    "dumptime"
 #define CMD_FLASH       "flash"
 #define CMD_GETMCUTEMP  "mcutemp"
 #define CMD_GETVDD      "vdd"
@@ -46,6 +47,7 @@
 #define CMD_NFREE       "nfree"
 #define CMD_PRINTTIME   "time"
 #define CMD_RESET       "reset"
+#define CMD_RXDMA       "rxdma"
 #define CMD_SAVEEVTS    "se"
 #define CMD_SHOWCONF    "showconf"
 #define CMD_STORECONF   "store"
@@ -54,6 +56,7 @@
 #define CMD_TRGTIME     "trigtime"
 #define CMD_TRIGLVL     "triglevel"
 #define CMD_USARTSPD    "usartspd"
+#define CMD_USARTSTAT   "usartstat"
 
 extern uint8_t showGPSstr;
 
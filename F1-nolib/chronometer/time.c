@@ -79,33 +79,25 @@ static char *puttwo(uint8_t N, char *buf){
 }
 
 /**
- * @brief ms2str - fill buffer str with milliseconds ms
+ * @brief frac2str - fill buffer str with fractional part of second
  * @param str (io) - pointer to buffer
- * @param T - milliseconds
+ * @param T - milliseconds or microseconds
+ * @param ndig - amount of digits: 3 for ms, 6 for us
  */
-static void ms2str(char **str, uint32_t T){
+static void frac2str(char **str, uint32_t T, int ndig){
     char *bptr = *str;
     *bptr++ = '.';
-    if(T > 99){
-        *bptr++ = (char)(T/100 + '0');
-        T %= 100;
-    }else *bptr++ = '0';
-    if(T > 9){
-        *bptr++ = (char)(T/10 + '0');
-        T %= 10;
-    }else *bptr++ = '0';
-    *bptr++ = (char)(T + '0');
-    *str = bptr;
+    for(int i = ndig - 1; i > -1; --i){
+        bptr[i] = (char)(T % 10 + '0');
+        T /= 10;
+    }
+    *str = bptr + ndig;
 }
 
-/**
- * print time: Tm - time structure, T - milliseconds
- */
-char *get_time(const curtime *Tm, uint32_t T){
+static char *timestr(const curtime *Tm, uint32_t T, int ndig){
     static char buf[64];
     char *bstart = &buf[5], *bptr = bstart;
     int S = 0;
-    if(T > 999) return "Wrong time";
     if(Tm->S < 60 && Tm->M < 60 && Tm->H < 24)
         S = Tm->S + Tm->H*3600 + Tm->M*60; // seconds from day beginning
     if(!S) *(--bstart) = '0';
@@ -114,13 +106,13 @@ char *get_time(const curtime *Tm, uint32_t T){
         S /= 10;
     }
     // now bstart is buffer starting index; bptr points to decimal point
-    ms2str(&bptr, T);
+    frac2str(&bptr, T, ndig);
     // put current time in HH:MM:SS format into buf
     *bptr++ = ' '; *bptr++ = '(';
     bptr = puttwo(Tm->H, bptr); *bptr++ = ':';
     bptr = puttwo(Tm->M, bptr); *bptr++ = ':';
     bptr = puttwo(Tm->S, bptr);
-    ms2str(&bptr, T);
+    frac2str(&bptr, T, ndig);
     *bptr++ = ')';
     if(GPS_status == GPS_NOTFOUND){
         strcpy(bptr, " GPS not found");
@@ -130,65 +122,253 @@ char *get_time(const curtime *Tm, uint32_t T){
     return bstart;
 }
 
+/**
+ * print time: Tm - time structure, T - milliseconds
+ */
+char *get_time(const curtime *Tm, uint32_t T){
+    if(T > 999) return "Wrong time";
+    return timestr(Tm, T, 3);
+}
+
+/**
+ * print time: Tm - time structure, us - microseconds
+ */
+char *get_time_us(const curtime *Tm, uint32_t us){
+    if(us > 999999) return "Wrong time";
+    return timestr(Tm, us, 6);
+}
 
-#ifdef EBUG
-uint32_t timerval, Tms1;
-int32_t timecntr=0, ticksdiff=0;
-#else
-static int32_t timecntr=0, ticksdiff=0;
-#endif
 uint32_t last_corr_time = 0;
+volatile clk_status clk_state = CLK_FREERUN;
+volatile int32_t clk_phase = 0, clk_freq = 0;
+volatile uint32_t clk_steps = 0; // amount of clock steps
+// current SysTick period correction (1/65536 clocks) and its fractional part accumulator
+static volatile int32_t clk_corr = 0;
+static volatile uint32_t clk_frac = 0;
+static uint32_t clk_lockcnt = 0, clk_outliers = 0;
+static int clk_seeded = 0; // frequency was estimated by PPS period
 
 /**
- * @brief systick_correction
- * Makes correction of system timer
- * The default frequency of timer is 1kHz - 72000 clocks per interrupt
- * So we check how much ticks there was for last one second - between PPS interrupts
- * Their amount equal to M = `Timer` value x (SysTick->LOAD+1) + (SysTick->LOAD+1 - SysTick->VAL)
- *    if `Timer` is very small, add 1000 to its value.
- * We need 1000xN ticks instead of M
- * if L = LOAD+1, then
- * M = Timer*L + L - VAL; newL = L + D = M/1000
- * 1000*D = M - 1000*L = L(Timer+1-1000) - VAL ->
- * D = [L*(Timer-999) - VAL]/1000
- * So correction equal to
- *      [ (SysTick->LOAD + 1) * (Timer - 999) - SysTick->VAL ] / 1000
+ * @brief clock_tick - SysTick reload value for next millisecond
+ * fractional part of period is accumulated, so mean period could be set with 1/65536 clock resolution;
+ * should be called from SysTick interrupt
  */
-void systick_correction(){
+void clock_tick(){
+    uint32_t f = clk_frac + ((uint32_t)clk_corr & 0xffff);
+    SysTick->LOAD = (uint32_t)(SYSTICK_DEFLOAD + (clk_corr >> 16)) + (f >> 16);
+    clk_frac = f & 0xffff;
+    if((clk_state == CLK_ACQUIRE || clk_state == CLK_LOCKED) && Tms - last_corr_time > CLK_PPSTMOUT){
+        // PPS lost: run by last frequency estimate
+        clk_state = (clk_state == CLK_LOCKED) ? CLK_HOLDOVER : CLK_FREERUN;
+        clk_corr = clk_freq;
+    }
+}
+
+// initial frequency estimate by PPS period measured by TIM2
+static int clock_seed(){
+    uint32_t P = pps_period;
+    if(!P) return 0;
+    clk_freq = ((int32_t)P - TSTAMP_FREQ) * 4719; // 72000*65536/10^6 = 4718.6
+    return 1;
+}
+
+// set local second beginning to current moment
+static void clock_step(int32_t phase){
     SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk; // stop systick for a while
-    int32_t systick_val = (int32_t)SysTick->VAL, L = (int32_t)SysTick->LOAD + 1;
-    uint32_t timer_val = Timer;
-#ifdef EBUG
-    timerval = Timer;
-    Tms1 = Tms;
-#endif
-    Timer = 0;
     SysTick->VAL = SysTick->LOAD;
     SysTick->CTRL |= SysTick_CTRL_ENABLE_Msk; // start it again
-//    if(systick_val != SysTick->LOAD) ++Tms;
-    if(timer_val > 500) time_increment(); // counter greater than 500 -> need to increment time
-    if(last_corr_time){
-        uint32_t Tdiff = Tms - last_corr_time;
-        if(Tdiff < 1500 && Tdiff > 700){ // there was perevious PPS signal ~1s ago
-            int32_t D = L * ((int32_t)(Tms - 1000 - last_corr_time)) + ((int32_t)SysTick->LOAD - systick_val); // amount of spare ticks
-            ++timecntr;
-            ticksdiff += D;
-            uint32_t ticksabs = (ticksdiff < 0) ? (uint32_t)-ticksdiff : (uint32_t)ticksdiff;
-            // 30000 == 30 seconds * 1000 interrupts per second
-            if(ticksabs > 30000 && timecntr > 10){ // need correction (not more often than each 10s)
-                ticksdiff /= timecntr * 1000; // correction per one interrupt
-                SysTick->LOAD = (uint32_t)(ticksdiff + (int32_t)SysTick->LOAD);
-                timecntr = 0;
-                ticksdiff = 0;
-#ifdef EBUG
-                SEND("Correction\n");
-#endif
-            }
-        }else{
-            timecntr = 0;
-            ticksdiff = 0;
-        }
-    }
+    if(phase < 0) time_increment(); // local clock didn't start new second yet
+    else Timer = 0;
+    ++clk_steps;
+    clk_lockcnt = 0;
+    clk_outliers = 0;
+    clk_seeded = clock_seed();
+    clk_corr = clk_freq;
+    clk_state = CLK_ACQUIRE;
+}
+
+// duration of N SysTick periods (clocks) with correction C
+static int32_t ticks2clk(uint32_t N, int32_t C){
+    return (int32_t)(N * SYSTICK_DEFCONF) + (int32_t)N * (C >> 16) + (int32_t)((N * ((uint32_t)C & 0xffff)) >> 16);
+}
+
+/**
+ * @brief clock_pps - clock discipline: phase & frequency PI loop
+ * Phase error is local time at PPS front: milliseconds counter and SysTick value
+ * corrected by interrupt latency measured by TIM2 capture. Its sign shows whether local clock
+ * is ahead (>0) or behind (<0) of PPS. Small errors are slewed by SysTick period:
+ *      period = nominal + I + Kp*e,   I += Ki*e,
+ * where e is correction of period removing phase error during one second.
+ * Large errors make clock step: new second starts right in PPS interrupt.
+ * Should be called from PPS interrupt after pps_capture().
+ */
+void clock_pps(){
+    uint32_t now = tstamp_now();
+    uint32_t L = SysTick->LOAD, val = SysTick->VAL, tmr = Timer;
+    int32_t C = clk_corr;
+    // SysTick overflow isn't processed yet
+    if((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && val > (L >> 1)) ++tmr;
     last_corr_time = Tms;
+    int32_t phase;
+    if(tmr < 500) phase = ticks2clk(tmr, C) + (int32_t)(L - val); // local second began `phase` clocks ago
+    else phase = -(ticks2clk(999 - tmr, C) + (int32_t)val + 1); // it will begin in `-phase` clocks
+    // PPS front was `lat` us ago
+    uint32_t lat = now - pps_last;
+    if(lat < 1000) phase -= (int32_t)(lat * (SYSTICK_DEFCONF / 1000));
+    clk_phase = phase;
+    int32_t aphase = (phase < 0) ? -phase : phase;
+    if(clk_state == CLK_FREERUN || aphase > CLK_STEP){
+        // ignore single PPS glitches if clock is locked (after holdover error is real: step at once)
+        if(clk_state == CLK_LOCKED && ++clk_outliers <= CLK_MAXOUTLIERS) return;
+        clock_step(phase);
+        return;
+    }
+    clk_outliers = 0;
+    if(!clk_seeded) clk_seeded = clock_seed();
+    if(clk_state == CLK_HOLDOVER) clk_state = CLK_LOCKED;
+    if(clk_state == CLK_LOCKED && aphase > CLK_UNLOCK){
+        clk_state = CLK_ACQUIRE;
+        clk_lockcnt = 0;
+    }
+    // phase -> period correction: phase * 65536 / 1000
+    int32_t e = phase * 8192 / 125, p;
+    if(clk_state == CLK_LOCKED){
+        clk_freq += e / CLK_KI_LOCK;
+        p = e / CLK_KP_LOCK;
+    }else{
+        clk_freq += e / CLK_KI_ACQ;
+        p = e / CLK_KP_ACQ;
+        if(aphase < CLK_LOCK){
+            if(++clk_lockcnt >= CLK_LOCKCNT) clk_state = CLK_LOCKED;
+        }else clk_lockcnt = 0;
+    }
+    clk_corr = clk_freq + p;
+}
+
+// high half of timestamp (TIM2 overflows)
+static volatile uint32_t tim2_ovf = 0;
+volatile uint32_t pps_last = 0, pps_period = 0;
+
+/**
+ * @brief tstamp_setup - run TIM2 as free running 1MHz counter,
+ *        PPS edges are captured by its channel 2 (PA1)
+ */
+void tstamp_setup(){
+    RCC->APB1ENR |= RCC_APB1ENR_TIM2EN;
+    // APB1 = 36MHz, so timers are clocked by 72MHz
+    TIM2->PSC = 72000000 / TSTAMP_FREQ - 1;
+    TIM2->ARR = 0xffff;
+    // IC2 is mapped on TI2, filter: fCK_INT, N=8; capture on rising edge
+    TIM2->CCMR1 = TIM_CCMR1_CC2S_0 | TIM_CCMR1_IC2F_0 | TIM_CCMR1_IC2F_1;
+    TIM2->CCER = TIM_CCER_CC2E;
+    TIM2->EGR = TIM_EGR_UG; // load prescaler
+    TIM2->SR = 0;
+    TIM2->DIER = TIM_DIER_UIE;
+    TIM2->CR1 = TIM_CR1_CEN;
+    NVIC_EnableIRQ(TIM2_IRQn);
 }
 
+// counter overflow: extend it to 32 bits
+void tim2_isr(){
+    if(TIM2->SR & TIM_SR_UIF){
+        TIM2->SR = ~TIM_SR_UIF;
+        tim2_ovf += 0x10000;
+    }
+}
+
+/**
+ * @brief tstamp_now - get current timestamp
+ * @return 32-bit counter value (1us ticks, overflows each ~71 minutes)
+ */
+uint32_t tstamp_now(){
+    uint32_t hi, lo, uif;
+    do{ // tim2_isr could fire between reads
+        hi = tim2_ovf;
+        lo = TIM2->CNT;
+        uif = TIM2->SR & TIM_SR_UIF;
+    }while(hi != tim2_ovf);
+    // overflow isn't processed yet: we are in interrupt with higher priority
+    if(uif && lo < 0x8000) hi += 0x10000;
+    return hi + lo;
+}
+
+/**
+ * @brief pps_capture - get timestamp of PPS captured by TIM2_CH2 and measure PPS period
+ * should be called from PPS interrupt
+ */
+void pps_capture(){
+    uint32_t t = tstamp_now();
+    if(TIM2->SR & TIM_SR_CC2IF){ // edge was captured less than 65ms ago
+        t -= (uint16_t)((uint16_t)t - TIM2->CCR2);
+        TIM2->SR = ~(TIM_SR_CC2IF | TIM_SR_CC2OF);
+    }
+    uint32_t P = t - pps_last;
+    if(pps_last && P > TSTAMP_FREQ - TSTAMP_MAXDEV && P < TSTAMP_FREQ + TSTAMP_MAXDEV) pps_period = P;
+    else pps_period = 0; // first or missed pulse
+    pps_last = t;
+}
+
+/**
+ * @brief tstamp2us - convert timestamp into microseconds from second beginning
+ * @param t - timestamp (got by tstamp_now() not earlier than last PPS)
+ * @return amount of microseconds; if there's no PPS, calculate it by SysTick
+ */
+uint32_t tstamp2us(uint32_t t){
+    uint32_t dt = t - pps_last, P = pps_period;
+    if(P && dt < P){
+        // dt*10^6/P, but without 64-bit division: |10^6 - P| < TSTAMP_MAXDEV
+        dt += (uint32_t)(((int32_t)dt * (int32_t)(TSTAMP_FREQ - P)) / (int32_t)P);
+    }else{
+        uint32_t L = SysTick->LOAD + 1;
+        dt = Timer * 1000 + (L - 1 - SysTick->VAL) * 1000 / L;
+    }
+    if(dt > 999999) dt = 999999;
+    return dt;
+}
+
+// move time one second forward (dir > 0) or backward
+static void time_shift(curtime *T, int dir){
+    if(T->H == 25) return; // time not initialized
+    if(dir > 0){
+        if(++T->S < 60) return;
+        T->S = 0;
+        if(++T->M < 60) return;
+        T->M = 0;
+        if(++T->H == 24) T->H = 0;
+    }else{
+        if(T->S--) return;
+        T->S = 59;
+        if(T->M--) return;
+        T->M = 59;
+        if(T->H-- == 0) T->H = 23;
+    }
+}
+
+/**
+ * @brief tstamp2time - get time of timestamp
+ * Microseconds are counted from PPS, while current_time is changed by SysTick, so in |clk_phase|
+ * near second edge they belong to different seconds. As phase error is much less than 0.5s,
+ * local second is moved to that of PPS in this case.
+ * @param t - timestamp (got by tstamp_now() just before)
+ * @param T (o) - time of the second
+ * @return amount of microseconds from second beginning
+ */
+uint32_t tstamp2time(uint32_t t, curtime *T){
+    uint32_t tmr, L, val;
+    do{ // SysTick interrupt could change time while copying
+        tmr = Timer;
+        memcpy(T, &current_time, sizeof(curtime));
+        L = SysTick->LOAD;
+        val = SysTick->VAL;
+    }while(tmr != Timer);
+    // SysTick overflow isn't processed yet
+    if((SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) && val > (L >> 1)) ++tmr;
+    if(tmr > 999){ // and it will start new second
+        time_shift(T, 1);
+        tmr = 0;
+    }
+    uint32_t us = tstamp2us(t);
+    if(us < 500000 && tmr > 499) time_shift(T, 1); // PPS began new second, local clock didn't
+    else if(us > 499999 && tmr < 500) time_shift(T, -1); // local second began before PPS
+    return us;
+}
@@ -34,6 +34,37 @@
 
 #define TMNOTINI  {25,61,61}
 
+// timestamp timer TIM2: free running @1MHz, PPS (PA1) captured by TIM2_CH2
+#define TSTAMP_FREQ       (1000000)
+// max deviation of PPS period from TSTAMP_FREQ (ticks) to trust it
+#define TSTAMP_MAXDEV     (1000)
+
+// clock discipline: SysTick period correction is in 1/65536 of clock
+// phase error (clocks) to step clock instead of slewing: 300us
+#define CLK_STEP          (21600)
+// phase error (clocks) less than 20us during CLK_LOCKCNT pulses -> locked
+#define CLK_LOCK          (1440)
+#define CLK_LOCKCNT       (10)
+// unlock if phase error greater than 100us
+#define CLK_UNLOCK        (7200)
+// ignore up to this amount of sequential PPS with too large phase error when locked
+#define CLK_MAXOUTLIERS   (3)
+// PPS absent more than this time (ms) -> holdover
+#define CLK_PPSTMOUT      (1500)
+// PI loop gains (divisors; Ki = Kp^2/4 gives critically damped loop):
+// time constant ~7s during acquisition and ~30s when locked
+#define CLK_KP_ACQ        (4)
+#define CLK_KI_ACQ        (64)
+#define CLK_KP_LOCK       (16)
+#define CLK_KI_LOCK       (1024)
+
+typedef enum{
+     CLK_FREERUN    // no PPS since start: nominal or last known frequency
+    ,CLK_ACQUIRE    // PPS found, fast loop
+    ,CLK_LOCKED     // phase error is small enough, slow loop
+    ,CLK_HOLDOVER   // PPS lost after lock: frequency estimate kept
+} clk_status;
+
 // current milliseconds
 #define get_millis()  (Timer)
 
@@ -43,10 +74,6 @@ typedef struct{
     uint8_t S;
 } curtime;
 
-#ifdef EBUG
-extern int32_t ticksdiff, timecntr;
-extern uint32_t timerval, Tms1;
-#endif
 extern volatile uint32_t Tms;
 extern volatile uint32_t Timer;
 extern curtime current_time;
@@ -57,9 +84,24 @@ extern uint32_t trigger_ms[];
 
 extern volatile int need_sync;
 
+extern volatile clk_status clk_state;
+// last phase error (clocks, local time minus PPS) & frequency correction (1/65536 clocks per ms)
+extern volatile int32_t clk_phase, clk_freq;
+extern volatile uint32_t clk_steps;
+
+// timestamp of last PPS and PPS period (0 if not measured) in timer ticks
+extern volatile uint32_t pps_last, pps_period;
+
 char *get_time(const curtime *T, uint32_t m);
+char *get_time_us(const curtime *Tm, uint32_t us);
 void set_time(const char *buf);
 void time_increment();
-void systick_correction();
+void clock_pps();
+void clock_tick();
+void tstamp_setup();
+uint32_t tstamp_now();
+uint32_t tstamp2us(uint32_t t);
+uint32_t tstamp2time(uint32_t t, curtime *T);
+void pps_capture();
 
 #endif // TIME_H__
@@ -23,34 +23,69 @@
 #include "str.h"
 #include "usart.h"
 
-extern volatile uint32_t Tms;
-static volatile uint8_t idatalen[4][2] = {{0}}; // received data line length (including '\n')
 static volatile uint8_t odatalen[4][2] = {{0}};
 
-static volatile uint8_t dlen[4] = {0}; // length of data (including '\n') in current buffer
+volatile uint8_t txrdy[4] = {0,1,1,1}; // transmission done
 
-volatile uint8_t linerdy[4] = {0},  // received data ready
-    bufovr[4] = {0},            // input buffer overfull
-    txrdy[4] = {0,1,1,1}        // transmission done
-;
+static uint8_t tbufno[4] = {0}; // current tbuf numbers
+static char tbuf[4][2][UARTBUFSZ]; // transmit buffers
 
+/*
+ * Receive path: single producer (USART IRQ) - single consumer (main loop).
+ * Bytes are stored in ring, each completed line adds its end position into line queue.
+ * ISR is the only writer of `head` and `rxlqhead`, main loop - of `tail` and `rxlqtail`,
+ * so no interrupts masking needed.
+ */
+#define RXRINGMASK  (RXRINGSZ - 1)
+#define RXLINEQMASK (RXLINEQSZ - 1)
+typedef struct{
+    volatile uint16_t head;     // ring write position (ISR)
+    volatile uint16_t tail;     // ring read position (main loop)
+    uint16_t lstart;            // start of line being received (ISR)
+    uint16_t llen;              // its length (including lost bytes)
+    uint8_t broken;             // line being received is lost
+    uint16_t lend[RXLINEQSZ];   // ends of received lines
+    char ring[RXRINGSZ];
+} rxring;
+
+static rxring rxr[USART_LAST]; // rxr[n-1] for USART n
+// circular DMA receive buffers and positions of first unprocessed byte
+static char rxdmabuf[USART_LAST][RXDMASZ];
+static uint16_t rxdmapos[USART_LAST];
+static USART_TypeDef *const usarts[USART_LAST] = {USART1, USART2, USART3};
+// Rx DMA channels: USART1 - Channel5, USART2 - Channel6, USART3 - Channel3
+static DMA_Channel_TypeDef *const rxdma[USART_LAST] = {DMA1_Channel5, DMA1_Channel6, DMA1_Channel3};
+static char rxline[USART_LAST][UARTBUFSZ+1]; // last line got by usart_getline
 
-static uint8_t rbufno[4] = {0}, tbufno[4] = {0}; // current rbuf/tbuf numbers
-static char rbuf[4][2][UARTBUFSZ], tbuf[4][2][UARTBUFSZ]; // receive & transmit buffers
-static char *recvdata[4] = {0};
+volatile uint8_t rxlqhead[4] = {0}, rxlqtail[4] = {0}; // line queue write/read positions
+volatile uint32_t rxdropped[4] = {0}, rxdroplines[4] = {0};
+uint16_t rxmaxfill[4] = {0};
 
 /**
- * return length of received data (without trailing zero)
+ * @brief usart_getline - get next received line
+ * @param n - USART number
+ * @param line - will point to line (valid till next call with the same `n`)
+ * @return length of received data (with '\n' but without trailing zero)
  */
 int usart_getline(int n, char **line){
-    if(bufovr[n]){
-        bufovr[n] = 0;
-        linerdy[n] = 0;
-        return 0;
+    if(n < 1 || n > USART_LAST) return 0;
+    uint8_t q = rxlqtail[n];
+    if(q == rxlqhead[n]) return 0;
+    __DMB(); // read line end after queue head
+    rxring *r = &rxr[n-1];
+    char *l = rxline[n-1];
+    uint16_t t = r->tail, e = r->lend[q];
+    int len = 0;
+    while(t != e){
+        l[len++] = r->ring[t];
+        t = (t + 1) & RXRINGMASK;
     }
-    *line = recvdata[n];
-    linerdy[n] = 0;
-    return dlen[n];
+    l[len] = 0;
+    __DMB(); // data should be copied before releasing
+    r->tail = t;
+    rxlqtail[n] = (q + 1) & RXLINEQMASK;
+    *line = l;
+    return len;
 }
 
 // transmit current tbuf and swap buffers
@@ -69,7 +104,10 @@ void transmit_tbuf(uint8_t n){
         default: return;
     }
     uint32_t tmout = 72000;
-    while(!txrdy[n]){if(--tmout == 0) return;} // wait for previos buffer transmission
+    while(!txrdy[n]){ // wait for previos buffer transmission
+        IWDG->KR = IWDG_REFRESH;
+        if(--tmout == 0) return;
+    }
     register uint32_t l = odatalen[n][tbufno[n]];
     if(!l) return;
     txrdy[n] = 0;
@@ -118,13 +156,14 @@ void newline(uint8_t n){
  */
 static void usart_setup(uint8_t n, uint16_t BRR){
     DMA_Channel_TypeDef *DMA;
-    IRQn_Type DMAirqN, USARTirqN;
+    IRQn_Type DMAirqN, DMArxirqN, USARTirqN;
     USART_TypeDef *USART;
     switch(n){
         case 1:
-            // USART1 Tx DMA - Channel4 (Rx - channel 5)
+            // USART1 Tx DMA - Channel4, Rx - Channel5
             DMA = DMA1_Channel4;
             DMAirqN = DMA1_Channel4_IRQn;
+            DMArxirqN = DMA1_Channel5_IRQn;
             USARTirqN = USART1_IRQn;
             // PA9 - Tx, PA10 - Rx
             RCC->APB2ENR |= RCC_APB2ENR_IOPAEN | RCC_APB2ENR_USART1EN;
@@ -132,9 +171,10 @@ static void usart_setup(uint8_t n, uint16_t BRR){
             USART = USART1;
         break;
         case 2:
-            // USART2 Tx DMA - Channel7
+            // USART2 Tx DMA - Channel7, Rx - Channel6
             DMA = DMA1_Channel7;
             DMAirqN = DMA1_Channel7_IRQn;
+            DMArxirqN = DMA1_Channel6_IRQn;
             USARTirqN = USART2_IRQn;
             // PA2 - Tx, PA3 - Rx
             RCC->APB2ENR |= RCC_APB2ENR_IOPAEN;
@@ -143,9 +183,10 @@ static void usart_setup(uint8_t n, uint16_t BRR){
             USART = USART2;
         break;
         case 3:
-            // USART3 Tx DMA - Channel2
+            // USART3 Tx DMA - Channel2, Rx - Channel3
             DMA = DMA1_Channel2;
             DMAirqN = DMA1_Channel2_IRQn;
+            DMArxirqN = DMA1_Channel3_IRQn;
             USARTirqN = USART3_IRQn;
             // PB10 - Tx, PB11 - Rx
             RCC->APB2ENR |= RCC_APB2ENR_IOPBEN;
@@ -164,11 +205,13 @@ static void usart_setup(uint8_t n, uint16_t BRR){
     uint32_t tmout = 16000000;
     while(!(USART->SR & USART_SR_TC)){if(--tmout == 0) break;} // polling idle frame Transmission
     USART->SR = 0; // clear flags
-    USART->CR1 |= USART_CR1_RXNEIE; // allow Rx IRQ
     USART->CR3 = USART_CR3_DMAT; // enable DMA Tx
+    usart_rxmode(n); // allow Rx IRQ or DMA
     // Tx CNDTR set @ each transmission due to data size
     NVIC_SetPriority(DMAirqN, n);
     NVIC_EnableIRQ(DMAirqN);
+    NVIC_SetPriority(DMArxirqN, n);
+    NVIC_EnableIRQ(DMArxirqN);
     NVIC_SetPriority(USARTirqN, n);
     NVIC_EnableIRQ(USARTirqN);
 }
@@ -181,43 +224,121 @@ void usarts_setup(){
 }
 
 
+// forget line being received
+static inline void rx_forget(rxring *r){
+    r->head = r->lstart;
+    r->llen = 0;
+    r->broken = 0;
+}
+
+static inline void rx_dropline(rxring *r, uint8_t n){
+    rxdropped[n] += r->llen;
+    ++rxdroplines[n];
+    rx_forget(r);
+}
+
+/**
+ * @brief rx_putchar - store next received byte
+ * @param n - USART number
+ * @param ch - byte
+ * @param eol - !=0 if it is the last byte of line
+ */
+static inline void rx_putchar(uint8_t n, char ch, uint8_t eol){
+    rxring *r = &rxr[n-1];
+    ++r->llen;
+    if(!r->broken){
+        uint16_t h = r->head, nxt = (h + 1) & RXRINGMASK;
+        if(r->llen > UARTBUFSZ || nxt == r->tail) r->broken = 1; // too long line or ring is full
+        else{
+            r->ring[h] = ch;
+            r->head = nxt;
+        }
+    }
+    if(!eol) return;
+    uint8_t q = rxlqhead[n], nq = (q + 1) & RXLINEQMASK;
+    if(r->broken || nq == rxlqtail[n]){ // line is lost or queue is full
+        rx_dropline(r, n);
+        return;
+    }
+    r->lend[q] = r->head;
+    uint16_t fill = (r->head - r->tail) & RXRINGMASK;
+    if(fill > rxmaxfill[n]) rxmaxfill[n] = fill;
+    __DMB(); // line should be stored before publishing
+    rxlqhead[n] = nq;
+    r->lstart = r->head;
+    r->llen = 0;
+}
+
+// process next received byte
+static void rx_byte(uint8_t n, char rb){
+    if(n != LIDAR_USART || (the_conf.defflags & FLAG_NOLIDAR)){ // regular TTY
+        if(rb != '\r') rx_putchar(n, rb, rb == '\n'); // omit '\r'
+        return;
+    }
+    lidar_rxbyte((uint8_t)rb); // binary frames
+}
+
+// process all bytes written by DMA since last call
+static void rxdma_proc(uint8_t n){
+    uint16_t end = RXDMASZ - rxdma[n-1]->CNDTR, pos = rxdmapos[n-1];
+    if(end >= RXDMASZ) end = 0;
+    const char *buf = rxdmabuf[n-1];
+    if(n == LIDAR_USART && !(the_conf.defflags & FLAG_NOLIDAR)){ // feed LIDAR decoder by chunks
+        if(end < pos){
+            lidar_rxdata((const uint8_t*)&buf[pos], RXDMASZ - pos);
+            pos = 0;
+        }
+        lidar_rxdata((const uint8_t*)&buf[pos], end - pos);
+        rxdmapos[n-1] = end;
+        return;
+    }
+    while(pos != end){
+        rx_byte(n, buf[pos]);
+        if(++pos == RXDMASZ) pos = 0;
+    }
+    rxdmapos[n-1] = pos;
+}
+
+/**
+ * @brief usart_rxmode - turn on circular DMA or RXNE interrupt reception due to FLAG_NORXDMA(n)
+ * In DMA mode data is processed on half/full buffer DMA interrupts and on IDLE line
+ * @param n - USART number
+ */
+void usart_rxmode(uint8_t n){
+    if(n < 1 || n > USART_LAST) return;
+    USART_TypeDef *USART = usarts[n-1];
+    DMA_Channel_TypeDef *DMA = rxdma[n-1];
+    __disable_irq();
+    if(USART->CR3 & USART_CR3_DMAR) rxdma_proc(n); // rest of data
+    USART->CR1 &= ~(USART_CR1_RXNEIE | USART_CR1_IDLEIE);
+    USART->CR3 &= ~USART_CR3_DMAR;
+    DMA->CCR = 0;
+    if(the_conf.defflags & FLAG_NORXDMA(n)){
+        USART->CR1 |= USART_CR1_RXNEIE;
+    }else{
+        DMA->CPAR = (uint32_t) &USART->DR; // periph
+        DMA->CMAR = (uint32_t) rxdmabuf[n-1]; // mem
+        DMA->CNDTR = RXDMASZ;
+        rxdmapos[n-1] = 0;
+        // 8bit, mem++, per->mem, circular, half & full transfer irqs
+        DMA->CCR = DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_HTIE | DMA_CCR_TCIE;
+        DMA->CCR |= DMA_CCR_EN;
+        USART->CR3 |= USART_CR3_DMAR;
+        USART->CR1 |= USART_CR1_IDLEIE;
+    }
+    __enable_irq();
+}
+
 static void usart_isr(uint8_t n, USART_TypeDef *USART){
-    #ifdef CHECK_TMOUT
-    static uint32_t tmout[n] = 0;
-    #endif
     IWDG->KR = IWDG_REFRESH;
-    if(USART->SR & USART_SR_RXNE){ // RX not emty - receive next char
-        #ifdef CHECK_TMOUT
-        if(tmout[n] && Tms >= tmout[n]){ // set overflow flag
-            bufovr[n] = 1;
-            idatalen[n][rbufno[n]] = 0;
-        }
-        tmout[n] = Tms + TIMEOUT_MS;
-        if(!tmout[n]) tmout[n] = 1; // prevent 0
-        #endif
-        char rb = (char)USART->DR;
-        if(idatalen[n][rbufno[n]] < UARTBUFSZ){ // put next char into buf
-            if(rb != '\r') rbuf[n][rbufno[n]][idatalen[n][rbufno[n]]++] = rb; // omit '\r'
-            if(rb == '\n'){ // got newline - line ready
-                linerdy[n] = 1;
-                dlen[n] = idatalen[n][rbufno[n]];
-                rbuf[n][rbufno[n]][dlen[n]] = 0;
-                recvdata[n] = rbuf[n][rbufno[n]];
-                // prepare other buffer
-                rbufno[n] = !rbufno[n];
-                idatalen[n][rbufno[n]] = 0;
-                #ifdef CHECK_TMOUT
-                // clear timeout at line end
-                tmout[n] = 0;
-                #endif
-            }
-        }else{ // buffer overrun
-            bufovr[n] = 1;
-            idatalen[n][rbufno[n]] = 0;
-            #ifdef CHECK_TMOUT
-            tmout[n] = 0;
-            #endif
+    uint32_t sr = USART->SR;
+    if(USART->CR3 & USART_CR3_DMAR){ // DMA mode
+        if(sr & USART_SR_IDLE){ // line is idle - process received chunk
+            (void)USART->DR; // clear IDLE flag
+            rxdma_proc(n);
         }
+    }else if(sr & USART_SR_RXNE){ // RX not emty - receive next char
+        rx_byte(n, (char)USART->DR);
     }
 }
 
@@ -232,33 +353,7 @@ void usart2_isr(){
 
 // LIDAR_USART
 void usart3_isr(){
-    if(the_conf.defflags & FLAG_NOLIDAR){ // regular TTY
-        usart_isr(3, USART3);
-        return;
-    }
-    // LIDAR - check for different things
-    IWDG->KR = IWDG_REFRESH;
-    if(USART3->SR & USART_SR_RXNE){ // RX not emty - receive next char
-        char rb = (char)USART3->DR;
-        uint8_t L = idatalen[3][rbufno[3]];
-        if(rb != LIDAR_FRAME_HEADER && (L == 0 || L == 1)){ // bad starting sequence
-            idatalen[3][rbufno[3]] = 0;
-            return;
-        }
-        if(L < LIDAR_FRAME_LEN){ // put next char into buf
-            rbuf[3][rbufno[3]][idatalen[3][rbufno[3]]++] = rb;
-            if(L == LIDAR_FRAME_LEN-1){ // got LIDAR_FRAME_LEN bytes - line ready
-                linerdy[3] = 1;
-                dlen[3] = idatalen[3][rbufno[3]];
-                recvdata[3] = rbuf[3][rbufno[3]];
-                // prepare other buffer
-                rbufno[3] = !rbufno[3];
-                idatalen[3][rbufno[3]] = 0;
-            }
-        }else{ // buffer overrun
-            idatalen[3][rbufno[3]] = 0;
-        }
-    }
+    usart_isr(3, USART3);
 }
 
 // print 32bit unsigned int
@@ -307,3 +402,19 @@ void dma1_channel2_isr(){ // USART3
         txrdy[3] = 1;
     }
 }
+
+// Rx DMA: half or full buffer received
+void dma1_channel5_isr(){ // USART1
+    DMA1->IFCR = DMA_IFCR_CGIF5; // clear all flags
+    rxdma_proc(1);
+}
+
+void dma1_channel6_isr(){ // USART2
+    DMA1->IFCR = DMA_IFCR_CGIF6;
+    rxdma_proc(2);
+}
+
+void dma1_channel3_isr(){ // USART3
+    DMA1->IFCR = DMA_IFCR_CGIF3;
+    rxdma_proc(3);
+}
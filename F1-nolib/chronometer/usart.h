@@ -22,8 +22,14 @@
 
 #include <stm32f1.h>
 
-// input and output buffers size (should be less than 256!!!)
+// output buffers size and max input line length (should be less than 256!!!)
 #define UARTBUFSZ   (128)
+// receive ring size (power of 2)
+#define RXRINGSZ    (512)
+// max amount of received lines in queue (power of 2)
+#define RXLINEQSZ   (64)
+// circular DMA receive buffer size (HT/TC interrupts at its halves)
+#define RXDMASZ     (64)
 // timeout between data bytes
 #ifndef TIMEOUT_MS
 #define TIMEOUT_MS (1500)
@@ -52,13 +58,18 @@
 #define DBG(str)
 #endif
 
-#define usartrx(n)  (linerdy[n])
-#define usartovr(n) (bufovr[n])
+// there's received lines in queue
+#define usartrx(n)  (rxlqhead[n] != rxlqtail[n])
 
-extern volatile uint8_t linerdy[], bufovr[], txrdy[];
+extern volatile uint8_t rxlqhead[], rxlqtail[], txrdy[];
+// bytes and lines lost due to ring/queue overflow or too long lines
+extern volatile uint32_t rxdropped[], rxdroplines[];
+// max amount of bytes in receive ring
+extern uint16_t rxmaxfill[];
 
 void transmit_tbuf(uint8_t n);
 void usarts_setup();
+void usart_rxmode(uint8_t n);
 int usart_getline(int n, char **line);
 void usart_send(uint8_t n, const char *str);
 void usart_putchar(uint8_t n, char ch);
@@ -27,10 +27,19 @@
 #include "hardware.h"
 
 #define BUFFSIZE   (64)
+// transmit ring buffer size (power of 2)
+#define USB_TXRINGSZ    (1024)
+
+// bytes dropped by USB_send() due to full transmit ring
+extern volatile uint32_t USB_txdropped;
+// ==1 when host opened port (set in main.c by control line state request)
+extern uint8_t USB_connected;
 
 void USB_setup();
 void usb_proc();
-void USB_send(const char *buf);
+int USB_send(const char *buf);
+int USB_txpending();
+void USB_txflush();
 int USB_receive(char *buf, int bufsize);
 int USB_configured();
 
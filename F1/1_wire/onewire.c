@@ -19,7 +19,7 @@
 #include "onewire.h"
 #include "user_proto.h"
 
-OW_ID id_array[OW_MAX_NUM]; // 1-wire devices ID buffer (not more than eight)
+OW_ID id_array[OW_MAX_NUM]; // 1-wire devices ID buffer (not more than OW_MAX_NUM)
 uint8_t dev_amount = 0;   // amount of 1-wire devices
 
 
@@ -33,86 +33,151 @@ typedef enum{
 volatile OW_States OW_State = OW_OFF_STATE; // 1-wire state, 0-not runned
 
 void (*ow_process_resdata)() = NULL;
-void wait_reading();
 
-uint16_t tim2_buff[TIM2_DMABUFF_SIZE];
-uint16_t tim2_inbuff[TIM2_DMABUFF_SIZE];
-int tum2buff_ctr = 0;
+/*
+ * Bit engine works in streaming mode: transmit queue keeps bytes (or parts of bytes) to write
+ * or read, DMA buffers are circular and refilled/decoded by half in DMA interrupts, so length
+ * of transaction is limited only by queue (which could be appended while transaction runs)
+ * and amount of data read - by ow_rxbuf.
+ */
+// circular DMA buffers: CCR4 values (slot 0 goes to CCR4 directly, so out[i] is slot i+1) & CCR3 captures
+static uint16_t dma_out[OW_DMABUF_SIZE];
+static uint16_t dma_in[OW_DMABUF_SIZE];
+// transmit queue: data (bits 0..7), amount of bits - 1 (8..10), read flag
+static uint16_t ow_txq[OW_TXQ_SIZE];
+static volatile uint16_t ow_txhead = 0, ow_txtail = 0;
+static uint8_t ow_txbit = 0;        // next bit of ow_txq[ow_txtail]
+// read data (only bits of read slots)
+static uint8_t ow_rxbuf[OW_RXBUF_SIZE];
+static volatile uint16_t ow_rxbits = 0;
+// slots: kind of slot (1 - read) by slot number modulo 64, amount of slots put & decoded
+static uint32_t readmask[2];
+static uint32_t ow_nslots, ow_decoded;
+// idle slot was sent: the rest of transaction is idle too (captures are counted only for real slots)
+static uint8_t ow_idle;
+// DMA transfers: filled into dma_out, done by out & in channels; last transfer with data slot
+static uint32_t out_filled, out_done, in_done;
+static int32_t out_lastreal;
 uint8_t ow_done = 1;
-uint8_t ow_measurements_done = 0;
 
 /**
- * this function sends bits of ow_byte (LSB first) to 1-wire line
- * @param ow_byte - byte to convert
- * @param Nbits   - number of bits to send
- * @param ini     - 1 to zero counter
+ * clear transmit queue and received data
  */
-uint8_t OW_add_byte(uint8_t ow_byte){
-	uint8_t i, byte;
-	for(i = 0; i < 8; i++){
-		if(ow_byte & 0x01){
-			byte = BIT_ONE_P;
-		}else{
-			byte = BIT_ZERO_P;
-		}
-		if(tum2buff_ctr == TIM2_DMABUFF_SIZE){
-			ERR("Tim2 buffer overflow");
-			return 0; // avoid buffer overflow
-		}
-		tim2_buff[tum2buff_ctr++] = byte;
-		ow_byte >>= 1;
+void OW_reset_buffer(){
+	ow_txhead = ow_txtail = 0;
+	ow_txbit = 0;
+	ow_rxbits = 0;
+}
+
+/**
+ * put bits into transmit queue
+ * @param data - data (LSB first)
+ * @param nbits - amount of bits (1..8)
+ * @param read - ==1 for read slots
+ * @return 0 if queue is full
+ */
+uint8_t OW_add_bits(uint8_t data, uint8_t nbits, uint8_t read){
+	uint16_t next = (ow_txhead + 1) % OW_TXQ_SIZE;
+	if(next == ow_txtail){
+		ERR("1-wire queue overflow");
+		return 0;
 	}
-//	INT(tum2buff_ctr);
-//	DBG(" bytes in send buffer\n");
+	ow_txq[ow_txhead] = data | ((uint16_t)(nbits - 1) << 8) | (read ? OW_Q_READ : 0);
+	ow_txhead = next;
 	return 1;
 }
 
-
+/**
+ * this function sends bits of ow_byte (LSB first) to 1-wire line
+ * @param ow_byte - byte to convert
+ */
+uint8_t OW_add_byte(uint8_t ow_byte){
+	return OW_add_bits(ow_byte, 8, 0);
+}
 
 /**
  * Adds Nbytes bytes 0xff  for reading sequence
  */
 uint8_t OW_add_read_seq(uint8_t Nbytes){
-	uint8_t i;
 	if(Nbytes == 0) return 0;
-	Nbytes *= 8; // 8 bits for each byte
-	for(i = 0; i < Nbytes; i++){
-		if(tum2buff_ctr == TIM2_DMABUFF_SIZE){
-			ERR("Tim2 buffer overflow");
-			return 0;
-		}
-		tim2_buff[tum2buff_ctr++] = BIT_READ_P;
-	}
-//	INT(tum2buff_ctr);
-//	DBG(" bytes in send buffer\n");
+	while(Nbytes--)
+		if(!OW_add_bits(0xff, 8, 1)) return 0;
 	return 1;
 }
 
 /**
- * Fill output buffer with data from 1-wire
- * @param start_idx - index from which to start (byte number)
+ * Fill output buffer with data read from 1-wire
+ * @param start_idx - index from which to start (byte number of data read)
  * @param N         - data length (in **bytes**)
  * @outbuf          - where to place data
  */
 void read_from_OWbuf(uint8_t start_idx, uint8_t N, uint8_t *outbuf){
-	start_idx *= 8;
-	uint8_t i, j, last = start_idx + N * 8, byte;
-	if(last >= TIM2_DMABUFF_SIZE) last = TIM2_DMABUFF_SIZE;
-	for(i = start_idx; i < last;){
-		byte = 0;
-		for(j = 0; j < 8; j++){
-			byte >>= 1;
-//			INT(tim2_inbuff[i]);
-//			DBG(" ");
-			if(tim2_inbuff[i++] < ONE_ZERO_BARRIER)
-				byte |= 0x80;
-		}
-		*outbuf++ = byte;
-//		DBG("readed \n");
+	while(N-- && start_idx < OW_RXBUF_SIZE)
+		*outbuf++ = ow_rxbuf[start_idx++];
+}
+
+/**
+ * get one bit of data read
+ * @param idx - bit number
+ */
+uint8_t OW_get_bit(uint16_t idx){
+	return (ow_rxbuf[idx >> 3] >> (idx & 7)) & 1;
+}
+
+/**
+ * amount of bits read in last transaction
+ */
+uint16_t OW_read_bits(){
+	return ow_rxbits;
+}
+
+// next slot value from queue (0 - idle: no pulse, no capture)
+static uint16_t next_slot(){
+	uint16_t e, v;
+	uint32_t s = ow_nslots, bit = 1UL << (s & 31);
+	if(ow_idle || ow_txtail == ow_txhead){
+		ow_idle = 1;
+		return 0;
+	}
+	e = ow_txq[ow_txtail];
+	if(e & OW_Q_READ){
+		v = BIT_READ_P;
+		readmask[(s >> 5) & 1] |= bit;
+	}else{
+		v = ((e >> ow_txbit) & 1) ? BIT_ONE_P : BIT_ZERO_P;
+		readmask[(s >> 5) & 1] &= ~bit;
+	}
+	++ow_nslots;
+	if(++ow_txbit > ((e >> 8) & 7)){
+		ow_txbit = 0;
+		ow_txtail = (ow_txtail + 1) % OW_TXQ_SIZE;
+	}
+	return v;
+}
+
+// fill N positions of dma_out starting from idx
+static void fill_out(uint16_t idx, uint16_t N){
+	while(N--){
+		uint16_t v = next_slot();
+		if(v) out_lastreal = out_filled;
+		dma_out[idx++] = v;
+		++out_filled;
 	}
-//	print_hex(outbuf-N, N);
-//	DBG(" readed\n");
 }
+
+// decode captured slots up to slot number upto
+static void decode_slots(uint32_t upto){
+	while(ow_decoded < upto){
+		uint32_t s = ow_decoded++;
+		if(!(readmask[(s >> 5) & 1] & (1UL << (s & 31)))) continue;
+		if(ow_rxbits >= OW_RXBUF_SIZE * 8) continue; // no place
+		uint8_t *b = &ow_rxbuf[ow_rxbits >> 3], mask = 1 << (ow_rxbits & 7);
+		if(dma_in[s % OW_DMABUF_SIZE] < ONE_ZERO_BARRIER) *b |= mask;
+		else *b &= ~mask;
+		++ow_rxbits;
+	}
+}
+
 // there's a mistake in opencm3, so redefine this if needed (TIM_CCMR2_CC3S_IN_TI1 -> TIM_CCMR2_CC3S_IN_TI4)
 #ifndef TIM_CCMR2_CC3S_IN_TI4
 #define TIM_CCMR2_CC3S_IN_TI4		(2)
@@ -140,10 +205,10 @@ void init_ow_dmatimer(){ // tim2_ch4 - PA3, no remap
 
 	// TIM2_CH4 - DMA1, channel 7
 	dma_channel_reset(DMA1, DMA_CHANNEL7);
-	DMA1_CCR7 = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_16BIT | DMA_CCR_MSIZE_16BIT
-			| DMA_CCR_TEIE | DMA_CCR_TCIE | DMA_CCR_PL_HIGH;
+	DMA1_CCR7 = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_16BIT | DMA_CCR_MSIZE_16BIT | DMA_CCR_CIRC
+			| DMA_CCR_TEIE | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_PL_HIGH;
 	nvic_enable_irq(NVIC_DMA1_CHANNEL7_IRQ); // enable dma1_channel7_isr
-	tum2buff_ctr = 0;
+	OW_reset_buffer();
 	DBG("OW INITED\n");
 #ifdef EBUG
 	gpio_set(GPIOC, GPIO10);
@@ -160,15 +225,21 @@ void run_dmatimer(){
 		DMA_ISR_TEIF1|DMA_ISR_HTIF1|DMA_ISR_TCIF1|DMA_ISR_GIF1; // clear flags
 	DMA1_CCR7 &= ~DMA_CCR_EN; // disable (what if it's enabled?) to set address
 	DMA1_CPAR7 = (uint32_t) &(TIM_CCR4(TIM2)); // dma_set_peripheral_address(DMA1, DMA_CHANNEL7, (uint32_t) &(TIM_CCR4(TIM2)));
-	DMA1_CMAR7 = (uint32_t) &tim2_buff[1]; // dma_set_memory_address(DMA1, DMA_CHANNEL7, (uint32_t)tim2_buff);
-	DMA1_CNDTR7 = tum2buff_ctr-1;//dma_set_number_of_data(DMA1, DMA_CHANNEL7, tum2buff_ctr);
+	ow_nslots = ow_decoded = 0;
+	ow_idle = 0;
+	out_filled = out_done = in_done = 0;
+	out_lastreal = -1;
+	uint16_t first = next_slot();
+	fill_out(0, OW_DMABUF_SIZE);
+	DMA1_CMAR7 = (uint32_t) dma_out; // dma_set_memory_address(DMA1, DMA_CHANNEL7, (uint32_t)dma_out);
+	DMA1_CNDTR7 = OW_DMABUF_SIZE; //dma_set_number_of_data(DMA1, DMA_CHANNEL7, OW_DMABUF_SIZE);
 	// TIM2_CH3 - DMA1, channel 1
 	dma_channel_reset(DMA1, DMA_CHANNEL1);
-	DMA1_CCR1 = DMA_CCR_MINC | DMA_CCR_PSIZE_16BIT | DMA_CCR_MSIZE_16BIT
-			| DMA_CCR_TEIE | DMA_CCR_TCIE | DMA_CCR_PL_HIGH;
+	DMA1_CCR1 = DMA_CCR_MINC | DMA_CCR_PSIZE_16BIT | DMA_CCR_MSIZE_16BIT | DMA_CCR_CIRC
+			| DMA_CCR_TEIE | DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_PL_HIGH;
 	DMA1_CPAR1 = (uint32_t) &(TIM_CCR3(TIM2)); //dma_set_peripheral_address(DMA1, DMA_CHANNEL1, (uint32_t) &(TIM_CCR3(TIM2)));
-	DMA1_CMAR1 = (uint32_t) tim2_inbuff; //dma_set_memory_address(DMA1, DMA_CHANNEL1, (uint32_t) tim2_inbuff);
-	DMA1_CNDTR1 = tum2buff_ctr; //dma_set_number_of_data(DMA1, DMA_CHANNEL1, tum2buff_ctr);
+	DMA1_CMAR1 = (uint32_t) dma_in; //dma_set_memory_address(DMA1, DMA_CHANNEL1, (uint32_t) dma_in);
+	DMA1_CNDTR1 = OW_DMABUF_SIZE; //dma_set_number_of_data(DMA1, DMA_CHANNEL1, OW_DMABUF_SIZE);
 	nvic_enable_irq(NVIC_DMA1_CHANNEL1_IRQ);
 
 	DMA1_CCR7 |= DMA_CCR_EN; //dma_enable_channel(DMA1, DMA_CHANNEL7);
@@ -176,7 +247,7 @@ void run_dmatimer(){
 
 	TIM2_SR = 0; // clear all flags
 	TIM2_ARR = BIT_LEN; // bit length
-	TIM2_CCR4 = tim2_buff[0]; // we should manually set first bit to avoid zero in tim2_inbuff[0]
+	TIM2_CCR4 = first; // we should manually set first bit to avoid zero in dma_in[0]
 	TIM2_EGR = TIM_EGR_UG; // update value of ARR
 	TIM2_CR1 = TIM_CR1_ARPE; // bufferize ARR/CCR
 
@@ -187,9 +258,6 @@ void run_dmatimer(){
 #ifdef EBUG
 	gpio_clear(GPIOC, GPIO10);
 #endif
-/*	DBG("RUN transfer of ");
-	INT(tum2buff_ctr);
-	DBG(" bits\n");*/
 }
 
 uint16_t rstat = 0, lastcc3 = 3;
@@ -236,35 +304,50 @@ void tim2_isr(){
 	}
 }
 
+// stop transaction: all slots done
+static void ow_stop(){
+	TIM2_CR1 &= ~TIM_CR1_CEN;    // timer_disable_counter(TIM2);
+	TIM2_DIER = 0;
+	DMA1_CCR7 &= ~DMA_CCR_EN; // disable DMA1 channels 7 & 1
+	DMA1_CCR1 &= ~DMA_CCR_EN;
+	nvic_disable_irq(NVIC_DMA1_CHANNEL1_IRQ);
+	DMA1_IFCR = DMA_ISR_GIF7 | DMA_ISR_GIF1; // clear all flags
+	decode_slots(ow_nslots); // the rest of captures
+	ow_done = 1;
+#ifdef EBUG
+	gpio_set(GPIOC, GPIO10);
+#endif
+}
+
 /**
- * DMA interrupt in 1-wire mode
+ * DMA interrupt in 1-wire mode: captures of half buffer are ready
  */
 void dma1_channel1_isr(){
-		//	int i;
-	if(DMA1_ISR & DMA_ISR_TCIF1){
-#ifdef EBUG
-		gpio_set(GPIOC, GPIO10);
-#endif
-		DMA1_IFCR = DMA_IFCR_CTCIF1;
-		TIM2_CR1 &= ~TIM_CR1_CEN;    // timer_disable_counter(TIM2);
-		DMA1_CCR1 &= ~DMA_CCR_EN; // disable DMA1 channel 1
-		nvic_disable_irq(NVIC_DMA1_CHANNEL1_IRQ);
-		ow_done = 1;
-/*			for(i = 0; i < tum2buff_ctr; i++){
-				print_int(tim2_inbuff[i]);
-				P(" ");
-			}
-			P("\n");*/
+	if(DMA1_ISR & (DMA_ISR_HTIF1 | DMA_ISR_TCIF1)){
+		DMA1_IFCR = DMA_IFCR_CHTIF1 | DMA_IFCR_CTCIF1;
+		in_done += OW_DMABUF_SIZE / 2;
+		decode_slots(in_done);
 	}else if(DMA1_ISR & DMA_ISR_TEIF1){
 		DMA1_IFCR = DMA_IFCR_CTEIF1;
 		DBG("DMA in transfer error\n");
 	}
 }
 
+/**
+ * DMA interrupt: half of output buffer sent, refill it or stop if the last slot is done
+ * (transfer N loads slot which starts after slot N, so slot of transfer N is done after
+ *  transfer N+2; as there's no captures in idle slots, the end is found here)
+ */
 void dma1_channel7_isr(){
-	if(DMA1_ISR & DMA_ISR_TCIF7){
-		DMA1_IFCR = DMA_IFCR_CTCIF7; // clear flag
-		DMA1_CCR7 &= ~DMA_CCR_EN; // disable DMA1 channel 7
+	if(DMA1_ISR & (DMA_ISR_HTIF7 | DMA_ISR_TCIF7)){
+		uint16_t idx = (DMA1_ISR & DMA_ISR_HTIF7) ? 0 : OW_DMABUF_SIZE / 2;
+		DMA1_IFCR = DMA_IFCR_CHTIF7 | DMA_IFCR_CTCIF7;
+		out_done += OW_DMABUF_SIZE / 2;
+		if(ow_idle && (int32_t)out_done > out_lastreal + 2){
+			ow_stop();
+			return;
+		}
+		fill_out(idx, OW_DMABUF_SIZE / 2);
 	}else if(DMA1_ISR & DMA_ISR_TEIF7){
 		DMA1_IFCR = DMA_IFCR_CTEIF7;
 		DBG("DMA out transfer error\n");
@@ -325,55 +408,6 @@ void OW_process(){
 }
 
 
-uint8_t *read_buf = NULL;    // buffer for storing readed data
-/**
- * fill ID buffer with readed data
- */
-void fill_buff_with_data(){
-	ow_process_resdata = NULL;
-	if(!read_buf) return;
-	read_from_OWbuf(1, 8, read_buf);
-	int i, j;
-	P("Readed ID: ");
-	for(i = 0; i < 8; ++i){
-		print_hex(&read_buf[i], 1);
-		usb_send(' ');
-	}
-	usb_send('\n');
-	// now check stored ROMs
-	for(i = 0; i < dev_amount; ++i){
-		uint8_t *ROM = id_array[i].bytes;
-		for(j = 0; j < 8; j++)
-			if(ROM[j] != read_buf[j]) break;
-		if(j == 8){ // we found this cell
-			DBG("Such ID exists\n");
-			goto ret;
-		}
-	}
-	++dev_amount;
-ret:
-	read_buf = NULL;
-}
-
-/**
- * fill Nth array with identificators
- */
-//uint8_t comtosend = 0;
-void OW_fill_next_ID(){
-	if(dev_amount >= OW_MAX_NUM){
-		ERR("No memory left for new device\n");
-		return;
-	}
-	ow_data_ready = 0;
-	OW_State = OW_RESET_STATE;
-	OW_reset_buffer();
-	OW_add_byte(OW_READ_ROM);
-	OW_add_read_seq(8); // wait for 8 bytes
-	read_buf = id_array[dev_amount].bytes;
-	ow_process_resdata = fill_buff_with_data;
-	DBG("wait for ID\n");
-}
-
 /**
  * Procedure of 1-wire communications
  * variables:
@@ -437,118 +471,204 @@ int32_t gettemp(uint8_t *scratchpad){
 	return t;
 }
 
-int32_t temperature = ERR_TEMP_VAL;
-int8_t Ncur = 0;
 /**
- * get temperature from buffer
+ * Dallas/Maxim CRC8 (polynome x^8 + x^5 + x^4 + 1, LSB first)
+ * @param buf - data
+ * @param len - its length
+ * @return CRC (0 if buf includes right CRC in its last byte)
  */
-void convert_next_temp(){
-	uint8_t scratchpad[9];
+uint8_t OW_crc8(const uint8_t *buf, uint8_t len){
+	uint8_t crc = 0, i, b, mix;
+	while(len--){
+		b = *buf++;
+		for(i = 0; i < 8; ++i){
+			mix = (crc ^ b) & 1;
+			crc >>= 1;
+			if(mix) crc ^= 0x8c;
+			b >>= 1;
+		}
+	}
+	return crc;
+}
+
+/*
+ * ROM search (Maxim AN187): each pass selects one device reading two bits (ROM bit and its
+ * complement) for all 64 ROM bits and writing the chosen direction. On discrepancy (both
+ * bits are zero) the pass goes by zero branch if it is new, so the next pass will take
+ * the "one" branch at the last such position. As the bit engine can't decide what to write
+ * in the middle of DMA run, each bit needs its own run: direction of previous bit + 2 read slots.
+ */
+static uint8_t srch_rom[8];     // ROM of current pass
+static uint8_t srch_bit;        // number of ROM bit to read
+static uint8_t srch_lastdisc;   // last discrepancy of previous pass (1..64, 0 - no)
+static uint8_t srch_lastzero;   // last discrepancy where zero branch was taken in this pass
+static uint8_t srch_retry;      // repeats of pass after CRC error
+uint32_t ow_crc_errors = 0;     // amount of CRC errors in ROMs and scratchpads
+static void search_step();
+
+static void search_done(){
 	ow_process_resdata = NULL;
-	if(dev_amount < 2){
-		read_from_OWbuf(2, 9, scratchpad);
-	}else{
-		read_from_OWbuf(10, 9, scratchpad);
+	P("Found ");
+	print_int(dev_amount);
+	P(" devices\n");
+}
+
+// start new search pass (or repeat of pass after CRC error)
+static void search_pass(){
+	srch_bit = 0;
+	srch_lastzero = 0;
+	// directions below last discrepancy are taken from the last good ROM, not from bad one
+	if(dev_amount) memcpy(srch_rom, id_array[dev_amount - 1].bytes, 8);
+	ow_data_ready = 0;
+	OW_State = OW_RESET_STATE;
+	OW_reset_buffer();
+	OW_add_byte(OW_SEARCH_ROM);
+	OW_add_bits(0xff, 2, 1);
+	ow_process_resdata = search_step;
+}
+
+// got ROM bit & its complement: write direction & read next
+static void search_step(){
+	uint16_t n = OW_read_bits();
+	uint8_t idb = OW_get_bit(n - 2), cmpb = OW_get_bit(n - 1), dir;
+	uint8_t byte = srch_bit >> 3, mask = 1 << (srch_bit & 7);
+	if(idb && cmpb){ // no devices answered
+		ERR("ROM search error");
+		search_done();
+		return;
+	}
+	if(idb != cmpb) dir = idb; // all devices left have the same bit
+	else{ // discrepancy
+		if(srch_bit + 1 < srch_lastdisc) dir = (srch_rom[byte] & mask) ? 1 : 0;
+		else dir = (srch_bit + 1 == srch_lastdisc);
+		if(!dir) srch_lastzero = srch_bit + 1;
+	}
+	if(dir) srch_rom[byte] |= mask;
+	else srch_rom[byte] &= ~mask;
+	if(++srch_bit < 64){
+		OW_State = OW_SEND_STATE;
+		OW_reset_buffer();
+		OW_add_bits(dir, 1, 0);
+		OW_add_bits(0xff, 2, 1);
+		return;
+	}
+	// all 64 bits read: the last direction isn't sent as the next pass starts with reset
+	if(OW_crc8(srch_rom, 8)){
+		++ow_crc_errors;
+		ERR("Bad ROM CRC");
+		if(++srch_retry < 3) search_pass();
+		else search_done();
+		return;
 	}
-	temperature = gettemp(scratchpad);
-	DBG("Readed temperature: ");
-	INT(temperature);
-	DBG("/10 degrC\n");
+	srch_retry = 0;
+	memcpy(id_array[dev_amount].bytes, srch_rom, 8);
+	P("Found ID: ");
+	OW_printID(dev_amount);
+	++dev_amount;
+	srch_lastdisc = srch_lastzero;
+	if(srch_lastdisc == 0 || dev_amount == OW_MAX_NUM) search_done();
+	else search_pass();
 }
 
 /**
- * read next stored thermometer
+ * find all devices on the bus (result is in id_array)
+ */
+void OW_search(){
+	dev_amount = 0;
+	srch_lastdisc = 0;
+	srch_retry = 0;
+	search_pass();
+}
+
+/*
+ * Scan of all sensors: one SKIP_ROM+CONVERT_T for all, polling of read slots until the
+ * slowest sensor ends conversion, then MATCH_ROM+READ_SCRATCHPAD for each device one by one
+ * (each read is one DMA run just after previous).
  */
-void OW_read_next_temp(){
+int32_t OW_temps[OW_MAX_NUM];   // temperatures got by last scan
+uint8_t ow_scan_done = 0;
+static uint8_t scan_idx;        // device read
+
+static void scan_read();
+
+// scratchpad of current device read
+static void scan_got(){
+	uint8_t scratchpad[9];
+	read_from_OWbuf(0, 9, scratchpad);
+	if(OW_crc8(scratchpad, 9)){
+		++ow_crc_errors;
+		OW_temps[scan_idx] = ERR_TEMP_VAL;
+	}else OW_temps[scan_idx] = gettemp(scratchpad);
+	if(++scan_idx < dev_amount) scan_read();
+	else{
+		ow_process_resdata = NULL;
+		ow_scan_done = 1;
+		OW_print_temps();
+	}
+}
+
+static void scan_read(){
+	uint8_t i;
 	ow_data_ready = 0;
 	OW_State = OW_RESET_STATE;
 	OW_reset_buffer();
-	int i;
 	if(dev_amount < 2){
-		Ncur = -1;
 		OW_add_byte(OW_SKIP_ROM);
 	}else{
-		if(++Ncur >= dev_amount) Ncur = 0;
 		OW_add_byte(OW_MATCH_ROM);
-		uint8_t *ROM = id_array[Ncur].bytes;
 		for(i = 0; i < 8; ++i)
-			OW_add_byte(ROM[i]);
+			OW_add_byte(id_array[scan_idx].bytes[i]);
 	}
 	OW_add_byte(OW_READ_SCRATCHPAD);
-	OW_add_read_seq(9); // wait for 9 bytes - ROM
-	ow_process_resdata = convert_next_temp;
+	OW_add_read_seq(9);
+	ow_process_resdata = scan_got;
 }
 
-void wait_reading(){
+// poll: bus is zero while any device converts temperature
+static void scan_wait(){
 	uint8_t bt;
 	read_from_OWbuf(0, 1, &bt);
 	if(bt == 0xff){ // the conversion is done!
-		ow_measurements_done = 1;
-		ow_process_resdata = NULL;
-		DBG("Measurements done!\n");
-	}else{
-		OW_State = OW_SEND_STATE;
-		OW_reset_buffer();
-		ow_data_ready = 0;
-		OW_add_read_seq(1); // send read seq waiting for end of conversion
+		scan_idx = 0; // if devices are unknown, read single one by SKIP_ROM
+		scan_read();
+		return;
 	}
+	OW_State = OW_SEND_STATE;
+	OW_reset_buffer();
+	ow_data_ready = 0;
+	OW_add_read_seq(1);
 }
 
-void OW_send_read_seq(){
+/**
+ * start temperature conversion of all sensors and read them all
+ */
+void OW_scan(){
+	ow_scan_done = 0;
 	ow_data_ready = 0;
-	ow_measurements_done = 0;
 	OW_State = OW_RESET_STATE;
 	OW_reset_buffer();
 	OW_add_byte(OW_SKIP_ROM);
 	OW_add_byte(OW_CONVERT_T);
 	OW_add_read_seq(1); // send read seq waiting for end of conversion
-	ow_process_resdata = wait_reading;
+	ow_process_resdata = scan_wait;
 }
-/*
- * scan 1-wire bus
- * WARNING! The procedure works in real-time, so it is VERY LONG
- * 		num - max number of devices
- * 		buf - array for devices' ID's (8*num bytes)
- * return amount of founded devices
- *
-uint8_t OW_Scan(uint8_t *buf, uint8_t num){
-	unsigned long path,next,pos;
-	uint8_t bit,chk;
-	uint8_t cnt_bit, cnt_byte, cnt_num;
-	path=0;
-	cnt_num=0;
-	do{
-		//(issue the 'ROM search' command)
-		if( 0 == OW_WriteCmd(OW_SEARCH_ROM) ) return 0;
-		OW_Wait_TX();
-		OW_ClearBuff(); // clear RX buffer
-		next = 0; // next path to follow
-		pos = 1;  // path bit pointer
-		for(cnt_byte = 0; cnt_byte != 8; cnt_byte++){
-			buf[cnt_num*8 + cnt_byte] = 0;
-			for(cnt_bit = 0; cnt_bit != 8; cnt_bit++){
-				//(read two bits, 'bit' and 'chk', from the 1-wire bus)
-				OW_SendBits(OW_R, 2);
-				OW_Wait_TX();
-				bit = -----OW_ReadByte();
-				chk = bit & 0x02; // bit 1
-				bit = bit & 0x01; // bit 0
-				if(bit && chk) return 0; // error
-				if(!bit && !chk){ // collision, both are zero
-					if (pos & path) bit = 1;     // if we've been here before
-					else next = (path&(pos-1)) | pos; // else, new branch for next
-					pos <<= 1;
-				}
-				//(save this bit as part of the current ROM value)
-				if (bit) buf[cnt_num*8 + cnt_byte]|=(1<<cnt_bit);
-				//(write 'bit' to the 1-wire bus)
-				OW_SendBits(bit, 1);
-				OW_Wait_TX();
-			}
-		}
-		path=next;
-		cnt_num++;
-	}while(path && cnt_num < num);
-	return cnt_num;
-}*/
 
+/**
+ * print temperatures got by last scan
+ */
+void OW_print_temps(){
+	uint8_t i, N = dev_amount ? dev_amount : 1;
+	for(i = 0; i < N; ++i){
+		if(dev_amount) OW_printID(i);
+		P("T=");
+		if(OW_temps[i] == ERR_TEMP_VAL) P("error");
+		else{
+			print_int(OW_temps[i]);
+			P("/10 degrC");
+		}
+		newline();
+	}
+	P("CRC errors: ");
+	print_int(ow_crc_errors);
+	newline();
+}
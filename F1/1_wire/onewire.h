@@ -24,8 +24,14 @@
 #include "main.h"
 #include "hardware_ini.h"
 
-// 20 bytes x 8bits
-#define TIM2_DMABUFF_SIZE 160
+// circular DMA buffers (slots), refilled by halves
+#define OW_DMABUF_SIZE    32
+// transmit queue (bytes or parts of bytes)
+#define OW_TXQ_SIZE       64
+// buffer for data read (bytes)
+#define OW_RXBUF_SIZE     64
+// flag of read slots in transmit queue
+#define OW_Q_READ         (1 << 11)
 
 // freq = 1MHz
 // ARR values: 1000 for reset, 100 for data in/out
@@ -48,39 +54,39 @@ typedef struct{
 
 extern OW_ID id_array[];
 
-#define OW_MAX_NUM 8
+#define OW_MAX_NUM 16
 
 void init_ow_dmatimer();
 void run_dmatimer();
 extern uint8_t ow_done;
 #define OW_READY()  (ow_done)
 void ow_dma_on();
+void OW_reset_buffer();
+uint8_t OW_add_bits(uint8_t data, uint8_t nbits, uint8_t read);
 uint8_t OW_add_byte(uint8_t ow_byte);
 uint8_t OW_add_read_seq(uint8_t Nbytes);
 void read_from_OWbuf(uint8_t start_idx, uint8_t N, uint8_t *outbuf);
+uint8_t OW_get_bit(uint16_t idx);
+uint16_t OW_read_bits();
 void ow_reset();
 uint8_t OW_get_reset_status();
 
-extern int tum2buff_ctr;
-#define OW_reset_buffer()   do{tum2buff_ctr = 0;}while(0)
-
 extern uint8_t ow_data_ready;
-extern uint8_t ow_measurements_done;
+extern uint8_t ow_scan_done;
 #define OW_DATA_READY()       (ow_data_ready)
 #define OW_CLEAR_READY_FLAG() do{ow_data_ready = 0;}while(0)
-#define OW_MEASUREMENTS_DONE()  (ow_measurements_done)
-#define OW_CLEAR_DONE_FLAG()  do{ow_measurements_done = 0;}while(0)
+#define OW_SCAN_DONE()        (ow_scan_done)
+
+extern uint8_t dev_amount;
+extern int32_t OW_temps[];
+extern uint32_t ow_crc_errors;
 
 void OW_process();
-void OW_fill_next_ID();
-void OW_send_read_seq();
 uint8_t OW_Send(uint8_t sendReset, uint8_t *command, uint8_t cLen);
-
-extern int32_t temperature;
-extern int8_t Ncur;
-void OW_read_next_temp();
-#define OW_current_temp()  (temperature)
-#define OW_current_num()   (Ncur)
+uint8_t OW_crc8(const uint8_t *buf, uint8_t len);
+void OW_search();
+void OW_scan();
+void OW_print_temps();
 
 /*
  * thermometer commands
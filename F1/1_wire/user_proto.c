@@ -45,9 +45,9 @@ void help(){
 	P("T\tshow current approx. time\n");
 	P("1\tswitch LED D1 state\n");
 	P("2\tswitch LED D2 state\n");
-	P("R\tstart reading temperature\n");
-	P("P\tread DS18 ID\n");
-	P("Q\tget temperature\n");
+	P("R\tconvert & read temperature of all sensors\n");
+	P("P\tsearch IDs of all devices\n");
+	P("Q\tshow temperatures got by last scan\n");
 }
 
 /**
@@ -100,16 +100,16 @@ int parse_incoming_buf(char *buf, int len){
 				newline();
 			break;
 			case 'P':
-				OW_fill_next_ID();
+				OW_search();
 			break;
 			case 'Q':
-				if(OW_MEASUREMENTS_DONE())
-					OW_read_next_temp();
+				if(OW_SCAN_DONE())
+					OW_print_temps();
 				else
 					P("Wait for measurements ends or start another\n");
 			break;
 			case 'R':
-				OW_send_read_seq();
+				OW_scan();
 			break;
 			case '\n': // show newline, space and tab as is
 			case '\r':
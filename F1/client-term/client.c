@@ -30,6 +30,9 @@
 #include <string.h>			// memcpy
 #include <stdint.h>			// int types
 #include <sys/time.h>		// gettimeofday
+#include <sys/epoll.h>		// EPOLLIN
+
+#include "hostio.h"
 
 #define BUFLEN 1024
 
@@ -37,13 +40,17 @@ double t0; // start time
 
 FILE *fout = NULL; // file for messages duplicating
 char *comdev = "/dev/ttyUSB0";
-int BAUD_RATE = B115200;
-struct termio oldtty, tty; // TTY flags
+int BAUD_RATE = 115200;
 struct termios oldt, newt; // terminal flags
-int comfd; // TTY fd
+ttyio tty = {.fd = -1}; // TTY (fd < 0 while not opened)
+int oldcmd = -1; // last command sent (to remove its echo from file)
 
 #define DBG(...) do{fprintf(stderr, __VA_ARGS__);}while(0)
 
+#ifndef _U_
+#define _U_    __attribute__((__unused__))
+#endif
+
 /**
  * function for different purposes that need to know time intervals
  * @return double value: time in seconds
@@ -62,13 +69,30 @@ double dtime(){
  */
 void quit(int ex_stat){
 	tcsetattr(STDIN_FILENO, TCSANOW, &oldt); // return terminal to previous state
-	ioctl(comfd, TCSANOW, &oldtty ); // return TTY to previous state
-	close(comfd);
+	ttyio_close(&tty); // return TTY to previous state
 	if(fout) fclose(fout);
 	printf("Exit! (%d)\n", ex_stat);
 	exit(ex_stat);
 }
 
+/**
+ * Line (or its beginning if there's no newline for a long time) from TTY
+ */
+void tty_frame(_U_ void *arg, char *data, _U_ size_t len, int complete){
+	if(!data){ // disconnect or other troubles
+		fprintf(stderr, "USB error or disconnected!\n");
+		quit(1);
+	}
+	printf("%s%s", data, complete ? "\n" : "");
+	if(!fout) return;
+	if(oldcmd > -1 && data[0] == (char)oldcmd){ // remove echo of command
+		++data;
+		oldcmd = -1;
+		if(!*data && complete) return;
+	}
+	fprintf(fout, "%s%s", data, complete ? "\n" : "");
+}
+
 /**
  * Open & setup TTY, terminal
  */
@@ -79,86 +103,11 @@ void tty_init(){
 	newt.c_lflag &= ~(ICANON | ECHO);
 	if(tcsetattr(STDIN_FILENO, TCSANOW, &newt) < 0) quit(-2);
 	printf("\nOpen port...\n");
-	if ((comfd = open(comdev,O_RDWR|O_NOCTTY|O_NONBLOCK)) < 0){
+	if(ttyio_open(&tty, comdev, BAUD_RATE, '\n', tty_frame, NULL)){
 		fprintf(stderr,"Can't use port %s\n",comdev);
 		quit(1);
 	}
-	printf(" OK\nGet current settings...\n");
-	if(ioctl(comfd,TCGETA,&oldtty) < 0) exit(-1); // Get settings
-	tty = oldtty;
-	tty.c_lflag     = 0; // ~(ICANON | ECHO | ECHOE | ISIG)
-	tty.c_oflag     = 0;
-	tty.c_cflag     = BAUD_RATE|CS8|CREAD|CLOCAL; // 9.6k, 8N1, RW, ignore line ctrl
-	tty.c_cc[VMIN]  = 0;  // non-canonical mode
-	tty.c_cc[VTIME] = 5;
-	if(ioctl(comfd,TCSETA,&tty) < 0) exit(-1); // set new mode
 	printf(" OK\n");
-	tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-}
-
-/**
- * getchar() without echo
- * wait until at least one character pressed
- * @return character readed
- *
-int mygetchar(){
-	int ret;
-	do ret = read_console();
-	while(ret == 0);
-	return ret;
-}*/
-
-/**
- * read both tty & console
- * @param buff (o)    - buffer for messages readed from tty
- * @param length (io) - buff's length (return readed len or 0)
- * @param rb (o)      - byte readed from console or -1
- * @return 1 if something was readed here or there
- */
-int read_tty_and_console(char *buff, size_t *length, int *rb){
-	ssize_t L;
-	// ssize_t l;
-	size_t buffsz = *length;
-	struct timeval tv;
-	int sel, retval = 0;
-	fd_set rfds;
-	FD_ZERO(&rfds);
-	FD_SET(STDIN_FILENO, &rfds);
-	FD_SET(comfd, &rfds);
-	tv.tv_sec = 0; tv.tv_usec = 10000;
-	sel = select(comfd + 1, &rfds, NULL, NULL, &tv);
-	if(sel > 0){
-		if(FD_ISSET(STDIN_FILENO, &rfds)){
-			*rb = getchar();
-			retval = 1;
-		}else{
-			*rb = -1;
-		}
-		if(FD_ISSET(comfd, &rfds)){
-			if((L = read(comfd, buff, buffsz)) < 1){ // disconnect or other troubles
-				fprintf(stderr, "USB error or disconnected!\n");
-				quit(1);
-			}else{
-				if(L == 0){ // USB disconnected
-					fprintf(stderr, "USB disconnected!\n");
-					quit(1);
-				}
-				// all OK continue reading
-		/*		DBG("readed %zd bytes, try more.. ", L);
-				buffsz -= L;
-				while(buffsz > 0 && (l = read(comfd, buff+L, buffsz)) > 0){
-					L += l;
-					buffsz -= l;
-				}
-				DBG("full len: %zd\n", L); */
-				*length = (size_t) L;
-				retval = 1;
-			}
-		}else{
-			*length = 0;
-		}
-	}
-	return retval;
 }
 
 void help(){
@@ -173,7 +122,8 @@ void con_sig(int rb){
 	if(rb < 1) return;
 	if(rb == 'q') quit(0); // q == exit
 	cmd = (char) rb;
-	write(comfd, &cmd, 1);
+	ttyio_write(&tty, &cmd, 1);
+	oldcmd = rb;
 	/*switch(rb){
 		case 'h':
 			help();
@@ -184,6 +134,15 @@ void con_sig(int rb){
 	}*/
 }
 
+/**
+ * Console input
+ */
+void console_event(_U_ void *arg, _U_ uint32_t events){
+	char c;
+	if(read(STDIN_FILENO, &c, 1) == 1) con_sig((unsigned char)c);
+	else quit(0);
+}
+
 /**
  * Get integer value from buffer
  * @param buff (i) - buffer with int
@@ -202,43 +161,7 @@ uint32_t get_int(char *buff, size_t len){
 	return data;
 }
 
-/**
- * Copy line by line buffer buff to file removing cmd starting from newline
- * @param buffer - data to put into file
- * @param cmd - symbol to remove from line startint (if found, change *cmd to (-1)
- * 			or NULL, (-1) if no command to remove
- */
-void copy_buf_to_file(char *buffer, int *cmd){
-	char *buff, *line, *ptr;
-	if(!cmd || *cmd < 0){
-		fprintf(fout, "%s", buffer);
-		return;
-	}
-	buff = strdup(buffer), ptr = buff;
-	do{
-		if(!*ptr) break;
-		if(ptr[0] == (char)*cmd){
-			*cmd = -1;
-			ptr++;
-			if(ptr[0] == '\n') ptr++;
-			if(!*ptr) break;
-		}
-		line = ptr;
-		ptr = strchr(buff, '\n');
-		if(ptr){
-			*ptr++ = 0;
-			//fprintf(fout, "%s\n", line);
-		}//else
-			//fprintf(fout, "%s", line); // no newline found in buffer
-		fprintf(fout, "%s\n", line);
-	}while(ptr);
-	free(buff);
-}
-
 int main(int argc, char *argv[]){
-	int rb, oldcmd = -1;
-	char buff[BUFLEN+1];
-	size_t L;
 	if(argc == 2){
 		fout = fopen(argv[1], "a");
 		if(!fout){
@@ -253,21 +176,10 @@ int main(int argc, char *argv[]){
 	signal(SIGQUIT, SIG_IGN);	// ctrl+\   .
 	signal(SIGTSTP, SIG_IGN);	// ctrl+Z
 	setbuf(stdout, NULL);
+	if(hostio_add(STDIN_FILENO, EPOLLIN, console_event, NULL)) quit(-3);
 	t0 = dtime();
 	while(1){
-		L = BUFLEN;
-		if(read_tty_and_console(buff, &L, &rb)){
-			if(rb > 0){
-				con_sig(rb);
-				oldcmd = rb;
-			}
-			if(L){
-				buff[L] = 0;
-				printf("%s", buff);
-				if(fout){
-					copy_buf_to_file(buff, &oldcmd);
-				}
-			}
-		}
+		// sleep till events; show incomplete line (e.g. echo) if nothing comes after it
+		if(hostio_poll(tty.ilen ? 50 : -1) == 0) ttyio_flushin(&tty);
 	}
 }
@@ -0,0 +1,362 @@
+/*
+ * hostio.c - event-driven serial I/O for host clients
+ *
+ * Copyright 2015 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#include <unistd.h>			// read, write, close
+#include <sys/ioctl.h>		// ioctl
+#include <asm/termbits.h>	// termios2: any baudrate (don't include termios.h here!)
+#include <sys/epoll.h>		// epoll
+#include <fcntl.h>			// open
+#include <errno.h>			// errno
+#include <stdio.h>			// vsnprintf
+#include <stdlib.h>			// malloc
+#include <string.h>			// memchr, memmove
+#include <stdarg.h>			// va_list
+
+#include "hostio.h"
+
+#define DBG(...) do{fprintf(stderr, __VA_ARGS__);}while(0)
+
+/*
+ * Event loop
+ */
+typedef struct{
+	int fd;             // -1 - free
+	hostio_cb cb;
+	void *arg;
+} handler;
+
+static int epfd = -1;
+static handler handlers[HOSTIO_MAXFD];
+
+/**
+ * Create event loop
+ * @return 0 if all OK
+ */
+int hostio_init(){
+	int i;
+	if(epfd > -1) return 0;
+	if((epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+		perror("epoll_create1()");
+		return -1;
+	}
+	for(i = 0; i < HOSTIO_MAXFD; ++i) handlers[i].fd = -1;
+	return 0;
+}
+
+static handler *find_handler(int fd){
+	int i;
+	for(i = 0; i < HOSTIO_MAXFD; ++i)
+		if(handlers[i].fd == fd) return &handlers[i];
+	return NULL;
+}
+
+/**
+ * Add descriptor to event loop
+ * @param events - EPOLLIN, EPOLLOUT etc
+ * @param cb     - callback for its events
+ * @return 0 if all OK
+ */
+int hostio_add(int fd, uint32_t events, hostio_cb cb, void *arg){
+	struct epoll_event ev;
+	handler *h;
+	if(hostio_init()) return -1;
+	if(!(h = find_handler(-1))){
+		DBG("Too many descriptors\n");
+		return -1;
+	}
+	ev.events = events;
+	ev.data.ptr = h;
+	if(epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev)){
+		perror("epoll_ctl()");
+		return -1;
+	}
+	h->cb = cb;
+	h->arg = arg;
+	h->fd = fd;
+	return 0;
+}
+
+/**
+ * Change events of descriptor (could be called from any thread: epoll_wait will get them)
+ */
+int hostio_mod(int fd, uint32_t events){
+	struct epoll_event ev;
+	handler *h = find_handler(fd);
+	if(!h) return -1;
+	ev.events = events;
+	ev.data.ptr = h;
+	return epoll_ctl(epfd, EPOLL_CTL_MOD, fd, &ev);
+}
+
+/**
+ * Remove descriptor from event loop
+ */
+int hostio_del(int fd){
+	handler *h = find_handler(fd);
+	if(!h) return -1;
+	h->fd = -1;
+	return epoll_ctl(epfd, EPOLL_CTL_DEL, fd, NULL);
+}
+
+/**
+ * Wait for events & run callbacks
+ * @param timeout_ms - max waiting time (-1 - infinity)
+ * @return amount of events, 0 on timeout or -1 on error
+ */
+int hostio_poll(int timeout_ms){
+	struct epoll_event ev[HOSTIO_MAXFD];
+	int i, n;
+	if(epfd < 0) return -1;
+	n = epoll_wait(epfd, ev, HOSTIO_MAXFD, timeout_ms);
+	if(n < 0){
+		if(errno == EINTR) return 0;
+		perror("epoll_wait()");
+		return -1;
+	}
+	for(i = 0; i < n; ++i){
+		handler *h = (handler*)ev[i].data.ptr;
+		if(h->fd > -1) h->cb(h->arg, ev[i].events);
+	}
+	return n;
+}
+
+/*
+ * TTY
+ */
+
+/**
+ * Set baudrate: any value (not only standard Bxxx) by termios2
+ * @return 0 if all OK
+ */
+int ttyio_setspeed(int fd, int baudrate){
+	struct termios2 tty;
+	if(ioctl(fd, TCGETS2, &tty)){
+		perror("TCGETS2");
+		return -1;
+	}
+	tty.c_cflag &= ~(CBAUD | (CBAUD << IBSHIFT));
+	tty.c_cflag |= BOTHER | (BOTHER << IBSHIFT);
+	tty.c_ispeed = tty.c_ospeed = baudrate;
+	if(ioctl(fd, TCSETS2, &tty)){
+		perror("TCSETS2");
+		return -1;
+	}
+	return 0;
+}
+
+// write as much of output buffer as possible; should be called with locked mutex
+static void write_out(ttyio *t){
+	ssize_t L;
+	while(t->ohead > t->otail){
+		L = write(t->fd, t->obuf + t->otail, t->ohead - t->otail);
+		if(L < 0){
+			if(errno == EINTR) continue;
+			if(errno != EAGAIN) perror("write()");
+			break;
+		}
+		++t->nwritecalls;
+		t->nwritten += L;
+		t->otail += L;
+	}
+	if(t->otail == t->ohead) t->otail = t->ohead = 0;
+	// wait for EPOLLOUT only while there's something to write
+	int events = EPOLLIN | ((t->ohead > t->otail) ? EPOLLOUT : 0);
+	if(events != t->events){
+		t->events = events;
+		hostio_mod(t->fd, events);
+	}
+}
+
+// split input buffer into frames, move the rest to buffer start
+static void split_frames(ttyio *t){
+	char *start = t->ibuf, *end = t->ibuf + t->ilen, *d;
+	while((d = memchr(start + t->iscan, t->delim, end - start - t->iscan))){
+		*d = 0;
+		t->frame(t->arg, start, d - start, 1);
+		start = d + 1;
+		t->iscan = 0;
+	}
+	t->ilen = end - start;
+	t->iscan = t->ilen;
+	if(t->ilen == TTYIO_IBUFSZ - 1){ // buffer is full: give data as is
+		ttyio_flushin(t);
+		return;
+	}
+	if(start != t->ibuf && t->ilen) memmove(t->ibuf, start, t->ilen);
+}
+
+// epoll callback
+static void tty_event(void *arg, uint32_t events){
+	ttyio *t = (ttyio*)arg;
+	ssize_t L;
+	if(events & EPOLLOUT){
+		pthread_mutex_lock(&t->mutex);
+		write_out(t);
+		pthread_mutex_unlock(&t->mutex);
+	}
+	if(events & (EPOLLIN | EPOLLHUP | EPOLLERR)){
+		while(1){
+			L = read(t->fd, t->ibuf + t->ilen, TTYIO_IBUFSZ - 1 - t->ilen);
+			if(L < 0 && errno == EINTR) continue;
+			if(L < 0 && errno == EAGAIN) break;
+			if(L < 1){ // disconnect or other troubles
+				if(L < 0) perror("read()");
+				hostio_del(t->fd);
+				t->frame(t->arg, NULL, 0, 0);
+				return;
+			}
+			++t->nreadcalls;
+			t->nread += L;
+			t->ilen += L;
+			split_frames(t);
+		}
+	}
+}
+
+/**
+ * Open & setup TTY (8N1, raw mode, non-blocking) and add it to event loop
+ * @param dev      - device path
+ * @param baudrate - any baudrate
+ * @param delim    - frame delimiter
+ * @param frame    - callback for frames (called with data == NULL on disconnect)
+ * @return 0 if all OK
+ */
+int ttyio_open(ttyio *t, const char *dev, int baudrate, char delim, ttyio_framecb frame, void *arg){
+	struct termios2 tty;
+	memset(t, 0, sizeof(ttyio));
+	t->delim = delim;
+	t->frame = frame;
+	t->arg = arg;
+	pthread_mutex_init(&t->mutex, NULL);
+	if((t->fd = open(dev, O_RDWR | O_NOCTTY | O_NONBLOCK)) < 0){
+		fprintf(stderr, "Can't use port %s\n", dev);
+		return -1;
+	}
+	if(ioctl(t->fd, TCGETS2, &tty)){
+		perror("TCGETS2");
+		close(t->fd);
+		t->fd = -1;
+		return -1;
+	}
+	if((t->oldtty = malloc(sizeof(tty)))) memcpy(t->oldtty, &tty, sizeof(tty));
+	tty.c_iflag = 0;
+	tty.c_oflag = 0;
+	tty.c_lflag = 0; // ~(ICANON | ECHO | ECHOE | ISIG)
+	tty.c_cflag = CS8 | CREAD | CLOCAL | BOTHER | (BOTHER << IBSHIFT); // 8N1, RW, ignore line ctrl
+	tty.c_ispeed = tty.c_ospeed = baudrate;
+	tty.c_cc[VMIN]  = 1;  // non-canonical mode: with O_NONBLOCK empty read gives EAGAIN, not 0
+	tty.c_cc[VTIME] = 0;
+	if(ioctl(t->fd, TCSETS2, &tty)){
+		perror("TCSETS2");
+		ttyio_close(t);
+		return -1;
+	}
+	t->events = EPOLLIN;
+	if(hostio_add(t->fd, EPOLLIN, tty_event, t)){
+		ttyio_close(t);
+		return -1;
+	}
+	return 0;
+}
+
+/**
+ * Remove TTY from event loop, restore its settings & close
+ */
+void ttyio_close(ttyio *t){
+	if(t->fd < 0) return;
+	hostio_del(t->fd);
+	if(t->oldtty){
+		ioctl(t->fd, TCSETS2, t->oldtty);
+		free(t->oldtty);
+		t->oldtty = NULL;
+	}
+	close(t->fd);
+	t->fd = -1;
+}
+
+/**
+ * Put data into output buffer: it will be sent by the event loop (all data written before
+ * next hostio_poll() goes by one write()); thread-safe
+ * @return 0 if all OK, -1 if buffer overflow
+ */
+int ttyio_write(ttyio *t, const void *data, size_t len){
+	int ret = 0;
+	pthread_mutex_lock(&t->mutex);
+	if(t->ohead + len > TTYIO_OBUFSZ && t->otail){ // move data to buffer start
+		memmove(t->obuf, t->obuf + t->otail, t->ohead - t->otail);
+		t->ohead -= t->otail;
+		t->otail = 0;
+	}
+	if(t->ohead + len > TTYIO_OBUFSZ) ret = -1;
+	else{
+		memcpy(t->obuf + t->ohead, data, len);
+		t->ohead += len;
+		if(!(t->events & EPOLLOUT)){
+			t->events |= EPOLLOUT;
+			hostio_mod(t->fd, t->events);
+		}
+	}
+	pthread_mutex_unlock(&t->mutex);
+	return ret;
+}
+
+/**
+ * printf into output buffer
+ */
+int ttyio_printf(ttyio *t, const char *fmt, ...){
+	char buf[1024];
+	va_list ap;
+	int L;
+	va_start(ap, fmt);
+	L = vsnprintf(buf, sizeof(buf), fmt, ap);
+	va_end(ap);
+	if(L < 0) return -1;
+	if(L >= (int)sizeof(buf)) L = sizeof(buf) - 1;
+	return ttyio_write(t, buf, L);
+}
+
+/**
+ * Give the rest of input data (without delimiter) to frame callback
+ */
+void ttyio_flushin(ttyio *t){
+	if(!t->ilen) return;
+	t->ibuf[t->ilen] = 0;
+	t->frame(t->arg, t->ibuf, t->ilen, 0);
+	t->ilen = t->iscan = 0;
+}
+
+/**
+ * Write all output buffer (blocking, e.g. before exit)
+ * @return 0 if all data written
+ */
+int ttyio_drain(ttyio *t, int timeout_ms){
+	int ret;
+	if(t->fd < 0) return 0;
+	while(timeout_ms > 0){
+		pthread_mutex_lock(&t->mutex);
+		write_out(t);
+		ret = (t->ohead == t->otail);
+		pthread_mutex_unlock(&t->mutex);
+		if(ret) return 0;
+		usleep(1000);
+		--timeout_ms;
+	}
+	return -1;
+}
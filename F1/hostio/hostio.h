@@ -0,0 +1,78 @@
+/*
+ * hostio.h - event-driven serial I/O for host clients
+ *
+ * Copyright 2015 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __HOSTIO_H__
+#define __HOSTIO_H__
+
+#include <stdint.h>
+#include <stddef.h>
+#include <pthread.h>
+
+// max amount of descriptors in event loop
+#define HOSTIO_MAXFD       (16)
+// sizes of tty buffers
+#define TTYIO_IBUFSZ       (4096)
+#define TTYIO_OBUFSZ       (65536)
+
+/*
+ * Event loop (epoll): callback is called with events of descriptor (EPOLLIN etc)
+ */
+typedef void (*hostio_cb)(void *arg, uint32_t events);
+
+int hostio_init();
+int hostio_add(int fd, uint32_t events, hostio_cb cb, void *arg);
+int hostio_mod(int fd, uint32_t events);
+int hostio_del(int fd);
+int hostio_poll(int timeout_ms);
+
+/*
+ * Frame callback: data points into input buffer of tty (valid only inside callback) and is
+ * terminated by zero instead of delimiter; complete == 0 for the rest of data without
+ * delimiter given by ttyio_flushin() or when buffer is full
+ */
+typedef void (*ttyio_framecb)(void *arg, char *data, size_t len, int complete);
+
+typedef struct{
+	int fd;                     // -1 if closed (static ttyio should be initialized so)
+	int events;                 // current events in epoll
+	char delim;                 // frame delimiter
+	ttyio_framecb frame;        // frame callback
+	void *arg;                  // its argument
+	pthread_mutex_t mutex;      // output buffer can be filled from any thread
+	char ibuf[TTYIO_IBUFSZ];
+	size_t ilen;                // data in input buffer
+	size_t iscan;               // amount of data checked for delimiter
+	char obuf[TTYIO_OBUFSZ];
+	size_t ohead, otail;        // output buffer: data is [otail, ohead)
+	void *oldtty;               // old settings (struct termios2) to restore on close
+	uint64_t nread, nwritten;   // statistics: bytes, read() & write() calls
+	uint64_t nreadcalls, nwritecalls;
+} ttyio;
+
+int ttyio_setspeed(int fd, int baudrate);
+int ttyio_open(ttyio *t, const char *dev, int baudrate, char delim, ttyio_framecb frame, void *arg);
+void ttyio_close(ttyio *t);
+int ttyio_write(ttyio *t, const void *data, size_t len);
+int ttyio_printf(ttyio *t, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+void ttyio_flushin(ttyio *t);
+int ttyio_drain(ttyio *t, int timeout_ms);
+
+#endif // __HOSTIO_H__
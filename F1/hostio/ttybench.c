@@ -0,0 +1,229 @@
+/*
+ * ttybench.c - throughput & latency of hostio against pty-based loopback device
+ *
+ * Copyright 2015 Edward V. Emelianoff <eddy@sao.ru>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * "Device" is a thread echoing all data from pty master; client opens slave side.
+ * Throughput: N frames of given size are sent keeping WINDOW frames in flight, each echoed
+ * frame is checked. Latency: one frame is sent after receiving previous (round trip).
+ * With -l the same is done like old clients did: one write() per byte & select() polling.
+ */
+
+#include <unistd.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/select.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#include "hostio.h"
+
+#ifndef _U_
+#define _U_    __attribute__((__unused__))
+#endif
+
+// frames in flight for throughput test
+#define WINDOW      (32)
+// max frame length
+#define MAXFRAME    (1024)
+
+static int nframes = 20000, framelen = 64, nping = 2000, baudrate = 115200, legacy = 0;
+static ttyio tty = {.fd = -1};
+static int nreceived, nbad;
+static double tsent; // time of last ping
+
+static double dtime(){
+	struct timeval tv;
+	gettimeofday(&tv, NULL);
+	return tv.tv_sec + ((double)tv.tv_usec)/1e6;
+}
+
+static double cputime(){
+	struct rusage r;
+	getrusage(RUSAGE_SELF, &r);
+	return r.ru_utime.tv_sec + r.ru_stime.tv_sec + (r.ru_utime.tv_usec + r.ru_stime.tv_usec) / 1e6;
+}
+
+// loopback device
+static void *device(void *arg){
+	int fd = *(int*)arg;
+	char buf[4096];
+	ssize_t L, w, off;
+	while((L = read(fd, buf, sizeof(buf))) > 0){
+		for(off = 0; off < L; off += w)
+			if((w = write(fd, buf + off, L - off)) < 0) return NULL;
+	}
+	return NULL;
+}
+
+// frame number n: "%08d" & letters, delimiter is '\n'
+static int mkframe(char *buf, int n){
+	int i = snprintf(buf, MAXFRAME, "%08d", n);
+	for(; i < framelen - 1; ++i) buf[i] = 'a' + (n + i) % 26;
+	buf[i++] = '\n';
+	return i;
+}
+
+static void check_frame(const char *data, size_t len){
+	char ref[MAXFRAME];
+	int L = mkframe(ref, nreceived);
+	if((size_t)L - 1 != len || memcmp(ref, data, len)) ++nbad;
+	++nreceived;
+}
+
+static double *rtt;
+
+static void frame(_U_ void *arg, char *data, size_t len, int complete){
+	if(!data){
+		fprintf(stderr, "Device disconnected\n");
+		exit(1);
+	}
+	if(!complete) ++nbad;
+	if(tsent > 0.) rtt[nreceived] = dtime() - tsent;
+	check_frame(data, len);
+}
+
+/*
+ * Old way: byte-by-byte writes, select() with 10ms timeout, frames collected by copying
+ */
+static int lfd;
+static char lbuf[TTYIO_IBUFSZ];
+static size_t llen;
+static uint64_t lreads, lwrites;
+
+static void legacy_write(const char *data, int len){
+	while(len--){
+		while(write(lfd, data, 1) != 1);
+		++data;
+		++lwrites;
+	}
+}
+
+static void legacy_poll(){
+	fd_set rfds;
+	struct timeval tv = {0, 10000};
+	ssize_t L;
+	size_t i, start = 0;
+	FD_ZERO(&rfds);
+	FD_SET(lfd, &rfds);
+	if(select(lfd + 1, &rfds, NULL, NULL, &tv) < 1) return;
+	if((L = read(lfd, lbuf + llen, sizeof(lbuf) - llen)) < 1) return;
+	++lreads;
+	llen += L;
+	for(i = 0; i < llen; ++i){
+		if(lbuf[i] != '\n') continue;
+		lbuf[i] = 0;
+		frame(NULL, lbuf + start, i - start, 1);
+		start = i + 1;
+	}
+	memmove(lbuf, lbuf + start, llen - start);
+	llen -= start;
+}
+
+static void send_frame(int n){
+	char buf[MAXFRAME];
+	int L = mkframe(buf, n);
+	if(legacy) legacy_write(buf, L);
+	else while(ttyio_write(&tty, buf, L)) hostio_poll(10);
+}
+
+static void poll_once(){
+	if(legacy) legacy_poll();
+	else hostio_poll(10);
+}
+
+static void show_stat(const char *name, double t, double cpu){
+	uint64_t r = legacy ? lreads : tty.nreadcalls, w = legacy ? lwrites : tty.nwritecalls;
+	printf("%s: %d frames in %.3fs, CPU %.3fs, %llu read() & %llu write() calls", name,
+		nreceived, t, cpu, (unsigned long long)r, (unsigned long long)w);
+	if(nbad) printf(", %d BAD frames", nbad);
+	printf("\n");
+}
+
+static int cmpd(const void *a, const void *b){
+	double d = *(double*)a - *(double*)b;
+	return (d > 0.) - (d < 0.);
+}
+
+int main(int argc, char **argv){
+	int c, mfd, sent;
+	pthread_t thr;
+	double t0, cpu0, t;
+	while((c = getopt(argc, argv, "b:n:s:p:l")) != -1){
+		switch(c){
+			case 'b': baudrate = atoi(optarg); break;
+			case 'n': nframes = atoi(optarg); break;
+			case 's': framelen = atoi(optarg); break;
+			case 'p': nping = atoi(optarg); break;
+			case 'l': legacy = 1; break;
+			default:
+				fprintf(stderr, "Usage: %s [-b baudrate] [-n frames] [-s frame size] [-p pings] [-l]\n"
+					"\t-l - old way: byte-by-byte write() & select()\n", argv[0]);
+				return 1;
+		}
+	}
+	if(framelen < 10 || framelen > MAXFRAME || nframes < 1 || nping < 1){
+		fprintf(stderr, "Wrong parameters\n");
+		return 1;
+	}
+	rtt = calloc(nping > nframes ? nping : nframes, sizeof(double));
+	if((mfd = posix_openpt(O_RDWR | O_NOCTTY)) < 0 || grantpt(mfd) || unlockpt(mfd)){
+		perror("Can't open pty");
+		return 1;
+	}
+	if(ttyio_open(&tty, ptsname(mfd), baudrate, '\n', frame, NULL)) return 1;
+	if(legacy){ // the same tty settings, but don't use event loop
+		hostio_del(tty.fd);
+		lfd = tty.fd;
+	}
+	if(pthread_create(&thr, NULL, device, &mfd)) return 1;
+	printf("%s, baudrate %d, frame %d bytes\n", legacy ? "select() & byte writes" : "epoll & buffered writes",
+		baudrate, framelen);
+	// throughput
+	t0 = dtime(); cpu0 = cputime();
+	for(sent = 0; nreceived < nframes;){
+		while(sent < nframes && sent - nreceived < WINDOW) send_frame(sent++);
+		poll_once();
+	}
+	t = dtime() - t0;
+	show_stat("throughput", t, cputime() - cpu0);
+	printf("\t%.1f kB/s, %.0f frames/s\n", nframes * framelen / t / 1024., nframes / t);
+	// latency
+	nreceived = 0; nbad = 0; lreads = lwrites = 0;
+	tty.nreadcalls = tty.nwritecalls = 0;
+	t0 = dtime(); cpu0 = cputime();
+	for(sent = 0; sent < nping; ++sent){
+		tsent = dtime();
+		send_frame(sent);
+		while(nreceived == sent) poll_once();
+	}
+	t = dtime() - t0;
+	show_stat("latency", t, cputime() - cpu0);
+	qsort(rtt, nping, sizeof(double), cmpd);
+	for(c = 0, t = 0.; c < nping; ++c) t += rtt[c];
+	printf("\tround trip: mean %.1fus, median %.1fus, 99%% %.1fus, max %.1fus\n", t / nping * 1e6,
+		rtt[nping / 2] * 1e6, rtt[nping * 99 / 100] * 1e6, rtt[nping - 1] * 1e6);
+	ttyio_close(&tty);
+	return nbad ? 1 : 0;
+}
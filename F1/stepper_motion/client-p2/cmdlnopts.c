@@ -33,6 +33,7 @@ glob_pars Gdefault = {
 	.serialdev        = "/dev/ttyACM0",
 	.gotopos          = -1000.,
 	.relmove          = 0.,
+	.tolerance        = 1.,
 };
 
 #ifndef N_
@@ -88,6 +89,7 @@ myoption cmdlnopts[] = {
 	{"serialdev",1,	NULL,	'd',	arg_string,	APTR(&G.serialdev),	N_("path to MCU device")},
 	{"goto",	1,	NULL,	'g',	arg_function,APTR(ang_goto),	N_("go to given position")},
 	{"relative",1,	NULL,	'r',	arg_function,APTR(ang_gorel),	N_("go relative current position")},
+	{"tolerance",1,	NULL,	't',	arg_double,	APTR(&G.tolerance),	N_("positioning accuracy (arcsec, default: 1)")},
 	end_option
 };
 
@@ -33,6 +33,7 @@ typedef struct{
 	char *serialdev;        // input device
 	double gotopos;         // go to given angle
 	double relmove;         // move relative current position
+	double tolerance;       // positioning accuracy (arcsec)
 }glob_pars;
 
 glob_pars *parse_args(int argc, char **argv);
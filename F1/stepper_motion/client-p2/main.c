@@ -28,22 +28,22 @@
 #include <signal.h>			// signal
 #include <time.h>			// time
 #include <string.h>			// memcpy
+#include <stdarg.h>			// va_list
 #include <stdint.h>			// int types
 #include <sys/time.h>		// gettimeofday
 #include <assert.h>			// assert
 #include <pthread.h>		// threads
+#include <math.h>			// fabs, lround
+#include <sys/epoll.h>		// EPOLLIN
 
 #include "bta_shdata.h"
 #include "cmdlnopts.h"
+#include "hostio.h"
 
 #ifndef _U_
 #define _U_    __attribute__((__unused__))
 #endif
 
-#ifndef fabs
-#define fabs(x)  ((x > 0.) ? x : -x)
-#endif
-
 // scale: how much steps there is in one angular second
 const double steps_per_second = 2.054;
 
@@ -52,15 +52,40 @@ const double steps_per_second = 2.054;
 // end-switch at 100degr
 #define MAX_RESTRICT_ANGLE (360000.)
 
-#define BUFLEN 1024
+// closed loop: P2 sampling period (s)
+#define SAMPLE_DT      (0.02)
+// MCU position polling period while moving (s)
+#define POLL_DT        (0.1)
+// P2 should be stable (within SETTLE_DP arcsec) for SETTLE_TIME seconds after stop
+#define SETTLE_TIME    (0.3)
+#define SETTLE_DP      (0.1)
+// max amount of moves to reach target
+#define MAX_MOVES      (10)
+// min angle of move to estimate scale (arcsec)
+#define MIN_EST_ANGLE  (10.)
+// min change of target while moving (steps)
+#define CORR_STEPS     (3)
 
 glob_pars *Global_parameters = NULL;
 
-int is_running = 1; // ==0 to exit
-int BAUD_RATE = B115200;
-struct termio oldtty, tty; // TTY flags
+volatile int is_running = 1; // ==0 to exit
+int BAUD_RATE = 115200;
 struct termios oldt, newt; // terminal flags
-int comfd; // TTY fd
+ttyio tty = {.fd = -1}; // TTY (fd < 0 while not opened)
+int wakefd[2]; // pipe: control thread wakes main one when it's over
+
+/*
+ * State of MCU: filled by main thread from MCU messages, used by control thread
+ */
+typedef struct{
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;    // signalled on each message
+	int moving;             // motor is moving: G sent, "Stopped!" not received yet
+	int haspos;             // position received after last request
+	long pos;               // X position (steps)
+} mcu_state;
+
+mcu_state mcu = {PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0, 0};
 
 #define DBG(...) do{fprintf(stderr, __VA_ARGS__);}while(0)
 
@@ -82,12 +107,35 @@ double dtime(){
  */
 void quit(int ex_stat){
 	tcsetattr(STDIN_FILENO, TCSANOW, &oldt); // return terminal to previous state
-	ioctl(comfd, TCSANOW, &oldtty ); // return TTY to previous state
-	close(comfd);
+	ttyio_drain(&tty, 100);
+	ttyio_close(&tty); // return TTY to previous state
 	printf("Exit! (%d)\n", ex_stat);
 	exit(ex_stat);
 }
 
+/**
+ * Process line from MCU
+ */
+void parse_line(_U_ void *arg, char *str, size_t len, int complete){
+	char *pos;
+	if(!str){ // disconnect or other troubles
+		fprintf(stderr, "USB error or disconnected!\n");
+		quit(1);
+	}
+	if(!complete) return; // too long line
+	if(len && str[len - 1] == '\r') str[len - 1] = 0;
+	pos = strstr(str, "X=");
+	if(!pos && *str && strcmp(str, "C")) printf("GOT: %s\n", str); // don't show polling
+	pthread_mutex_lock(&mcu.mutex);
+	if(pos){
+		mcu.pos = strtol(pos + 2, NULL, 10);
+		mcu.haspos = 1;
+	}
+	if(strstr(str, "Stopped")) mcu.moving = 0; // could be mixed with echo
+	pthread_cond_signal(&mcu.cond);
+	pthread_mutex_unlock(&mcu.mutex);
+}
+
 /**
  * Open & setup TTY, terminal
  */
@@ -98,59 +146,11 @@ void tty_init(){
 	newt.c_lflag &= ~(ICANON | ECHO);
 	if(tcsetattr(STDIN_FILENO, TCSANOW, &newt) < 0) quit(-2);
 	printf("\nOpen port...\n");
-	if ((comfd = open(Global_parameters->serialdev,O_RDWR|O_NOCTTY|O_NONBLOCK)) < 0){
+	if(ttyio_open(&tty, Global_parameters->serialdev, BAUD_RATE, '\n', parse_line, NULL)){
 		fprintf(stderr,"Can't use port %s\n",Global_parameters->serialdev);
 		quit(1);
 	}
-	printf(" OK\nGet current settings...\n");
-	if(ioctl(comfd,TCGETA,&oldtty) < 0) exit(-1); // Get settings
-	tty = oldtty;
-	tty.c_lflag     = 0; // ~(ICANON | ECHO | ECHOE | ISIG)
-	tty.c_oflag     = 0;
-	tty.c_cflag     = BAUD_RATE|CS8|CREAD|CLOCAL; // 9.6k, 8N1, RW, ignore line ctrl
-	tty.c_cc[VMIN]  = 0;  // non-canonical mode
-	tty.c_cc[VTIME] = 5;
-	if(ioctl(comfd,TCSETA,&tty) < 0) exit(-1); // set new mode
 	printf(" OK\n");
-	tcsetattr(STDIN_FILENO, TCSANOW, &newt);
-}
-
-/**
- * read tty
- * @param buff (o)    - buffer for messages readed from tty
- * @param length (io) - buff's length (return readed len or 0)
- * @return 1 if something was readed here or there
- */
-int read_tty(char *buff, size_t *length){
-	ssize_t L;
-	size_t buffsz = *length;
-	struct timeval tv;
-	int sel, retval = 0;
-	fd_set rfds;
-	FD_ZERO(&rfds);
-	FD_SET(STDIN_FILENO, &rfds);
-	FD_SET(comfd, &rfds);
-	tv.tv_sec = 0; tv.tv_usec = 100000;
-	sel = select(comfd + 1, &rfds, NULL, NULL, &tv);
-	if(sel > 0){
-		if(FD_ISSET(comfd, &rfds)){
-			if((L = read(comfd, buff, buffsz)) < 1){ // disconnect or other troubles
-				fprintf(stderr, "USB error or disconnected!\n");
-				quit(1);
-			}else{
-				if(L == 0){ // USB disconnected
-					fprintf(stderr, "USB disconnected!\n");
-					quit(1);
-				}
-				// all OK continue reading
-				*length = (size_t) L;
-				retval = 1;
-			}
-		}else{
-			*length = 0;
-		}
-	}
-	return retval;
 }
 
 void print_P2(){
@@ -175,73 +175,184 @@ void help(){
 }
 */
 
-void write_tty(char *str){
-	while(*str){
-		write(comfd, str++, 1);
-	}
+/**
+ * Send command to MCU
+ */
+void mcu_cmd(const char *fmt, ...){
+	char buf[256];
+	va_list ap;
+	int L;
+	va_start(ap, fmt);
+	L = vsnprintf(buf, 256, fmt, ap);
+	va_end(ap);
+	if(L > 255) L = 255;
+	if(L > 0) ttyio_write(&tty, buf, L);
+}
+
+/**
+ * angle from a to b in preferred direction (not more than 180degr)
+ * 360degr = 1296000''; 180degr = 648000''
+ */
+double ang_diff(double b, double a){
+	double angle = b - a;
+	while(angle < 0.) angle += 1296000.;
+	while(angle > 648000.) angle -= 1296000.; // it's better to move in negative direction
+	return angle;
 }
 
 /**
- * give command to move P2 on some angle
+ * check target of P2 moving
  * @param rel  == 1 for relative moving
  * @param angle - angle in seconds
+ * @return absolute target or -1. if there's nothing to do
  */
-void move_P2(int rel, double angle){
+double target_P2(int rel, double angle){
 	double curP = val_P, targP;
-	char buf[256];
-	if(fabs(angle) < 1.) return; // don't move to such little degrees
+	if(fabs(angle) < 1.) return -1.; // don't move to such little degrees
 	if(curP > MIN_RESTRICT_ANGLE && curP < MAX_RESTRICT_ANGLE){
 		fprintf(stderr, "Error: motor is in restricted area!\n");
 		quit(-1);
 	}
 	if(rel) targP = curP + angle;
 	else targP = angle;
+	while(targP < 0.) targP += 1296000.;
+	while(targP >= 1296000.) targP -= 1296000.;
 	// check for restricted zone
 	if(targP > MIN_RESTRICT_ANGLE && targP < MAX_RESTRICT_ANGLE){
 		fprintf(stderr, "Error: you want to move into restricted area!\n");
 		quit(-10);
 	}
-	// now check preferred rotation direction
-	angle = targP - curP;
-	//printf("targP: %g, curP: %g, angle: %g\n", targP, curP, angle);
-	// 360degr = 1296000''; 180degr = 648000''
-	if(angle < 0.) angle += 1296000.;
-	if(angle > 648000.){ // it's better to move in negative direction
-		angle -= 1296000.;
+	return targP;
+}
+
+/**
+ * wait for message from MCU not more than dt seconds (mcu.mutex should be locked)
+ */
+void wait_mcu(double dt){
+	struct timespec ts;
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ts.tv_nsec += (long)(dt * 1e9);
+	while(ts.tv_nsec >= 1000000000L){
+		ts.tv_nsec -= 1000000000L;
+		++ts.tv_sec;
 	}
-	// convert angle into steps
-	angle *= steps_per_second;
-	_U_ size_t L = snprintf(buf, 256, "G%d\n", ((int)angle));
-	//printf("BUF: %s\n", buf);
-	write_tty(buf);
-	//is_running = 0;
-	while(is_running);
+	pthread_cond_timedwait(&mcu.cond, &mcu.mutex, &ts);
+}
+
+/**
+ * Closed loop: P2 is sampled each SAMPLE_DT; while motor moves its target is corrected
+ * by current estimation of scale (steps per second of arc), which is refined by pairs
+ * (MCU position, P2) from the start of each move; after stop & P2 settling the rest
+ * of error is corrected by the next move till it will be less than tolerance
+ */
+void control_P2(double targP){
+	double k = steps_per_second, sxy = 0., sxx = 0., est;
+	double P, P0 = 0., Pst = -1., t, tst = 0., tpoll = 0., err, dP;
+	long s0 = 0, stgt = 0, steps;
+	int nmoves = 0, wasmoving = 0;
+	pthread_mutex_lock(&mcu.mutex);
+	mcu.haspos = 0;
+	mcu_cmd("C\n"); // initial position
+	while(is_running){
+		wait_mcu(SAMPLE_DT);
+		P = val_P;
+		t = dtime();
+		err = ang_diff(targP, P);
+		if(mcu.moving){
+			wasmoving = 1;
+			if(mcu.haspos){ // new pair: refine scale & target of move
+				mcu.haspos = 0;
+				dP = ang_diff(P, P0);
+				if(fabs(dP) > MIN_EST_ANGLE){
+					sxy += (mcu.pos - s0) * dP;
+					sxx += dP * dP;
+					est = sxy / sxx;
+					// reject nonsense (e.g. P2 doesn't follow motor)
+					if(est > steps_per_second / 2. && est < steps_per_second * 2.) k = est;
+				}
+				steps = s0 + lround(ang_diff(targP, P0) * k);
+				if(labs(steps - stgt) >= CORR_STEPS){
+					mcu_cmd("G%ld\n", steps - stgt);
+					stgt = steps;
+				}
+			}
+			if(t - tpoll > POLL_DT){
+				tpoll = t;
+				mcu_cmd("C\n");
+			}
+			continue;
+		}
+		if(wasmoving){ // motor stopped: get its position
+			wasmoving = 0;
+			mcu.haspos = 0;
+			mcu_cmd("C\n");
+		}
+		// wait for stable P2
+		if(fabs(P - Pst) > SETTLE_DP){
+			Pst = P;
+			tst = t;
+			continue;
+		}
+		if(t - tst < SETTLE_TIME || !mcu.haspos) continue;
+		if(fabs(err) < Global_parameters->tolerance){
+			printf("Target reached after %d move[s], error: %.1f'', scale: %.4f steps/''\n",
+				nmoves, err, k);
+			break;
+		}
+		steps = lround(err * k);
+		if(nmoves == MAX_MOVES || !steps){
+			fprintf(stderr, "Can't reach target, error: %.1f''\n", err);
+			break;
+		}
+		++nmoves;
+		s0 = mcu.pos;
+		stgt = s0 + steps;
+		P0 = P;
+		tpoll = t;
+		mcu.moving = 1;
+		mcu.haspos = 0;
+		mcu_cmd("G%ld\n", steps);
+	}
+	pthread_mutex_unlock(&mcu.mutex);
 }
 
 void *moving_thread(_U_ void *buf){
+	double targP = -1.;
 	if(Global_parameters->gotopos > 0.){
-//printf("gotoval: %g\n", Global_parameters->gotopos);
-		move_P2(0, Global_parameters->gotopos);
+		targP = target_P2(0, Global_parameters->gotopos);
 	}else if(fabs(Global_parameters->relmove) > 1.){ // move relative current position
-//printf("relval: %g\n", Global_parameters->relmove);
-		move_P2(1, Global_parameters->relmove);
+		targP = target_P2(1, Global_parameters->relmove);
 	}
-//	sleep(1); // give a little time for receiving messages
-//	is_running = 0;
+	if(targP < 0.) return NULL; // nothing to do: just show P2 position
+	control_P2(targP);
+	is_running = 0;
+	if(write(wakefd[1], "", 1) < 0) perror("write()");
 	return NULL;
 }
 
+/**
+ * Control thread is over
+ */
+void wake_event(_U_ void *arg, _U_ uint32_t events){
+	char c;
+	if(read(wakefd[0], &c, 1) < 0) perror("read()");
+	is_running = 0;
+}
+
 int main(int argc, char *argv[]){
-	char buff[BUFLEN+1];
 	pthread_t motor_thread;
-	size_t L;
 	Global_parameters = parse_args(argc, argv);
 	assert(Global_parameters != NULL);
 	if(!get_shm_block(&sdat, ClientSide) || !check_shm_block(&sdat)){
 		fprintf(stderr, "Can't get SHM block!");
 		return -1;
 	}
+	if(pipe(wakefd)){
+		perror("pipe()");
+		return -1;
+	}
 	tty_init();
+	if(hostio_add(wakefd[0], EPOLLIN, wake_event, NULL)) quit(-3);
 	signal(SIGTERM, quit);		// kill (-15)
 	signal(SIGINT, quit);		// ctrl+C
 	signal(SIGQUIT, SIG_IGN);	// ctrl+\   .
@@ -256,29 +367,20 @@ int main(int argc, char *argv[]){
 		quit(-1);
 	}
 	while(is_running){
-		L = BUFLEN;
 		if((t = dtime()) - t0 > 1.){ // once per second (and on first run) check P2 position
 			if(fabs(val_P - p_old) > 0.1){
 				p_old = val_P;
 				print_P2();
 			}
 			t0 = t;
-		}
-		if(read_tty(buff, &L)){
-			if(L){
-				buff[L] = 0;
-				printf("GOT: %s", buff);
-				if(strncmp(buff, "Stop", 4) == 0){
-					is_running = 0;
-					sleep(1);
-				}
+			if(!check_shm_block(&sdat)){
+				fprintf(stderr, "Corruption in SHM block!");
+				quit(-2);
 			}
 		}
-		if(!check_shm_block(&sdat)){
-			fprintf(stderr, "Corruption in SHM block!");
-			quit(-2);
-		}
+		if(hostio_poll(1000) < 0) quit(-4); // MCU messages & end of control thread
 	}
+	pthread_join(motor_thread, NULL);
 	quit(0);
 	return 0;
 }
@@ -55,6 +55,7 @@ int main(){
 		if(usbdatalen){ // there's something in USB buffer
 			usbdatalen = parse_incoming_buf(usbdatabuf, usbdatalen);
 		}
+		check_stepper_stop();
 		//check_and_parse_UART(USART1); // also check data in UART buffers
 		if(Timer - Old_timer > 999){ // one-second cycle
 			Old_timer += 1000;
@@ -0,0 +1,228 @@
+/*
+ * motion.c - trapezoidal & S-curve motion planner (integer arithmetic only)
+ *
+ * Copyright 2015 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "motion.h"
+
+// ramp length is dv^2 * RAMPK / (4 * accel): 2 for trapezoid, 3 for S-curve (1.5 times longer)
+#define RAMPK(m)   (((m)->type == PROFILE_SCURVE) ? 3 : 2)
+// max period: TIM2_ARR is 16-bit
+#define MAX_PERIOD (65536)
+// fixed point of ramp shape
+#define SHAPE_BITS (24)
+#define SHAPE_ONE  (1ULL << SHAPE_BITS)
+
+/**
+ * integer square root
+ */
+static uint32_t isqrt64(uint64_t x){
+	uint64_t r = 0, bit = 1ULL << 62;
+	while(bit > x) bit >>= 2;
+	while(bit){
+		if(x >= r + bit){
+			x -= r + bit;
+			r = (r >> 1) + bit;
+		}else r >>= 1;
+		bit >>= 2;
+	}
+	return (uint32_t)r;
+}
+
+/**
+ * start/stop speed squared: not more than cruise speed & not less than timer allows
+ */
+static uint32_t vstart2(motion_plan *m){
+	uint32_t vs = m->vstart, vmin = m->freq / (MAX_PERIOD - 1) + 1;
+	if(vs > m->vmax) vs = m->vmax;
+	if(vs < vmin) vs = vmin;
+	return vs * vs;
+}
+
+/**
+ * length of ramp between speeds (squared) v2a and v2b, rounded up
+ */
+static int32_t ramplen(motion_plan *m, uint32_t v2a, uint32_t v2b){
+	uint64_t d = (v2a > v2b) ? v2a - v2b : v2b - v2a, a4 = 4ULL * m->accel;
+	return (int32_t)((d * RAMPK(m) + a4 - 1) / a4);
+}
+
+/**
+ * ramp shape (1/SHAPE_ONE) at position i of len
+ */
+static uint32_t shape(motion_plan *m, int32_t i, int32_t len){
+	uint64_t x;
+	if(i >= len) return SHAPE_ONE;
+	x = ((uint64_t)i << SHAPE_BITS) / (uint32_t)len;
+	if(m->type == PROFILE_SCURVE) // smoothstep: 3x^2 - 2x^3
+		return (uint32_t)((((x * x) >> SHAPE_BITS) * (3 * SHAPE_ONE - 2 * x)) >> SHAPE_BITS);
+	return (uint32_t)x;
+}
+
+/**
+ * speed squared at position i of ramp from v2a to v2b with length len
+ */
+static uint32_t ramp(motion_plan *m, uint32_t v2a, uint32_t v2b, int32_t i, int32_t len){
+	int64_t d = (int64_t)v2b - (int64_t)v2a;
+	return (uint32_t)((int64_t)v2a + ((d * (int64_t)shape(m, i, len)) >> SHAPE_BITS));
+}
+
+/**
+ * gain of speed squared on D steps of acceleration
+ */
+uint32_t motion_reach(motion_plan *m, int32_t D){
+	uint64_t r = (uint64_t)D * 4 * m->accel / RAMPK(m);
+	return (r > UINT32_MAX) ? UINT32_MAX : (uint32_t)r;
+}
+
+/**
+ * plan segment of D steps from current position & speed (acceleration or deceleration
+ * to cruise speed, cruise, deceleration to end speed m->ve2)
+ */
+static void plan(motion_plan *m, int32_t D){
+	uint32_t vmax2 = m->vmax * m->vmax, reach = motion_reach(m, D);
+	uint64_t top;
+	m->vs2 = vstart2(m);
+	if(vmax2 < m->vs2) vmax2 = m->vs2;
+	m->base = m->n;
+	m->N = m->n + D;
+	m->v02 = m->vc2;
+	// end speed: not less than vstart, not more than reachable
+	if(m->ve2 < m->vs2) m->ve2 = m->vs2;
+	if(m->ve2 > vmax2) m->ve2 = vmax2;
+	if(m->ve2 > m->v02 && m->ve2 - m->v02 > reach) m->ve2 = m->v02 + reach;
+	// the highest speed reachable: acceleration & deceleration meet
+	top = ((uint64_t)reach + m->v02 + m->ve2) / 2;
+	m->vm2 = (top < vmax2) ? (uint32_t)top : vmax2;
+	m->nacc = ramplen(m, m->v02, m->vm2);
+	m->ndec = ramplen(m, m->vm2, m->ve2);
+}
+
+/**
+ * Init planner for timer with frequency freq
+ */
+void motion_init(motion_plan *m, uint32_t freq){
+	m->freq = freq;
+	m->vstart = MOTION_DEFAULT_VSTART;
+	m->vmax = MOTION_DEFAULT_VSTART;
+	m->accel = MOTION_DEFAULT_ACCEL;
+	m->type = PROFILE_TRAPEZOID;
+	m->cperiod = 0;
+	m->N = m->n = m->base = 0;
+	m->pending = 0;
+}
+
+/**
+ * Plan move of Nsteps (>0) from rest
+ */
+void motion_start(motion_plan *m, int32_t Nsteps){
+	m->n = 0;
+	m->pending = 0;
+	m->vc2 = vstart2(m);
+	m->ve2 = 0;
+	plan(m, Nsteps);
+}
+
+/**
+ * Plan next segment of Nsteps (>0) from current speed to end speed squared ve2
+ */
+void motion_continue(motion_plan *m, int32_t Nsteps, uint32_t ve2){
+	m->n = 0;
+	m->ve2 = ve2;
+	plan(m, Nsteps);
+}
+
+/**
+ * Change end speed squared of current segment (e.g. next segment is added)
+ */
+void motion_setend(motion_plan *m, uint32_t ve2){
+	if(m->n >= m->N) return;
+	m->ve2 = ve2;
+	plan(m, m->N - m->n);
+}
+
+/**
+ * distance needed to decelerate from speed squared v2 to start/stop speed
+ */
+int32_t motion_stopdist(motion_plan *m, uint32_t v2){
+	uint32_t vs2 = vstart2(m);
+	if(m->cperiod || v2 <= vs2) return 0;
+	return ramplen(m, v2, vs2);
+}
+
+/**
+ * Change target on the fly (also used to apply new speed/acceleration while moving);
+ * the segment should be the last one: it ends at start/stop speed
+ * @param delta - target shift (steps in current direction, <0 - closer)
+ * @return change of segment length (steps)
+ * If the target is closer than stopping distance, the segment becomes deceleration to stop
+ * and the rest (negative: move back) is left in m->pending.
+ */
+int32_t motion_retarget(motion_plan *m, int32_t delta){
+	int32_t oldN = m->N, D = m->N - m->n + m->pending + delta, dstop;
+	m->pending = 0;
+	dstop = motion_stopdist(m, m->vc2);
+	if(D < dstop){
+		m->pending = D - dstop;
+		m->base = m->n;
+		m->N = m->n + dstop;
+		m->v02 = m->vm2 = m->vc2;
+		m->ve2 = m->vs2 = vstart2(m);
+		m->nacc = 0;
+		m->ndec = dstop;
+	}else{
+		m->ve2 = 0;
+		plan(m, D);
+	}
+	return m->N - oldN;
+}
+
+/**
+ * speed squared of step n
+ */
+uint32_t motion_v2(motion_plan *m, int32_t n){
+	int32_t i = n - m->base, r = m->N - n - 1;
+	uint32_t v2 = m->vm2, vd;
+	if(i < m->nacc) v2 = ramp(m, m->v02, m->vm2, i, m->nacc);
+	if(r < m->ndec){
+		vd = ramp(m, m->ve2, m->vm2, r, m->ndec);
+		if(vd < v2) v2 = vd;
+	}
+	if(v2 < m->vs2) v2 = m->vs2;
+	return v2;
+}
+
+/**
+ * Period of next step
+ * @return period in timer ticks or 0 if segment is over
+ */
+uint32_t motion_next(motion_plan *m){
+	uint32_t v2, vq, p;
+	if(m->n >= m->N) return 0;
+	if(m->cperiod){
+		++m->n;
+		return m->cperiod;
+	}
+	v2 = motion_v2(m, m->n++);
+	m->vc2 = v2;
+	vq = isqrt64((uint64_t)v2 << 8); // speed * 16
+	p = (m->freq * 16 + vq / 2) / vq;
+	if(p > MAX_PERIOD) p = MAX_PERIOD;
+	return p;
+}
@@ -0,0 +1,81 @@
+/*
+ * motion.h
+ *
+ * Copyright 2015 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __MOTION_H__
+#define __MOTION_H__
+
+#include <stdint.h>
+
+// default acceleration (steps/s^2)
+#define MOTION_DEFAULT_ACCEL   (20000)
+// default start/stop speed (steps/s)
+#define MOTION_DEFAULT_VSTART  (200)
+// max acceleration
+#define MOTION_MAX_ACCEL       (1000000)
+// max speed (min period is 100us)
+#define MOTION_MAX_SPEED       (10000)
+
+typedef enum{
+	PROFILE_TRAPEZOID = 0, // constant acceleration
+	PROFILE_SCURVE         // acceleration rises & falls smoothly
+} profile_type;
+
+/*
+ * Motion segment: speed squared is a function of distance from segment start (acceleration
+ * from v0 to vm) and distance to its end (deceleration from vm to vstart):
+ *   v^2 = v0^2 + (vm^2 - v0^2) * shape(i / nacc),  v^2 = ve^2 + (vm^2 - ve^2) * shape(r / ndec)
+ * (ve is vstart for the last segment or speed of junction with the next one)
+ * shape(x) = x for trapezoid (constant acceleration) or smoothstep 3x^2-2x^3 for S-curve
+ * (acceleration is zero at the ends of ramp and 1.5 times larger in its middle, so the ramp is
+ * 1.5 times longer to keep acceleration under limit).
+ * All values are integer: speed squared in (steps/s)^2, shape in 1/2^24.
+ */
+typedef struct{
+	// configuration
+	uint32_t freq;       // timer frequency (Hz)
+	uint32_t vstart;     // start/stop speed (steps/s)
+	uint32_t vmax;       // cruise speed (steps/s)
+	uint32_t accel;      // acceleration (steps/s^2)
+	profile_type type;   // profile shape
+	uint32_t cperiod;    // !=0 - constant period (ticks) without ramps (speed is lower than vstart)
+	// current segment
+	int32_t N;           // step number of segment end
+	int32_t base;        // step number of segment start
+	int32_t n;           // amount of periods given
+	int32_t nacc, ndec;  // lengths of acceleration & deceleration
+	uint32_t v02, vm2, ve2; // speeds squared: start, cruise, end
+	uint32_t vs2;        // vstart squared
+	uint32_t vc2;        // speed squared of last step
+	int32_t pending;     // steps to move after segment ends (<0 - reverse)
+} motion_plan;
+
+void motion_init(motion_plan *m, uint32_t freq);
+void motion_start(motion_plan *m, int32_t Nsteps);
+void motion_continue(motion_plan *m, int32_t Nsteps, uint32_t ve2);
+void motion_setend(motion_plan *m, uint32_t ve2);
+uint32_t motion_reach(motion_plan *m, int32_t D);
+int32_t motion_retarget(motion_plan *m, int32_t delta);
+uint32_t motion_next(motion_plan *m);
+int32_t motion_stopdist(motion_plan *m, uint32_t v2);
+uint32_t motion_v2(motion_plan *m, int32_t n);
+#define motion_left(m)   ((m)->N - (m)->n)
+
+#endif // __MOTION_H__
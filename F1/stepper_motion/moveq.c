@@ -0,0 +1,238 @@
+/*
+ * moveq.c - queue of coordinated linear moves with look-ahead
+ *
+ * Copyright 2015 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+#include "moveq.h"
+
+#define MOVEQ_PREV(i)    (((i) - 1) & (MOVEQ_LEN - 1))
+
+static int32_t iabs(int32_t x){
+	return (x < 0) ? -x : x;
+}
+
+/**
+ * Init queue, planner works with timer of frequency freq
+ */
+void moveq_init(moveq *q, uint32_t freq){
+	int i;
+	motion_init(&q->m, freq);
+	moveq_clear(q);
+	for(i = 0; i < MOVEQ_AXES; ++i) q->pos[i] = 0;
+}
+
+/**
+ * Remove all segments (motion should be stopped)
+ */
+void moveq_clear(moveq *q){
+	q->head = q->plan = q->exec = 0;
+	q->tail = 0;
+	q->moving = 0;
+	q->left = 0;
+	q->mask = 0;
+	q->m.pending = 0;
+}
+
+/**
+ * Max speed squared at junction of segments a & b: speed of each axis can't change
+ * more than by start/stop speed (speeds of axis are v*a->d[i]/a->L and v*b->d[i]/b->L)
+ */
+static uint32_t junction(moveq *q, move_segment *a, move_segment *b){
+	uint64_t maxdiff = 0, num = (uint64_t)a->L * b->L, v;
+	int64_t diff;
+	int i;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		diff = (int64_t)a->d[i] * b->L - (int64_t)b->d[i] * a->L;
+		if(diff < 0) diff = -diff;
+		if((uint64_t)diff > maxdiff) maxdiff = diff;
+	}
+	while(num >> 47){
+		num >>= 1;
+		maxdiff >>= 1;
+	}
+	if(!maxdiff) return UINT32_MAX; // the same direction: limited by cruise speed only
+	v = num * q->m.vstart / maxdiff;
+	if(v > MOTION_MAX_SPEED) return UINT32_MAX;
+	return (uint32_t)(v * v);
+}
+
+/**
+ * Look-ahead: end speeds of segments not given to planner yet, backwards from the last one
+ * (which ends by stop): entry speed is limited by junction & by deceleration over segment
+ */
+static void lookahead(moveq *q){
+	uint8_t i = MOVEQ_PREV(q->head), first = q->moving ? q->plan : q->exec;
+	uint64_t ve2 = 0; // the last segment ends at vstart
+	move_segment *s;
+	while(1){
+		s = &q->seg[i];
+		s->ve2 = (uint32_t)ve2;
+		if(i == first) break;
+		ve2 += motion_reach(&q->m, s->L);
+		if(ve2 > s->jv2) ve2 = s->jv2;
+		i = MOVEQ_PREV(i);
+	}
+	// current segment is planned: change its end speed
+	if(q->moving && !q->tail) motion_setend(&q->m, q->seg[q->plan].ve2);
+}
+
+/**
+ * Add segment to queue
+ * @param d - steps of each axis
+ * @return 0 if queue is full or segment is empty
+ */
+int moveq_push(moveq *q, const int32_t *d){
+	uint8_t h = q->head;
+	move_segment *s = &q->seg[h];
+	int32_t L = 0;
+	int i;
+	if(MOVEQ_NEXT(h) == q->exec) return 0;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		s->d[i] = d[i];
+		if(iabs(d[i]) > L) L = iabs(d[i]);
+	}
+	if(!L) return 0;
+	s->L = L;
+	s->ve2 = 0;
+	if(h != q->exec) s->jv2 = junction(q, &q->seg[MOVEQ_PREV(h)], s);
+	else s->jv2 = 0; // from rest
+	q->head = MOVEQ_NEXT(h);
+	lookahead(q);
+	return 1;
+}
+
+/**
+ * Shift target of the only single-axis segment in work (see motion_retarget); if new target is
+ * behind stopping distance, segment becomes deceleration & move back is added to queue
+ * @param delta - shift along this axis
+ * @return 0 if there's several segments or several axes moving
+ */
+int moveq_retarget(moveq *q, int32_t delta){
+	move_segment *s = &q->seg[q->exec];
+	int32_t dn, neg = 0;
+	int i, axis = -1;
+	if(!q->moving || q->tail || q->exec != q->plan || MOVEQ_NEXT(q->plan) != q->head) return 0;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		if(!s->d[i]) continue;
+		if(axis > -1) return 0;
+		axis = i;
+		neg = (s->d[i] < 0);
+	}
+	if(neg) delta = -delta;
+	dn = motion_retarget(&q->m, delta);
+	q->left += dn;
+	s->L += dn;
+	s->d[axis] = neg ? -s->L : s->L;
+	if(q->m.pending){
+		int32_t d[MOVEQ_AXES] = {0};
+		d[axis] = neg ? -q->m.pending : q->m.pending;
+		q->m.pending = 0;
+		moveq_push(q, d);
+	}
+	return 1;
+}
+
+// start execution of segment exec
+static void seg_begin(moveq *q){
+	move_segment *s = &q->seg[q->exec];
+	int i;
+	q->left = s->L;
+	q->negmask = 0;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		q->err[i] = s->L / 2;
+		if(s->d[i] < 0) q->negmask |= 1 << i;
+	}
+}
+
+// Bresenham: axes stepping on next step
+static void prepare(moveq *q){
+	move_segment *s = &q->seg[q->exec];
+	int i;
+	q->mask = 0;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		if(!s->d[i]) continue;
+		q->err[i] += iabs(s->d[i]);
+		if(q->err[i] >= (uint32_t)s->L){
+			q->err[i] -= s->L;
+			q->mask |= 1 << i;
+		}
+	}
+}
+
+/**
+ * Start motion from rest (queue shouldn't be empty): plan first segment & prepare first step
+ */
+void moveq_start(moveq *q){
+	q->moving = 0;
+	q->seg[q->exec].jv2 = 0;
+	lookahead(q);
+	q->plan = q->exec;
+	q->tail = 0;
+	q->moving = 1;
+	motion_start(&q->m, q->seg[q->exec].L);
+	motion_setend(&q->m, q->seg[q->exec].ve2);
+	seg_begin(q);
+	prepare(q);
+}
+
+/**
+ * Period (clock ticks) before next step; segments are given to planner one by one
+ * @return 0 if there's nothing to plan
+ */
+uint32_t moveq_period(moveq *q){
+	uint32_t p;
+	uint8_t nxt;
+	if(q->tail) return 0;
+	while(!(p = motion_next(&q->m))){
+		nxt = MOVEQ_NEXT(q->plan);
+		if(nxt == q->head){
+			q->tail = 1;
+			return 0;
+		}
+		q->plan = nxt;
+		motion_continue(&q->m, q->seg[nxt].L, q->seg[nxt].ve2);
+	}
+	return p;
+}
+
+/**
+ * Prepared step is done: count positions, go to next segment if current is over & prepare
+ * next step (q->mask & q->negmask)
+ * @return 0 if motion is over (if queue isn't empty, it should be started again)
+ */
+int moveq_step(moveq *q){
+	int i;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		if(!(q->mask & (1 << i))) continue;
+		if(q->negmask & (1 << i)) --q->pos[i];
+		else ++q->pos[i];
+	}
+	if(--q->left < 1){
+		if(q->tail && q->exec == q->plan){ // all planned segments are done
+			q->moving = 0;
+			q->mask = 0;
+			q->exec = MOVEQ_NEXT(q->exec);
+			return 0;
+		}
+		q->exec = MOVEQ_NEXT(q->exec);
+		seg_begin(q);
+	}
+	prepare(q);
+	return 1;
+}
@@ -0,0 +1,77 @@
+/*
+ * moveq.h
+ *
+ * Copyright 2015 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+#pragma once
+#ifndef __MOVEQ_H__
+#define __MOVEQ_H__
+
+#include "motion.h"
+
+// amount of axes
+#define MOVEQ_AXES      (3)
+// length of segments queue (power of 2), one segment is always free
+#define MOVEQ_LEN       (16)
+
+/*
+ * Linear move: the dominant axis steps on each period of step clock, others - by Bresenham
+ * algorithm. Speeds are in steps of dominant axis per second.
+ */
+typedef struct{
+	int32_t d[MOVEQ_AXES];   // steps of each axis
+	int32_t L;               // steps of dominant axis (amount of clock periods)
+	uint32_t jv2;            // max speed squared at segment start (junction with previous)
+	uint32_t ve2;            // speed squared at segment end (look-ahead result)
+} move_segment;
+
+/*
+ * Queue of segments: [exec, head) - segments in queue; exec is executed now, plan is given to
+ * planner (it runs ahead of execution by the length of DMA buffer).
+ */
+typedef struct{
+	motion_plan m;                  // planner of current segment
+	move_segment seg[MOVEQ_LEN];
+	uint8_t head;                   // first free
+	uint8_t plan;                   // segment given to planner
+	uint8_t exec;                   // segment executed
+	uint8_t tail;                   // planner is over: all the rest are idle periods
+	uint8_t moving;                 // motion is active
+	// execution
+	int32_t left;                   // steps of executed segment left (including prepared one)
+	uint32_t err[MOVEQ_AXES];       // Bresenham errors
+	int32_t pos[MOVEQ_AXES];        // positions
+	uint8_t mask;                   // axes stepping on prepared step
+	uint8_t negmask;                // axes moving in negative direction
+} moveq;
+
+#define MOVEQ_NEXT(i)    (((i) + 1) & (MOVEQ_LEN - 1))
+// amount of segments in queue
+#define moveq_count(q)   (((q)->head - (q)->exec) & (MOVEQ_LEN - 1))
+// prepared step is the last one: step clock should stop after it
+#define moveq_last(q)    ((q)->tail && (q)->exec == (q)->plan && (q)->left == 1)
+
+void moveq_init(moveq *q, uint32_t freq);
+void moveq_clear(moveq *q);
+int moveq_push(moveq *q, const int32_t *d);
+int moveq_retarget(moveq *q, int32_t delta);
+void moveq_start(moveq *q);
+uint32_t moveq_period(moveq *q);
+int moveq_step(moveq *q);
+
+#endif // __MOVEQ_H__
@@ -0,0 +1,337 @@
+/*
+ * motionsim.c - host simulator of motion planner
+ *
+ * Copyright 2015 Edward V. Emelianov <eddy@sao.ru, edward.emelianoff@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ * MA 02110-1301, USA.
+ */
+
+/*
+ * Periods are taken from planner by the same way as steppers.c does: two first go to TIM1_ARR
+ * directly, then circular DMA buffer is refilled by halves each 16 steps; steps are counted in
+ * timer interrupt (moveq_step), exhausted planner gives long "tail" periods which never should
+ * be executed. Each executed period is compared with the planned profile computed in floating
+ * point; acceleration (v_k^2 - v_{k-1}^2)/2 is checked both for plan and for executed periods
+ * (averaged over AVG steps as periods are rounded to timer ticks; executed one can exceed the
+ * limit by errors of v^2 at the ends of averaging window given by PQUANT ticks of period). For multi-axis moves speed
+ * change of each axis at segments junctions is checked too.
+ * Run `./motionsim -o file` to store time, positions and speed of each step for plotting.
+ */
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "moveq.h"
+
+// the same as STEPPER_DMABUF_SIZE
+#define DMABUF      (32)
+// tail period (ticks): move is over
+#define TAILP       (65536)
+// averaging window for executed acceleration
+#define AVG         (32)
+// tolerance of executed period (ticks): rounding to timer ticks
+#define PQUANT      (0.5)
+// max queue length
+#define QLEN        (1<<20)
+// max amount of segments in test
+#define MAXSEGS     (8)
+
+typedef struct{
+	int32_t at;                 // push after `at` steps (0 - before start, <0 - end of list)
+	int32_t d[MOVEQ_AXES];
+} tseg;
+
+typedef struct{
+	const char *name;
+	profile_type type;
+	uint32_t freq, vstart, vmax, accel, cperiod;
+	int32_t at, delta;   // target change by delta after `at` steps (at < 0 - no change)
+	int moves;           // expected amount of starts from rest
+	tseg segs[MAXSEGS];
+} test;
+
+#define END {-1, {0}}
+static const test tests[] = {
+	{"trapezoid",          PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1, {{0, {20000}}, END}},
+	{"S-curve",            PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, -1, 0, 1, {{0, {20000}}, END}},
+	{"trapezoid fast",     PROFILE_TRAPEZOID, 1000000, 500, 10000, 100000, 0, -1, 0, 1, {{0, {-50000}}, END}},
+	{"triangle",           PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1, {{0, {300}}, END}},
+	{"S triangle",         PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, -1, 0, 1, {{0, {300}}, END}},
+	{"one step",           PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1, {{0, {1}}, END}},
+	{"slow constant",      PROFILE_TRAPEZOID, 10000,   200, 0, 20000, 2000, -1, 0, 1, {{0, {5}}, END}},
+	{"extend target",      PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, 3000, 5000, 1, {{0, {10000}}, END}},
+	{"S extend in ramp",   PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, 300, 8000, 1, {{0, {2000}}, END}},
+	{"shorten target",     PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, 4000, -12000, 1, {{0, {20000}}, END}},
+	{"overshoot & return", PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, 10000, -9800, 1, {{0, {20000}}, END}},
+	{"reverse",            PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, 2000, -4000, 1, {{0, {5000}}, END}},
+	{"S reverse",          PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, 2000, 4000, 1, {{0, {-5000}}, END}},
+	{"extend at the end",  PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, 990, 500, 2, {{0, {1000}}, END}},
+	// coordinated moves
+	{"collinear chain",    PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {2000, 1000}}, {0, {2000, 1000}}, {0, {2000, 1000}}, {0, {2000, 1000}}, {0, {2000, 1000}}, END}},
+	{"square",             PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {3000, 0}}, {0, {0, 3000}}, {0, {-3000, 0}}, {0, {0, -3000}}, END}},
+	{"S zigzag 3D",        PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {4000, 1000, 200}}, {0, {4000, -1000, 300}}, {0, {4000, 1100, -100}}, {0, {4000, -900, 0}}, END}},
+	{"gentle curve",       PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {2000, 0}}, {0, {2000, 100}}, {0, {2000, 200}}, {0, {2000, 300}}, {0, {1000, 1000}}, END}},
+	{"push while moving",  PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {10000, 0}}, {5000, {10000, 500}}, {12000, {5000, 0, 5000}}, END}},
+	{"push after tail",    PROFILE_SCURVE,    1000000, 200, 5000, 20000, 0, -1, 0, 2,
+		{{0, {1000, 0}}, {995, {0, 1000}}, END}},
+	{"many short",         PROFILE_TRAPEZOID, 1000000, 200, 5000, 20000, 0, -1, 0, 1,
+		{{0, {30, 10}}, {0, {30, 12}}, {0, {30, 14}}, {0, {30, 16}}, {0, {30, 18}}, {0, {30, 20}},
+		{0, {30, 22}}, END}},
+};
+
+typedef struct{
+	uint32_t p;    // period given
+	double ref;    // planned period (0 for tail)
+	double aref;   // planned acceleration
+} qitem;
+
+static moveq mq;
+static qitem *q;
+static int32_t qhead, qtail; // generated & executed
+static double prevref2;
+static FILE *out = NULL;
+
+static double shape(profile_type t, double x){
+	if(x >= 1.) return 1.;
+	if(t == PROFILE_SCURVE) return x * x * (3. - 2. * x);
+	return x;
+}
+
+// planned speed squared of step n (floating point)
+static double ref_v2(motion_plan *m, int32_t n){
+	int32_t i = n - m->base, r = m->N - n - 1;
+	double v2 = m->vm2;
+	if(i < m->nacc) v2 = m->v02 + ((double)m->vm2 - m->v02) * shape(m->type, (double)i / m->nacc);
+	if(r < m->ndec){
+		double vd = m->ve2 + ((double)m->vm2 - m->ve2) * shape(m->type, (double)r / m->ndec);
+		if(vd < v2) v2 = vd;
+	}
+	if(v2 < m->vs2) v2 = m->vs2;
+	return v2;
+}
+
+// fill N items like DMA half-transfer interrupt does
+static void gen(int N){
+	motion_plan *m = &mq.m;
+	while(N--){
+		qitem *it = &q[qhead++];
+		uint32_t p = moveq_period(&mq);
+		if(!p){
+			it->p = TAILP;
+			it->ref = 0.;
+			continue;
+		}
+		it->p = p;
+		if(m->cperiod){
+			it->ref = m->cperiod;
+			it->aref = 0.;
+		}else{
+			double v2 = ref_v2(m, m->n - 1);
+			it->ref = m->freq / sqrt(v2);
+			if(it->ref > TAILP) it->ref = TAILP;
+			it->aref = (prevref2 > 0.) ? fabs(v2 - prevref2) / 2. : 0.;
+			prevref2 = v2;
+		}
+	}
+}
+
+typedef struct{
+	int32_t steps, moves;
+	double T, perr, aplan, aexec, aend, jerr;
+	double aover; // max executed acceleration minus rounding tolerance
+	int bad;
+} result;
+
+// start motion from rest
+static void start(){
+	moveq_start(&mq);
+	prevref2 = 0.;
+	qhead = qtail = 0;
+	gen(2 + DMABUF);
+}
+
+static int push(const int32_t *d, int32_t *target){
+	int i;
+	if(!moveq_push(&mq, d)){
+		printf("  can't push segment\n");
+		return 1;
+	}
+	for(i = 0; i < MOVEQ_AXES; ++i) target[i] += d[i];
+	return 0;
+}
+
+// max speed change of axes when speed v1 along segment a is changed to v2 along b
+// (reverse of axis is stop & start: each of them can't be faster than vstart)
+static double jchange(const move_segment *a, double v1, const move_segment *b, double v2){
+	double d, dmax = 0., s1, s2;
+	int i;
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		s1 = v1 * a->d[i] / a->L;
+		s2 = v2 * b->d[i] / b->L;
+		if(s1 * s2 < 0.) d = fmax(fabs(s1), fabs(s2));
+		else d = fabs(s1 - s2);
+		if(d > dmax) dmax = d;
+	}
+	return dmax;
+}
+
+static int run(const test *t, result *res){
+	int32_t target[MOVEQ_AXES] = {0}, pulses[MOVEQ_AXES] = {0}, transfers = 0;
+	int changed = 0, nseg = 0, i;
+	double v2hist[AVG + 1], e2hist[AVG + 1], vprev = 0.; // v^2 & its error by PQUANT
+	int nhist = 0;
+	move_segment prevseg;
+	int prevexec = -1;
+	memset(res, 0, sizeof(result));
+	moveq_init(&mq, t->freq);
+	mq.m.type = t->type;
+	mq.m.vstart = t->vstart;
+	mq.m.vmax = t->vmax;
+	mq.m.accel = t->accel;
+	mq.m.cperiod = t->cperiod;
+	while(nseg < MAXSEGS && t->segs[nseg].at == 0)
+		if(push(t->segs[nseg++].d, target)) return 1;
+	start();
+	++res->moves;
+	while(1){
+		qitem *it = &q[qtail++];
+		double v2;
+		if(it->ref == 0.){
+			printf("  tail period executed at step %d\n", res->steps);
+			return 1;
+		}
+		if(fabs(it->p - it->ref) > res->perr) res->perr = fabs(it->p - it->ref);
+		if(it->p > it->ref * 1.005 + 1. || it->p < it->ref * 0.995 - 1.){
+			printf("  step %d: period %u instead of %.1f\n", res->steps, it->p, it->ref);
+			return 1;
+		}
+		if(it->aref > res->aplan) res->aplan = it->aref;
+		v2 = (double)t->freq * t->freq / ((double)it->p * it->p);
+		double e2 = v2 * 2. * PQUANT / it->p;
+		if(nhist <= AVG){
+			v2hist[nhist] = v2;
+			e2hist[nhist++] = e2;
+		}else{
+			memmove(v2hist, &v2hist[1], AVG * sizeof(double));
+			memmove(e2hist, &e2hist[1], AVG * sizeof(double));
+			v2hist[AVG] = v2;
+			e2hist[AVG] = e2;
+			double a = fabs(v2hist[AVG] - v2hist[0]) / (2. * AVG);
+			if(a > res->aexec) res->aexec = a;
+			a -= (e2hist[AVG] + e2hist[0]) / (2. * AVG);
+			if(a > res->aover) res->aover = a;
+		}
+		if(res->steps == 1 && !t->cperiod) res->aend = fabs(v2 - v2hist[0]) / 2.;
+		// junction of segments: speed of each axis can't change more than by vstart
+		if(prevexec > -1 && prevexec != mq.exec){
+			double j = jchange(&prevseg, vprev, &mq.seg[mq.exec], sqrt(v2)) / t->vstart;
+			if(j > res->jerr) res->jerr = j;
+		}
+		prevexec = mq.exec;
+		prevseg = mq.seg[mq.exec];
+		vprev = sqrt(v2);
+		res->T += (double)it->p / t->freq;
+		for(i = 0; i < MOVEQ_AXES; ++i)
+			if(mq.mask & (1 << i)) pulses[i] += (mq.negmask & (1 << i)) ? -1 : 1;
+		++res->steps;
+		if(out) fprintf(out, "%.6f\t%d\t%d\t%d\t%.1f\n", res->T, pulses[0], pulses[1], pulses[2], sqrt(v2));
+		// main loop: commands while this step runs
+		if(!changed && t->at >= 0 && res->steps == t->at){
+			int32_t d[MOVEQ_AXES] = {t->delta};
+			changed = 1;
+			if(moveq_retarget(&mq, t->delta)) target[0] += t->delta;
+			else if(push(d, target)) return 1;
+		}
+		while(nseg < MAXSEGS && t->segs[nseg].at == res->steps)
+			if(push(t->segs[nseg++].d, target)) return 1;
+		// update event: next period, DMA transfer
+		if(moveq_step(&mq)){
+			if(++transfers % (DMABUF / 2) == 0) gen(DMABUF / 2);
+			continue;
+		}
+		if(moveq_count(&mq)){ // segments added after planner was over
+			start();
+			transfers = 0;
+			nhist = 0;
+			prevexec = -1;
+			++res->moves;
+			continue;
+		}
+		break;
+	}
+	for(i = 0; i < MOVEQ_AXES; ++i){
+		if(pulses[i] != target[i] || mq.pos[i] != target[i]){
+			printf("  axis %d stopped at %d (counted %d) instead of %d\n", i, pulses[i],
+				mq.pos[i], target[i]);
+			return 1;
+		}
+	}
+	if(res->moves != t->moves){
+		printf("  %d starts from rest instead of %d\n", res->moves, t->moves);
+		return 1;
+	}
+	return 0;
+}
+
+int main(int argc, char **argv){
+	int c, failed = 0;
+	size_t i;
+	while((c = getopt(argc, argv, "o:")) != -1){
+		if(c == 'o') out = fopen(optarg, "w");
+		else{
+			fprintf(stderr, "Usage: %s [-o steps.dat]\n", argv[0]);
+			return 1;
+		}
+	}
+	q = malloc(QLEN * sizeof(qitem));
+	if(!q) return 1;
+	printf("%-20s %7s %6s %9s %8s %6s %6s %6s %6s\n", "test", "steps", "moves", "time, s",
+		"perr", "aplan", "aexec", "astart", "jump");
+	for(i = 0; i < sizeof(tests) / sizeof(test); ++i){
+		const test *t = &tests[i];
+		result r;
+		int bad;
+		if(out) fprintf(out, "# %s\n", t->name);
+		bad = run(t, &r);
+		// accelerations in units of limit; plan shouldn't exceed it, execution - by more than
+		// period rounding gives
+		if(!t->cperiod && r.aplan > t->accel * 1.01) bad = 1;
+		if(!t->cperiod && r.aover > t->accel * 1.01){
+			printf("  executed acceleration %.3f of limit is over rounding tolerance\n",
+				r.aover / t->accel);
+			bad = 1;
+		}
+		// axis speed jump at junction in units of vstart
+		if(r.jerr > 1.05) bad = 1;
+		printf("%-20s %7d %6d %9.4f %8.2f %6.3f %6.3f %6.3f %6.3f %s\n", t->name, r.steps, r.moves,
+			r.T, r.perr, r.aplan / t->accel, r.aexec / t->accel, r.aend / t->accel, r.jerr,
+			bad ? "FAIL" : "OK");
+		failed += bad;
+		if(out) fprintf(out, "\n\n");
+	}
+	free(q);
+	if(out) fclose(out);
+	printf("%s\n", failed ? "FAILED" : "All tests passed");
+	return failed;
+}
@@ -23,128 +23,443 @@
 #include "user_proto.h"
 #include <libopencm3/stm32/timer.h>
 
+int32_t stepper_period = STEPPER_DEFAULT_PERIOD + 1; // cruise period (us)
 
-volatile int32_t Glob_steps = 0;
-volatile int Dir = 0; // 0 - stop, 1 - move to +, -1 - move to -
-int32_t stepper_period = STEPPER_DEFAULT_PERIOD;
+static moveq Q;
+// TIM1_ARR values fed by DMA1_Channel5 (TIM1_UP), refilled by halves
+static uint16_t arrbuf[STEPPER_DMABUF_SIZE];
+static uint8_t first = 0; // the first period of motion: its step is prepared by moveq_start
+static volatile uint8_t stopped = 0; // motion is over, report is needed
+static int32_t segment[STEPPER_AXES]; // segment composed by x/y/z commands
+
+/*
+ * TIM1 is the step clock: its update event (TRGO) starts timers of axes (ITR0) which work in
+ * one-pulse mode; each of them gives pulse only if its CCR3 is set before the step
+ */
+typedef struct{
+	uint32_t tim;       // timer of STEP output (CH3)
+	uint32_t dirport;   // DIR pin
+	uint16_t dirpin;
+} axis;
+
+static const axis axes[STEPPER_AXES] = {
+	{TIM2, GPIOB, GPIO11}, // X: PB10 (TIM2 partial remap 2) & PB11
+	{TIM3, GPIOC, GPIO9},  // Y: PC8 (TIM3 full remap) & PC9
+	{TIM4, GPIOB, GPIO9}   // Z: PB8 & PB9
+};
+// CCR3 of axis which shouldn't step (more than ARR)
+#define STEPPER_NOPULSE  (0xffff)
 
 /**
- * Init TIM2_CH3 (& remap to 5V tolerant PB10) [STEP] and PB11 [DIR]
+ * Init TIM1 (step clock), slave timers TIM2..4 [STEP]: TIM2_CH3 (remap to 5V tolerant PB10),
+ * TIM3_CH3 (remap to PC8), TIM4_CH3 (PB8) & their DIR pins
  */
 void steppers_init(){
-	// Turn off JTAG & SWD, remap TIM2_CH3 to PB10 (five tolerant)
-	rcc_peripheral_enable_clock(&RCC_APB2ENR, RCC_APB2ENR_AFIOEN | RCC_APB2ENR_IOPBEN);
-	gpio_primary_remap(AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_OFF, AFIO_MAPR_TIM2_REMAP_PARTIAL_REMAP2);
-	// setup PB10 & PB11 - both opendrain
+	int i;
+	// Turn off JTAG & SWD, remap TIM2_CH3 to PB10 & TIM3_CH3 to PC8 (five tolerant)
+	rcc_peripheral_enable_clock(&RCC_APB2ENR, RCC_APB2ENR_AFIOEN | RCC_APB2ENR_IOPBEN |
+			RCC_APB2ENR_IOPCEN);
+	gpio_primary_remap(AFIO_MAPR_SWJ_CFG_JTAG_OFF_SW_OFF, AFIO_MAPR_TIM2_REMAP_PARTIAL_REMAP2 |
+			AFIO_MAPR_TIM3_REMAP_FULL_REMAP);
+	// setup STEP & DIR pins - all opendrain
 	gpio_set_mode(GPIO_BANK_TIM2_PR2_CH3, GPIO_MODE_OUTPUT_2_MHZ,
 		GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN, GPIO_TIM2_PR2_CH3);
-	//	GPIO_CNF_OUTPUT_ALTFN_PUSHPULL, GPIO_TIM2_PR2_CH3);
-	gpio_set_mode(GPIOB, GPIO_MODE_OUTPUT_2_MHZ,
-		GPIO_CNF_OUTPUT_OPENDRAIN, GPIO11);
+	gpio_set_mode(GPIO_BANK_TIM3_FR_CH3, GPIO_MODE_OUTPUT_2_MHZ,
+		GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN, GPIO_TIM3_FR_CH3);
+	gpio_set_mode(GPIO_BANK_TIM4_CH3, GPIO_MODE_OUTPUT_2_MHZ,
+		GPIO_CNF_OUTPUT_ALTFN_OPENDRAIN, GPIO_TIM4_CH3);
+	rcc_periph_clock_enable(RCC_TIM1);
 	rcc_periph_clock_enable(RCC_TIM2);
-	timer_reset(TIM2);
-	// timers have frequency of 1MHz -- 1us for one step
-	timer_set_mode(TIM2, TIM_CR1_CKD_CK_INT, TIM_CR1_CMS_EDGE, TIM_CR1_DIR_UP);
-	// 36MHz of APB1 x2 = 72MHz
-	TIM2_PSC = STEPPER_TIM_DEFAULT_PRESCALER;  // prescaler is (div - 1)
-	TIM2_CR1 = 0;
-	TIM2_CCER = 0;
-	TIM2_CCMR2 = 0;
-	TIM2_DIER = 0;
-	TIM2_SR = 0; // clear all flags
-	// PWM_OUT for TIM2_CH3
-	TIM2_CCMR2 = TIM_CCMR2_CC3S_OUT | TIM_CCMR2_OC3M_PWM1;
-	// active is low
-	TIM2_CCER = TIM_CCER_CC3E | TIM_CCER_CC3P;
-	// enable update IRQ
-	TIM2_DIER = TIM_DIER_UIE;
-	TIM2_ARR  = STEPPER_DEFAULT_PERIOD;
-	TIM2_CCR3 = STEPPER_PULSE_LEN;
-	nvic_enable_irq(NVIC_TIM2_IRQ);
-}
-
-/**
- * Set stepper period
+	rcc_periph_clock_enable(RCC_TIM3);
+	rcc_periph_clock_enable(RCC_TIM4);
+	rcc_periph_clock_enable(RCC_DMA1);
+	// step clock: 72MHz of APB2
+	timer_reset(TIM1);
+	TIM1_PSC = STEPPER_TIM_DEFAULT_PRESCALER;  // prescaler is (div - 1)
+	TIM1_CR1 = 0;
+	TIM1_DIER = 0;
+	TIM1_SR = 0;
+	TIM1_ARR = STEPPER_DEFAULT_PERIOD;
+	TIM1_CR2 = TIM_CR2_MMS_UPDATE; // update event is TRGO
+	// axes: 36MHz of APB1 x2 = 72MHz -> 1MHz; active (low) from CNT=1 till ARR (PWM2)
+	for(i = 0; i < STEPPER_AXES; ++i){
+		uint32_t t = axes[i].tim;
+		gpio_set_mode(axes[i].dirport, GPIO_MODE_OUTPUT_2_MHZ,
+			GPIO_CNF_OUTPUT_OPENDRAIN, axes[i].dirpin);
+		gpio_set(axes[i].dirport, axes[i].dirpin);
+		timer_reset(t);
+		TIM_PSC(t) = STEPPER_TIM_DEFAULT_PRESCALER;
+		TIM_ARR(t) = STEPPER_PULSE_LEN + 1;
+		TIM_CCR3(t) = STEPPER_NOPULSE;
+		TIM_CCMR2(t) = TIM_CCMR2_CC3S_OUT | TIM_CCMR2_OC3M_PWM2;
+		TIM_CCER(t) = TIM_CCER_CC3E | TIM_CCER_CC3P;
+		TIM_SMCR(t) = TIM_SMCR_SMS_TM | TIM_SMCR_TS_ITR0; // TIM1 TRGO starts counter
+		TIM_EGR(t) = TIM_EGR_UG;
+		TIM_SR(t) = 0;
+		TIM_CR1(t) = TIM_CR1_OPM;
+	}
+	// TIM1_UP - DMA1, channel 5: periods into TIM1_ARR
+	dma_channel_reset(DMA1, DMA_CHANNEL5);
+	DMA1_CPAR5 = (uint32_t) &(TIM1_ARR);
+	DMA1_CMAR5 = (uint32_t) arrbuf;
+	DMA1_CCR5 = DMA_CCR_DIR | DMA_CCR_MINC | DMA_CCR_PSIZE_16BIT | DMA_CCR_MSIZE_16BIT | DMA_CCR_CIRC
+			| DMA_CCR_HTIE | DMA_CCR_TCIE | DMA_CCR_PL_HIGH;
+	// step interrupt can't wait while planner refills buffer; USB polling & commands (SysTick)
+	// can't break any of them
+	nvic_set_priority(NVIC_TIM1_CC_IRQ, 0);
+	nvic_set_priority(NVIC_TIM1_UP_IRQ, 0);
+	nvic_set_priority(NVIC_DMA1_CHANNEL5_IRQ, 16);
+	nvic_set_priority(NVIC_SYSTICK_IRQ, 32);
+	nvic_enable_irq(NVIC_TIM1_CC_IRQ);
+	nvic_enable_irq(NVIC_TIM1_UP_IRQ);
+	nvic_enable_irq(NVIC_DMA1_CHANNEL5_IRQ);
+	moveq_init(&Q, STEPPER_TIM_FREQ);
+	Q.m.vmax = 1000000 / stepper_period;
+}
+
+// commands change queue & planner: turn off its interrupts
+static void irq_off(){
+	nvic_disable_irq(NVIC_TIM1_CC_IRQ);
+	nvic_disable_irq(NVIC_TIM1_UP_IRQ);
+	nvic_disable_irq(NVIC_DMA1_CHANNEL5_IRQ);
+}
+
+static void irq_on(){
+	nvic_enable_irq(NVIC_TIM1_CC_IRQ);
+	nvic_enable_irq(NVIC_TIM1_UP_IRQ);
+	nvic_enable_irq(NVIC_DMA1_CHANNEL5_IRQ);
+}
+
+/**
+ * next value of TIM1_ARR
+ */
+static uint16_t next_arr(){
+	uint32_t p = moveq_period(&Q);
+	if(!p) p = STEPPER_TIM_MAX_ARRVAL; // planner is over: long periods till the timer stops
+	return (uint16_t)(p - 1);
+}
+
+// fill N values of arrbuf from idx
+static void fill_periods(int idx, int N){
+	while(N--) arrbuf[idx++] = next_arr();
+}
+
+/**
+ * Prepared step will be done on next update event: set directions & enable pulses of axes
+ */
+static void prepare_step(){
+	int i;
+	for(i = 0; i < STEPPER_AXES; ++i){
+		if(!(Q.mask & (1 << i))){
+			TIM_CCR3(axes[i].tim) = STEPPER_NOPULSE;
+			continue;
+		}
+		if(Q.negmask & (1 << i)) gpio_clear(axes[i].dirport, axes[i].dirpin);
+		else gpio_set(axes[i].dirport, axes[i].dirpin);
+		TIM_CCR3(axes[i].tim) = 1;
+	}
+	if(moveq_last(&Q)){ // the last step: stop at update event
+		TIM1_CR1 |= TIM_CR1_OPM;
+		TIM1_SR = ~TIM_SR_UIF;
+		TIM1_DIER |= TIM_DIER_UIE;
+	}
+}
+
+/**
+ * Start motion from rest: first two periods go to ARR (active & preload), the rest -
+ * to DMA buffer; slaves get first step in CC1 interrupt (the pulse of previous motion could
+ * be not finished yet)
+ */
+static void start_motion(){
+	TIM1_CR1 = 0;
+	TIM1_DIER = 0;
+	DMA1_CCR5 &= ~DMA_CCR_EN;
+	moveq_start(&Q);
+	if(Q.m.freq == STEPPER_TIM_FREQ){
+		TIM1_PSC = STEPPER_TIM_DEFAULT_PRESCALER;
+		TIM1_CCR1 = STEPPER_PULSE_LEN + 10; // after the end of step pulse
+	}else{
+		TIM1_PSC = STEPPER_TIM_HUNDR_PRESCALER;
+		TIM1_CCR1 = 1;
+	}
+	TIM1_CR2 = TIM_CR2_MMS_ENABLE; // UG shouldn't start slaves
+	TIM1_CR1 = TIM_CR1_ARPE; // bufferize ARR
+	TIM1_ARR = next_arr();
+	TIM1_EGR = TIM_EGR_UG; // load PSC & ARR
+	TIM1_SR = 0;
+	TIM1_CR2 = TIM_CR2_MMS_UPDATE;
+	TIM1_ARR = next_arr(); // preload: the second period
+	fill_periods(0, STEPPER_DMABUF_SIZE);
+	DMA1_IFCR = DMA_IFCR_CGIF5;
+	DMA1_CNDTR5 = STEPPER_DMABUF_SIZE;
+	DMA1_CCR5 |= DMA_CCR_EN;
+	first = 1;
+	TIM1_DIER = TIM_DIER_UDE | TIM_DIER_CC1IE;
+	TIM1_CR1 |= TIM_CR1_CEN;
+}
+
+// turn off step clock (slaves can't start without it)
+static void stop_clock(){
+	TIM1_DIER = 0;
+	TIM1_CR1 = 0;
+	DMA1_CCR5 &= ~DMA_CCR_EN;
+	TIM1_SR = 0;
+}
+
+/**
+ * Set stepper period (cruise speed); periods longer than 65.5ms use 10kHz timer clock
+ * and can't be changed while moving
  */
 uint8_t set_stepper_speed(int32_t Period){
 	if(Period > STEPPER_MIN_PERIOD && Period < STEPPER_MAX_PERIOD){
-		P("Set stepper period to ");
+		uint32_t freq = STEPPER_TIM_FREQ, speed = 1000000 / Period;
 		if(Period > STEPPER_TIM_MAX_ARRVAL){ // redefine prescaler when value is too large
-			TIM2_PSC = STEPPER_TIM_HUNDR_PRESCALER;
-			Period /= 100;
-			print_int(Period*100);
-			TIM2_ARR = --Period;
-		}else{ // default prescaler - for 1MHz
-			print_int(Period);
-			TIM2_PSC = STEPPER_TIM_DEFAULT_PRESCALER;
-			TIM2_ARR = --Period;
+			freq /= 100;
+			Period = Period / 100 * 100;
 		}
-		stepper_period = Period;
+		if(Q.moving && (freq != Q.m.freq || Q.m.cperiod || speed <= Q.m.vstart)){
+			P("Can't change to/from constant speed while moving\n");
+			return 0;
+		}
+		P("Set stepper period to ");
+		print_int(Period);
 		newline();
+		stepper_period = Period;
+		irq_off();
+		Q.m.freq = freq;
+		if(speed > Q.m.vstart){
+			Q.m.vmax = speed;
+			Q.m.cperiod = 0;
+		}else{ // too slow for ramps
+			Q.m.vmax = Q.m.vstart;
+			Q.m.cperiod = Period / (1000000 / freq);
+		}
+		// new speed on the fly (for several segments - from the next one)
+		if(Q.moving) moveq_retarget(&Q, 0);
+		irq_on();
+	}
+	return 0;
+}
+
+/**
+ * Set acceleration (steps/s^2)
+ */
+uint8_t set_stepper_accel(int32_t A){
+	if(A < 1 || A > MOTION_MAX_ACCEL){
+		P("Wrong acceleration\n");
+		return 0;
+	}
+	if(Q.moving){
+		P("Can't change acceleration while moving\n");
+		return 0;
+	}
+	Q.m.accel = A;
+	P("Set acceleration to ");
+	print_int(A);
+	newline();
+	return 0;
+}
+
+/**
+ * Set start/stop speed (steps/s)
+ */
+uint8_t set_stepper_vstart(int32_t V){
+	if(V < 1 || V > MOTION_MAX_SPEED){
+		P("Wrong speed\n");
+		return 0;
+	}
+	if(Q.moving){
+		P("Can't change start speed while moving\n");
+		return 0;
+	}
+	Q.m.vstart = V;
+	P("Set start speed to ");
+	print_int(V);
+	newline();
+	return 0;
+}
+
+/**
+ * Set profile type: 0 - trapezoid, 1 - S-curve
+ */
+uint8_t set_stepper_profile(int32_t type){
+	if(Q.moving){
+		P("Can't change profile while moving\n");
+		return 0;
 	}
+	Q.m.type = type ? PROFILE_SCURVE : PROFILE_TRAPEZOID;
+	if(type) P("S-curve profile\n");
+	else P("Trapezoidal profile\n");
 	return 0;
 }
 
+/**
+ * Stop all axes & clear queue
+ */
 void stop_stepper(){
-	TIM2_CCR3 = 0;
-	TIM2_CR1 = 0;
-	Glob_steps = 0;
-	Dir = 0;
-	gpio_set(GPIOB, GPIO11); // clear "direction"
+	irq_off();
+	stop_clock();
+	moveq_clear(&Q);
+	irq_on();
 	P("Stopped!\n");
 }
 
 /**
- * move stepper motor to N steps
- * if motor is moving - just add Nsteps to current counter
+ * Add segment to queue, start motion if stopped (interrupts should be off)
+ */
+static uint8_t push_segment(const int32_t *d){
+	if(!moveq_push(&Q, d)){
+		P("Queue is full\n");
+		return 0;
+	}
+	if(!Q.moving) start_motion();
+	return 1;
+}
+
+/**
+ * move stepper X to N steps
+ * if it is the only axis moving - just shift its target by Nsteps (speed profile is
+ * recalculated, if the target became closer than stopping distance the motor stops &
+ * returns back), else add a segment to queue
  */
 uint8_t move_stepper(int32_t Nsteps){
-	int dir = 1;
+	int32_t d[STEPPER_AXES] = {Nsteps};
 	if(!Nsteps) return 0;
-	if(TIM2_CR1){ // moving
-		if(!gpio_get(GPIOB, GPIO11)) dir = 0; // negative direction
-		Glob_steps += Nsteps;
-		if(Glob_steps < 0){
-			Glob_steps = -Glob_steps;
-			dir = !dir;
-		}
-	}else{ // start timer if not moving
-		if(Nsteps < 0){ // change direction
-			dir = 0;
-			Nsteps = -Nsteps;
-		}
-		Glob_steps = Nsteps;
-		TIM2_ARR = stepper_period;
-		TIM2_CCR3 = STEPPER_PULSE_LEN;
-		TIM2_CR1 = TIM_CR1_CEN;
-	}
-	// set/clear direction
-	P("Rotate ");
-	if(dir){
-		gpio_set(GPIOB, GPIO11);
-	}else{
-		gpio_clear(GPIOB, GPIO11);
-		P("counter-");
+	irq_off();
+	if(!moveq_retarget(&Q, Nsteps)) push_segment(d);
+	irq_on();
+	P("Steps left: ");
+	print_int(stepper_get_steps());
+	newline();
+	return 0;
+}
+
+// set component of segment
+static void set_segment(int i, int32_t N){
+	segment[i] = N;
+	P("Segment: ");
+	for(i = 0; i < STEPPER_AXES; ++i){
+		print_int(segment[i]);
+		usb_send(' ');
 	}
-	P("clockwise to ");
-	print_int(Glob_steps);
-	P(" steps\n");
+	newline();
+}
+
+uint8_t set_segment_x(int32_t N){
+	set_segment(0, N);
+	return 0;
+}
+
+uint8_t set_segment_y(int32_t N){
+	set_segment(1, N);
+	return 0;
+}
+
+uint8_t set_segment_z(int32_t N){
+	set_segment(2, N);
 	return 0;
 }
 
-void tim2_isr(){
-	// Next step
-	if(TIM2_SR & TIM_SR_UIF){
-		if(--Glob_steps < 1){ // stop timer as steps ends
-			stop_stepper();
+/**
+ * Add segment composed by x/y/z commands to queue; consecutive segments are blended: speed
+ * at their junction is limited only by speed change of each axis (not more than start speed)
+ */
+void queue_segment(){
+	int i;
+	uint8_t ok;
+	irq_off();
+	ok = push_segment(segment);
+	i = moveq_count(&Q);
+	irq_on();
+	if(!ok) return;
+	P("Segments in queue: ");
+	print_int(i);
+	newline();
+	for(i = 0; i < STEPPER_AXES; ++i) segment[i] = 0;
+}
+
+/**
+ * Show positions of all axes & queue length
+ */
+void show_coordinates(){
+	int i;
+	for(i = 0; i < STEPPER_AXES; ++i){
+		usb_send('X' + i);
+		usb_send('=');
+		print_int(Q.pos[i]);
+		usb_send(' ');
+	}
+	P("queue: ");
+	print_int(moveq_count(&Q));
+	newline();
+}
+
+/**
+ * Steps of dominant axes left till the end of queue (approx. - segments may change)
+ */
+int32_t stepper_get_steps(){
+	int32_t N;
+	uint8_t i;
+	irq_off();
+	N = Q.moving ? Q.left : 0;
+	for(i = MOVEQ_NEXT(Q.exec); i != Q.head; i = MOVEQ_NEXT(i)) N += Q.seg[i].L;
+	if(!Q.moving && Q.exec != Q.head) N += Q.seg[Q.exec].L;
+	irq_on();
+	return N;
+}
+
+/**
+ * CC1: some time after update event (the step of previous period & its pulse are done):
+ * count step & set up the next one
+ */
+void tim1_cc_isr(){
+	if(TIM1_SR & TIM_SR_CC1IF){
+		TIM1_SR = ~TIM_SR_CC1IF;
+		if(first) first = 0;
+		else moveq_step(&Q);
+		prepare_step();
+	}
+}
+
+/**
+ * Update event after the last step (timer stopped itself by OPM): start again if
+ * segments were added after planner was over
+ */
+void tim1_up_isr(){
+	if(TIM1_SR & TIM_SR_UIF){
+		TIM1_SR = ~TIM_SR_UIF;
+		if(moveq_step(&Q)) return;
+		if(moveq_count(&Q)) start_motion();
+		else{
+			stop_clock();
+			stopped = 1;
 		}
 	}
-	TIM2_SR = 0;
 }
 
+/**
+ * DMA: half of periods buffer is loaded into ARR, calculate next
+ */
+void dma1_channel5_isr(){
+	if(DMA1_ISR & DMA_ISR_HTIF5){
+		DMA1_IFCR = DMA_IFCR_CHTIF5;
+		fill_periods(0, STEPPER_DMABUF_SIZE / 2);
+	}
+	if(DMA1_ISR & DMA_ISR_TCIF5){
+		DMA1_IFCR = DMA_IFCR_CTCIF5;
+		fill_periods(STEPPER_DMABUF_SIZE / 2, STEPPER_DMABUF_SIZE / 2);
+	}
+}
+
+/**
+ * Report end of motion (from main loop: USB can't be used in step interrupt)
+ */
+void check_stepper_stop(){
+	if(!stopped) return;
+	stopped = 0;
+	P("Stopped!\n");
+}
 
 int32_t stepper_get_period(){
-	int32_t r = stepper_period + 1;
-	if(TIM2_PSC == STEPPER_TIM_DEFAULT_PRESCALER) return r;
-	else return r * 100;
+	return stepper_period;
 }
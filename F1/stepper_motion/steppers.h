@@ -23,27 +23,42 @@
 #define __STEPPERS_H__
 
 #include "main.h"
+#include "moveq.h"
 // minimal period - 100us (10000ticks per second)
 #define STEPPER_MIN_PERIOD      (99)
 // default period
 #define STEPPER_DEFAULT_PERIOD  (1299)
 // high (off) pulse length: 70us (minimum value according documentation is 0.5us)
 #define STEPPER_PULSE_LEN       (69)
-// TIM2 have 16bit ARR register, so max P with fixed prescaler is 65536
+// TIM1 have 16bit ARR register, so max P with fixed prescaler is 65536
 #define STEPPER_TIM_MAX_ARRVAL  (65536)
 // max period allowed: 6553600us = 6.5s
 #define STEPPER_MAX_PERIOD      (6553601)
 // default prescaler for 1MHz
 #define STEPPER_TIM_DEFAULT_PRESCALER  (71)
-// prescaler for 100kHz
+// prescaler for 10kHz
 #define STEPPER_TIM_HUNDR_PRESCALER    (7199)
+// timer frequency with default prescaler
+#define STEPPER_TIM_FREQ        (1000000)
+// size of DMA buffer with periods (steps)
+#define STEPPER_DMABUF_SIZE     (32)
+// axes amount
+#define STEPPER_AXES            MOVEQ_AXES
 void steppers_init();
 
 uint8_t set_stepper_speed(int32_t Period);
+uint8_t set_stepper_accel(int32_t A);
+uint8_t set_stepper_vstart(int32_t V);
+uint8_t set_stepper_profile(int32_t type);
 uint8_t move_stepper(int32_t Nsteps);
+uint8_t set_segment_x(int32_t N);
+uint8_t set_segment_y(int32_t N);
+uint8_t set_segment_z(int32_t N);
+void queue_segment();
+void show_coordinates();
 void stop_stepper();
-extern volatile int32_t Glob_steps;
-#define stepper_get_steps()  (Glob_steps)
+void check_stepper_stop();
+int32_t stepper_get_steps();
 
 extern int32_t stepper_period;
 int32_t stepper_get_period();
@@ -40,13 +40,19 @@ intfun I = NULL; // function to process entered integer
 #define READINT() do{i += read_int(&buf[i+1], len-i-1);}while(0)
 
 void help(){
-	P("G\tgo to N steps\n");
+	P("A\tset acceleration (steps/s^2)\n");
+	P("C\tshow coordinates & queue length\n");
+	P("G\tmove X to N steps (shift target if moving alone)\n");
 	P("H\tshow this help\n");
+	P("M\tset profile: 0 - trapezoid, 1 - S-curve\n");
 	P("P\tset stepper period (us)\n");
+	P("Q\tqueue segment composed by x, y, z\n");
 	P("S\tstop motor\n");
 	P("T\tshow current approx. time\n");
-	P("W\tshow current steps value\n");
+	P("V\tset start/stop speed (steps/s)\n");
+	P("W\tshow steps left\n");
 	P("X\tshow current stepper period\n");
+	P("x,y,z\tset steps of axis for next segment\n");
 }
 
 
@@ -71,6 +77,13 @@ int parse_incoming_buf(char *buf, int len){
 		command = buf[i];
 		if(!command) continue; // omit zero
 		switch (command){
+			case 'A':
+				I = set_stepper_accel;
+				READINT();
+			break;
+			case 'C':
+				show_coordinates();
+			break;
 			case 'G':
 				I = move_stepper;
 				READINT();
@@ -78,10 +91,17 @@ int parse_incoming_buf(char *buf, int len){
 			case 'H': // show help
 				help();
 			break;
+			case 'M':
+				I = set_stepper_profile;
+				READINT();
+			break;
 			case 'P':
 				I = set_stepper_speed;
 				READINT();
 			break;
+			case 'Q':
+				queue_segment();
+			break;
 			case 'S':
 				stop_stepper();
 			break;
@@ -90,6 +110,10 @@ int parse_incoming_buf(char *buf, int len){
 				print_int(Timer); // be careful for Time >= 2^{31}!!!
 				newline();
 			break;
+			case 'V':
+				I = set_stepper_vstart;
+				READINT();
+			break;
 			case 'W':
 				print_int(stepper_get_steps());
 				newline();
@@ -98,6 +122,18 @@ int parse_incoming_buf(char *buf, int len){
 				print_int(stepper_get_period());
 				newline();
 			break;
+			case 'x':
+				I = set_segment_x;
+				READINT();
+			break;
+			case 'y':
+				I = set_segment_y;
+				READINT();
+			break;
+			case 'z':
+				I = set_segment_z;
+				READINT();
+			break;
 			case '\n': // show newline, space and tab as is
 			case '\r':
 			case ' ':